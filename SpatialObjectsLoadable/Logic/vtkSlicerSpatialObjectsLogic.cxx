@@ -20,27 +20,57 @@
 #include "vtkSlicerSpatialObjectsLogic.h"
 
 // MRML includes
+#include <vtkMRMLColorNode.h>
 #include <vtkMRMLConfigure.h>
+#include <vtkMRMLScene.h>
+#include "vtkMRMLSpatialObjectsDisplayNode.h"
 #include "vtkMRMLSpatialObjectsDisplayPropertiesNode.h"
 #include "vtkMRMLSpatialObjectsNode.h"
 #include "vtkMRMLSpatialObjectsStorageNode.h"
 #include "vtkMRMLSpatialObjectsLineDisplayNode.h"
 #include "vtkMRMLSpatialObjectsTubeDisplayNode.h"
 #include "vtkMRMLSpatialObjectsGlyphDisplayNode.h"
+#include "vtkMRMLSpatialObjectsHighlightDisplayNode.h"
+#include "vtkSlicerSpatialObjectsMeshWriter.h"
+#include "vtkSpatialObjectsTrace.h"
 
 // VTK includes
+#include <vtkCollection.h>
 #include <vtkNew.h>
+#include <vtkPolyData.h>
 
 // ITK includes
 #include <itksys/Directory.hxx>
 #include <itksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Tube index and cache written next to the .tre files by
+// vtkMRMLSpatialObjectsStorageNode: their names contain ".tre" too.
+bool IsSidecarFile(const std::string& filename)
+{
+  const std::string extension =
+    itksys::SystemTools::GetFilenameLastExtension(filename);
+  return extension == ".idx" || extension == ".cache";
+}
+
+} // end of anonymous namespace
+
 vtkCxxRevisionMacro(vtkSlicerSpatialObjectsLogic, "$Revision: 1.9.12.1 $");
 vtkStandardNewMacro(vtkSlicerSpatialObjectsLogic);
 
 //------------------------------------------------------------------------------
 vtkSlicerSpatialObjectsLogic::vtkSlicerSpatialObjectsLogic()
-{}
+{
+  this->DefaultSpatialObjectPolicy =
+    vtkMRMLSpatialObjectsNode::spatialObjectPolicyKeep;
+  this->MergeOnLoad = false;
+}
 
 //------------------------------------------------------------------------------
 vtkSlicerSpatialObjectsLogic::~vtkSlicerSpatialObjectsLogic()
@@ -56,15 +86,21 @@ int vtkSlicerSpatialObjectsLogic::AddSpatialObjects(const char* dirname,
  
   int nfiles = dir.GetNumberOfFiles();
   int res = 1;
+  std::vector<std::string> mergedFiles;
   for (int i = 0; i < nfiles; ++i) {
     const char* filename = dir.GetFile(i);
     std::string sname = filename;
-    if (!itksys::SystemTools::FileIsDirectory(filename))
+    if (!itksys::SystemTools::FileIsDirectory(filename) &&
+        !IsSidecarFile(sname))
       {
       if (sname.find(ssuf) != std::string::npos)
         {
         std::string fullPath = std::string(dir.GetPath()) + "/" + filename;
-        if (this->AddSpatialObject(fullPath.c_str()) == NULL)
+        if (this->MergeOnLoad)
+          {
+          mergedFiles.push_back(fullPath);
+          }
+        else if (this->AddSpatialObject(fullPath.c_str()) == NULL)
           {
           res = 0;
           }
@@ -72,7 +108,8 @@ int vtkSlicerSpatialObjectsLogic::AddSpatialObjects(const char* dirname,
       }
   }
 
-  return res;
+  return this->MergeOnLoad ?
+    this->MergeSpatialObjectsFiles(dirname, mergedFiles) : res;
 }
 
 //------------------------------------------------------------------------------
@@ -84,12 +121,14 @@ AddSpatialObjects(const char* dirname, std::vector<std::string> suffix)
  
   int nfiles = dir.GetNumberOfFiles();
   int res = 1;
+  std::vector<std::string> mergedFiles;
 
   for (int i = 0; i < nfiles; ++i) {
     const char* filename = dir.GetFile(i);
     std::string name = filename;
 
-    if (!itksys::SystemTools::FileIsDirectory(filename))
+    if (!itksys::SystemTools::FileIsDirectory(filename) &&
+        !IsSidecarFile(name))
       {
       for (unsigned int s = 0; s < suffix.size(); ++s)
         {
@@ -98,44 +137,131 @@ AddSpatialObjects(const char* dirname, std::vector<std::string> suffix)
           {
           std::string fullPath = std::string(dir.GetPath()) + "/" + filename;
 
-          if (this->AddSpatialObject(fullPath.c_str()) == NULL)
+          if (this->MergeOnLoad)
+            {
+            mergedFiles.push_back(fullPath);
+            }
+          else if (this->AddSpatialObject(fullPath.c_str()) == NULL)
             {
             res = 0;
             }
+          // A file matching several suffixes is read once, its tubes
+          // would be merged twice otherwise.
+          break;
           }
         }
       }
   }
 
-  return res;
+  return this->MergeOnLoad ?
+    this->MergeSpatialObjectsFiles(dirname, mergedFiles) : res;
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsLogic::
+MergeSpatialObjectsFiles(const char* dirname,
+                        std::vector<std::string>& filenames)
+{
+  if (filenames.empty())
+    {
+    return 1;
+    }
+  // Directory listings are not sorted, the source file indices are.
+  std::sort(filenames.begin(), filenames.end());
+  std::string name = itksys::SystemTools::GetFilenameName(
+    itksys::SystemTools::CollapseFullPath(dirname));
+  if (name.empty())
+    {
+    name = "SpatialObjects";
+    }
+  return this->AddMergedSpatialObjects(filenames, name.c_str()) != NULL;
 }
 
 //------------------------------------------------------------------------------
 vtkMRMLSpatialObjectsNode*
 vtkSlicerSpatialObjectsLogic::AddSpatialObject(const char* filename)
 {
+  return this->AddSpatialObject(filename, 0);
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode* vtkSlicerSpatialObjectsLogic::
+AddSpatialObject(const char* filename,
+                 vtkMRMLSpatialObjectsStorageNode* readOptions)
+{
+  vtkSpatialObjectsTraceScope("vtkSlicerSpatialObjectsLogic::AddSpatialObject");
   vtkDebugMacro("Adding spatial objects from filename " << filename);
 
-  vtkNew<vtkMRMLSpatialObjectsNode> spatialObjectsNode;
   vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->CopyReadOptions(readOptions);
+  storageNode->SetFileName(filename);
+  // Like the tube index, the cache is kept next to the file: the scenes
+  // are restored without converting the file again.
+  storageNode->SetUseCache(true);
+
+  const itksys_stl::string fname(filename);
+  itksys_stl::string name =
+    itksys::SystemTools::GetFilenameWithoutExtension(fname);
+  return this->AddSpatialObject(storageNode.GetPointer(), name.c_str());
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode* vtkSlicerSpatialObjectsLogic::
+AddMergedSpatialObjects(const std::vector<std::string>& filenames,
+                        const char* name,
+                        vtkMRMLSpatialObjectsStorageNode* readOptions)
+{
+  vtkSpatialObjectsTraceScope("vtkSlicerSpatialObjectsLogic::AddMergedSpatialObjects");
+
+  if (filenames.empty() || name == NULL)
+    {
+    return 0;
+    }
+
+  // The files are read from the file list, the merged tubes are saved
+  // next to the first file.
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->CopyReadOptions(readOptions);
+  for (size_t i = 0; i < filenames.size(); ++i)
+    {
+    storageNode->AddFileName(filenames[i].c_str());
+    }
+  const std::string directory =
+    itksys::SystemTools::GetFilenamePath(filenames[0]);
+  const std::string filename =
+    (directory.empty() ? name : directory + "/" + name) + ".tre";
+  storageNode->SetFileName(filename.c_str());
+
+  return this->AddSpatialObject(storageNode.GetPointer(), name);
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode* vtkSlicerSpatialObjectsLogic::
+AddSpatialObject(vtkMRMLSpatialObjectsStorageNode* storageNode,
+                 const char* name)
+{
+  vtkNew<vtkMRMLSpatialObjectsNode> spatialObjectsNode;
   vtkNew<vtkMRMLSpatialObjectsLineDisplayNode> displayLineNode;
   vtkNew<vtkMRMLSpatialObjectsTubeDisplayNode> displayTubeNode;
   vtkNew<vtkMRMLSpatialObjectsGlyphDisplayNode> displayGlyphNode;
 
-  vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> lineProperties;
-  vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> tubeProperties;
+  vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> defaultProperties;
   vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphProperties;
   glyphProperties->SetGlyphGeometry(
     vtkMRMLSpatialObjectsDisplayPropertiesNode::Lines);
 
-  storageNode->SetFileName(filename);
-  if (storageNode->ReadData(spatialObjectsNode.GetPointer()) != 0)
+  spatialObjectsNode->SetSpatialObjectPolicy(this->DefaultSpatialObjectPolicy);
+
+  // The display pipelines are updated once, when the nodes are all set up.
+  spatialObjectsNode->StartBatchUpdate();
+  displayLineNode->StartBatchUpdate();
+  displayTubeNode->StartBatchUpdate();
+  displayGlyphNode->StartBatchUpdate();
+
+  const bool read = storageNode->ReadData(spatialObjectsNode.GetPointer()) != 0;
+  if (read)
     {
-    const itksys_stl::string fname(filename);
-    itksys_stl::string name =
-      itksys::SystemTools::GetFilenameWithoutExtension(fname);
-    std::string uname(
-      this->GetMRMLScene()->GetUniqueNameByString(name.c_str()));
+    std::string uname(this->GetMRMLScene()->GetUniqueNameByString(name));
     spatialObjectsNode->SetName(uname.c_str());
    
     spatialObjectsNode->SetScene(this->GetMRMLScene());
@@ -149,21 +275,25 @@ vtkSlicerSpatialObjectsLogic::AddSpatialObject(const char* filename)
     displayGlyphNode->SetVisibility(0);
 
     this->GetMRMLScene()->SaveStateForUndo();
-    this->GetMRMLScene()->AddNode(lineProperties.GetPointer());
-    this->GetMRMLScene()->AddNode(tubeProperties.GetPointer());
-    this->GetMRMLScene()->AddNode(glyphProperties.GetPointer());
 
+    // The display nodes of all the spatial objects with the default
+    // settings share the same properties nodes.
+    vtkMRMLSpatialObjectsDisplayPropertiesNode* properties =
+      vtkMRMLSpatialObjectsDisplayPropertiesNode::GetSharedNode(
+        this->GetMRMLScene(), defaultProperties.GetPointer());
     displayLineNode->
       SetAndObserveSpatialObjectsDisplayPropertiesNodeID(
-        lineProperties->GetID());
+        properties->GetID());
     displayTubeNode->
       SetAndObserveSpatialObjectsDisplayPropertiesNodeID(
-        tubeProperties->GetID());
+        properties->GetID());
+    properties = vtkMRMLSpatialObjectsDisplayPropertiesNode::GetSharedNode(
+      this->GetMRMLScene(), glyphProperties.GetPointer());
     displayGlyphNode->
       SetAndObserveSpatialObjectsDisplayPropertiesNodeID(
-        glyphProperties->GetID());
+        properties->GetID());
  
-    this->GetMRMLScene()->AddNode(storageNode.GetPointer());
+    this->GetMRMLScene()->AddNode(storageNode);
     this->GetMRMLScene()->AddNode(displayLineNode.GetPointer());
     this->GetMRMLScene()->AddNode(displayTubeNode.GetPointer());
     this->GetMRMLScene()->AddNode(displayGlyphNode.GetPointer());
@@ -178,15 +308,22 @@ vtkSlicerSpatialObjectsLogic::AddSpatialObject(const char* filename)
     spatialObjectsNode->AddAndObserveDisplayNodeID(displayGlyphNode->GetID());
 
     this->GetMRMLScene()->AddNode(spatialObjectsNode.GetPointer());
-    this->Modified();
     }
-  else
+
+  // First the inputs of the display nodes, then their pipelines.
+  spatialObjectsNode->EndBatchUpdate();
+  displayLineNode->EndBatchUpdate();
+  displayTubeNode->EndBatchUpdate();
+  displayGlyphNode->EndBatchUpdate();
+
+  if (!read)
     {
     vtkErrorMacro("Couldn't read file, returning null SpatialObjectsNode: "
-                  << filename);
+                  << storageNode->GetFileName());
     return 0;
     }
 
+  this->Modified();
   return spatialObjectsNode.GetPointer();
 }
 
@@ -221,6 +358,214 @@ SaveSpatialObject(const char* filename,
   return storageNode->WriteData(spatialObjectsNode);
 }
 
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsLogic::
+ExportSpatialObject(const char* filename,
+                    vtkMRMLSpatialObjectsNode* spatialObjectsNode,
+                    int geometry)
+{
+  if (spatialObjectsNode == NULL || filename == NULL ||
+      spatialObjectsNode->GetPolyData() == NULL)
+    {
+    return 0;
+    }
+
+  vtkNew<vtkSlicerSpatialObjectsMeshWriter> writer;
+  writer->SetFileName(filename);
+  writer->SetGeometry(geometry);
+  // Only the lines of the visible tubes
+  writer->SetInput(spatialObjectsNode->GetFilteredPolyData());
+
+  vtkMRMLSpatialObjectsDisplayNode* displayNode = NULL;
+  switch (geometry)
+    {
+    case vtkSlicerSpatialObjectsMeshWriter::Lines:
+      displayNode = spatialObjectsNode->GetLineDisplayNode();
+      break;
+    case vtkSlicerSpatialObjectsMeshWriter::Tubes:
+      displayNode = spatialObjectsNode->GetTubeDisplayNode();
+      break;
+    default:
+      displayNode = spatialObjectsNode->GetGlyphDisplayNode();
+      break;
+    }
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* propertiesNode =
+    displayNode ? displayNode->GetSpatialObjectsDisplayPropertiesNode() :
+    NULL;
+  if (geometry == vtkSlicerSpatialObjectsMeshWriter::Glyphs)
+    {
+    if (propertiesNode == NULL)
+      {
+      vtkErrorMacro("ExportSpatialObject: no glyph display properties");
+      return 0;
+      }
+    writer->SetGlyphSource(propertiesNode->GetGlyphSource());
+    writer->SetGlyphScaleFactor(propertiesNode->GetGlyphScaleFactor());
+    }
+
+  vtkMRMLSpatialObjectsTubeDisplayNode* tubeDisplayNode =
+    vtkMRMLSpatialObjectsTubeDisplayNode::SafeDownCast(displayNode);
+  if (tubeDisplayNode)
+    {
+    writer->SetTubeRadius(tubeDisplayNode->GetTubeRadius());
+    writer->SetTubeNumberOfSides(tubeDisplayNode->GetTubeNumberOfSides());
+    }
+
+  // Bake the colors displayed: the scalars through the color node, or the
+  // solid color.
+  if (displayNode)
+    {
+    writer->BakeColorsOn();
+    writer->SetColor(displayNode->GetColor());
+    writer->SetOpacity(displayNode->GetOpacity());
+    vtkMRMLColorNode* colorNode = displayNode->GetColorNode();
+    if (displayNode->GetScalarVisibility() &&
+        displayNode->GetActiveScalarName() && colorNode)
+      {
+      writer->SetScalarArrayName(displayNode->GetActiveScalarName());
+      writer->SetLookupTable(colorNode->GetScalarsToColors());
+      writer->SetScalarRange(displayNode->GetScalarRange());
+      }
+    }
+
+  return writer->Write();
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsLogic::
+GetSceneMemoryUsage(std::map<std::string, unsigned long>& usage)
+{
+  if (!this->GetMRMLScene())
+    {
+    return;
+    }
+
+  vtkCollection* nodes =
+    this->GetMRMLScene()->GetNodesByClass("vtkMRMLSpatialObjectsNode");
+  for (int i = 0; i < nodes->GetNumberOfItems(); ++i)
+    {
+    vtkMRMLSpatialObjectsNode* spatialObjectsNode =
+      vtkMRMLSpatialObjectsNode::SafeDownCast(nodes->GetItemAsObject(i));
+    if (spatialObjectsNode)
+      {
+      spatialObjectsNode->GetMemoryUsage(usage);
+      }
+    }
+  nodes->Delete();
+}
+
+//------------------------------------------------------------------------------
+unsigned long vtkSlicerSpatialObjectsLogic::GetSceneMemorySize()
+{
+  std::map<std::string, unsigned long> usage;
+  this->GetSceneMemoryUsage(usage);
+
+  unsigned long size = 0;
+  for (std::map<std::string, unsigned long>::const_iterator it =
+         usage.begin(); it != usage.end(); ++it)
+    {
+    size += it->second;
+    }
+
+  return size;
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsLogic::
+ReleaseHiddenDisplayPipelines(double minimumHiddenTime,
+                              unsigned long memoryBudget)
+{
+  if (!this->GetMRMLScene())
+    {
+    return 0;
+    }
+
+  // Sort the hidden display nodes, the longest hidden first.
+  std::multimap<double, vtkMRMLSpatialObjectsDisplayNode*> hiddenNodes;
+  vtkCollection* nodes =
+    this->GetMRMLScene()->GetNodesByClass("vtkMRMLSpatialObjectsDisplayNode");
+  for (int i = 0; i < nodes->GetNumberOfItems(); ++i)
+    {
+    vtkMRMLSpatialObjectsDisplayNode* displayNode =
+      vtkMRMLSpatialObjectsDisplayNode::SafeDownCast(
+        nodes->GetItemAsObject(i));
+    if (displayNode && displayNode->IsPipelineAllocated() &&
+        !displayNode->GetVisibility() &&
+        displayNode->GetHiddenTime() >= minimumHiddenTime)
+      {
+      hiddenNodes.insert(
+        std::make_pair(-displayNode->GetHiddenTime(), displayNode));
+      }
+    }
+
+  // The scene size is computed once, then decreased by the memory each
+  // release frees: buffers shared with other nodes (e.g. the glyph source
+  // of the display properties) stay counted.
+  unsigned long sceneSize = memoryBudget > 0 ? this->GetSceneMemorySize() : 0;
+  int released = 0;
+  for (std::multimap<double, vtkMRMLSpatialObjectsDisplayNode*>::iterator
+         it = hiddenNodes.begin(); it != hiddenNodes.end(); ++it)
+    {
+    if (memoryBudget > 0 && sceneSize <= memoryBudget)
+      {
+      break;
+      }
+    vtkMRMLSpatialObjectsDisplayNode::MemoryUsageType usage;
+    it->second->GetMemoryUsage(usage);
+    if (!it->second->ReleasePipeline(minimumHiddenTime))
+      {
+      continue;
+      }
+    ++released;
+
+    vtkMRMLSpatialObjectsDisplayNode::MemoryUsageType releasedUsage;
+    it->second->GetMemoryUsage(releasedUsage);
+    for (vtkMRMLSpatialObjectsDisplayNode::MemoryUsageType::const_iterator
+           bufferIt = usage.begin(); bufferIt != usage.end(); ++bufferIt)
+      {
+      const unsigned long freed =
+        bufferIt->second - std::min(bufferIt->second,
+                                    releasedUsage[bufferIt->first]);
+      sceneSize -= std::min(sceneSize, freed);
+      }
+    }
+  nodes->Delete();
+
+  return released;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsLogic::StartTrace(const char* fileName)
+{
+  if (!fileName || fileName[0] == '\0')
+    {
+    vtkErrorMacro("StartTrace: no trace file name specified");
+    return;
+    }
+  vtkSpatialObjectsTrace::Start(fileName);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerSpatialObjectsLogic::StopTrace()
+{
+  if (!vtkSpatialObjectsTrace::IsEnabled())
+    {
+    return false;
+    }
+  if (!vtkSpatialObjectsTrace::Stop())
+    {
+    vtkErrorMacro("StopTrace: the trace file could not be written");
+    return false;
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerSpatialObjectsLogic::IsTracing()
+{
+  return vtkSpatialObjectsTrace::IsEnabled();
+}
+
 //------------------------------------------------------------------------------
 void vtkSlicerSpatialObjectsLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -228,6 +573,9 @@ void vtkSlicerSpatialObjectsLogic::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "vtkSlicerSpatialObjectsLogic: "
      << this->GetClassName() << "\n";
+  os << indent << "DefaultSpatialObjectPolicy: "
+     << this->DefaultSpatialObjectPolicy << "\n";
+  os << indent << "MergeOnLoad: " << this->MergeOnLoad << "\n";
 }
 
 //------------------------------------------------------------------------------
@@ -246,6 +594,8 @@ void vtkSlicerSpatialObjectsLogic::RegisterNodes()
     vtkNew<vtkMRMLSpatialObjectsTubeDisplayNode>().GetPointer());
   this->GetMRMLScene()->RegisterNodeClass(
     vtkNew<vtkMRMLSpatialObjectsGlyphDisplayNode>().GetPointer());
+  this->GetMRMLScene()->RegisterNodeClass(
+    vtkNew<vtkMRMLSpatialObjectsHighlightDisplayNode>().GetPointer());
   this->GetMRMLScene()->RegisterNodeClass(
     vtkNew<vtkMRMLSpatialObjectsStorageNode>().GetPointer());
 }
@@ -31,8 +31,12 @@
 
 // STD includes
 #include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
 
 class vtkMRMLSpatialObjectsNode;
+class vtkMRMLSpatialObjectsStorageNode;
 
 
 class VTK_SLICER_SPATIALOBJECTS_MODULE_LOGIC_EXPORT vtkSlicerSpatialObjectsLogic
@@ -49,25 +53,103 @@ public:
   // Also create the logic object for its display.
   vtkMRMLSpatialObjectsNode* AddSpatialObject(const char* filename);
 
+  // Description:
+  // Same as AddSpatialObject(filename) with the read options of
+  // \a readOptions, e.g. to load a subset of the tubes or of their
+  // point data. The storage node of the new node keeps the options and
+  // uses a binary cache (see vtkMRMLSpatialObjectsStorageNode::UseCache).
+  vtkMRMLSpatialObjectsNode* AddSpatialObject(
+    const char* filename, vtkMRMLSpatialObjectsStorageNode* readOptions);
+
   // Description:
   // Create SpatialObjectsNode and
   // read their polydata from a specified directory.
-  // Files matching suffix are read
+  // Files matching suffix are read, but the tube indices and caches kept
+  // next to the .tre files.
   // Internally calls AddSpatialObjects for each file.
   int AddSpatialObjects(const char* dirname, const char* suffix);
 
   // Description:
   // Create SpatialObjectsNode and
   // read their polydata from a specified directory.
-  // Files matching all suffixes are read
+  // Files matching any of the suffixes are read, once.
   // Internally calls AddSpatialObjects for each file.
   int AddSpatialObjects(const char* dirname, std::vector<std::string> suffix);
 
+  // Description:
+  // If true, AddSpatialObjects() merges the files of the directory into a
+  // single SpatialObjectsNode, named after the directory, instead of
+  // creating one node per file. False by default.
+  vtkGetMacro(MergeOnLoad, bool);
+  vtkSetMacro(MergeOnLoad, bool);
+  vtkBooleanMacro(MergeOnLoad, bool);
+
+  // Description:
+  // Create a single SpatialObjectsNode, and its display nodes, from the
+  // tubes of all the files: one polydata, one set of display pipelines.
+  // The tube IDs are shifted to stay unique and the SourceFileIndex cell
+  // array gives the index in filenames of the file of each tube. The node
+  // is saved, as a whole and without SourceFileIndex, into <name>.tre next
+  // to the first file. See
+  // vtkMRMLSpatialObjectsStorageNode::ReadMergedDataInternal().
+  vtkMRMLSpatialObjectsNode* AddMergedSpatialObjects(
+    const std::vector<std::string>& filenames, const char* name,
+    vtkMRMLSpatialObjectsStorageNode* readOptions = 0);
+
   // Description:
   // Write SpatialObjectsNode's polydata  to a specified file.
   int SaveSpatialObject(const char* filename,
                         vtkMRMLSpatialObjectsNode *spatialObjectsNode);
 
+  // Description:
+  // Write the line, tube or glyph mesh (see
+  // vtkSlicerSpatialObjectsMeshWriter::Lines, Tubes and Glyphs) of the
+  // visible tubes of spatialObjectsNode to a binary PLY (.ply) or glTF
+  // (.glb) file. The mesh is streamed tube by tube, without building the
+  // display mesh, with the colors and parameters of the corresponding
+  // display node if the node has one. Return 0 on error.
+  int ExportSpatialObject(const char* filename,
+                          vtkMRMLSpatialObjectsNode* spatialObjectsNode,
+                          int geometry);
+
+  // Description:
+  // Memory policy given to the SpatialObjectsNodes created by the logic.
+  // See vtkMRMLSpatialObjectsNode::SpatialObjectPolicy.
+  vtkGetMacro(DefaultSpatialObjectPolicy, int);
+  vtkSetMacro(DefaultSpatialObjectPolicy, int);
+
+  // Description:
+  // Sum, per buffer, the memory usage in kibibytes of all the
+  // SpatialObjectsNodes of the scene and of their display nodes.
+  // See vtkMRMLSpatialObjectsNode::GetMemoryUsage().
+  void GetSceneMemoryUsage(std::map<std::string, unsigned long>& usage);
+
+  // Description:
+  // Return the total memory, in kibibytes, used by the SpatialObjectsNodes
+  // of the scene and their display nodes.
+  unsigned long GetSceneMemorySize();
+
+  // Description:
+  // Release the display pipelines of the spatial objects display nodes
+  // hidden for at least minimumHiddenTime seconds, the longest hidden
+  // first, until the scene memory size is below memoryBudget kibibytes
+  // (0 releases them all). The pipelines are rebuilt when the nodes are
+  // shown again. Return the number of pipelines released.
+  int ReleaseHiddenDisplayPipelines(double minimumHiddenTime,
+                                    unsigned long memoryBudget = 0);
+
+  // Description:
+  // Record the timings of the reading, writing and display pipeline
+  // stages of the spatial objects into a Chrome trace-event file
+  // (chrome://tracing). StopTrace() writes the file and returns false
+  // if no trace was started or if the file could not be written.
+  // Tracing can also be enabled at startup with the
+  // SPATIALOBJECTS_TRACE_FILE environment variable.
+  // See vtkSpatialObjectsTrace.
+  void StartTrace(const char* fileName);
+  bool StopTrace();
+  bool IsTracing();
+
   // Description:
   // Register MRML Node classes to Scene.
   // Called automatically when the MRMLScene is attached to this logic class.
@@ -83,6 +165,20 @@ protected:
   // Collection of pointers to display logic objects
   // for spatial objects nodes in the scene.
   vtkCollection *DisplayLogicCollection;
+
+  // Description:
+  // Create the SpatialObjectsNode read by storageNode, named name, with
+  // its display nodes. storageNode is added to the scene on success.
+  vtkMRMLSpatialObjectsNode* AddSpatialObject(
+    vtkMRMLSpatialObjectsStorageNode* storageNode, const char* name);
+
+  // Description:
+  // Merge the files found by AddSpatialObjects() in dirname.
+  int MergeSpatialObjectsFiles(const char* dirname,
+                               std::vector<std::string>& filenames);
+
+  int DefaultSpatialObjectPolicy;
+  bool MergeOnLoad;
 };
 
 #endif
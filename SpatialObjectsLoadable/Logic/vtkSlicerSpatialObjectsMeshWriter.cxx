@@ -0,0 +1,929 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerSpatialObjectsMeshWriter.h"
+
+// SpatialObjects includes
+#include "vtkSpatialObjectsTrace.h"
+#include "vtkSpatialObjectsTreWriter.h"
+
+// VTK includes
+#include <vtkByteSwap.h>
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkScalarsToColors.h>
+#include <vtkTriangleFilter.h>
+
+// ITK includes
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+vtkCxxRevisionMacro(vtkSlicerSpatialObjectsMeshWriter, "$Revision: 1.0 $");
+vtkStandardNewMacro(vtkSlicerSpatialObjectsMeshWriter);
+vtkCxxSetObjectMacro(vtkSlicerSpatialObjectsMeshWriter, Input, vtkPolyData);
+vtkCxxSetObjectMacro(vtkSlicerSpatialObjectsMeshWriter, GlyphSource,
+                     vtkPolyData);
+vtkCxxSetObjectMacro(vtkSlicerSpatialObjectsMeshWriter, LookupTable,
+                     vtkScalarsToColors);
+
+namespace
+{
+
+// Number of vertices buffered before they are written
+const size_t ChunkSize = 65536;
+
+//------------------------------------------------------------------------------
+// Attributes and sizes of the mesh, known before it is generated.
+struct Layout
+{
+  bool HasNormals;
+  bool HasColors;
+  bool HasScalars;
+  // 3 for triangles, 2 for line segments
+  int VerticesPerPrimitive;
+  vtkIdType NumberOfVertices;
+  vtkIdType NumberOfPrimitives;
+  std::string ScalarName;
+};
+
+//------------------------------------------------------------------------------
+// Consecutive vertices and primitives of the mesh, with their attributes.
+struct Chunk
+{
+  vtkIdType FirstVertex;
+  vtkIdType FirstPrimitive;
+  std::vector<float> Positions;
+  std::vector<float> Normals;
+  std::vector<unsigned char> Colors;
+  std::vector<float> Scalars;
+  // Global vertex indices, VerticesPerPrimitive per primitive
+  std::vector<vtkTypeUInt32> Indices;
+
+  vtkIdType GetNumberOfVertices()const
+  {
+    return static_cast<vtkIdType>(this->Positions.size() / 3);
+  }
+};
+
+//------------------------------------------------------------------------------
+void AppendFloat(std::vector<char>& buffer, float value)
+{
+  vtkByteSwap::Swap4LE(&value);
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + 4);
+}
+
+//------------------------------------------------------------------------------
+void AppendIndex(std::vector<char>& buffer, vtkTypeUInt32 value)
+{
+  vtkByteSwap::Swap4LE(&value);
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + 4);
+}
+
+//------------------------------------------------------------------------------
+bool WriteAt(std::ofstream& file, std::streamoff offset,
+             const void* data, size_t size)
+{
+  if (size == 0)
+    {
+    return true;
+    }
+  file.seekp(offset);
+  file.write(static_cast<const char*>(data), size);
+  return file.good();
+}
+
+//------------------------------------------------------------------------------
+// Write the little endian copy of the 4 bytes values.
+template <class T>
+bool WriteValuesAt(std::ofstream& file, std::streamoff offset,
+                   const std::vector<T>& values)
+{
+  if (values.empty())
+    {
+    return true;
+    }
+  std::vector<T> swapped(values);
+  vtkByteSwap::Swap4LERange(&swapped[0], static_cast<int>(swapped.size()));
+  return WriteAt(file, offset, &swapped[0], swapped.size() * sizeof(T));
+}
+
+//------------------------------------------------------------------------------
+// Output file receiving the chunks at their final offsets.
+class MeshFile
+{
+public:
+  virtual ~MeshFile() {}
+  virtual bool Begin(const char* fileName, const Layout& layout) = 0;
+  virtual bool Write(const Chunk& chunk) = 0;
+  virtual bool End(const double bounds[6]) = 0;
+};
+
+//------------------------------------------------------------------------------
+// Binary little endian PLY: the vertices, then the faces or the edges.
+class PLYFile : public MeshFile
+{
+public:
+  virtual bool Begin(const char* fileName, const Layout& layout)
+  {
+    this->Mesh = layout;
+    if (layout.NumberOfVertices > VTK_INT_MAX)
+      {
+      return false;
+      }
+    std::ostringstream header;
+    header << "ply\n"
+           << "format binary_little_endian 1.0\n"
+           << "comment Spatial objects mesh\n"
+           << "element vertex " << layout.NumberOfVertices << "\n"
+           << "property float x\nproperty float y\nproperty float z\n";
+    this->VertexSize = 12;
+    if (layout.HasNormals)
+      {
+      header << "property float nx\nproperty float ny\nproperty float nz\n";
+      this->VertexSize += 12;
+      }
+    if (layout.HasColors)
+      {
+      header << "property uchar red\nproperty uchar green\n"
+             << "property uchar blue\nproperty uchar alpha\n";
+      this->VertexSize += 4;
+      }
+    if (layout.HasScalars)
+      {
+      header << "comment scalar is " << layout.ScalarName << "\n"
+             << "property float scalar\n";
+      this->VertexSize += 4;
+      }
+    if (layout.VerticesPerPrimitive == 3)
+      {
+      header << "element face " << layout.NumberOfPrimitives << "\n"
+             << "property list uchar int vertex_indices\n";
+      this->PrimitiveSize = 13;
+      }
+    else
+      {
+      header << "element edge " << layout.NumberOfPrimitives << "\n"
+             << "property int vertex1\nproperty int vertex2\n";
+      this->PrimitiveSize = 8;
+      }
+    header << "end_header\n";
+
+    this->File.open(fileName, std::ios::out | std::ios::binary);
+    const std::string text = header.str();
+    this->File.write(text.c_str(), text.size());
+    this->VertexOffset = static_cast<std::streamoff>(text.size());
+    this->PrimitiveOffset = this->VertexOffset +
+      static_cast<std::streamoff>(layout.NumberOfVertices) *
+      this->VertexSize;
+    return this->File.good();
+  }
+
+  virtual bool Write(const Chunk& chunk)
+  {
+    const vtkIdType numberOfVertices = chunk.GetNumberOfVertices();
+    this->Buffer.clear();
+    this->Buffer.reserve(numberOfVertices * this->VertexSize);
+    for (vtkIdType i = 0; i < numberOfVertices; ++i)
+      {
+      for (int k = 0; k < 3; ++k)
+        {
+        AppendFloat(this->Buffer, chunk.Positions[3 * i + k]);
+        }
+      if (this->Mesh.HasNormals)
+        {
+        for (int k = 0; k < 3; ++k)
+          {
+          AppendFloat(this->Buffer, chunk.Normals[3 * i + k]);
+          }
+        }
+      if (this->Mesh.HasColors)
+        {
+        this->Buffer.insert(this->Buffer.end(),
+                            chunk.Colors.begin() + 4 * i,
+                            chunk.Colors.begin() + 4 * i + 4);
+        }
+      if (this->Mesh.HasScalars)
+        {
+        AppendFloat(this->Buffer, chunk.Scalars[i]);
+        }
+      }
+    if (!this->Buffer.empty() &&
+        !WriteAt(this->File, this->VertexOffset +
+                 static_cast<std::streamoff>(chunk.FirstVertex) *
+                 this->VertexSize, &this->Buffer[0], this->Buffer.size()))
+      {
+      return false;
+      }
+
+    const int count = this->Mesh.VerticesPerPrimitive;
+    const size_t numberOfPrimitives = chunk.Indices.size() / count;
+    this->Buffer.clear();
+    this->Buffer.reserve(numberOfPrimitives * this->PrimitiveSize);
+    for (size_t i = 0; i < numberOfPrimitives; ++i)
+      {
+      if (count == 3)
+        {
+        this->Buffer.push_back(3);
+        }
+      for (int k = 0; k < count; ++k)
+        {
+        AppendIndex(this->Buffer, chunk.Indices[count * i + k]);
+        }
+      }
+    return this->Buffer.empty() ||
+      WriteAt(this->File, this->PrimitiveOffset +
+              static_cast<std::streamoff>(chunk.FirstPrimitive) *
+              this->PrimitiveSize, &this->Buffer[0], this->Buffer.size());
+  }
+
+  virtual bool End(const double* vtkNotUsed(bounds))
+  {
+    this->File.close();
+    return !this->File.fail();
+  }
+
+protected:
+  Layout Mesh;
+  std::ofstream File;
+  std::vector<char> Buffer;
+  int VertexSize;
+  int PrimitiveSize;
+  std::streamoff VertexOffset;
+  std::streamoff PrimitiveOffset;
+};
+
+//------------------------------------------------------------------------------
+// Binary glTF 2.0: a single mesh whose buffer holds the positions, normals,
+// colors, scalars and indices blocks, in this order. The JSON chunk is
+// written first with placeholder bounds of the same width as the final
+// ones, then rewritten once the bounds are known.
+class GLBFile : public MeshFile
+{
+public:
+  virtual bool Begin(const char* fileName, const Layout& layout)
+  {
+    this->Mesh = layout;
+    const vtkIdType n = layout.NumberOfVertices;
+    this->PositionOffset = 0;
+    this->NormalOffset = this->PositionOffset + 12 * n;
+    this->ColorOffset =
+      this->NormalOffset + (layout.HasNormals ? 12 * n : 0);
+    this->ScalarOffset =
+      this->ColorOffset + (layout.HasColors ? 4 * n : 0);
+    this->IndexOffset =
+      this->ScalarOffset + (layout.HasScalars ? 4 * n : 0);
+    this->BinaryLength = this->IndexOffset +
+      4 * layout.VerticesPerPrimitive * layout.NumberOfPrimitives;
+
+    const double bounds[6] = {0., 0., 0., 0., 0., 0.};
+    const std::string json = this->GetJSON(bounds);
+    this->BinaryStart = 12 + 8 + json.size() + 8;
+    const vtkTypeInt64 length = this->BinaryStart + this->BinaryLength;
+    if (length > VTK_UNSIGNED_INT_MAX)
+      {
+      return false;
+      }
+
+    this->File.open(fileName, std::ios::out | std::ios::binary);
+    std::vector<vtkTypeUInt32> header;
+    header.push_back(0x46546C67); // "glTF"
+    header.push_back(2);
+    header.push_back(static_cast<vtkTypeUInt32>(length));
+    header.push_back(static_cast<vtkTypeUInt32>(json.size()));
+    header.push_back(0x4E4F534A); // "JSON"
+    if (!WriteValuesAt(this->File, 0, header) ||
+        !WriteAt(this->File, 20, json.c_str(), json.size()))
+      {
+      return false;
+      }
+    header.clear();
+    header.push_back(static_cast<vtkTypeUInt32>(this->BinaryLength));
+    header.push_back(0x004E4942); // "BIN\0"
+    return WriteValuesAt(this->File, this->BinaryStart - 8, header);
+  }
+
+  virtual bool Write(const Chunk& chunk)
+  {
+    const std::streamoff first = chunk.FirstVertex;
+    const int count = this->Mesh.VerticesPerPrimitive;
+    return
+      WriteValuesAt(this->File, this->BinaryStart + this->PositionOffset +
+                    12 * first, chunk.Positions) &&
+      WriteValuesAt(this->File, this->BinaryStart + this->NormalOffset +
+                    12 * first, chunk.Normals) &&
+      (chunk.Colors.empty() ||
+       WriteAt(this->File, this->BinaryStart + this->ColorOffset +
+               4 * first, &chunk.Colors[0], chunk.Colors.size())) &&
+      WriteValuesAt(this->File, this->BinaryStart + this->ScalarOffset +
+                    4 * first, chunk.Scalars) &&
+      WriteValuesAt(this->File, this->BinaryStart + this->IndexOffset +
+                    4 * count *
+                    static_cast<std::streamoff>(chunk.FirstPrimitive),
+                    chunk.Indices);
+  }
+
+  virtual bool End(const double bounds[6])
+  {
+    const std::string json = this->GetJSON(bounds);
+    if (static_cast<std::streamoff>(json.size()) !=
+        this->BinaryStart - 28 ||
+        !WriteAt(this->File, 20, json.c_str(), json.size()))
+      {
+      return false;
+      }
+    this->File.close();
+    return !this->File.fail();
+  }
+
+protected:
+  // JSON chunk, padded with spaces to a multiple of 4 bytes.
+  std::string GetJSON(const double bounds[6])
+  {
+    const vtkIdType n = this->Mesh.NumberOfVertices;
+    std::ostringstream json;
+    std::ostringstream views;
+    std::ostringstream accessors;
+    std::ostringstream attributes;
+    int index = 0;
+
+    attributes << "\"POSITION\":" << index;
+    views << "{\"buffer\":0,\"byteOffset\":" << this->PositionOffset
+          << ",\"byteLength\":" << 12 * n << ",\"target\":34962}";
+    accessors << "{\"bufferView\":" << index << ",\"componentType\":5126,"
+              << "\"count\":" << n << ",\"type\":\"VEC3\",\"min\":["
+              << FormatBound(bounds[0]) << "," << FormatBound(bounds[2])
+              << "," << FormatBound(bounds[4]) << "],\"max\":["
+              << FormatBound(bounds[1]) << "," << FormatBound(bounds[3])
+              << "," << FormatBound(bounds[5]) << "]}";
+    ++index;
+    if (this->Mesh.HasNormals)
+      {
+      attributes << ",\"NORMAL\":" << index;
+      views << ",{\"buffer\":0,\"byteOffset\":" << this->NormalOffset
+            << ",\"byteLength\":" << 12 * n << ",\"target\":34962}";
+      accessors << ",{\"bufferView\":" << index
+                << ",\"componentType\":5126,\"count\":" << n
+                << ",\"type\":\"VEC3\"}";
+      ++index;
+      }
+    if (this->Mesh.HasColors)
+      {
+      attributes << ",\"COLOR_0\":" << index;
+      views << ",{\"buffer\":0,\"byteOffset\":" << this->ColorOffset
+            << ",\"byteLength\":" << 4 * n << ",\"target\":34962}";
+      accessors << ",{\"bufferView\":" << index
+                << ",\"componentType\":5121,\"normalized\":true,"
+                << "\"count\":" << n << ",\"type\":\"VEC4\"}";
+      ++index;
+      }
+    if (this->Mesh.HasScalars)
+      {
+      attributes << ",\"_SCALAR\":" << index;
+      views << ",{\"buffer\":0,\"byteOffset\":" << this->ScalarOffset
+            << ",\"byteLength\":" << 4 * n << ",\"target\":34962}";
+      accessors << ",{\"bufferView\":" << index
+                << ",\"componentType\":5126,\"count\":" << n
+                << ",\"type\":\"SCALAR\"}";
+      ++index;
+      }
+    const vtkIdType numberOfIndices =
+      this->Mesh.VerticesPerPrimitive * this->Mesh.NumberOfPrimitives;
+    views << ",{\"buffer\":0,\"byteOffset\":" << this->IndexOffset
+          << ",\"byteLength\":" << 4 * numberOfIndices
+          << ",\"target\":34963}";
+    accessors << ",{\"bufferView\":" << index
+              << ",\"componentType\":5125,\"count\":" << numberOfIndices
+              << ",\"type\":\"SCALAR\"}";
+
+    json << "{\"asset\":{\"version\":\"2.0\","
+         << "\"generator\":\"SpatialObjects\"},"
+         << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+         << "\"nodes\":[{\"mesh\":0}],"
+         << "\"meshes\":[{\"primitives\":[{\"attributes\":{"
+         << attributes.str() << "},\"indices\":" << index
+         << ",\"mode\":" << (this->Mesh.VerticesPerPrimitive == 3 ? 4 : 1)
+         << "}]";
+    if (this->Mesh.HasScalars)
+      {
+      json << ",\"extras\":{\"scalarName\":\"" << this->Mesh.ScalarName
+           << "\"}";
+      }
+    json << "}],"
+         << "\"buffers\":[{\"byteLength\":" << this->BinaryLength << "}],"
+         << "\"bufferViews\":[" << views.str() << "],"
+         << "\"accessors\":[" << accessors.str() << "]}";
+    std::string text = json.str();
+    text.append((4 - text.size() % 4) % 4, ' ');
+    return text;
+  }
+
+  // Shortest exact formatting of the float, padded with spaces to the
+  // longest one: the JSON keeps its size when the bounds change.
+  // The decimal separator is '.' whatever the locale, a ',' would split
+  // the value in the JSON array.
+  static std::string FormatBound(double value)
+  {
+    char buffer[32];
+    std::string bound(buffer, vtkSpatialObjectsTreWriter::FormatValue(
+      static_cast<float>(value), 9, buffer));
+    if (bound.size() < 15)
+      {
+      bound.append(15 - bound.size(), ' ');
+      }
+    return bound;
+  }
+
+  Layout Mesh;
+  std::ofstream File;
+  std::streamoff BinaryStart;
+  vtkTypeInt64 BinaryLength;
+  vtkTypeInt64 PositionOffset;
+  vtkTypeInt64 NormalOffset;
+  vtkTypeInt64 ColorOffset;
+  vtkTypeInt64 ScalarOffset;
+  vtkTypeInt64 IndexOffset;
+};
+
+//------------------------------------------------------------------------------
+// Unit tangent, normal and binormal of the points of a tube, the normals
+// being transported along the tube to avoid twisting the mesh.
+void ComputeFrames(vtkPoints* points, vtkIdType npts, const vtkIdType* pts,
+                   std::vector<double>& frames)
+{
+  frames.resize(9 * npts);
+  double tangent[3] = {1., 0., 0.};
+  double normal[3] = {0., 0., 0.};
+  for (vtkIdType j = 0; j < npts; ++j)
+    {
+    double previous[3];
+    double next[3];
+    points->GetPoint(pts[j > 0 ? j - 1 : 0], previous);
+    points->GetPoint(pts[j < npts - 1 ? j + 1 : npts - 1], next);
+    double direction[3] = {next[0] - previous[0], next[1] - previous[1],
+                           next[2] - previous[2]};
+    // Duplicate points keep the previous tangent.
+    if (vtkMath::Normalize(direction) > 0.)
+      {
+      tangent[0] = direction[0];
+      tangent[1] = direction[1];
+      tangent[2] = direction[2];
+      }
+    const double dot = vtkMath::Dot(normal, tangent);
+    for (int k = 0; k < 3; ++k)
+      {
+      normal[k] -= dot * tangent[k];
+      }
+    if (vtkMath::Normalize(normal) < 1e-6)
+      {
+      double binormal[3];
+      vtkMath::Perpendiculars(tangent, normal, binormal, 0.);
+      }
+    double* frame = &frames[9 * j];
+    double binormal[3];
+    vtkMath::Cross(tangent, normal, binormal);
+    for (int k = 0; k < 3; ++k)
+      {
+      frame[k] = tangent[k];
+      frame[3 + k] = normal[k];
+      frame[6 + k] = binormal[k];
+      }
+    }
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsMeshWriter::vtkSlicerSpatialObjectsMeshWriter()
+{
+  this->FileName = 0;
+  this->Input = 0;
+  this->Geometry = Tubes;
+  this->TubeRadius = 0.5;
+  this->TubeNumberOfSides = 6;
+  this->GlyphSource = 0;
+  this->GlyphScaleFactor = 1.;
+  this->ScalarArrayName = 0;
+  this->BakeColors = false;
+  this->LookupTable = 0;
+  this->ScalarRange[0] = 0.;
+  this->ScalarRange[1] = 1.;
+  this->Color[0] = this->Color[1] = this->Color[2] = 1.;
+  this->Opacity = 1.;
+  this->NumberOfVertices = 0;
+  this->NumberOfPrimitives = 0;
+}
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsMeshWriter::~vtkSlicerSpatialObjectsMeshWriter()
+{
+  this->SetFileName(0);
+  this->SetInput(0);
+  this->SetGlyphSource(0);
+  this->SetScalarArrayName(0);
+  this->SetLookupTable(0);
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsMeshWriter::PrintSelf(ostream& os,
+                                                  vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "Input: " << this->Input << "\n";
+  os << indent << "Geometry: " << this->Geometry << "\n";
+  os << indent << "TubeRadius: " << this->TubeRadius << "\n";
+  os << indent << "TubeNumberOfSides: " << this->TubeNumberOfSides << "\n";
+  os << indent << "GlyphSource: " << this->GlyphSource << "\n";
+  os << indent << "GlyphScaleFactor: " << this->GlyphScaleFactor << "\n";
+  os << indent << "ScalarArrayName: "
+     << (this->ScalarArrayName ? this->ScalarArrayName : "(none)") << "\n";
+  os << indent << "BakeColors: " << this->BakeColors << "\n";
+  os << indent << "LookupTable: " << this->LookupTable << "\n";
+  os << indent << "ScalarRange: " << this->ScalarRange[0] << " "
+     << this->ScalarRange[1] << "\n";
+  os << indent << "Color: " << this->Color[0] << " " << this->Color[1]
+     << " " << this->Color[2] << "\n";
+  os << indent << "Opacity: " << this->Opacity << "\n";
+  os << indent << "NumberOfVertices: " << this->NumberOfVertices << "\n";
+  os << indent << "NumberOfPrimitives: " << this->NumberOfPrimitives << "\n";
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsMeshWriter::Write()
+{
+  vtkSpatialObjectsTraceScope("vtkSlicerSpatialObjectsMeshWriter::Write");
+
+  this->NumberOfVertices = 0;
+  this->NumberOfPrimitives = 0;
+  if (!this->FileName || !this->Input || !this->Input->GetPoints() ||
+      !this->Input->GetLines())
+    {
+    vtkErrorMacro("Write: no file name or no input lines");
+    return 0;
+    }
+  const std::string extension = itksys::SystemTools::LowerCase(
+    itksys::SystemTools::GetFilenameLastExtension(this->FileName));
+  PLYFile plyFile;
+  GLBFile glbFile;
+  MeshFile* file = 0;
+  if (extension == ".ply")
+    {
+    file = &plyFile;
+    }
+  else if (extension == ".glb")
+    {
+    file = &glbFile;
+    }
+  else
+    {
+    vtkErrorMacro("Write: unknown extension " << extension);
+    return 0;
+    }
+
+  // Glyph template: its points, normals and primitives.
+  std::vector<double> glyphPoints;
+  std::vector<double> glyphNormals;
+  std::vector<vtkIdType> glyphIndices;
+  Layout layout;
+  layout.VerticesPerPrimitive = this->Geometry == Tubes ? 3 : 2;
+  layout.HasNormals = this->Geometry == Tubes;
+  if (this->Geometry == Glyphs)
+    {
+    if (!this->GlyphSource)
+      {
+      vtkErrorMacro("Write: no glyph source");
+      return 0;
+      }
+    vtkNew<vtkPolyData> glyphSource;
+    glyphSource->ShallowCopy(this->GlyphSource);
+    vtkNew<vtkTriangleFilter> triangleFilter;
+    triangleFilter->SetInput(glyphSource.GetPointer());
+    triangleFilter->Update();
+    vtkPolyData* glyph = triangleFilter->GetOutput();
+    vtkCellArray* cells = glyph->GetPolys();
+    if (glyph->GetNumberOfPolys() > 0)
+      {
+      layout.VerticesPerPrimitive = 3;
+      }
+    else
+      {
+      cells = glyph->GetLines();
+      }
+    vtkIdType npts = 0;
+    vtkIdType* pts = 0;
+    for (cells->InitTraversal(); cells->GetNextCell(npts, pts);)
+      {
+      if (npts == layout.VerticesPerPrimitive)
+        {
+        glyphIndices.insert(glyphIndices.end(), pts, pts + npts);
+        }
+      }
+    vtkDataArray* normals = glyph->GetPointData()->GetNormals();
+    layout.HasNormals = normals != 0 && layout.VerticesPerPrimitive == 3;
+    for (vtkIdType i = 0; i < glyph->GetNumberOfPoints(); ++i)
+      {
+      double* point = glyph->GetPoint(i);
+      glyphPoints.insert(glyphPoints.end(), point, point + 3);
+      if (layout.HasNormals)
+        {
+        double* normal = normals->GetTuple3(i);
+        glyphNormals.insert(glyphNormals.end(), normal, normal + 3);
+        }
+      }
+    }
+  const vtkIdType glyphNumberOfPoints =
+    static_cast<vtkIdType>(glyphPoints.size() / 3);
+  const vtkIdType glyphNumberOfPrimitives =
+    static_cast<vtkIdType>(glyphIndices.size()) /
+    layout.VerticesPerPrimitive;
+
+  vtkDataArray* scalars = this->ScalarArrayName ?
+    this->Input->GetPointData()->GetArray(this->ScalarArrayName) : 0;
+  vtkDataArray* radii = this->Input->GetPointData()->GetArray("TubeRadius");
+  layout.HasScalars = scalars != 0;
+  layout.HasColors = this->BakeColors;
+  if (scalars)
+    {
+    layout.ScalarName = this->ScalarArrayName;
+    // Keep the name usable in the PLY header and in the JSON.
+    for (size_t i = 0; i < layout.ScalarName.size(); ++i)
+      {
+      const char c = layout.ScalarName[i];
+      if (!isalnum(static_cast<unsigned char>(c)))
+        {
+        layout.ScalarName[i] = '_';
+        }
+      }
+    }
+
+  // Count the vertices and primitives of the tubes.
+  vtkPoints* points = this->Input->GetPoints();
+  vtkCellArray* lines = this->Input->GetLines();
+  const int sides = this->TubeNumberOfSides;
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  layout.NumberOfVertices = 0;
+  layout.NumberOfPrimitives = 0;
+  for (lines->InitTraversal(); lines->GetNextCell(npts, pts);)
+    {
+    if (this->Geometry == Lines && npts >= 2)
+      {
+      layout.NumberOfVertices += npts;
+      layout.NumberOfPrimitives += npts - 1;
+      }
+    else if (this->Geometry == Tubes && npts >= 2)
+      {
+      layout.NumberOfVertices += npts * sides;
+      layout.NumberOfPrimitives += 2 * sides * (npts - 1);
+      }
+    else if (this->Geometry == Glyphs)
+      {
+      layout.NumberOfVertices += npts * glyphNumberOfPoints;
+      layout.NumberOfPrimitives += npts * glyphNumberOfPrimitives;
+      }
+    }
+  if (layout.NumberOfVertices == 0 || layout.NumberOfPrimitives == 0 ||
+      layout.NumberOfVertices > VTK_UNSIGNED_INT_MAX)
+    {
+    vtkErrorMacro("Write: " << layout.NumberOfVertices
+                  << " vertices can't be written");
+    return 0;
+    }
+  if (!file->Begin(this->FileName, layout))
+    {
+    vtkErrorMacro("Write: can't write " << this->FileName);
+    return 0;
+    }
+
+  // Mesh the tubes one after the other.
+  const unsigned char solidColor[4] = {
+    static_cast<unsigned char>(this->Color[0] * 255. + 0.5),
+    static_cast<unsigned char>(this->Color[1] * 255. + 0.5),
+    static_cast<unsigned char>(this->Color[2] * 255. + 0.5),
+    static_cast<unsigned char>(this->Opacity * 255. + 0.5)};
+  const double* lookupTableRange =
+    this->LookupTable ? this->LookupTable->GetRange() : 0;
+  const double scalarSpan = this->ScalarRange[1] - this->ScalarRange[0];
+  double bounds[6] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX,
+                      -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+  std::vector<double> ringCos(sides);
+  std::vector<double> ringSin(sides);
+  for (int k = 0; k < sides; ++k)
+    {
+    const double angle = 2. * vtkMath::DoublePi() * k / sides;
+    ringCos[k] = cos(angle);
+    ringSin[k] = sin(angle);
+    }
+  std::vector<double> frames;
+  Chunk chunk;
+  chunk.FirstVertex = 0;
+  chunk.FirstPrimitive = 0;
+  bool success = true;
+  for (lines->InitTraversal(); success && lines->GetNextCell(npts, pts);)
+    {
+    if (npts < (this->Geometry == Glyphs ? 1 : 2))
+      {
+      continue;
+      }
+    if (this->Geometry != Lines)
+      {
+      ComputeFrames(points, npts, pts, frames);
+      }
+    const vtkTypeUInt32 base = static_cast<vtkTypeUInt32>(
+      chunk.FirstVertex + chunk.GetNumberOfVertices());
+    for (vtkIdType j = 0; j < npts; ++j)
+      {
+      double point[3];
+      points->GetPoint(pts[j], point);
+      const double* frame = this->Geometry != Lines ? &frames[9 * j] : 0;
+
+      // Vertices of the point
+      const size_t first = chunk.Positions.size() / 3;
+      if (this->Geometry == Lines)
+        {
+        chunk.Positions.insert(chunk.Positions.end(), point, point + 3);
+        }
+      else if (this->Geometry == Tubes)
+        {
+        const double radius =
+          radii ? std::fabs(radii->GetComponent(pts[j], 0)) :
+          this->TubeRadius;
+        for (int k = 0; k < sides; ++k)
+          {
+          for (int l = 0; l < 3; ++l)
+            {
+            const double direction =
+              ringCos[k] * frame[3 + l] + ringSin[k] * frame[6 + l];
+            chunk.Positions.push_back(
+              static_cast<float>(point[l] + radius * direction));
+            chunk.Normals.push_back(static_cast<float>(direction));
+            }
+          }
+        }
+      else
+        {
+        const double scale = this->GlyphScaleFactor;
+        for (vtkIdType g = 0; g < glyphNumberOfPoints; ++g)
+          {
+          const double* glyphPoint = &glyphPoints[3 * g];
+          for (int l = 0; l < 3; ++l)
+            {
+            chunk.Positions.push_back(static_cast<float>(
+              point[l] + scale * (glyphPoint[0] * frame[l] +
+                                  glyphPoint[1] * frame[3 + l] +
+                                  glyphPoint[2] * frame[6 + l])));
+            }
+          if (layout.HasNormals)
+            {
+            const double* glyphNormal = &glyphNormals[3 * g];
+            for (int l = 0; l < 3; ++l)
+              {
+              chunk.Normals.push_back(static_cast<float>(
+                glyphNormal[0] * frame[l] + glyphNormal[1] * frame[3 + l] +
+                glyphNormal[2] * frame[6 + l]));
+              }
+            }
+          }
+        }
+      const size_t last = chunk.Positions.size() / 3;
+      for (size_t v = first; v < last; ++v)
+        {
+        for (int l = 0; l < 3; ++l)
+          {
+          const double value = chunk.Positions[3 * v + l];
+          bounds[2 * l] = std::min(bounds[2 * l], value);
+          bounds[2 * l + 1] = std::max(bounds[2 * l + 1], value);
+          }
+        }
+
+      // Scalar and color of the vertices
+      double scalar = 0.;
+      if (scalars)
+        {
+        scalar = scalars->GetNumberOfComponents() == 1 ?
+          scalars->GetComponent(pts[j], 0) :
+          vtkMath::Norm(scalars->GetTuple(pts[j]),
+                        scalars->GetNumberOfComponents());
+        chunk.Scalars.insert(chunk.Scalars.end(), last - first,
+                             static_cast<float>(scalar));
+        }
+      if (layout.HasColors)
+        {
+        unsigned char color[4] = {solidColor[0], solidColor[1],
+                                  solidColor[2], solidColor[3]};
+        if (scalars && this->LookupTable)
+          {
+          double t = scalarSpan > 0. ?
+            (scalar - this->ScalarRange[0]) / scalarSpan : 0.;
+          t = std::min(1., std::max(0., t));
+          const unsigned char* rgba = this->LookupTable->MapValue(
+            lookupTableRange[0] +
+            t * (lookupTableRange[1] - lookupTableRange[0]));
+          for (int l = 0; l < 3; ++l)
+            {
+            color[l] = rgba[l];
+            }
+          color[3] = static_cast<unsigned char>(
+            rgba[3] * this->Opacity + 0.5);
+          }
+        for (size_t v = first; v < last; ++v)
+          {
+          chunk.Colors.insert(chunk.Colors.end(), color, color + 4);
+          }
+        }
+      }
+
+    // Primitives of the tube
+    if (this->Geometry == Lines)
+      {
+      for (vtkIdType j = 0; j + 1 < npts; ++j)
+        {
+        chunk.Indices.push_back(base + j);
+        chunk.Indices.push_back(base + j + 1);
+        }
+      }
+    else if (this->Geometry == Tubes)
+      {
+      for (vtkIdType j = 0; j + 1 < npts; ++j)
+        {
+        for (int k = 0; k < sides; ++k)
+          {
+          const vtkTypeUInt32 a = base + j * sides + k;
+          const vtkTypeUInt32 b = base + j * sides + (k + 1) % sides;
+          chunk.Indices.push_back(a);
+          chunk.Indices.push_back(b);
+          chunk.Indices.push_back(a + sides);
+          chunk.Indices.push_back(b);
+          chunk.Indices.push_back(b + sides);
+          chunk.Indices.push_back(a + sides);
+          }
+        }
+      }
+    else
+      {
+      for (vtkIdType j = 0; j < npts; ++j)
+        {
+        const vtkTypeUInt32 glyphBase = base + j * glyphNumberOfPoints;
+        for (size_t g = 0; g < glyphIndices.size(); ++g)
+          {
+          chunk.Indices.push_back(glyphBase + glyphIndices[g]);
+          }
+        }
+      }
+
+    if (chunk.Positions.size() / 3 >= ChunkSize)
+      {
+      success = file->Write(chunk);
+      chunk.FirstVertex += chunk.GetNumberOfVertices();
+      chunk.FirstPrimitive += static_cast<vtkIdType>(
+        chunk.Indices.size() / layout.VerticesPerPrimitive);
+      chunk.Positions.clear();
+      chunk.Normals.clear();
+      chunk.Colors.clear();
+      chunk.Scalars.clear();
+      chunk.Indices.clear();
+      }
+    }
+  success = success && file->Write(chunk) && file->End(bounds);
+  if (!success)
+    {
+    vtkErrorMacro("Write: error while writing " << this->FileName);
+    return 0;
+    }
+  this->NumberOfVertices = layout.NumberOfVertices;
+  this->NumberOfPrimitives = layout.NumberOfPrimitives;
+  return 1;
+}
@@ -0,0 +1,156 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkSlicerSpatialObjectsMeshWriter -
+// write the line, tube or glyph mesh of spatial objects to PLY or glTF.
+// .SECTION Description
+// The mesh of the lines of the input polydata, one line per tube, is
+// written to a binary little endian PLY file (.ply) or to a binary glTF 2.0
+// file (.glb), depending on the extension of FileName:
+// - Lines: the centerlines, as line segments.
+// - Tubes: a tube of TubeNumberOfSides sides around each centerline, of
+//   the radius of the TubeRadius point array (TubeRadius if there is no
+//   such array), as vtkTubeFilter without caps.
+// - Glyphs: GlyphSource, scaled by GlyphScaleFactor, at each point of
+//   the tubes, its x axis along the tube.
+// The ScalarArrayName point array is written as a float vertex attribute
+// ("scalar" PLY property, "_SCALAR" glTF attribute). If BakeColors is
+// true, the vertices are also given the color of their scalar through
+// LookupTable, or Color if there is no scalar array or lookup table.
+//
+// The mesh is never built as a whole: the vertex and primitive counts are
+// computed first, then the tubes are meshed one after the other into a
+// small buffer flushed at their final offsets in the file. The memory used
+// is independent of the size of the mesh.
+
+#ifndef __vtkSlicerSpatialObjectsMeshWriter_h
+#define __vtkSlicerSpatialObjectsMeshWriter_h
+
+#include "vtkObject.h"
+#include "vtkSlicerSpatialObjectsModuleLogicExport.h"
+
+class vtkPolyData;
+class vtkScalarsToColors;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_LOGIC_EXPORT
+vtkSlicerSpatialObjectsMeshWriter : public vtkObject
+{
+public:
+  static vtkSlicerSpatialObjectsMeshWriter *New();
+  vtkTypeRevisionMacro(vtkSlicerSpatialObjectsMeshWriter, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // File written, its extension (.ply or .glb) gives the format.
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  // Description:
+  // Polydata whose lines are meshed, one tube per line.
+  virtual void SetInput(vtkPolyData* polyData);
+  vtkGetObjectMacro(Input, vtkPolyData);
+
+  // Description:
+  // Geometry written. Tubes by default.
+  enum
+  {
+    Lines = 0,
+    Tubes,
+    Glyphs
+  };
+  vtkSetClampMacro(Geometry, int, Lines, Glyphs);
+  vtkGetMacro(Geometry, int);
+
+  // Description:
+  // Radius of the tubes without TubeRadius point array, 0.5 by default,
+  // and number of sides of the tubes, 6 by default.
+  vtkSetClampMacro(TubeRadius, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(TubeRadius, double);
+  vtkSetClampMacro(TubeNumberOfSides, int, 3, 1024);
+  vtkGetMacro(TubeNumberOfSides, int);
+
+  // Description:
+  // Glyph copied at each point, triangulated before the copies. Its polygons
+  // are written if it has some, its lines otherwise. Its normals, if any,
+  // are written with the glyphs.
+  virtual void SetGlyphSource(vtkPolyData* glyphSource);
+  vtkGetObjectMacro(GlyphSource, vtkPolyData);
+  vtkSetMacro(GlyphScaleFactor, double);
+  vtkGetMacro(GlyphScaleFactor, double);
+
+  // Description:
+  // Point data array written with the vertices, none (0) by default. The
+  // magnitude of the arrays with several components is written.
+  vtkSetStringMacro(ScalarArrayName);
+  vtkGetStringMacro(ScalarArrayName);
+
+  // Description:
+  // If true, RGBA colors are written with the vertices. False by default.
+  vtkSetMacro(BakeColors, bool);
+  vtkGetMacro(BakeColors, bool);
+  vtkBooleanMacro(BakeColors, bool);
+
+  // Description:
+  // Lookup table giving the baked colors of the scalars, ScalarRange being
+  // mapped to the range of the table. Color and Opacity are the color of
+  // the vertices without scalars. White and opaque by default.
+  virtual void SetLookupTable(vtkScalarsToColors* lookupTable);
+  vtkGetObjectMacro(LookupTable, vtkScalarsToColors);
+  vtkSetVector2Macro(ScalarRange, double);
+  vtkGetVector2Macro(ScalarRange, double);
+  vtkSetVector3Macro(Color, double);
+  vtkGetVector3Macro(Color, double);
+  vtkSetClampMacro(Opacity, double, 0., 1.);
+  vtkGetMacro(Opacity, double);
+
+  // Description:
+  // Write the mesh of the input into FileName. Return 0 on error, e.g. if
+  // the extension is unknown or if the mesh is empty.
+  int Write();
+
+  // Description:
+  // Number of vertices and of primitives (triangles or line segments)
+  // written by the last Write().
+  vtkGetMacro(NumberOfVertices, vtkIdType);
+  vtkGetMacro(NumberOfPrimitives, vtkIdType);
+
+protected:
+  vtkSlicerSpatialObjectsMeshWriter();
+  ~vtkSlicerSpatialObjectsMeshWriter();
+  vtkSlicerSpatialObjectsMeshWriter(
+    const vtkSlicerSpatialObjectsMeshWriter&);
+  void operator=(const vtkSlicerSpatialObjectsMeshWriter&);
+
+  char* FileName;
+  vtkPolyData* Input;
+  int Geometry;
+  double TubeRadius;
+  int TubeNumberOfSides;
+  vtkPolyData* GlyphSource;
+  double GlyphScaleFactor;
+  char* ScalarArrayName;
+  bool BakeColors;
+  vtkScalarsToColors* LookupTable;
+  double ScalarRange[2];
+  double Color[3];
+  double Opacity;
+
+  vtkIdType NumberOfVertices;
+  vtkIdType NumberOfPrimitives;
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerSpatialObjectsNetworkGenerator.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkType.h>
+
+// ITK includes
+#include <itkSpatialObjectWriter.h>
+#include <itkVesselTubeSpatialObject.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+vtkCxxRevisionMacro(vtkSlicerSpatialObjectsNetworkGenerator, "$Revision: 1.0 $");
+vtkStandardNewMacro(vtkSlicerSpatialObjectsNetworkGenerator);
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Xorshift generator: unlike rand(), it gives the same sequence on every
+// platform and doesn't share its state with the rest of the application.
+class RandomGenerator
+{
+public:
+  RandomGenerator(unsigned int seed)
+  {
+    this->State = static_cast<vtkTypeUInt32>(seed) * 2654435761u;
+    if (this->State == 0)
+      {
+      this->State = 0x9E3779B9u;
+      }
+  }
+
+  // Uniform in [0, 1[
+  double Uniform()
+  {
+    this->State ^= this->State << 13;
+    this->State ^= this->State >> 17;
+    this->State ^= this->State << 5;
+    return this->State / 4294967296.;
+  }
+
+  // Uniform in [min, max[
+  double Uniform(double min, double max)
+  {
+    return min + (max - min) * this->Uniform();
+  }
+
+  // Uniform in [0, max[
+  int Integer(int max)
+  {
+    return static_cast<int>(this->Uniform() * max);
+  }
+
+  // Direction uniformly distributed on the unit sphere
+  void Direction(double direction[3])
+  {
+    const double z = this->Uniform(-1., 1.);
+    const double angle = this->Uniform(0., 2. * vtkMath::Pi());
+    const double r = sqrt(1. - z * z);
+    direction[0] = r * cos(angle);
+    direction[1] = r * sin(angle);
+    direction[2] = z;
+  }
+
+private:
+  vtkTypeUInt32 State;
+};
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsNetworkGenerator::
+vtkSlicerSpatialObjectsNetworkGenerator()
+{
+  this->Seed = 0;
+  this->NumberOfTubes = 100;
+  this->NumberOfTrees = 1;
+  this->NumberOfPointsPerTube = 100;
+  this->StepLength = 1.;
+  this->Tortuosity = 0.2;
+  this->Extent = 100.;
+  this->RootRadius = 5.;
+  this->RadiusRatio = 0.7;
+  this->MinimumRadius = 0.5;
+  this->RadiusProfile = radiusProfileConstant;
+  this->GenerateMedialness = false;
+  this->GenerateRidgeness = false;
+}
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsNetworkGenerator::
+~vtkSlicerSpatialObjectsNetworkGenerator()
+{}
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsNetworkGenerator::TubeNetType::Pointer
+vtkSlicerSpatialObjectsNetworkGenerator::GenerateSpatialObject()
+{
+  typedef itk::VesselTubeSpatialObject<3>      TubeType;
+  typedef itk::VesselTubeSpatialObjectPoint<3> TubePointType;
+
+  RandomGenerator random(this->Seed);
+
+  TubeNetType::Pointer group = TubeNetType::New();
+  std::vector<TubeType::Pointer> tubes;
+  tubes.reserve(this->NumberOfTubes);
+
+  const int numberOfPoints = this->NumberOfPointsPerTube;
+  for (int tubeIndex = 0; tubeIndex < this->NumberOfTubes; ++tubeIndex)
+    {
+    TubeType::Pointer tube = TubeType::New();
+    tube->SetId(tubeIndex);
+
+    double position[3];
+    double direction[3];
+    double radius = this->RootRadius;
+    TubeType* parent = NULL;
+
+    if (tubeIndex < this->NumberOfTrees)
+      {
+      // Root of a new tree
+      tube->SetRoot(true);
+      position[0] = random.Uniform(0., this->Extent);
+      position[1] = random.Uniform(0., this->Extent);
+      position[2] = random.Uniform(0., this->Extent);
+      random.Direction(direction);
+      }
+    else
+      {
+      // Branch from a random point of a previous tube, away from its
+      // extremities
+      parent = tubes[random.Integer(tubeIndex)];
+      tube->SetParentId(parent->GetId());
+
+      const int branchIndex = 1 + random.Integer(numberOfPoints - 2);
+      const TubePointType& branchPoint = parent->GetPoints()[branchIndex];
+      const TubePointType& previous = parent->GetPoints()[branchIndex - 1];
+      const TubePointType& next = parent->GetPoints()[branchIndex + 1];
+
+      double deviation[3];
+      random.Direction(deviation);
+      for (int i = 0; i < 3; ++i)
+        {
+        position[i] = branchPoint.GetPosition()[i];
+        direction[i] = next.GetPosition()[i] - previous.GetPosition()[i];
+        }
+      vtkMath::Normalize(direction);
+      for (int i = 0; i < 3; ++i)
+        {
+        direction[i] += deviation[i];
+        }
+      vtkMath::Normalize(direction);
+
+      radius = std::max(branchPoint.GetRadius() * this->RadiusRatio,
+                        this->MinimumRadius);
+      }
+
+    TubeType::PointListType points(numberOfPoints);
+    for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+      TubePointType& point = points[pointIndex];
+      point.SetID(pointIndex);
+      point.SetPosition(position[0], position[1], position[2]);
+
+      const double t = static_cast<double>(pointIndex) / (numberOfPoints - 1);
+      double pointRadius = radius;
+      switch (this->RadiusProfile)
+        {
+        case radiusProfileTapered:
+          pointRadius = radius * (1. - 0.5 * t);
+          break;
+        case radiusProfileStenosis:
+          pointRadius =
+            radius * (1. - 0.5 * exp(-(t - 0.5) * (t - 0.5) / 0.01));
+          break;
+        default:
+          break;
+        }
+      point.SetRadius(std::max(pointRadius, this->MinimumRadius));
+
+      if (this->GenerateMedialness)
+        {
+        point.SetMedialness(random.Uniform(0.5, 1.));
+        }
+      if (this->GenerateRidgeness)
+        {
+        point.SetRidgeness(random.Uniform(0.5, 1.));
+        }
+
+      // Random walk
+      double deviation[3];
+      random.Direction(deviation);
+      for (int i = 0; i < 3; ++i)
+        {
+        direction[i] += this->Tortuosity * deviation[i];
+        }
+      vtkMath::Normalize(direction);
+      for (int i = 0; i < 3; ++i)
+        {
+        position[i] += this->StepLength * direction[i];
+        }
+      }
+
+    tube->SetPoints(points);
+    tube->ComputeTangentAndNormals();
+    // The writer takes the ParentID from the tree, not from GetParentId()
+    if (parent)
+      {
+      parent->AddSpatialObject(tube);
+      }
+    else
+      {
+      group->AddSpatialObject(tube);
+      }
+    tubes.push_back(tube);
+    }
+
+  return group;
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsNetworkGenerator::WriteFile(const char* filename)
+{
+  typedef itk::SpatialObjectWriter<3> WriterType;
+
+  if (!filename)
+    {
+    vtkErrorMacro(<< "WriteFile: no file name");
+    return 0;
+    }
+
+  try
+    {
+    TubeNetType::Pointer group = this->GenerateSpatialObject();
+
+    WriterType::Pointer writer = WriterType::New();
+    writer->SetFileName(filename);
+    writer->SetInput(group);
+    writer->Update();
+    }
+  catch (...)
+    {
+    vtkErrorMacro(<< "Error occured writing Spatial Objects: " << filename);
+    return 0;
+    }
+
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsNetworkGenerator::
+PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Seed: " << this->Seed << "\n";
+  os << indent << "NumberOfTubes: " << this->NumberOfTubes << "\n";
+  os << indent << "NumberOfTrees: " << this->NumberOfTrees << "\n";
+  os << indent << "NumberOfPointsPerTube: "
+     << this->NumberOfPointsPerTube << "\n";
+  os << indent << "StepLength: " << this->StepLength << "\n";
+  os << indent << "Tortuosity: " << this->Tortuosity << "\n";
+  os << indent << "Extent: " << this->Extent << "\n";
+  os << indent << "RootRadius: " << this->RootRadius << "\n";
+  os << indent << "RadiusRatio: " << this->RadiusRatio << "\n";
+  os << indent << "MinimumRadius: " << this->MinimumRadius << "\n";
+  os << indent << "RadiusProfile: " << this->RadiusProfile << "\n";
+  os << indent << "GenerateMedialness: " << this->GenerateMedialness << "\n";
+  os << indent << "GenerateRidgeness: " << this->GenerateRidgeness << "\n";
+}
@@ -0,0 +1,150 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkSlicerSpatialObjectsNetworkGenerator -
+// generate synthetic vessel networks.
+// .SECTION Description
+// This class generates branching tube trees from a seed, the same seed and
+// parameters always giving the same network on every platform.
+// The networks are used as reproducible inputs for tests and benchmarks:
+// the number of points is NumberOfTubes * NumberOfPointsPerTube.
+
+#ifndef __vtkSlicerSpatialObjectsNetworkGenerator_h
+#define __vtkSlicerSpatialObjectsNetworkGenerator_h
+
+#include "vtkObject.h"
+#include "vtkSlicerSpatialObjectsModuleLogicExport.h"
+
+// SpatialObjects includes
+#include "vtkMRMLSpatialObjectsNode.h"
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_LOGIC_EXPORT
+vtkSlicerSpatialObjectsNetworkGenerator : public vtkObject
+{
+public:
+  typedef vtkMRMLSpatialObjectsNode::TubeNetType TubeNetType;
+
+  static vtkSlicerSpatialObjectsNetworkGenerator *New();
+  vtkTypeRevisionMacro(vtkSlicerSpatialObjectsNetworkGenerator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Seed of the random generator. 0 by default.
+  vtkGetMacro(Seed, unsigned int);
+  vtkSetMacro(Seed, unsigned int);
+
+  // Description:
+  // Total number of tubes, including the roots of the trees.
+  // 100 by default.
+  vtkGetMacro(NumberOfTubes, int);
+  vtkSetClampMacro(NumberOfTubes, int, 0, VTK_INT_MAX);
+
+  // Description:
+  // Number of trees, the other tubes branch from their roots or from
+  // other branches. 1 by default.
+  vtkGetMacro(NumberOfTrees, int);
+  vtkSetClampMacro(NumberOfTrees, int, 1, VTK_INT_MAX);
+
+  // Description:
+  // Number of points of each tube. 100 by default.
+  vtkGetMacro(NumberOfPointsPerTube, int);
+  vtkSetClampMacro(NumberOfPointsPerTube, int, 3, VTK_INT_MAX);
+
+  // Description:
+  // Distance between two consecutive points of a tube. 1 by default.
+  vtkGetMacro(StepLength, double);
+  vtkSetMacro(StepLength, double);
+
+  // Description:
+  // Amount of random deviation of the direction between two points,
+  // 0 giving straight tubes. 0.2 by default.
+  vtkGetMacro(Tortuosity, double);
+  vtkSetMacro(Tortuosity, double);
+
+  // Description:
+  // The roots are generated in the box [0, Extent]^3. 100 by default.
+  vtkGetMacro(Extent, double);
+  vtkSetMacro(Extent, double);
+
+  // Description:
+  // Radius of the roots, the branches get RadiusRatio times the radius
+  // of their parent at the branching point, but not less than
+  // MinimumRadius.
+  vtkGetMacro(RootRadius, double);
+  vtkSetMacro(RootRadius, double);
+  vtkGetMacro(RadiusRatio, double);
+  vtkSetMacro(RadiusRatio, double);
+  vtkGetMacro(MinimumRadius, double);
+  vtkSetMacro(MinimumRadius, double);
+
+  // Description:
+  // Evolution of the radius along a tube:
+  // 0) constant
+  // 1) tapered: linearly decreasing to half the initial radius
+  // 2) stenosis: constant with a narrowing in the middle of the tube
+  enum
+  {
+    radiusProfileConstant = 0,
+    radiusProfileTapered = 1,
+    radiusProfileStenosis = 2
+  };
+
+  vtkGetMacro(RadiusProfile, int);
+  vtkSetClampMacro(RadiusProfile, int,
+                   radiusProfileConstant, radiusProfileStenosis);
+
+  // Description:
+  // Generate random medialness and ridgeness values. Off by default.
+  vtkGetMacro(GenerateMedialness, bool);
+  vtkSetMacro(GenerateMedialness, bool);
+  vtkBooleanMacro(GenerateMedialness, bool);
+  vtkGetMacro(GenerateRidgeness, bool);
+  vtkSetMacro(GenerateRidgeness, bool);
+  vtkBooleanMacro(GenerateRidgeness, bool);
+
+  // Description:
+  // Generate a new network made of vessel tubes.
+  TubeNetType::Pointer GenerateSpatialObject();
+
+  // Description:
+  // Generate a new network and write it into a .tre file.
+  // Return 1 on success, 0 otherwise.
+  int WriteFile(const char* filename);
+
+protected:
+  vtkSlicerSpatialObjectsNetworkGenerator();
+  ~vtkSlicerSpatialObjectsNetworkGenerator();
+  vtkSlicerSpatialObjectsNetworkGenerator(
+    const vtkSlicerSpatialObjectsNetworkGenerator&);
+  void operator=(const vtkSlicerSpatialObjectsNetworkGenerator&);
+
+  unsigned int Seed;
+  int NumberOfTubes;
+  int NumberOfTrees;
+  int NumberOfPointsPerTube;
+  double StepLength;
+  double Tortuosity;
+  double Extent;
+  double RootRadius;
+  double RadiusRatio;
+  double MinimumRadius;
+  int RadiusProfile;
+  bool GenerateMedialness;
+  bool GenerateRidgeness;
+};
+
+#endif
@@ -0,0 +1,583 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerSpatialObjectsTubePicker.h"
+
+// SpatialObjects includes
+#include "vtkMRMLSpatialObjectsNode.h"
+#include "vtkSpatialObjectsTrace.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+#include <vtkTimeStamp.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+vtkCxxRevisionMacro(vtkSlicerSpatialObjectsTubePicker, "$Revision: 1.0 $");
+vtkStandardNewMacro(vtkSlicerSpatialObjectsTubePicker);
+vtkCxxSetObjectMacro(vtkSlicerSpatialObjectsTubePicker, SpatialObjectsNode,
+                     vtkMRMLSpatialObjectsNode);
+
+namespace
+{
+
+// Maximum number of segments in a leaf of the hierarchy
+const vtkIdType LeafSize = 4;
+
+//------------------------------------------------------------------------------
+// Centerline segment [PointIds[0], PointIds[1]] of a tube.
+struct Segment
+{
+  vtkIdType TubeId;
+  // Index in the tube of the first point
+  vtkIdType Index;
+  vtkIdType PointIds[2];
+  // Arc length at the first point
+  double ArcLength;
+};
+
+//------------------------------------------------------------------------------
+// Node of the hierarchy: a leaf holds the segments [First, First + Count[,
+// the children of the other nodes are Child and Child + 1.
+struct HierarchyNode
+{
+  double Bounds[6];
+  vtkIdType First;
+  vtkIdType Count;
+  vtkIdType Child;
+};
+
+//------------------------------------------------------------------------------
+// Compare the segments by the center of their bounds along an axis.
+struct SegmentCenterCompare
+{
+  const std::vector<double>* Bounds;
+  int Axis;
+
+  bool operator()(vtkIdType segment, vtkIdType otherSegment) const
+  {
+    const double* bounds = &(*this->Bounds)[6 * segment];
+    const double* otherBounds = &(*this->Bounds)[6 * otherSegment];
+    return bounds[2 * this->Axis] + bounds[2 * this->Axis + 1] <
+      otherBounds[2 * this->Axis] + otherBounds[2 * this->Axis + 1];
+  }
+};
+
+//------------------------------------------------------------------------------
+// Intersect the segment origin + t * direction, t in [0, 1], with a box.
+bool IntersectBox(const double bounds[6], const double origin[3],
+                  const double direction[3], double& tMin, double& tMax)
+{
+  tMin = 0.;
+  tMax = 1.;
+  for (int i = 0; i < 3; ++i)
+    {
+    if (direction[i] == 0.)
+      {
+      if (origin[i] < bounds[2 * i] || origin[i] > bounds[2 * i + 1])
+        {
+        return false;
+        }
+      continue;
+      }
+    double t0 = (bounds[2 * i] - origin[i]) / direction[i];
+    double t1 = (bounds[2 * i + 1] - origin[i]) / direction[i];
+    if (t0 > t1)
+      {
+      std::swap(t0, t1);
+      }
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+    if (tMin > tMax)
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Closest points of the segments p0 + s * d0 and p1 + t * d1, s and t in
+// [0, 1]. Return the squared distance between them.
+double ClosestPointsBetweenSegments(const double p0[3], const double d0[3],
+                                    const double p1[3], const double d1[3],
+                                    double& s, double& t)
+{
+  double r[3] = {p0[0] - p1[0], p0[1] - p1[1], p0[2] - p1[2]};
+  const double a = vtkMath::Dot(d0, d0);
+  const double e = vtkMath::Dot(d1, d1);
+  const double f = vtkMath::Dot(d1, r);
+  const double epsilon = 1e-12;
+
+  if (a <= epsilon && e <= epsilon)
+    {
+    s = t = 0.;
+    }
+  else if (a <= epsilon)
+    {
+    s = 0.;
+    t = std::min(std::max(f / e, 0.), 1.);
+    }
+  else
+    {
+    const double c = vtkMath::Dot(d0, r);
+    if (e <= epsilon)
+      {
+      t = 0.;
+      s = std::min(std::max(-c / a, 0.), 1.);
+      }
+    else
+      {
+      const double b = vtkMath::Dot(d0, d1);
+      const double denominator = a * e - b * b;
+      s = denominator > epsilon ?
+        std::min(std::max((b * f - c * e) / denominator, 0.), 1.) : 0.;
+      t = (b * s + f) / e;
+      if (t < 0.)
+        {
+        t = 0.;
+        s = std::min(std::max(-c / a, 0.), 1.);
+        }
+      else if (t > 1.)
+        {
+        t = 1.;
+        s = std::min(std::max((b - c) / a, 0.), 1.);
+        }
+      }
+    }
+
+  double distance2 = 0.;
+  for (int i = 0; i < 3; ++i)
+    {
+    const double delta = (p0[i] + s * d0[i]) - (p1[i] + t * d1[i]);
+    distance2 += delta * delta;
+    }
+  return distance2;
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+class vtkSlicerSpatialObjectsTubePicker::vtkInternal
+{
+public:
+  vtkInternal();
+
+  void Clear();
+
+  std::vector<Segment> Segments;
+  std::vector<HierarchyNode> Nodes;
+
+  vtkPolyData* PolyData;
+  vtkTimeStamp BuildTime;
+};
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsTubePicker::vtkInternal::vtkInternal()
+{
+  this->PolyData = NULL;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsTubePicker::vtkInternal::Clear()
+{
+  // swap() to release the memory
+  std::vector<Segment>().swap(this->Segments);
+  std::vector<HierarchyNode>().swap(this->Nodes);
+  this->PolyData = NULL;
+}
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsTubePicker::vtkSlicerSpatialObjectsTubePicker()
+{
+  this->Internal = new vtkInternal;
+  this->SpatialObjectsNode = NULL;
+  this->Tolerance = 0.5;
+  this->UseTubeRadius = true;
+  this->TubeId = -1;
+  this->PointIndex = -1;
+  this->ArcLength = 0.;
+  this->PickPosition[0] = this->PickPosition[1] = this->PickPosition[2] = 0.;
+  this->Distance = 0.;
+}
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsTubePicker::~vtkSlicerSpatialObjectsTubePicker()
+{
+  this->SetSpatialObjectsNode(NULL);
+  delete this->Internal;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsTubePicker::PrintSelf(ostream& os,
+                                                  vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "SpatialObjectsNode: " << this->SpatialObjectsNode << "\n";
+  os << indent << "Tolerance: " << this->Tolerance << "\n";
+  os << indent << "UseTubeRadius: " << this->UseTubeRadius << "\n";
+  os << indent << "TubeId: " << this->TubeId << "\n";
+  os << indent << "PointIndex: " << this->PointIndex << "\n";
+  os << indent << "ArcLength: " << this->ArcLength << "\n";
+  os << indent << "PickPosition: " << this->PickPosition[0] << " "
+     << this->PickPosition[1] << " " << this->PickPosition[2] << "\n";
+  os << indent << "Distance: " << this->Distance << "\n";
+  os << indent << "NumberOfSegments: " << this->GetNumberOfSegments() << "\n";
+}
+
+//------------------------------------------------------------------------------
+vtkIdType vtkSlicerSpatialObjectsTubePicker::GetNumberOfSegments()
+{
+  return static_cast<vtkIdType>(this->Internal->Segments.size());
+}
+
+//------------------------------------------------------------------------------
+unsigned long vtkSlicerSpatialObjectsTubePicker::GetMemorySize()
+{
+  const size_t size =
+    this->Internal->Segments.capacity() * sizeof(Segment) +
+    this->Internal->Nodes.capacity() * sizeof(HierarchyNode);
+  return static_cast<unsigned long>(size / 1024);
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsTubePicker::BuildHierarchy()
+{
+  vtkInternal* internal = this->Internal;
+  vtkPolyData* polyData =
+    this->SpatialObjectsNode ? this->SpatialObjectsNode->GetPolyData() : NULL;
+  if (!polyData || !polyData->GetPoints() || !polyData->GetLines())
+    {
+    internal->Clear();
+    return;
+    }
+  // The tolerance and the radius are in the bounds of the nodes.
+  if (internal->PolyData == polyData &&
+      polyData->GetMTime() <= internal->BuildTime.GetMTime() &&
+      this->GetMTime() <= internal->BuildTime.GetMTime())
+    {
+    return;
+    }
+
+  vtkSpatialObjectsTraceScope(
+    "vtkSlicerSpatialObjectsTubePicker::BuildHierarchy");
+
+  vtkPoints* points = polyData->GetPoints();
+  vtkDataArray* tubeRadius = this->UseTubeRadius ?
+    polyData->GetPointData()->GetArray("TubeRadius") : NULL;
+
+  // Segments and their bounds, inflated by the radius and the tolerance
+  std::vector<Segment> segments;
+  std::vector<double> segmentBounds;
+  segments.reserve(polyData->GetNumberOfPoints());
+  segmentBounds.reserve(6 * polyData->GetNumberOfPoints());
+  vtkCellArray* lines = polyData->GetLines();
+  const vtkIdType* connectivity = lines->GetPointer();
+  const vtkIdType numberOfTubes = lines->GetNumberOfCells();
+  vtkIdType location = 0;
+  for (vtkIdType tubeId = 0; tubeId < numberOfTubes; ++tubeId)
+    {
+    const vtkIdType npts = connectivity[location];
+    const vtkIdType* pts = connectivity + location + 1;
+    location += npts + 1;
+
+    double arcLength = 0.;
+    for (vtkIdType j = 0; j + 1 < npts; ++j)
+      {
+      Segment segment;
+      segment.TubeId = tubeId;
+      segment.Index = j;
+      segment.PointIds[0] = pts[j];
+      segment.PointIds[1] = pts[j + 1];
+      segment.ArcLength = arcLength;
+      segments.push_back(segment);
+
+      double a[3];
+      double b[3];
+      points->GetPoint(pts[j], a);
+      points->GetPoint(pts[j + 1], b);
+      arcLength += sqrt(vtkMath::Distance2BetweenPoints(a, b));
+      double margin = this->Tolerance;
+      if (tubeRadius)
+        {
+        margin += std::max(tubeRadius->GetTuple1(pts[j]),
+                           tubeRadius->GetTuple1(pts[j + 1]));
+        }
+      for (int i = 0; i < 3; ++i)
+        {
+        segmentBounds.push_back(std::min(a[i], b[i]) - margin);
+        segmentBounds.push_back(std::max(a[i], b[i]) + margin);
+        }
+      }
+    }
+
+  // Top-down build, splitting the segments of a node at the median of the
+  // longest axis of its bounds.
+  const vtkIdType numberOfSegments = static_cast<vtkIdType>(segments.size());
+  std::vector<vtkIdType> order(numberOfSegments);
+  for (vtkIdType i = 0; i < numberOfSegments; ++i)
+    {
+    order[i] = i;
+    }
+  internal->Nodes.clear();
+  if (numberOfSegments > 0)
+    {
+    internal->Nodes.reserve(2 * (numberOfSegments / LeafSize + 1));
+    HierarchyNode root;
+    root.First = 0;
+    root.Count = numberOfSegments;
+    root.Child = -1;
+    internal->Nodes.push_back(root);
+    }
+  std::vector<vtkIdType> stack(internal->Nodes.empty() ? 0 : 1, 0);
+  SegmentCenterCompare compare;
+  compare.Bounds = &segmentBounds;
+  while (!stack.empty())
+    {
+    const vtkIdType nodeId = stack.back();
+    stack.pop_back();
+    const vtkIdType first = internal->Nodes[nodeId].First;
+    const vtkIdType count = internal->Nodes[nodeId].Count;
+
+    double* bounds = internal->Nodes[nodeId].Bounds;
+    for (vtkIdType i = first; i < first + count; ++i)
+      {
+      const double* box = &segmentBounds[6 * order[i]];
+      for (int k = 0; k < 3; ++k)
+        {
+        if (i == first || box[2 * k] < bounds[2 * k])
+          {
+          bounds[2 * k] = box[2 * k];
+          }
+        if (i == first || box[2 * k + 1] > bounds[2 * k + 1])
+          {
+          bounds[2 * k + 1] = box[2 * k + 1];
+          }
+        }
+      }
+    if (count <= LeafSize)
+      {
+      continue;
+      }
+
+    compare.Axis = 0;
+    for (int k = 1; k < 3; ++k)
+      {
+      if (bounds[2 * k + 1] - bounds[2 * k] >
+          bounds[2 * compare.Axis + 1] - bounds[2 * compare.Axis])
+        {
+        compare.Axis = k;
+        }
+      }
+    const vtkIdType half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half,
+                     order.begin() + first + count, compare);
+
+    HierarchyNode child;
+    child.Child = -1;
+    child.First = first;
+    child.Count = half;
+    internal->Nodes[nodeId].Child =
+      static_cast<vtkIdType>(internal->Nodes.size());
+    internal->Nodes.push_back(child);
+    child.First = first + half;
+    child.Count = count - half;
+    internal->Nodes.push_back(child);
+    stack.push_back(internal->Nodes[nodeId].Child);
+    stack.push_back(internal->Nodes[nodeId].Child + 1);
+    }
+
+  // Store the segments in the order of the leaves.
+  internal->Segments.resize(numberOfSegments);
+  for (vtkIdType i = 0; i < numberOfSegments; ++i)
+    {
+    internal->Segments[i] = segments[order[i]];
+    }
+
+  internal->PolyData = polyData;
+  internal->BuildTime.Modified();
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsTubePicker::Pick(const double p0[3],
+                                            const double p1[3])
+{
+  vtkSpatialObjectsTraceScope("vtkSlicerSpatialObjectsTubePicker::Pick");
+
+  this->TubeId = -1;
+  this->PointIndex = -1;
+  this->ArcLength = 0.;
+  this->Distance = 0.;
+
+  this->BuildHierarchy();
+  vtkInternal* internal = this->Internal;
+  if (internal->Nodes.empty())
+    {
+    return 0;
+    }
+
+  vtkPolyData* polyData = internal->PolyData;
+  vtkPoints* points = polyData->GetPoints();
+  vtkDataArray* tubeRadius = this->UseTubeRadius ?
+    polyData->GetPointData()->GetArray("TubeRadius") : NULL;
+  vtkMRMLSpatialObjectsNode* node = this->SpatialObjectsNode;
+  const bool hiddenTubes = node->GetNumberOfHiddenTubes() > 0;
+
+  const double direction[3] =
+    {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  const double length2 = vtkMath::Dot(direction, direction);
+  if (length2 == 0.)
+    {
+    return 0;
+    }
+  double bestT = VTK_DOUBLE_MAX;
+  const Segment* bestSegment = NULL;
+  double bestS = 0.;
+
+  std::vector<vtkIdType> stack(1, 0);
+  while (!stack.empty())
+    {
+    const HierarchyNode& hierarchyNode = internal->Nodes[stack.back()];
+    stack.pop_back();
+
+    // A segment within reach of the ray has its closest point on the ray
+    // inside the inflated bounds: the farther nodes can be skipped.
+    double tMin = 0.;
+    double tMax = 0.;
+    if (!IntersectBox(hierarchyNode.Bounds, p0, direction, tMin, tMax) ||
+        tMin > bestT)
+      {
+      continue;
+      }
+    if (hierarchyNode.Child >= 0)
+      {
+      stack.push_back(hierarchyNode.Child + 1);
+      stack.push_back(hierarchyNode.Child);
+      continue;
+      }
+
+    for (vtkIdType i = hierarchyNode.First;
+         i < hierarchyNode.First + hierarchyNode.Count; ++i)
+      {
+      const Segment& segment = internal->Segments[i];
+      if (hiddenTubes && !node->GetTubeVisibility(segment.TubeId))
+        {
+        continue;
+        }
+      double a[3];
+      double b[3];
+      points->GetPoint(segment.PointIds[0], a);
+      points->GetPoint(segment.PointIds[1], b);
+      const double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      double t = 0.;
+      double s = 0.;
+      const double distance2 =
+        ClosestPointsBetweenSegments(p0, direction, a, ab, t, s);
+      double reach = this->Tolerance;
+      if (tubeRadius)
+        {
+        reach += (1. - s) * tubeRadius->GetTuple1(segment.PointIds[0]) +
+          s * tubeRadius->GetTuple1(segment.PointIds[1]);
+        }
+      if (distance2 > reach * reach)
+        {
+        continue;
+        }
+      // Where the ray enters the tube near its closest point, so that the
+      // segment under the ray wins over its neighbours.
+      const double entry =
+        t - sqrt((reach * reach - distance2) / length2);
+      if (entry < bestT)
+        {
+        bestT = entry;
+        bestS = s;
+        bestSegment = &segment;
+        this->Distance = sqrt(distance2);
+        }
+      }
+    }
+
+  if (!bestSegment)
+    {
+    return 0;
+    }
+
+  double a[3];
+  double b[3];
+  points->GetPoint(bestSegment->PointIds[0], a);
+  points->GetPoint(bestSegment->PointIds[1], b);
+  for (int i = 0; i < 3; ++i)
+    {
+    this->PickPosition[i] = a[i] + bestS * (b[i] - a[i]);
+    }
+  this->TubeId = bestSegment->TubeId;
+  this->PointIndex = bestSegment->Index + (bestS < 0.5 ? 0 : 1);
+  this->ArcLength = bestSegment->ArcLength +
+    bestS * sqrt(vtkMath::Distance2BetweenPoints(a, b));
+
+  vtkMRMLSpatialObjectsNode::TubePickType pick;
+  pick.TubeId = this->TubeId;
+  pick.PointIndex = this->PointIndex;
+  pick.ArcLength = this->ArcLength;
+  pick.Position[0] = this->PickPosition[0];
+  pick.Position[1] = this->PickPosition[1];
+  pick.Position[2] = this->PickPosition[2];
+  node->InvokeEvent(vtkMRMLSpatialObjectsNode::TubePickedEvent, &pick);
+
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsTubePicker::Pick(double x, double y,
+                                            vtkRenderer* renderer)
+{
+  if (!renderer)
+    {
+    return 0;
+    }
+
+  double rayPoints[2][3];
+  for (int i = 0; i < 2; ++i)
+    {
+    // From the near (z = 0) to the far (z = 1) clipping plane
+    double worldPoint[4];
+    renderer->SetDisplayPoint(x, y, i);
+    renderer->DisplayToWorld();
+    renderer->GetWorldPoint(worldPoint);
+    if (worldPoint[3] == 0.)
+      {
+      return 0;
+      }
+    for (int k = 0; k < 3; ++k)
+      {
+      rayPoints[i][k] = worldPoint[k] / worldPoint[3];
+      }
+    }
+
+  return this->Pick(rayPoints[0], rayPoints[1]);
+}
@@ -0,0 +1,121 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkSlicerSpatialObjectsTubePicker -
+// pick the tubes of a spatial objects node along a ray.
+// .SECTION Description
+// The ray is tested against the centerline segments of the tubes, each
+// segment being a cone of the radius of its points (TubeRadius point
+// array) inflated by Tolerance. The segments are stored in a bounding
+// volume hierarchy built by the first pick and rebuilt when the polydata
+// of the node is modified: a pick only visits the segments near the ray,
+// unlike a vtkCellPicker which would test every cell of the tube mesh.
+// The hidden tubes (see vtkMRMLSpatialObjectsNode::SetTubeVisibility())
+// are not picked.
+// A successful pick invokes vtkMRMLSpatialObjectsNode::TubePickedEvent on
+// the node.
+
+#ifndef __vtkSlicerSpatialObjectsTubePicker_h
+#define __vtkSlicerSpatialObjectsTubePicker_h
+
+#include "vtkObject.h"
+#include "vtkSlicerSpatialObjectsModuleLogicExport.h"
+
+class vtkMRMLSpatialObjectsNode;
+class vtkRenderer;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_LOGIC_EXPORT
+vtkSlicerSpatialObjectsTubePicker : public vtkObject
+{
+public:
+  static vtkSlicerSpatialObjectsTubePicker *New();
+  vtkTypeRevisionMacro(vtkSlicerSpatialObjectsTubePicker, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Node whose tubes are picked.
+  virtual void SetSpatialObjectsNode(vtkMRMLSpatialObjectsNode* node);
+  vtkGetObjectMacro(SpatialObjectsNode, vtkMRMLSpatialObjectsNode);
+
+  // Description:
+  // Distance added to the radius of the tubes. 0.5 by default.
+  vtkGetMacro(Tolerance, double);
+  vtkSetClampMacro(Tolerance, double, 0., VTK_DOUBLE_MAX);
+
+  // Description:
+  // If false, the radius of the tubes is ignored: only the Tolerance is
+  // used, e.g. to pick the tubes drawn as lines. True by default.
+  vtkGetMacro(UseTubeRadius, bool);
+  vtkSetMacro(UseTubeRadius, bool);
+  vtkBooleanMacro(UseTubeRadius, bool);
+
+  // Description:
+  // Pick the tube nearest to p0 along the segment [p0, p1], in world
+  // coordinates. Return 1 if a tube is picked, 0 otherwise.
+  int Pick(const double p0[3], const double p1[3]);
+
+  // Description:
+  // Pick the tube under the display position (x, y) of renderer, from
+  // its near to its far clipping plane.
+  int Pick(double x, double y, vtkRenderer* renderer);
+
+  // Description:
+  // Result of the last pick: the index of the picked tube or -1, the index
+  // in the tube of the centerline point nearest to the pick, the distance
+  // along the centerline from the first point of the tube, the picked
+  // position on the centerline and its distance to the ray.
+  vtkGetMacro(TubeId, vtkIdType);
+  vtkGetMacro(PointIndex, vtkIdType);
+  vtkGetMacro(ArcLength, double);
+  vtkGetVector3Macro(PickPosition, double);
+  vtkGetMacro(Distance, double);
+
+  // Description:
+  // Build the hierarchy if the polydata of the node changed since it was
+  // built. Called by Pick().
+  void BuildHierarchy();
+
+  // Description:
+  // Number of segments in the hierarchy.
+  vtkIdType GetNumberOfSegments();
+
+  // Description:
+  // Memory, in kibibytes, used by the hierarchy.
+  unsigned long GetMemorySize();
+
+protected:
+  vtkSlicerSpatialObjectsTubePicker();
+  ~vtkSlicerSpatialObjectsTubePicker();
+  vtkSlicerSpatialObjectsTubePicker(
+    const vtkSlicerSpatialObjectsTubePicker&);
+  void operator=(const vtkSlicerSpatialObjectsTubePicker&);
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+  vtkMRMLSpatialObjectsNode* SpatialObjectsNode;
+  double Tolerance;
+  bool UseTubeRadius;
+
+  vtkIdType TubeId;
+  vtkIdType PointIndex;
+  double ArcLength;
+  double PickPosition[3];
+  double Distance;
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerSpatialObjectsVoxelizer.h"
+
+// SpatialObjects includes
+#include "vtkSpatialObjectsTrace.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+vtkCxxRevisionMacro(vtkSlicerSpatialObjectsVoxelizer, "$Revision: 1.0 $");
+vtkStandardNewMacro(vtkSlicerSpatialObjectsVoxelizer);
+vtkCxxSetObjectMacro(vtkSlicerSpatialObjectsVoxelizer, Input, vtkPolyData);
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+double GetRadius(vtkDataArray* radii, vtkIdType pointId,
+                 double defaultRadius, double minimumRadius)
+{
+  return std::max(minimumRadius,
+                  radii ? std::fabs(radii->GetComponent(pointId, 0)) :
+                  defaultRadius);
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsVoxelizer::vtkSlicerSpatialObjectsVoxelizer()
+{
+  this->Input = 0;
+  this->Spacing[0] = this->Spacing[1] = this->Spacing[2] = 1.;
+  this->Margin = 0.;
+  this->DefaultRadius = 0.;
+  this->MaximumNumberOfVoxels = 512 * 512 * 512;
+  this->Output = vtkImageData::New();
+}
+
+//------------------------------------------------------------------------------
+vtkSlicerSpatialObjectsVoxelizer::~vtkSlicerSpatialObjectsVoxelizer()
+{
+  this->SetInput(0);
+  this->Output->Delete();
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerSpatialObjectsVoxelizer::PrintSelf(ostream& os,
+                                                 vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Input: " << this->Input << "\n";
+  os << indent << "Spacing: " << this->Spacing[0] << " " << this->Spacing[1]
+     << " " << this->Spacing[2] << "\n";
+  os << indent << "Margin: " << this->Margin << "\n";
+  os << indent << "DefaultRadius: " << this->DefaultRadius << "\n";
+  os << indent << "MaximumNumberOfVoxels: " << this->MaximumNumberOfVoxels
+     << "\n";
+}
+
+//------------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsVoxelizer::Update()
+{
+  vtkSpatialObjectsTraceScope("vtkSlicerSpatialObjectsVoxelizer::Update");
+
+  this->Output->Initialize();
+  if (!this->Input || !this->Input->GetPoints() || !this->Input->GetLines())
+    {
+    return 0;
+    }
+  vtkPoints* points = this->Input->GetPoints();
+  vtkCellArray* lines = this->Input->GetLines();
+  vtkDataArray* radii = this->Input->GetPointData()->GetArray("TubeRadius");
+  const double minimumRadius = 0.5 * sqrt(
+    vtkMath::Dot(this->Spacing, this->Spacing));
+
+  // Bounds of the tubes
+  double bounds[6] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX,
+                      -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  for (lines->InitTraversal(); lines->GetNextCell(npts, pts);)
+    {
+    for (vtkIdType j = 0; j < npts; ++j)
+      {
+      const double* point = points->GetPoint(pts[j]);
+      const double radius = this->Margin +
+        GetRadius(radii, pts[j], this->DefaultRadius, minimumRadius);
+      for (int k = 0; k < 3; ++k)
+        {
+        bounds[2 * k] = std::min(bounds[2 * k], point[k] - radius);
+        bounds[2 * k + 1] = std::max(bounds[2 * k + 1], point[k] + radius);
+        }
+      }
+    }
+  if (bounds[0] > bounds[1])
+    {
+    vtkErrorMacro("Update: no tube to rasterize");
+    return 0;
+    }
+
+  double origin[3];
+  int dimensions[3];
+  double numberOfVoxels = 1.;
+  for (int k = 0; k < 3; ++k)
+    {
+    const double first = floor(bounds[2 * k] / this->Spacing[k]);
+    origin[k] = first * this->Spacing[k];
+    dimensions[k] = static_cast<int>(
+      ceil(bounds[2 * k + 1] / this->Spacing[k]) - first) + 1;
+    numberOfVoxels *= dimensions[k];
+    }
+  if (numberOfVoxels > this->MaximumNumberOfVoxels)
+    {
+    vtkErrorMacro("Update: " << numberOfVoxels << " voxels, more than "
+                  << this->MaximumNumberOfVoxels);
+    return 0;
+    }
+  this->Output->SetOrigin(origin);
+  this->Output->SetSpacing(this->Spacing);
+  this->Output->SetDimensions(dimensions);
+  this->Output->SetScalarTypeToUnsignedChar();
+  this->Output->SetNumberOfScalarComponents(1);
+  this->Output->AllocateScalars();
+  unsigned char* voxels =
+    static_cast<unsigned char*>(this->Output->GetScalarPointer());
+  memset(voxels, 0, static_cast<size_t>(numberOfVoxels));
+
+  // Rasterize each segment within its bounds
+  for (lines->InitTraversal(); lines->GetNextCell(npts, pts);)
+    {
+    // A single point is rasterized as a sphere.
+    const vtkIdType numberOfSegments = npts > 1 ? npts - 1 : npts;
+    for (vtkIdType j = 0; j < numberOfSegments; ++j)
+      {
+      const vtkIdType id0 = pts[j];
+      const vtkIdType id1 = pts[npts > 1 ? j + 1 : j];
+      double p0[3];
+      double p1[3];
+      points->GetPoint(id0, p0);
+      points->GetPoint(id1, p1);
+      const double r0 = GetRadius(radii, id0, this->DefaultRadius,
+                                  minimumRadius);
+      const double r1 = GetRadius(radii, id1, this->DefaultRadius,
+                                  minimumRadius);
+      const double direction[3] = {p1[0] - p0[0], p1[1] - p0[1],
+                                   p1[2] - p0[2]};
+      const double length2 = vtkMath::Dot(direction, direction);
+      int extent[6];
+      for (int k = 0; k < 3; ++k)
+        {
+        const double low = std::min(p0[k] - r0, p1[k] - r1);
+        const double high = std::max(p0[k] + r0, p1[k] + r1);
+        extent[2 * k] = std::max(0, static_cast<int>(
+          floor((low - origin[k]) / this->Spacing[k])));
+        extent[2 * k + 1] = std::min(dimensions[k] - 1, static_cast<int>(
+          ceil((high - origin[k]) / this->Spacing[k])));
+        }
+      for (int z = extent[4]; z <= extent[5]; ++z)
+        {
+        for (int y = extent[2]; y <= extent[3]; ++y)
+          {
+          unsigned char* row = voxels +
+            (static_cast<vtkIdType>(z) * dimensions[1] + y) * dimensions[0];
+          for (int x = extent[0]; x <= extent[1]; ++x)
+            {
+            const double voxel[3] = {origin[0] + x * this->Spacing[0],
+                                     origin[1] + y * this->Spacing[1],
+                                     origin[2] + z * this->Spacing[2]};
+            const double offset[3] = {voxel[0] - p0[0], voxel[1] - p0[1],
+                                      voxel[2] - p0[2]};
+            double t = length2 > 0. ?
+              vtkMath::Dot(offset, direction) / length2 : 0.;
+            t = std::min(1., std::max(0., t));
+            const double radius = r0 + t * (r1 - r0);
+            double distance2 = 0.;
+            for (int k = 0; k < 3; ++k)
+              {
+              const double d = offset[k] - t * direction[k];
+              distance2 += d * d;
+              }
+            if (distance2 <= radius * radius)
+              {
+              row[x] = 1;
+              }
+            }
+          }
+        }
+      }
+    }
+  return 1;
+}
@@ -0,0 +1,94 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME vtkSlicerSpatialObjectsVoxelizer -
+// rasterize the tubes of a spatial objects polydata into a label map.
+// .SECTION Description
+// Each segment of the lines of the input, one line per tube, is rasterized
+// as a cone frustum with rounded ends of the radius of its points
+// (TubeRadius point array, DefaultRadius without it): the voxels whose
+// center is inside are set to 1, the others to 0. The radius is at least
+// half the diagonal of a voxel, so that thin tubes stay connected.
+// The output covers the tubes, grown by Margin, with Spacing voxels whose
+// centers are multiples of Spacing.
+
+#ifndef __vtkSlicerSpatialObjectsVoxelizer_h
+#define __vtkSlicerSpatialObjectsVoxelizer_h
+
+#include "vtkObject.h"
+#include "vtkSlicerSpatialObjectsModuleLogicExport.h"
+
+class vtkImageData;
+class vtkPolyData;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_LOGIC_EXPORT
+vtkSlicerSpatialObjectsVoxelizer : public vtkObject
+{
+public:
+  static vtkSlicerSpatialObjectsVoxelizer *New();
+  vtkTypeRevisionMacro(vtkSlicerSpatialObjectsVoxelizer, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Polydata whose lines are rasterized, one tube per line.
+  virtual void SetInput(vtkPolyData* polyData);
+  vtkGetObjectMacro(Input, vtkPolyData);
+
+  // Description:
+  // Spacing of the output, 1 by default.
+  vtkSetVector3Macro(Spacing, double);
+  vtkGetVector3Macro(Spacing, double);
+
+  // Description:
+  // Distance added around the tubes, 0 by default.
+  vtkSetClampMacro(Margin, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(Margin, double);
+
+  // Description:
+  // Radius of the tubes without TubeRadius point array, 0 by default.
+  vtkSetClampMacro(DefaultRadius, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(DefaultRadius, double);
+
+  // Description:
+  // Rasterize the input into the output. Return 0 if the input has no
+  // tube or if the output would be larger than MaximumNumberOfVoxels.
+  int Update();
+
+  // Description:
+  // Maximum number of voxels of the output, 512^3 by default.
+  vtkSetMacro(MaximumNumberOfVoxels, vtkIdType);
+  vtkGetMacro(MaximumNumberOfVoxels, vtkIdType);
+
+  // Description:
+  // Unsigned char label map filled by Update().
+  vtkGetObjectMacro(Output, vtkImageData);
+
+protected:
+  vtkSlicerSpatialObjectsVoxelizer();
+  ~vtkSlicerSpatialObjectsVoxelizer();
+  vtkSlicerSpatialObjectsVoxelizer(const vtkSlicerSpatialObjectsVoxelizer&);
+  void operator=(const vtkSlicerSpatialObjectsVoxelizer&);
+
+  vtkPolyData* Input;
+  double Spacing[3];
+  double Margin;
+  double DefaultRadius;
+  vtkIdType MaximumNumberOfVoxels;
+  vtkImageData* Output;
+};
+
+#endif
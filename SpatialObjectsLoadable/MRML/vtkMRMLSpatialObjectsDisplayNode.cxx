@@ -26,9 +26,11 @@
 
 // VTK includes
 #include <vtkCommand.h>
+#include <vtkNew.h>
+#include <vtkTimerLog.h>
 
 // STD includes
-#include <sstream>
+#include <cstdlib>
 
 //------------------------------------------------------------------------------
 vtkCxxSetReferenceStringMacro(vtkMRMLSpatialObjectsDisplayNode,
@@ -48,6 +50,13 @@ vtkMRMLSpatialObjectsDisplayNode::vtkMRMLSpatialObjectsDisplayNode()
 
   this->ScalarRange[0] = 0.;
   this->ScalarRange[1] = 1.;
+
+  this->BatchUpdateLevel = 0;
+  this->BatchDisabledModify = 0;
+  this->PolyDataModifiedEventPending = false;
+
+  this->PipelineAllocated = false;
+  this->HiddenSince = vtkTimerLog::GetUniversalTime();
 }
 
 //------------------------------------------------------------------------------
@@ -87,11 +96,7 @@ void vtkMRMLSpatialObjectsDisplayNode::ReadXMLAttributes(const char** atts)
 
     if (!strcmp(attName, "colorMode")) 
       {
-      std::stringstream ss;
-      ss << attValue;
-      int colorMode;
-      ss >> colorMode;
-      this->SetColorMode(colorMode);
+      this->SetColorMode(atoi(attValue));
       }
 
     else if (!strcmp(attName, "SpatialObjectsDisplayPropertiesNodeRef"))
@@ -125,6 +130,8 @@ void vtkMRMLSpatialObjectsDisplayNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   Superclass::PrintSelf(os,indent);
   os << indent << "ColorMode: " << this->ColorMode << "\n";
+  os << indent << "BatchUpdateLevel: " << this->BatchUpdateLevel << "\n";
+  os << indent << "PipelineAllocated: " << this->PipelineAllocated << "\n";
 }
 
 //------------------------------------------------------------------------------
@@ -177,6 +184,71 @@ GetSpatialObjectsDisplayPropertiesNode()
   return node;
 }
 
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayPropertiesNode* vtkMRMLSpatialObjectsDisplayNode::
+GetEditableSpatialObjectsDisplayPropertiesNode()
+{
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* node =
+    this->GetSpatialObjectsDisplayPropertiesNode();
+  if (node == NULL)
+    {
+    return NULL;
+    }
+
+  // Count the display nodes observing the properties node.
+  vtkMRMLScene* scene = this->GetScene();
+  const char* className = "vtkMRMLSpatialObjectsDisplayNode";
+  const int numberOfNodes = scene->GetNumberOfNodesByClass(className);
+  int numberOfReferences = 0;
+  for (int i = 0; i < numberOfNodes && numberOfReferences < 2; ++i)
+    {
+    vtkMRMLSpatialObjectsDisplayNode* displayNode =
+      vtkMRMLSpatialObjectsDisplayNode::SafeDownCast(
+        scene->GetNthNodeByClass(i, className));
+    if (displayNode &&
+        displayNode->GetSpatialObjectsDisplayPropertiesNodeID() &&
+        !strcmp(displayNode->GetSpatialObjectsDisplayPropertiesNodeID(),
+                this->SpatialObjectsDisplayPropertiesNodeID))
+      {
+      ++numberOfReferences;
+      }
+    }
+  if (numberOfReferences < 2)
+    {
+    return node;
+    }
+
+  vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> copy;
+  copy->Copy(node);
+  copy->SetPreviewMode(node->GetPreviewMode());
+  scene->AddNode(copy.GetPointer());
+  this->SetAndObserveSpatialObjectsDisplayPropertiesNodeID(copy->GetID());
+  return copy.GetPointer();
+}
+
+//------------------------------------------------------------------------------
+// Copy the properties node before changing a setting, unless it is unchanged.
+#define vtkMRMLSpatialObjectsDisplayPropertySetMacro(name, type) \
+void vtkMRMLSpatialObjectsDisplayNode::Set##name(type value) \
+{ \
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* node = \
+    this->GetSpatialObjectsDisplayPropertiesNode(); \
+  if (node == NULL || node->Get##name() == value) \
+    { \
+    return; \
+    } \
+  this->GetEditableSpatialObjectsDisplayPropertiesNode()->Set##name(value); \
+}
+
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(GlyphGeometry, int)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(GlyphScaleFactor, double)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(LineGlyphResolution, int)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(TubeGlyphRadius, double)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(TubeGlyphNumberOfSides, int)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(PreviewMode, int)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(ScalarInvariant, int)
+vtkMRMLSpatialObjectsDisplayPropertySetMacro(ColorGlyphBy, int)
+
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsDisplayNode::
 SetAndObserveSpatialObjectsDisplayPropertiesNodeID(const char *id )
@@ -209,10 +281,97 @@ SetAndObserveSpatialObjectsDisplayPropertiesNodeID(const char *id )
   // on the properties so we emit the event that the polydata has been modified.
   if (cnode)
     {
+    this->InvokePolyDataModifiedEvent();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayNode::StartBatchUpdate()
+{
+  if (this->BatchUpdateLevel++ == 0)
+    {
+    this->BatchDisabledModify = this->StartModify();
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayNode::EndBatchUpdate()
+{
+  if (this->BatchUpdateLevel <= 0)
+    {
+    vtkErrorMacro("EndBatchUpdate: no matching StartBatchUpdate()");
+    return;
+    }
+  if (--this->BatchUpdateLevel > 0)
+    {
+    return;
+    }
+
+  // Fires the pending ModifiedEvent, which updates the pipeline once.
+  this->EndModify(this->BatchDisabledModify);
+
+  if (this->PolyDataModifiedEventPending)
+    {
+    this->PolyDataModifiedEventPending = false;
     this->InvokeEvent(vtkMRMLModelNode::PolyDataModifiedEvent, this);
     }
 }
 
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayNode::SetVisibility(int visibility)
+{
+  if (this->Visibility && !visibility)
+    {
+    this->HiddenSince = vtkTimerLog::GetUniversalTime();
+    }
+  this->Superclass::SetVisibility(visibility);
+}
+
+//------------------------------------------------------------------------------
+double vtkMRMLSpatialObjectsDisplayNode::GetHiddenTime()
+{
+  if (this->Visibility)
+    {
+    return 0.;
+    }
+  return vtkTimerLog::GetUniversalTime() - this->HiddenSince;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayNode::AllocatePipeline()
+{
+  if (this->PipelineAllocated)
+    {
+    return;
+    }
+  this->CreatePipeline();
+  this->PipelineAllocated = true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsDisplayNode::ReleasePipeline(double minimumHiddenTime)
+{
+  if (!this->PipelineAllocated || this->Visibility ||
+      this->GetHiddenTime() < minimumHiddenTime)
+    {
+    return false;
+    }
+  this->DeletePipeline();
+  this->PipelineAllocated = false;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayNode::InvokePolyDataModifiedEvent()
+{
+  if (this->IsBatchUpdating())
+    {
+    this->PolyDataModifiedEventPending = true;
+    return;
+    }
+  this->InvokeEvent(vtkMRMLModelNode::PolyDataModifiedEvent, this);
+}
+
 //------------------------------------------------------------------------------
 std::vector<int> vtkMRMLSpatialObjectsDisplayNode::GetSupportedColorModes()
 {
@@ -244,3 +403,10 @@ int vtkMRMLSpatialObjectsDisplayNode::GetNthScalarInvariant(int i)
 
   return modes[i];
 }
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayNode::
+GetMemoryUsage(MemoryUsageType& vtkNotUsed(usage))
+{
+  // The default pipeline only passes the input polydata through.
+}
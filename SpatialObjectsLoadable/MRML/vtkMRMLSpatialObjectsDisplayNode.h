@@ -34,6 +34,10 @@
 // Tractography includes
 #include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
 
+// STD includes
+#include <map>
+#include <string>
+
 class vtkMRMLSpatialObjectsDisplayPropertiesNode;
 
 class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT
@@ -155,9 +159,90 @@ public:
   /// MRML node object for vessels glyph.
   vtkGetStringMacro(SpatialObjectsDisplayPropertiesNodeID);
 
+  ///
+  /// Return the display properties node, to be modified. If it is shared
+  /// with other display nodes of the scene, it is first replaced by a copy
+  /// observed by this node only (copy-on-write).
+  vtkMRMLSpatialObjectsDisplayPropertiesNode*
+    GetEditableSpatialObjectsDisplayPropertiesNode();
+
+  ///
+  /// Set the settings of the display properties node. These setters are
+  /// the way to change the display of a single spatial objects node: when
+  /// the value changes, a properties node shared with other display nodes
+  /// is first replaced by a copy (see
+  /// GetEditableSpatialObjectsDisplayPropertiesNode()). Setting a shared
+  /// properties node directly changes the display of all its display nodes.
+  void SetGlyphGeometry(int geometry);
+  void SetGlyphScaleFactor(double scaleFactor);
+  void SetLineGlyphResolution(int resolution);
+  void SetTubeGlyphRadius(double radius);
+  void SetTubeGlyphNumberOfSides(int numberOfSides);
+  void SetPreviewMode(int previewMode);
+  void SetScalarInvariant(int scalarInvariant);
+  void SetColorGlyphBy(int colorGlyphBy);
+
   static int GetNumberOfScalarInvariants();
   static int GetNthScalarInvariant(int i);
 
+  //----------------------------------------------------------------------------
+  /// Memory accounting
+  //----------------------------------------------------------------------------
+  typedef std::map<std::string, unsigned long> MemoryUsageType;
+
+  ///
+  /// Add to \a usage the memory, in kibibytes, of the buffers owned by the
+  /// display pipeline (e.g. tube meshes, glyph sources), one entry per
+  /// buffer. The entries are prefixed by the node tag name.
+  /// The input polydata is owned by the spatial objects node and is not
+  /// counted.
+  virtual void GetMemoryUsage(MemoryUsageType& usage);
+
+  //----------------------------------------------------------------------------
+  /// Batch updates
+  //----------------------------------------------------------------------------
+
+  ///
+  /// Accumulate the modifications of the node until the matching
+  /// EndBatchUpdate(). The Modified and PolyDataModified events, and the
+  /// pipeline updates they trigger, are coalesced into a single one fired
+  /// by the outermost EndBatchUpdate(). Calls can be nested.
+  void StartBatchUpdate();
+  void EndBatchUpdate();
+  bool IsBatchUpdating()const
+  {return this->BatchUpdateLevel > 0;}
+
+  //----------------------------------------------------------------------------
+  /// Lazy display pipeline
+  /// The filters and output buffers of the display pipeline are allocated
+  /// when the node is first made visible. Until then the input polydata is
+  /// passed through. They can be released when the node has been hidden
+  /// for a while, and are allocated again when the node is shown.
+  /// The output port is the one of the AssignAttribute filter created with
+  /// the node: it does not change when the pipeline is allocated or
+  /// released, the mappers connected to it stay connected.
+  //----------------------------------------------------------------------------
+
+  ///
+  /// Keep track of when the node was hidden.
+  virtual void SetVisibility(int visibility);
+
+  ///
+  /// Return for how long, in seconds, the node has been hidden.
+  /// Return 0 if the node is visible.
+  double GetHiddenTime();
+
+  ///
+  /// Return true if the filters of the display pipeline are allocated.
+  bool IsPipelineAllocated()const
+  {return this->PipelineAllocated;}
+
+  ///
+  /// Release the filters and buffers of the display pipeline if the node
+  /// has been hidden for at least \a minimumHiddenTime seconds.
+  /// Return true if the pipeline was released.
+  bool ReleasePipeline(double minimumHiddenTime = 0.);
+
  protected:
   vtkMRMLSpatialObjectsDisplayNode();
   ~vtkMRMLSpatialObjectsDisplayNode();
@@ -172,6 +257,25 @@ public:
 
   static std::vector<int> GetSupportedColorModes();
   int ColorMode;
+
+  /// Invoke PolyDataModifiedEvent, or postpone it to the end of the batch.
+  void InvokePolyDataModifiedEvent();
+
+  int BatchUpdateLevel;
+  int BatchDisabledModify;
+  bool PolyDataModifiedEventPending;
+
+  /// Allocate the display pipeline if it is not. To be called by the
+  /// UpdatePolyDataPipeline() of the subclasses when the node is visible.
+  void AllocatePipeline();
+
+  /// To be reimplemented in subclasses with a lazy pipeline: create, or
+  /// delete, the filters between the input polydata and AssignAttribute.
+  virtual void CreatePipeline() {}
+  virtual void DeletePipeline() {}
+
+  bool PipelineAllocated;
+  double HiddenSince;
 };
 
 #endif
@@ -17,11 +17,14 @@
 
 ==============================================================================*/
 
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
 
 #include "vtkObjectFactory.h"
 
+#include "vtkMRMLScene.h"
 #include "vtkMRMLSpatialObjectsDisplayPropertiesNode.h"
+#include "vtkSpatialObjectsTrace.h"
 
 #include <vtkLineSource.h>
 #include <vtkTubeFilter.h>
@@ -53,10 +56,10 @@ vtkMRMLSpatialObjectsDisplayPropertiesNode()
   // Tube Glyph parameters
   this->TubeGlyphRadius = 0.1;
   this->TubeGlyphNumberOfSides = 6;
+  this->PreviewMode = 0;
 
-  // VTK Objects
+  // VTK Objects, built on demand
   this->GlyphSource = NULL;
-  this->UpdateGlyphSource();
 
   // set the type to user
   this->SetTypeToUser();
@@ -79,6 +82,8 @@ void vtkMRMLSpatialObjectsDisplayPropertiesNode::WriteXML(ostream& oss,
   Superclass::WriteXML(oss, nIndent);
   
   vtkIndent indent(nIndent);
+  oss << indent << " scalarInvariant=\""
+      << this->ScalarInvariant << "\"";
   oss << indent << " glyphGeometry=\""
       << this->GlyphGeometry << "\"";
   oss << indent << " colorGlyphBy=\""
@@ -109,41 +114,31 @@ ReadXMLAttributes(const char** atts)
       attValue = *(atts++);
       if (!strcmp(attName, "glyphGeometry")) 
       {
-      int glyphGeometry;
-      std::stringstream ss;
-      ss << attValue;
-      ss >> glyphGeometry;
-      this->SetGlyphGeometry(glyphGeometry);
+      this->SetGlyphGeometry(atoi(attValue));
+      }
+      else if (!strcmp(attName, "scalarInvariant")) 
+      {
+      this->ScalarInvariant = atoi(attValue);
       }
       else if (!strcmp(attName, "colorGlyphBy")) 
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> ColorGlyphBy;
+      this->ColorGlyphBy = atoi(attValue);
       }
       else if (!strcmp(attName, "glyphScaleFactor")) 
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> GlyphScaleFactor;
+      this->GlyphScaleFactor = atof(attValue);
       }
       else if (!strcmp(attName, "lineGlyphResolution")) 
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> LineGlyphResolution;
+      this->LineGlyphResolution = atoi(attValue);
       }
       else if (!strcmp(attName, "tubeGlyphRadius")) 
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> TubeGlyphRadius;
+      this->TubeGlyphRadius = atof(attValue);
       }
       else if (!strcmp(attName, "tubeGlyphNumberOfSides")) 
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> TubeGlyphNumberOfSides;
+      this->TubeGlyphNumberOfSides = atoi(attValue);
       }
   }
   this->EndModify(disabledModify);
@@ -169,6 +164,67 @@ void vtkMRMLSpatialObjectsDisplayPropertiesNode::Copy(vtkMRMLNode *anode)
   this->EndModify(disabledModify);
   }
 
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsDisplayPropertiesNode::
+HasSameProperties(vtkMRMLSpatialObjectsDisplayPropertiesNode* node)
+{
+  if (node == NULL ||
+      this->GetType() != node->GetType() ||
+      this->GetNumberOfColors() != node->GetNumberOfColors())
+    {
+    return false;
+    }
+  for (int i = 0; i < this->GetNumberOfColors(); ++i)
+    {
+    double color[4];
+    double nodeColor[4];
+    this->GetColor(i, color);
+    node->GetColor(i, nodeColor);
+    if (!std::equal(color, color + 4, nodeColor))
+      {
+      return false;
+      }
+    }
+  return this->ScalarInvariant == node->ScalarInvariant &&
+    this->GlyphGeometry == node->GlyphGeometry &&
+    this->ColorGlyphBy == node->ColorGlyphBy &&
+    this->GlyphScaleFactor == node->GlyphScaleFactor &&
+    this->LineGlyphResolution == node->LineGlyphResolution &&
+    this->TubeGlyphRadius == node->TubeGlyphRadius &&
+    this->TubeGlyphNumberOfSides == node->TubeGlyphNumberOfSides;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayPropertiesNode*
+vtkMRMLSpatialObjectsDisplayPropertiesNode::
+GetSharedNode(vtkMRMLScene* scene,
+              vtkMRMLSpatialObjectsDisplayPropertiesNode* properties)
+{
+  if (scene == NULL || properties == NULL)
+    {
+    return properties;
+    }
+
+  const char* className = "vtkMRMLSpatialObjectsDisplayPropertiesNode";
+  const int numberOfNodes = scene->GetNumberOfNodesByClass(className);
+  for (int i = 0; i < numberOfNodes; ++i)
+    {
+    vtkMRMLSpatialObjectsDisplayPropertiesNode* node =
+      vtkMRMLSpatialObjectsDisplayPropertiesNode::SafeDownCast(
+        scene->GetNthNodeByClass(i, className));
+    if (node && node != properties && node->HasSameProperties(properties))
+      {
+      return node;
+      }
+    }
+
+  if (properties->GetScene() != scene)
+    {
+    scene->AddNode(properties);
+    }
+  return properties;
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsDisplayPropertiesNode::PrintSelf(ostream& os,
                                                            vtkIndent indent)
@@ -188,6 +244,8 @@ void vtkMRMLSpatialObjectsDisplayPropertiesNode::PrintSelf(ostream& os,
      << this->TubeGlyphRadius << "\n";
   os << indent << "TubeGlyphNumberOfSides: "
      << this->TubeGlyphNumberOfSides << "\n";
+  os << indent << "PreviewMode: "
+     << this->PreviewMode << "\n";
 }
 
 //------------------------------------------------------------------------------
@@ -196,14 +254,32 @@ void vtkMRMLSpatialObjectsDisplayPropertiesNode::SetGlyphGeometry(int geometry)
   if ( this->GlyphGeometry != geometry )
     {
     this->GlyphGeometry = geometry;
-    this->UpdateGlyphSource();
+    this->ReleaseGlyphSource();
     this->Modified();
     }
 }
 
+//------------------------------------------------------------------------------
+vtkPolyData* vtkMRMLSpatialObjectsDisplayPropertiesNode::GetGlyphSource()
+{
+  if (this->GlyphSource == NULL)
+    {
+    this->UpdateGlyphSource();
+    }
+  return this->GlyphSource;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsDisplayPropertiesNode::ReleaseGlyphSource()
+{
+  this->SetGlyphSource(NULL);
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsDisplayPropertiesNode::UpdateGlyphSource()
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsDisplayPropertiesNode::UpdateGlyphSource");
+
   vtkDebugMacro("Get Glyph Source");
 
   // Get rid of any old glyph source
@@ -220,7 +296,7 @@ void vtkMRMLSpatialObjectsDisplayPropertiesNode::UpdateGlyphSource()
     case Tubes:
       {
       vtkLineSource *line = vtkLineSource::New();
-      line->SetResolution(this->LineGlyphResolution);
+      line->SetResolution(this->PreviewMode ? 1 : this->LineGlyphResolution);
       line->Update();
 
       // if we are doing tubes, put a tube on the line
@@ -229,7 +305,9 @@ void vtkMRMLSpatialObjectsDisplayPropertiesNode::UpdateGlyphSource()
         vtkTubeFilter *tube = vtkTubeFilter::New();
         tube->SetInput(line->GetOutput());
         tube->SetRadius( this->TubeGlyphRadius );
-        tube->SetNumberOfSides( this->TubeGlyphNumberOfSides );
+        tube->SetNumberOfSides( this->PreviewMode ?
+          std::min(this->TubeGlyphNumberOfSides, 3) :
+          this->TubeGlyphNumberOfSides );
         tube->Update();
 
         this->SetGlyphSource(tube->GetOutput());
@@ -30,6 +30,12 @@
 /// This class inherits from the vtkMRMLColorNode->vtkMRMLColorTableNode
 /// superclasses, used for vtkMRMLModelNodes and vtkMRMLVolumeNodes, in order
 /// toprovide specific lookup tables for the scalar invariant display.
+///
+/// The display nodes with the same settings share a single properties node
+/// (see GetSharedNode()): the settings of a spatial objects node are changed
+/// with the setters of its display nodes (e.g. vtkMRMLSpatialObjectsDisplayNode
+/// ::SetGlyphScaleFactor()), which give the display node a copy of its own
+/// first. The setters of this class change every display node sharing it.
 
 #ifndef __vtkMRMLSpatialObjectsDisplayPropertiesNode_h
 #define __vtkMRMLSpatialObjectsDisplayPropertiesNode_h
@@ -50,12 +56,13 @@ virtual void Set##name (type _arg) \
     if (this->GlyphGeometry == this->Lines || \
         this->GlyphGeometry == this->Tubes) \
       { \
-      this->UpdateGlyphSource(); \
+      this->ReleaseGlyphSource(); \
       } \
     this->Modified(); \
     } \
   }
 
+class vtkMRMLScene;
 class vtkPolyData;
 
 class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT
@@ -90,6 +97,18 @@ public:
   virtual const char* GetNodeTagName()
   {return "SpatialObjectsDisplayProperties";}
 
+  ///
+  /// Return true if node has the same settings and colors as this node.
+  bool HasSameProperties(vtkMRMLSpatialObjectsDisplayPropertiesNode* node);
+
+  ///
+  /// Return the properties node of the scene with the same settings as
+  /// \a properties. If there is none, \a properties is added to the scene
+  /// and returned.
+  static vtkMRMLSpatialObjectsDisplayPropertiesNode* GetSharedNode(
+    vtkMRMLScene* scene,
+    vtkMRMLSpatialObjectsDisplayPropertiesNode* properties);
+
   //----------------------------------------------------------------------------
   /// Display Information:
   /// Types of scalars that may be generated from spatial objects.
@@ -200,6 +219,17 @@ public:
   vtkGetMacro(TubeGlyphNumberOfSides, int);
   SpatialObjectsPropertySetMacro(TubeGlyphNumberOfSides, int);
 
+  ///
+  /// Build a cheaper glyph source while the properties are interactively
+  /// changed: a single segment line and triangular tubes.
+  /// Not saved in the scene. Off by default.
+  /// The glyph source is not rendered: it is only used by the mesh export.
+  /// The rendered tubes have their own preview, see
+  /// vtkMRMLSpatialObjectsTubeDisplayNode::SetTubePreviewMode().
+  vtkGetMacro(PreviewMode, int);
+  SpatialObjectsPropertySetMacro(PreviewMode, int);
+  vtkBooleanMacro(PreviewMode, int);
+
   // TODO other representation properties
 
   //----------------------------------------------------------------------------
@@ -247,7 +277,18 @@ public:
   ///
   /// Get a polydata object according to current glyph display settings
   /// (so a line, sphere, or tube) to use as a source for a glyphing filter.
-  vtkGetObjectMacro(GlyphSource, vtkPolyData);
+  /// The source is only built when it is first requested after a change
+  /// of the glyph settings.
+  virtual vtkPolyData* GetGlyphSource();
+
+  ///
+  /// Return true if the glyph source is built.
+  bool IsGlyphSourceAllocated()
+  {return this->GlyphSource != NULL;}
+
+  ///
+  /// Free the glyph source, it is built again by the next GetGlyphSource().
+  void ReleaseGlyphSource();
 
   ///
   /// Return a text string describing the GlyphScalar variable
@@ -283,6 +324,8 @@ protected:
   double TubeGlyphRadius;
   int TubeGlyphNumberOfSides;
   /// ---- End of parameters that should be written to MRML --- //
+
+  int PreviewMode;
  
   /// Pipeline
   vtkPolyData* GlyphSource;
@@ -23,13 +23,16 @@
 // VTK includes
 #include <vtkConeSource.h>
 #include <vtkGlyph3DMapper.h>
+#include <vtkPolyData.h>
 #include <vtkSource.h>
 
 // MRML includes
 #include "vtkMRMLScene.h"
 #include "vtkMRMLNode.h"
 #include "vtkMRMLSpatialObjectsGlyphDisplayNode.h"
+#include "vtkMRMLSpatialObjectsDisplayPropertiesNode.h"
 #include "vtkMRMLDiffusionTensorDisplayPropertiesNode.h"
+#include "vtkSpatialObjectsTrace.h"
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSpatialObjectsGlyphDisplayNode);
@@ -37,7 +40,8 @@ vtkMRMLNodeNewMacro(vtkMRMLSpatialObjectsGlyphDisplayNode);
 //------------------------------------------------------------------------------
 vtkMRMLSpatialObjectsGlyphDisplayNode::vtkMRMLSpatialObjectsGlyphDisplayNode()
 {
-  this->Glyph3DMapper = vtkGlyph3DMapper::New();
+  // Created when the node is first made visible
+  this->Glyph3DMapper = NULL;
   this->ColorMode = vtkMRMLSpatialObjectsDisplayNode::colorModeScalar;
 }
 
@@ -45,7 +49,10 @@ vtkMRMLSpatialObjectsGlyphDisplayNode::vtkMRMLSpatialObjectsGlyphDisplayNode()
 vtkMRMLSpatialObjectsGlyphDisplayNode::~vtkMRMLSpatialObjectsGlyphDisplayNode()
 {
   this->RemoveObservers(vtkCommand::ModifiedEvent, this->MRMLCallbackCommand);
-  this->Glyph3DMapper->Delete();
+  if (this->Glyph3DMapper)
+    {
+    this->Glyph3DMapper->Delete();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -78,19 +85,29 @@ void vtkMRMLSpatialObjectsGlyphDisplayNode::PrintSelf(ostream& os,
 }
 
 //------------------------------------------------------------------------------
-vtkAlgorithmOutput* vtkMRMLSpatialObjectsGlyphDisplayNode::GetOutputPort()
+void vtkMRMLSpatialObjectsGlyphDisplayNode::CreatePipeline()
+{
+  this->Glyph3DMapper = vtkGlyph3DMapper::New();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsGlyphDisplayNode::DeletePipeline()
 {
-  return this->Glyph3DMapper->GetOutputPort();
+  this->Glyph3DMapper->Delete();
+  this->Glyph3DMapper = NULL;
 }
 
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsGlyphDisplayNode::UpdatePolyDataPipeline() 
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsGlyphDisplayNode::UpdatePolyDataPipeline");
+
   if (!this->GetInputPolyData()|| !this->Visibility)
     {
     return;
     }
 
+  this->AllocatePipeline();
   this->Superclass::UpdatePolyDataPipeline();
 
   /*if (this->Glyph3DMapper)
@@ -104,3 +121,20 @@ void vtkMRMLSpatialObjectsGlyphDisplayNode::UpdatePolyDataPipeline()
   // TODO Create own prooperties nodes
 
 }
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsGlyphDisplayNode::
+GetMemoryUsage(MemoryUsageType& usage)
+{
+  this->Superclass::GetMemoryUsage(usage);
+
+  // Do not build the glyph source of a hidden node.
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* properties =
+    this->GetSpatialObjectsDisplayPropertiesNode();
+  if (properties && properties->IsGlyphSourceAllocated())
+    {
+    const std::string prefix = std::string(this->GetNodeTagName()) + "/";
+    usage[prefix + "GlyphSource"] +=
+      properties->GetGlyphSource()->GetActualMemorySize();
+    }
+}
@@ -68,6 +68,10 @@ public:
   /// Update the pipeline based on this node attributes
   virtual void UpdatePolyDataPipeline();
 
+  ///
+  /// Add the memory used by the glyph source.
+  virtual void GetMemoryUsage(MemoryUsageType& usage);
+
  protected:
   vtkMRMLSpatialObjectsGlyphDisplayNode();
   ~vtkMRMLSpatialObjectsGlyphDisplayNode();
@@ -75,9 +79,9 @@ public:
     const vtkMRMLSpatialObjectsGlyphDisplayNode&);
   void operator=(const vtkMRMLSpatialObjectsGlyphDisplayNode&);
 
-  /// Return the polydata that is processed by the display node.
-  /// This is the polydata that needs to be connected with the mappers.
-  virtual vtkAlgorithmOutput* GetOutputPort();
+  /// Create the glyph mapper when the node is first made visible.
+  virtual void CreatePipeline();
+  virtual void DeletePipeline();
 
   /// Pipeline
   vtkGlyph3DMapper* Glyph3DMapper;
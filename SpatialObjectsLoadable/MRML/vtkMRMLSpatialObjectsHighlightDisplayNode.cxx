@@ -0,0 +1,49 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkObjectFactory.h"
+
+// MRML includes
+#include "vtkMRMLSpatialObjectsHighlightDisplayNode.h"
+
+//------------------------------------------------------------------------------
+vtkMRMLNodeNewMacro(vtkMRMLSpatialObjectsHighlightDisplayNode);
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsHighlightDisplayNode::
+vtkMRMLSpatialObjectsHighlightDisplayNode()
+{
+  // Drawn in a solid color, over the lines and tubes
+  this->ColorMode = vtkMRMLSpatialObjectsDisplayNode::colorModeSolid;
+  this->Color[0] = 1.;
+  this->Color[1] = 1.;
+  this->Color[2] = 0.;
+  this->LineWidth = 3.;
+  this->HideFromEditors = 1;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsHighlightDisplayNode::
+~vtkMRMLSpatialObjectsHighlightDisplayNode()
+{}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsHighlightDisplayNode::PrintSelf(ostream& os,
+                                                          vtkIndent indent)
+{
+  Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,58 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkMRMLSpatialObjectsHighlightDisplayNode -
+/// MRML node to display the highlighted and selected tubes of a spatial
+/// objects node as lines drawn over its other representations.
+///
+/// Its input is vtkMRMLSpatialObjectsNode::GetHighlightedPolyData(), it is
+/// not returned by vtkMRMLSpatialObjectsNode::GetLineDisplayNode().
+
+#ifndef __vtkMRMLSpatialObjectsHighlightDisplayNode_h
+#define __vtkMRMLSpatialObjectsHighlightDisplayNode_h
+
+#include "vtkMRMLSpatialObjectsLineDisplayNode.h"
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT
+vtkMRMLSpatialObjectsHighlightDisplayNode :
+  public vtkMRMLSpatialObjectsLineDisplayNode
+{
+public:
+  static vtkMRMLSpatialObjectsHighlightDisplayNode* New();
+  vtkTypeMacro(vtkMRMLSpatialObjectsHighlightDisplayNode,
+               vtkMRMLSpatialObjectsLineDisplayNode);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  //----------------------------------------------------------------------------
+  /// MRMLNode methods
+  //----------------------------------------------------------------------------
+  virtual vtkMRMLNode* CreateNodeInstance();
+
+  ///
+  /// Get node XML tag name (like Volume, UnstructuredGrid)
+  virtual const char* GetNodeTagName()
+  {return "SpatialObjectsHighlightDisplayNode";}
+
+protected:
+  vtkMRMLSpatialObjectsHighlightDisplayNode();
+  ~vtkMRMLSpatialObjectsHighlightDisplayNode();
+  vtkMRMLSpatialObjectsHighlightDisplayNode(
+    const vtkMRMLSpatialObjectsHighlightDisplayNode&);
+  void operator= (const vtkMRMLSpatialObjectsHighlightDisplayNode&);
+};
+
+#endif
@@ -32,6 +32,7 @@
 #include "vtkMRMLNode.h"
 #include "vtkMRMLSpatialObjectsLineDisplayNode.h"
 #include "vtkMRMLSpatialObjectsDisplayPropertiesNode.h"
+#include "vtkSpatialObjectsTrace.h"
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSpatialObjectsLineDisplayNode);
@@ -77,11 +78,14 @@ void vtkMRMLSpatialObjectsLineDisplayNode::PrintSelf(ostream& os,
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsLineDisplayNode::UpdatePolyDataPipeline() 
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsLineDisplayNode::UpdatePolyDataPipeline");
+
   if (!this->GetInputPolyData() || !this->Visibility)
     {
     return;
     }
 
+  this->AllocatePipeline();
   this->Superclass::UpdatePolyDataPipeline();
 
   // Set display properties according to the
@@ -18,293 +18,3045 @@
 ==============================================================================*/
 
 // VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
 #include <vtkCleanPolyData.h>
 #include <vtkCommand.h>
+#include <vtkDataArray.h>
 #include <vtkEventBroker.h>
 #include <vtkExtractPolyDataGeometry.h>
 #include <vtkExtractSelectedPolyDataIds.h>
 #include <vtkIdTypeArray.h>
 #include <vtkInformation.h>
+#include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPlanes.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
 #include <vtkSelection.h>
 #include <vtkSelectionNode.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+#include <vtkUnsignedCharArray.h>
 
 // TractographyMRML includes
 #include "vtkMRMLSpatialObjectsGlyphDisplayNode.h"
+#include "vtkMRMLSpatialObjectsHighlightDisplayNode.h"
 #include "vtkMRMLSpatialObjectsLineDisplayNode.h"
 #include "vtkMRMLSpatialObjectsNode.h"
 #include "vtkMRMLSpatialObjectsStorageNode.h"
 #include "vtkMRMLSpatialObjectsTubeDisplayNode.h"
+#include "vtkSpatialObjectsTrace.h"
 
 // MRML includes
 #include <vtkMRMLSpatialObjectsDisplayPropertiesNode.h>
 #include <vtkMRMLScene.h>
 
+// ITK includes
+#include <itkVesselTubeSpatialObject.h>
+
 // STD includes
 #include <math.h>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <utility>
 #include <vector>
 #include <algorithm>
 
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Linear congruential generator with a fixed seed, for std::random_shuffle.
+struct ShuffleGenerator
+{
+  ShuffleGenerator() : State(12345u) {}
+  vtkIdType operator()(vtkIdType n)
+  {
+    // The low bits of the state are not random.
+    this->State = this->State * 1103515245u + 12345u;
+    return static_cast<vtkIdType>((this->State >> 1) % n);
+  }
+  vtkTypeUInt32 State;
+};
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+class vtkMRMLSpatialObjectsNode::vtkInternal
+{
+public:
+  vtkInternal();
+
+  // Replace the tubes [FirstTubeId, FirstTubeId + NumberOfTubes[ by Tubes
+  // to revert a ReplaceTubes() call.
+  struct TubeEditStep
+  {
+    vtkIdType FirstTubeId;
+    vtkIdType NumberOfTubes;
+    vtkSmartPointer<vtkPolyData> Tubes;
+  };
+  // The steps are reverted from the last to the first.
+  typedef std::vector<TubeEditStep> TubeEdit;
+
+  unsigned long GetMemorySize(const TubeEdit& edit) const;
+
+  // Revert the steps of edit and record in inverse the steps that revert
+  // them back, in the reverse order: reverting inverse replays edit.
+  bool RevertEdit(vtkMRMLSpatialObjectsNode* node,
+                  TubeEdit& edit, TubeEdit& inverse);
+
+  std::deque<TubeEdit> UndoEdits;
+  std::deque<TubeEdit> RedoEdits;
+  TubeEdit CurrentEdit;
+  int EditNestingLevel;
+  bool RecordEdits;
+
+  // Smallest TubeIDs value greater than all the values of the polydata,
+  // -1 until computed. The edits keep it up to date.
+  double NextTubeID;
+  double AllocateTubeID(vtkDataArray* tubeIDs);
+  // Positions of the tubes inserted in the subsampling
+  ShuffleGenerator InsertionGenerator;
+
+  int BatchUpdateLevel;
+  int BatchDisabledModify;
+  bool SubsamplingPending;
+  bool PolyDataModifiedPending;
+  // Display nodes whose batch was started by StartBatchUpdate()
+  std::vector<vtkSmartPointer<vtkMRMLSpatialObjectsDisplayNode> >
+    BatchedDisplayNodes;
+
+  // Per-tube attributes, see UpdateTubeAttributes()
+  vtkPolyData* TubeAttributesPolyData;
+  vtkTimeStamp TubeAttributesTime;
+  bool TubeAttributesModified;
+  std::vector<int> TubeIdentifiers;
+  std::vector<int> TubeParentIdentifiers;
+  std::vector<vtkIdType> TubeParents;
+  std::vector<int> TubeOrders;
+  std::vector<double> TubeLengths;
+  std::vector<double> TubeMeanRadii;
+  // The children of the tube i are TubeChildren[TubeChildrenOffsets[i]] to
+  // TubeChildren[TubeChildrenOffsets[i + 1] - 1], in increasing order. The
+  // root tubes are stored as the children of the tube NumberOfTubes.
+  std::vector<vtkIdType> TubeChildrenOffsets;
+  std::vector<vtkIdType> TubeChildren;
+  // (TubeIDs value, tube index) sorted by value.
+  std::vector<std::pair<int, vtkIdType> > TubeIndices;
+
+  unsigned long GetTubeAttributesMemorySize() const;
+  void ClearTubeAttributes();
+
+  // Per-tube flags. There may be fewer bits than tubes, the missing bits
+  // are unset. Count is the number of set bits.
+  struct TubeMask
+  {
+    std::vector<bool> Bits;
+    vtkIdType Count;
+    // Tubes whose flag changed since the masked outputs were updated, or
+    // AllModified if too many changed to patch the outputs.
+    std::vector<vtkIdType> ModifiedTubes;
+    bool AllModified;
+
+    TubeMask() : Count(0), AllModified(true) {}
+    bool Get(vtkIdType tubeId) const
+    {
+      return tubeId >= 0 &&
+        tubeId < static_cast<vtkIdType>(this->Bits.size()) &&
+        this->Bits[tubeId];
+    }
+    // Return true if the flag changed.
+    bool Set(vtkIdType tubeId, bool on, vtkIdType numberOfTubes);
+    void Clear();
+    // Follow a ReplaceTubes() edit. Return true if set bits were removed
+    // or moved.
+    bool Replace(vtkIdType firstTubeId, vtkIdType numberOfTubes,
+                 vtkIdType insertedNumberOfTubes);
+    void SetAllModified();
+    void ClearModified();
+  };
+  TubeMask HiddenTubes;
+  TubeMask HighlightedTubes;
+  TubeMask SelectedTubes;
+
+  // Masks read from the scene, as (first tube, number of tubes) runs. They
+  // are applied by UpdateScene(), once the tubes are read.
+  std::vector<vtkIdType> SceneHiddenTubes;
+  std::vector<vtkIdType> SceneHighlightedTubes;
+  std::vector<vtkIdType> SceneSelectedTubes;
+
+  // Prefix sums of per-tube values, updated in O(log(number of tubes)).
+  struct TubePrefixSums
+  {
+    std::vector<vtkIdType> Tree;
+
+    void Build(const std::vector<vtkIdType>& values);
+    void Add(vtkIdType tubeId, vtkIdType value);
+    // Sum of the values of the tubes [0, tubeId[
+    vtkIdType Sum(vtkIdType tubeId) const;
+  };
+
+  // Tubes kept in a masked output, and the location of their lines in it.
+  struct MaskedState
+  {
+    bool Valid;
+    std::vector<bool> Kept;
+    TubePrefixSums KeptCells;
+    TubePrefixSums KeptSizes;
+
+    MaskedState() : Valid(false) {}
+  };
+
+  // Masked outputs, see UpdateMaskedPolyData()
+  vtkSmartPointer<vtkPolyData> VisiblePolyData;
+  vtkSmartPointer<vtkPolyData> HighlightedPolyData;
+  MaskedState VisibleState;
+  MaskedState HighlightedState;
+  vtkPolyData* MaskedPolyDataInput;
+  vtkTimeStamp MaskedPolyDataTime;
+  bool MaskedPolyDataModified;
+  // Location of the tubes in the input connectivity, NumberOfTubes + 1
+  std::vector<vtkIdType> MaskedTubeLocations;
+
+  // Beyond, the masked outputs are rebuilt instead of patched.
+  static const vtkIdType MaximumNumberOfPatchedTubes = 64;
+
+  bool IsKept(vtkIdType tubeId, bool highlighted) const
+  {
+    return !this->HiddenTubes.Get(tubeId) &&
+      (!highlighted || this->HighlightedTubes.Get(tubeId) ||
+       this->SelectedTubes.Get(tubeId));
+  }
+
+  // Copy in output the lines of the tubes of input that are visible and,
+  // if highlighted is true, highlighted or selected. The points and point
+  // data are shared.
+  void BuildMaskedPolyData(vtkPolyData* input, vtkPolyData* output,
+                           bool highlighted, MaskedState& state);
+  // Insert in, or remove from, output the lines of the modified tubes.
+  void PatchMaskedPolyData(vtkPolyData* input, vtkPolyData* output,
+                           bool highlighted, MaskedState& state,
+                           const std::vector<vtkIdType>& modifiedTubes);
+};
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode::vtkInternal::vtkInternal()
+{
+  this->EditNestingLevel = 0;
+  this->RecordEdits = true;
+  this->NextTubeID = -1.;
+  this->BatchUpdateLevel = 0;
+  this->BatchDisabledModify = 0;
+  this->SubsamplingPending = false;
+  this->PolyDataModifiedPending = false;
+  this->TubeAttributesPolyData = NULL;
+  this->TubeAttributesModified = true;
+  this->VisiblePolyData = vtkSmartPointer<vtkPolyData>::New();
+  this->HighlightedPolyData = vtkSmartPointer<vtkPolyData>::New();
+  this->MaskedPolyDataInput = NULL;
+  this->MaskedPolyDataModified = true;
+}
+
+//------------------------------------------------------------------------------
+double vtkMRMLSpatialObjectsNode::vtkInternal::
+AllocateTubeID(vtkDataArray* tubeIDs)
+{
+  if (this->NextTubeID < 0.)
+    {
+    // Scanned once per polydata, the edits update it.
+    this->NextTubeID = 0.;
+    for (vtkIdType i = 0; tubeIDs && i < tubeIDs->GetNumberOfTuples(); ++i)
+      {
+      this->NextTubeID = std::max(this->NextTubeID,
+                                  tubeIDs->GetTuple1(i) + 1.);
+      }
+    }
+  return this->NextTubeID++;
+}
+
+//------------------------------------------------------------------------------
+unsigned long vtkMRMLSpatialObjectsNode::vtkInternal::
+GetTubeAttributesMemorySize() const
+{
+  const size_t size =
+    this->TubeIdentifiers.capacity() * sizeof(int) +
+    this->TubeParentIdentifiers.capacity() * sizeof(int) +
+    this->TubeParents.capacity() * sizeof(vtkIdType) +
+    this->TubeOrders.capacity() * sizeof(int) +
+    this->TubeLengths.capacity() * sizeof(double) +
+    this->TubeMeanRadii.capacity() * sizeof(double) +
+    this->TubeChildrenOffsets.capacity() * sizeof(vtkIdType) +
+    this->TubeChildren.capacity() * sizeof(vtkIdType) +
+    this->TubeIndices.capacity() * sizeof(std::pair<int, vtkIdType>);
+  return static_cast<unsigned long>(size / 1024);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::ClearTubeAttributes()
+{
+  // swap() to release the memory
+  std::vector<int>().swap(this->TubeIdentifiers);
+  std::vector<int>().swap(this->TubeParentIdentifiers);
+  std::vector<vtkIdType>().swap(this->TubeParents);
+  std::vector<int>().swap(this->TubeOrders);
+  std::vector<double>().swap(this->TubeLengths);
+  std::vector<double>().swap(this->TubeMeanRadii);
+  std::vector<vtkIdType>().swap(this->TubeChildrenOffsets);
+  std::vector<vtkIdType>().swap(this->TubeChildren);
+  std::vector<std::pair<int, vtkIdType> >().swap(this->TubeIndices);
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::vtkInternal::TubeMask::
+Set(vtkIdType tubeId, bool on, vtkIdType numberOfTubes)
+{
+  if (this->Get(tubeId) == on)
+    {
+    return false;
+    }
+  if (static_cast<vtkIdType>(this->Bits.size()) < numberOfTubes)
+    {
+    this->Bits.resize(numberOfTubes, false);
+    }
+  this->Bits[tubeId] = on;
+  this->Count += on ? 1 : -1;
+  if (!this->AllModified)
+    {
+    this->ModifiedTubes.push_back(tubeId);
+    if (static_cast<vtkIdType>(this->ModifiedTubes.size()) >
+          vtkInternal::MaximumNumberOfPatchedTubes)
+      {
+      this->SetAllModified();
+      }
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::TubeMask::SetAllModified()
+{
+  this->AllModified = true;
+  this->ModifiedTubes.clear();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::TubeMask::ClearModified()
+{
+  this->AllModified = false;
+  this->ModifiedTubes.clear();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::TubeMask::Clear()
+{
+  // swap() to release the memory
+  std::vector<bool>().swap(this->Bits);
+  this->Count = 0;
+  this->SetAllModified();
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::vtkInternal::TubeMask::
+Replace(vtkIdType firstTubeId, vtkIdType numberOfTubes,
+        vtkIdType insertedNumberOfTubes)
+{
+  const vtkIdType size = static_cast<vtkIdType>(this->Bits.size());
+  if (this->Count == 0 || firstTubeId >= size)
+    {
+    return false;
+    }
+
+  // The replaced tubes keep their flag, the others are removed or
+  // inserted unset.
+  const vtkIdType keptNumberOfTubes =
+    std::min(numberOfTubes, insertedNumberOfTubes);
+  const vtkIdType first = firstTubeId + keptNumberOfTubes;
+  if (first >= size || numberOfTubes == insertedNumberOfTubes)
+    {
+    return false;
+    }
+  const bool moved =
+    std::find(this->Bits.begin() + first, this->Bits.end(), true) !=
+    this->Bits.end();
+  // The tubes are renumbered
+  this->SetAllModified();
+  if (numberOfTubes > keptNumberOfTubes)
+    {
+    const vtkIdType last = std::min(firstTubeId + numberOfTubes, size);
+    for (vtkIdType i = first; i < last; ++i)
+      {
+      this->Count -= this->Bits[i] ? 1 : 0;
+      }
+    this->Bits.erase(this->Bits.begin() + first, this->Bits.begin() + last);
+    }
+  else
+    {
+    this->Bits.insert(this->Bits.begin() + first,
+                      insertedNumberOfTubes - keptNumberOfTubes, false);
+    }
+  return moved;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::TubePrefixSums::
+Build(const std::vector<vtkIdType>& values)
+{
+  // Linear construction of the Fenwick tree
+  const size_t size = values.size() + 1;
+  this->Tree.assign(size, 0);
+  for (size_t i = 1; i < size; ++i)
+    {
+    this->Tree[i] += values[i - 1];
+    const size_t parent = i + (i & (~i + 1));
+    if (parent < size)
+      {
+      this->Tree[parent] += this->Tree[i];
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::TubePrefixSums::
+Add(vtkIdType tubeId, vtkIdType value)
+{
+  const vtkIdType size = static_cast<vtkIdType>(this->Tree.size());
+  for (vtkIdType i = tubeId + 1; i < size; i += i & (-i))
+    {
+    this->Tree[i] += value;
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkIdType vtkMRMLSpatialObjectsNode::vtkInternal::TubePrefixSums::
+Sum(vtkIdType tubeId) const
+{
+  vtkIdType sum = 0;
+  for (vtkIdType i = tubeId; i > 0; i -= i & (-i))
+    {
+    sum += this->Tree[i];
+    }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::
+BuildMaskedPolyData(vtkPolyData* input, vtkPolyData* output, bool highlighted,
+                    MaskedState& state)
+{
+  output->Initialize();
+  output->SetPoints(input->GetPoints());
+  output->GetPointData()->ShallowCopy(input->GetPointData());
+  state.Valid = false;
+
+  vtkCellArray* lines = input->GetLines();
+  const vtkIdType numberOfTubes = lines ? lines->GetNumberOfCells() : 0;
+  if (numberOfTubes == 0 ||
+      (highlighted && this->HighlightedTubes.Count == 0 &&
+       this->SelectedTubes.Count == 0))
+    {
+    return;
+    }
+
+  std::vector<bool>& kept = state.Kept;
+  kept.assign(numberOfTubes, false);
+  std::vector<vtkIdType> keptCells(numberOfTubes, 0);
+  std::vector<vtkIdType> keptSizes(numberOfTubes, 0);
+  const vtkIdType* connectivity = lines->GetPointer();
+  vtkIdType location = 0;
+  vtkIdType numberOfKeptTubes = 0;
+  vtkIdType keptSize = 0;
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    kept[i] = this->IsKept(i, highlighted);
+    if (kept[i])
+      {
+      ++numberOfKeptTubes;
+      keptSize += connectivity[location] + 1;
+      keptCells[i] = 1;
+      keptSizes[i] = connectivity[location] + 1;
+      }
+    location += connectivity[location] + 1;
+    }
+  state.KeptCells.Build(keptCells);
+  state.KeptSizes.Build(keptSizes);
+  state.Valid = true;
+
+  // Copy the connectivity of the runs of kept tubes.
+  vtkNew<vtkIdTypeArray> keptConnectivity;
+  keptConnectivity->SetNumberOfTuples(keptSize);
+  vtkIdType* keptPointer = keptConnectivity->GetPointer(0);
+  vtkCellData* cellData = input->GetCellData();
+  vtkCellData* keptCellData = output->GetCellData();
+  keptCellData->CopyAllocate(cellData, numberOfKeptTubes);
+  vtkIdType runLocation = 0;
+  vtkIdType runSize = 0;
+  vtkIdType keptTubeId = 0;
+  location = 0;
+  for (vtkIdType i = 0; i <= numberOfTubes; ++i)
+    {
+    if (i < numberOfTubes && kept[i])
+      {
+      if (runSize == 0)
+        {
+        runLocation = location;
+        }
+      runSize += connectivity[location] + 1;
+      keptCellData->CopyData(cellData, i, keptTubeId++);
+      }
+    else if (runSize > 0)
+      {
+      memcpy(keptPointer, connectivity + runLocation,
+             runSize * sizeof(vtkIdType));
+      keptPointer += runSize;
+      runSize = 0;
+      }
+    if (i < numberOfTubes)
+      {
+      location += connectivity[location] + 1;
+      }
+    }
+
+  vtkNew<vtkCellArray> keptLines;
+  keptLines->SetCells(numberOfKeptTubes, keptConnectivity.GetPointer());
+  output->SetLines(keptLines.GetPointer());
+
+  // The points are shared with the input, whether they are used by a line
+  // or not: flag the points of the kept tubes for the point based
+  // representations.
+  if (!highlighted)
+    {
+    vtkNew<vtkUnsignedCharArray> pointMask;
+    pointMask->SetName("TubeVisibilityMask");
+    pointMask->SetNumberOfTuples(input->GetNumberOfPoints());
+    pointMask->FillComponent(0, 0);
+    const vtkIdType* keptConnectivityPointer =
+      keptConnectivity->GetPointer(0);
+    for (vtkIdType i = 0; i < keptSize; i += keptConnectivityPointer[i] + 1)
+      {
+      for (vtkIdType j = 1; j <= keptConnectivityPointer[i]; ++j)
+        {
+        pointMask->SetValue(keptConnectivityPointer[i + j], 1);
+        }
+      }
+    output->GetPointData()->AddArray(pointMask.GetPointer());
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned long vtkMRMLSpatialObjectsNode::vtkInternal::
+GetMemorySize(const TubeEdit& edit) const
+{
+  unsigned long size = 0;
+  for (TubeEdit::const_iterator it = edit.begin(); it != edit.end(); ++it)
+    {
+    if (it->Tubes)
+      {
+      size += it->Tubes->GetActualMemorySize();
+      }
+    }
+  return size;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::vtkInternal::
+RevertEdit(vtkMRMLSpatialObjectsNode* node, TubeEdit& edit, TubeEdit& inverse)
+{
+  this->RecordEdits = false;
+  bool res = true;
+  for (TubeEdit::reverse_iterator step = edit.rbegin();
+       res && step != edit.rend(); ++step)
+    {
+    TubeEditStep inverseStep;
+    inverseStep.FirstTubeId = step->FirstTubeId;
+    inverseStep.NumberOfTubes = step->Tubes->GetLines()->GetNumberOfCells();
+    inverseStep.Tubes.TakeReference(
+      node->ExtractTubes(step->FirstTubeId, step->NumberOfTubes));
+
+    res = node->ReplaceTubes(step->FirstTubeId, step->NumberOfTubes,
+                             step->Tubes);
+    inverse.push_back(inverseStep);
+    }
+  this->RecordEdits = true;
+
+  if (!res)
+    {
+    vtkErrorWithObjectMacro(node, << "Failed to revert a tube edit, "
+                            << "clearing the history");
+    node->ClearTubeEditHistory();
+    }
+
+  return res;
+}
+
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSpatialObjectsNode);
 
+//------------------------------------------------------------------------------
+vtkCxxSetObjectMacro(vtkMRMLSpatialObjectsNode, SharedDataToken, vtkObject);
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode::vtkMRMLSpatialObjectsNode()
+{
+  this->Internal = new vtkInternal;
+  this->MaximumNumberOfTubeEdits = 1000;
+  this->SharedDataToken = vtkObject::New();
+  this->SpatialObjectPolicy = this->spatialObjectPolicyKeep;
+  this->PrepareSubsampling();
+  this->SubsamplingRatio = 1;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode::~vtkMRMLSpatialObjectsNode()
+{
+  this->CleanSubsampling();
+  this->SetSharedDataToken(NULL);
+  delete this->Internal;
+}
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Write the TubeIDs values of the tubes of mask as "first count" runs of
+// values. The tube order depends on how the file was read, the values don't.
+void WriteTubeMask(ostream& of, const std::vector<bool>& mask,
+                   vtkMRMLSpatialObjectsNode* node)
+{
+  std::vector<int> identifiers;
+  for (size_t i = 0; i < mask.size(); ++i)
+    {
+    if (mask[i])
+      {
+      identifiers.push_back(
+        node->GetTubeIdentifier(static_cast<vtkIdType>(i)));
+      }
+    }
+  std::sort(identifiers.begin(), identifiers.end());
+  identifiers.erase(std::unique(identifiers.begin(), identifiers.end()),
+                    identifiers.end());
+  const char* separator = "";
+  for (size_t first = 0; first < identifiers.size();)
+    {
+    size_t last = first + 1;
+    while (last < identifiers.size() &&
+           identifiers[last] == identifiers[last - 1] + 1)
+      {
+      ++last;
+      }
+    of << separator << identifiers[first] << " " << last - first;
+    separator = " ";
+    first = last;
+    }
+}
+
+//------------------------------------------------------------------------------
+void ReadTubeMask(const char* value, std::vector<vtkIdType>& runs)
+{
+  runs.clear();
+  char* end = 0;
+  for (long number = strtol(value, &end, 10); end != value;
+       number = strtol(value, &end, 10))
+    {
+    runs.push_back(number);
+    value = end;
+    }
+  if (runs.size() % 2)
+    {
+    runs.pop_back();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Return the tubes whose TubeIDs value is in the runs, given the (TubeIDs
+// value, tube index) pairs sorted by value. The runs, which may come from
+// a malformed or stale scene, are clamped to the number of tubes and
+// cleared.
+void PopTubeMask(std::vector<vtkIdType>& runs,
+                 const std::vector<std::pair<int, vtkIdType> >& tubeIndices,
+                 vtkIdTypeArray* tubeIds)
+{
+  tubeIds->Initialize();
+  const vtkIdType numberOfTubes = static_cast<vtkIdType>(tubeIndices.size());
+  for (size_t i = 0; i + 1 < runs.size(); i += 2)
+    {
+    const vtkIdType count = std::min(runs[i + 1], numberOfTubes);
+    for (vtkIdType j = 0; j < count; ++j)
+      {
+      const vtkIdType value = runs[i] + j;
+      const int identifier = static_cast<int>(value);
+      if (identifier != value)
+        {
+        break;
+        }
+      std::vector<std::pair<int, vtkIdType> >::const_iterator it =
+        std::lower_bound(tubeIndices.begin(), tubeIndices.end(),
+                         std::make_pair(identifier,
+                                        static_cast<vtkIdType>(0)));
+      for (; it != tubeIndices.end() && it->first == identifier; ++it)
+        {
+        tubeIds->InsertNextValue(it->second);
+        }
+      }
+    }
+  std::vector<vtkIdType>().swap(runs);
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::WriteXML(ostream& of, int nIndent)
+{
+  Superclass::WriteXML(of, nIndent);
+
+  vtkIndent indent(nIndent);
+  of << indent << " SubsamplingRatio=\"" << this->SubsamplingRatio << "\"";
+  of << indent << " spatialObjectPolicy=\"" << this->SpatialObjectPolicy
+     << "\"";
+
+  // The masks are saved as runs of tubes, usually a few ones.
+  if (this->Internal->HiddenTubes.Count > 0)
+    {
+    of << indent << " hiddenTubes=\"";
+    WriteTubeMask(of, this->Internal->HiddenTubes.Bits, this);
+    of << "\"";
+    }
+  if (this->Internal->HighlightedTubes.Count > 0)
+    {
+    of << indent << " highlightedTubes=\"";
+    WriteTubeMask(of, this->Internal->HighlightedTubes.Bits, this);
+    of << "\"";
+    }
+  if (this->Internal->SelectedTubes.Count > 0)
+    {
+    of << indent << " selectedTubes=\"";
+    WriteTubeMask(of, this->Internal->SelectedTubes.Bits, this);
+    of << "\"";
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::ReadXMLAttributes(const char** atts)
+{
+  int disabledModify = this->StartModify();
+
+  Superclass::ReadXMLAttributes(atts);
+
+  const char* attName;
+  const char* attValue;
+  while (*atts != NULL) 
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+
+    if (!strcmp(attName, "SubsamplingRatio"))
+      {
+      this->SubsamplingRatio = atof(attValue);
+      }
+    else if (!strcmp(attName, "spatialObjectPolicy"))
+      {
+      this->SpatialObjectPolicy = atoi(attValue);
+      }
+    else if (!strcmp(attName, "hiddenTubes"))
+      {
+      ReadTubeMask(attValue, this->Internal->SceneHiddenTubes);
+      }
+    else if (!strcmp(attName, "highlightedTubes"))
+      {
+      ReadTubeMask(attValue, this->Internal->SceneHighlightedTubes);
+      }
+    else if (!strcmp(attName, "selectedTubes"))
+      {
+      ReadTubeMask(attValue, this->Internal->SceneSelectedTubes);
+      }
+    }
+
+  this->EndModify(disabledModify);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::Copy(vtkMRMLNode *anode)
+{
+  int disabledModify = this->StartModify();
+
+  // vtkMRMLModelNode::Copy would duplicate the polydata,
+  // it is shared below instead.
+  this->vtkMRMLDisplayableNode::Copy(anode);
+
+  vtkMRMLSpatialObjectsNode *node =
+    vtkMRMLSpatialObjectsNode::SafeDownCast(anode);
+
+  if (node)
+    {
+    this->SetSubsamplingRatio(node->SubsamplingRatio);
+    this->SetSpatialObjectPolicy(node->SpatialObjectPolicy);
+    this->SetSpatialObject(node->SpatialObject);
+
+    // Share the buffers of the copied node instead of duplicating them:
+    // the polydata container is new, so adding/removing arrays does not
+    // affect the other node, but the points, cells and arrays are
+    // referenced until DetachSharedData() is called on an edit.
+    if (node->GetPolyData())
+      {
+      vtkPolyData* sharedPolyData = vtkPolyData::New();
+      sharedPolyData->ShallowCopy(node->GetPolyData());
+      this->SetSharedDataToken(node->SharedDataToken);
+
+      // Bypass our SetAndObservePolyData to keep the shuffled ids
+      this->Superclass::SetAndObservePolyData(sharedPolyData);
+      sharedPolyData->Delete();
+
+      this->ShuffledIds->DeepCopy(node->ShuffledIds);
+      this->Internal->NextTubeID = node->Internal->NextTubeID;
+      // The masks are not copied
+      this->Internal->HiddenTubes.Clear();
+      this->Internal->HighlightedTubes.Clear();
+      this->Internal->SelectedTubes.Clear();
+      this->Internal->MaskedPolyDataModified = true;
+      this->UpdateSubsampling();
+      }
+    else
+      {
+      // Do not keep the tubes of a previous polydata
+      this->SetAndObservePolyData(NULL);
+      }
+    }
+
+  this->EndModify(disabledModify);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::PrintSelf(ostream& os, vtkIndent indent)
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "SubsamplingRatio: " << this->SubsamplingRatio << "\n";
+  os << indent << "SpatialObject: " << this->SpatialObject.GetPointer()
+     << "\n";
+  os << indent << "SpatialObjectPolicy: " << this->SpatialObjectPolicy
+     << "\n";
+  os << indent << "DataShared: " << this->IsDataShared() << "\n";
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::UpdateScene(vtkMRMLScene *scene)
+{
+  // Reading the data resets the ratio and the masks.
+  double ActualSubsamplingRatio = this->SubsamplingRatio;
+
+  Superclass::UpdateScene(scene);
+
+  this->StartBatchUpdate();
+
+  // We are forcing the update of the fields as UpdateScene
+  // should only be called after loading data
+  this->SubsamplingRatio = 0.;
+  this->SetSubsamplingRatio(ActualSubsamplingRatio);
+
+  // The masks are matched by TubeIDs value.
+  vtkNew<vtkIdTypeArray> tubeIds;
+  const std::vector<std::pair<int, vtkIdType> >& tubeIndices =
+    this->Internal->TubeIndices;
+  if ((!this->Internal->SceneHiddenTubes.empty() ||
+       !this->Internal->SceneHighlightedTubes.empty() ||
+       !this->Internal->SceneSelectedTubes.empty()) &&
+      !this->UpdateTubeAttributes())
+    {
+    this->Internal->SceneHiddenTubes.clear();
+    this->Internal->SceneHighlightedTubes.clear();
+    this->Internal->SceneSelectedTubes.clear();
+    }
+  if (!this->Internal->SceneHiddenTubes.empty())
+    {
+    PopTubeMask(this->Internal->SceneHiddenTubes, tubeIndices,
+                tubeIds.GetPointer());
+    this->SetTubesVisibility(tubeIds.GetPointer(), false);
+    }
+  if (!this->Internal->SceneHighlightedTubes.empty())
+    {
+    PopTubeMask(this->Internal->SceneHighlightedTubes, tubeIndices,
+                tubeIds.GetPointer());
+    this->SetTubesHighlight(tubeIds.GetPointer(), true);
+    }
+  if (!this->Internal->SceneSelectedTubes.empty())
+    {
+    PopTubeMask(this->Internal->SceneSelectedTubes, tubeIndices,
+                tubeIds.GetPointer());
+    this->SetTubesSelection(tubeIds.GetPointer(), true);
+    }
+
+  this->EndBatchUpdate();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::UpdateReferences()
+{
+  for(int ii = 0; ii < this->GetNumberOfDisplayNodes(); ++ii)
+    {
+    vtkMRMLSpatialObjectsDisplayNode *node = vtkMRMLSpatialObjectsDisplayNode::
+      SafeDownCast(this->GetNthDisplayNode(ii));
+    if (vtkMRMLSpatialObjectsHighlightDisplayNode::SafeDownCast(node))
+      {
+      node->SetInputPolyData(this->GetHighlightedPolyData());
+      }
+    else if (node)
+      {
+      node->SetInputPolyData(this->GetFilteredPolyData());
+      }
+    }
+
+  Superclass::UpdateReferences();
+}
+
+//------------------------------------------------------------------------------
+vtkPolyData* vtkMRMLSpatialObjectsNode::GetFilteredPolyData()
+{
+  if (!this->PolyData || this->Internal->HiddenTubes.Count == 0)
+    {
+    return this->PolyData;
+    }
+  this->UpdateMaskedPolyData();
+  return this->Internal->VisiblePolyData;
+  //return this->CleanPolyDataPostSubsampling->GetOutput();
+}
+
+//------------------------------------------------------------------------------
+vtkPolyData* vtkMRMLSpatialObjectsNode::GetHighlightedPolyData()
+{
+  if (!this->PolyData)
+    {
+    return NULL;
+    }
+  this->UpdateMaskedPolyData();
+  return this->Internal->HighlightedPolyData;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::UpdateMaskedPolyData()
+{
+  vtkInternal* internal = this->Internal;
+  vtkPolyData* polyData = this->GetPolyData();
+  if (!polyData)
+    {
+    return;
+    }
+
+  // A new or edited polydata rebuilds the outputs, a few mask changes
+  // patch them.
+  const bool inputModified = internal->MaskedPolyDataModified ||
+    internal->MaskedPolyDataInput != polyData ||
+    polyData->GetMTime() > internal->MaskedPolyDataTime.GetMTime();
+  vtkInternal::TubeMask* masks[3] =
+    {
+    &internal->HiddenTubes,
+    &internal->HighlightedTubes,
+    &internal->SelectedTubes
+    };
+  bool allModified = inputModified;
+  std::vector<vtkIdType> modifiedTubes;
+  for (int i = 0; i < 3; ++i)
+    {
+    allModified |= masks[i]->AllModified;
+    modifiedTubes.insert(modifiedTubes.end(),
+                         masks[i]->ModifiedTubes.begin(),
+                         masks[i]->ModifiedTubes.end());
+    masks[i]->ClearModified();
+    }
+  if (!allModified && modifiedTubes.empty())
+    {
+    return;
+    }
+
+  vtkSpatialObjectsTraceScope(
+    "vtkMRMLSpatialObjectsNode::UpdateMaskedPolyData");
+
+  std::sort(modifiedTubes.begin(), modifiedTubes.end());
+  modifiedTubes.erase(std::unique(modifiedTubes.begin(), modifiedTubes.end()),
+                      modifiedTubes.end());
+  allModified |= static_cast<vtkIdType>(modifiedTubes.size()) >
+    vtkInternal::MaximumNumberOfPatchedTubes;
+
+  if (inputModified)
+    {
+    vtkCellArray* lines = polyData->GetLines();
+    const vtkIdType numberOfTubes = lines ? lines->GetNumberOfCells() : 0;
+    const vtkIdType* connectivity = lines ? lines->GetPointer() : NULL;
+    internal->MaskedTubeLocations.resize(numberOfTubes + 1);
+    internal->MaskedTubeLocations[0] = 0;
+    for (vtkIdType i = 0; i < numberOfTubes; ++i)
+      {
+      internal->MaskedTubeLocations[i + 1] = internal->MaskedTubeLocations[i] +
+        connectivity[internal->MaskedTubeLocations[i]] + 1;
+      }
+    }
+
+  // The visible tubes are only filtered if tubes are hidden, see
+  // GetFilteredPolyData().
+  if (internal->HiddenTubes.Count == 0)
+    {
+    internal->VisibleState.Valid = false;
+    if (internal->VisiblePolyData->GetNumberOfPoints() > 0)
+      {
+      internal->VisiblePolyData->Initialize();
+      }
+    }
+  else if (allModified || !internal->VisibleState.Valid)
+    {
+    internal->BuildMaskedPolyData(polyData, internal->VisiblePolyData, false,
+                                  internal->VisibleState);
+    }
+  else
+    {
+    internal->PatchMaskedPolyData(polyData, internal->VisiblePolyData, false,
+                                  internal->VisibleState, modifiedTubes);
+    }
+
+  if (allModified || !internal->HighlightedState.Valid ||
+      (internal->HighlightedTubes.Count == 0 &&
+       internal->SelectedTubes.Count == 0))
+    {
+    internal->BuildMaskedPolyData(polyData, internal->HighlightedPolyData,
+                                  true, internal->HighlightedState);
+    }
+  else
+    {
+    internal->PatchMaskedPolyData(polyData, internal->HighlightedPolyData,
+                                  true, internal->HighlightedState,
+                                  modifiedTubes);
+    }
+
+  internal->MaskedPolyDataInput = polyData;
+  internal->MaskedPolyDataModified = false;
+  internal->MaskedPolyDataTime.Modified();
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+GetLineDisplayNode()
+{
+  int nnodes = this->GetNumberOfDisplayNodes();
+  vtkMRMLSpatialObjectsLineDisplayNode *node = NULL;
+
+  for (int n = 0; n < nnodes; ++n)
+    {
+    node = vtkMRMLSpatialObjectsLineDisplayNode::SafeDownCast(
+             this->GetNthDisplayNode(n));
+    // The highlight display node is a line display node too.
+    if (node &&
+        !vtkMRMLSpatialObjectsHighlightDisplayNode::SafeDownCast(node))
+      {
+      break;
+      }
+    node = NULL;
+    }
+
+  return node;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+GetTubeDisplayNode()
+{
+  int nnodes = this->GetNumberOfDisplayNodes();
+  vtkMRMLSpatialObjectsTubeDisplayNode *node = NULL;
+
+  for (int n = 0; n < nnodes; ++n)
+    {
+    node = vtkMRMLSpatialObjectsTubeDisplayNode::SafeDownCast(
+             this->GetNthDisplayNode(n));
+    if (node) 
+      {
+      break;
+      }
+    }
+
+  return node;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+GetGlyphDisplayNode()
+{
+  int nnodes = this->GetNumberOfDisplayNodes();
+  vtkMRMLSpatialObjectsGlyphDisplayNode *node = NULL;
+
+  for (int n = 0; n < nnodes; ++n)
+    {
+    node = vtkMRMLSpatialObjectsGlyphDisplayNode::SafeDownCast(
+            this->GetNthDisplayNode(n));
+    if (node) 
+      {
+      break;
+      }
+    }
+
+  return node;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+GetHighlightDisplayNode()
+{
+  int nnodes = this->GetNumberOfDisplayNodes();
+  vtkMRMLSpatialObjectsHighlightDisplayNode *node = NULL;
+
+  for (int n = 0; n < nnodes; ++n)
+    {
+    node = vtkMRMLSpatialObjectsHighlightDisplayNode::SafeDownCast(
+            this->GetNthDisplayNode(n));
+    if (node)
+      {
+      break;
+      }
+    }
+
+  return node;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+AddLineDisplayNode()
+{
+  vtkMRMLSpatialObjectsDisplayNode *node = this->GetLineDisplayNode();
+  if (node == NULL)
+    {
+    node = vtkMRMLSpatialObjectsLineDisplayNode::New();
+
+    if (this->GetScene())
+      {
+      this->GetScene()->AddNode(node);
+      node->Delete();
+
+      vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphSOPN;
+      vtkMRMLSpatialObjectsDisplayPropertiesNode* properties =
+        vtkMRMLSpatialObjectsDisplayPropertiesNode::GetSharedNode(
+          this->GetScene(), glyphSOPN.GetPointer());
+      node->
+        SetAndObserveSpatialObjectsDisplayPropertiesNodeID(properties->GetID());
+      node->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
+
+      this->AddAndObserveDisplayNodeID(node->GetID());
+      node->SetInputPolyData(this->GetFilteredPolyData());
+      }
+    }
+
+  return node;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+AddTubeDisplayNode()
+{
+  vtkMRMLSpatialObjectsDisplayNode *node = this->GetTubeDisplayNode();
+  if (node == NULL)
+    {
+    node = vtkMRMLSpatialObjectsTubeDisplayNode::New();
+    if (this->GetScene())
+      {
+      this->GetScene()->AddNode(node);
+      node->Delete();
+
+      vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphSOPN;
+      vtkMRMLSpatialObjectsDisplayPropertiesNode* properties =
+        vtkMRMLSpatialObjectsDisplayPropertiesNode::GetSharedNode(
+          this->GetScene(), glyphSOPN.GetPointer());
+      node->
+        SetAndObserveSpatialObjectsDisplayPropertiesNodeID(properties->GetID());
+      node->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
+
+      this->AddAndObserveDisplayNodeID(node->GetID());
+      node->SetInputPolyData(this->GetFilteredPolyData());
+      }
+    }
+
+  return node;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+AddGlyphDisplayNode()
+{
+  vtkMRMLSpatialObjectsDisplayNode *node = this->GetGlyphDisplayNode();
+  if (node == NULL)
+    {
+    node = vtkMRMLSpatialObjectsGlyphDisplayNode::New();
+    if (this->GetScene())
+      {
+      this->GetScene()->AddNode(node);
+      node->Delete();
+
+      vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphSOPN;
+      vtkMRMLSpatialObjectsDisplayPropertiesNode* properties =
+        vtkMRMLSpatialObjectsDisplayPropertiesNode::GetSharedNode(
+          this->GetScene(), glyphSOPN.GetPointer());
+      node->
+        SetAndObserveSpatialObjectsDisplayPropertiesNodeID(properties->GetID());
+      node->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
+
+      this->AddAndObserveDisplayNodeID(node->GetID());
+      node->SetInputPolyData(this->GetFilteredPolyData());
+      }
+    }
+
+  return node;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
+AddHighlightDisplayNode()
+{
+  vtkMRMLSpatialObjectsDisplayNode *node = this->GetHighlightDisplayNode();
+  if (node == NULL)
+    {
+    node = vtkMRMLSpatialObjectsHighlightDisplayNode::New();
+    if (this->GetScene())
+      {
+      this->GetScene()->AddNode(node);
+      node->Delete();
+
+      // Drawn in a solid color, no display properties node is needed.
+      this->AddAndObserveDisplayNodeID(node->GetID());
+      node->SetInputPolyData(this->GetHighlightedPolyData());
+      }
+    }
+
+  return node;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode::TubeNetType* vtkMRMLSpatialObjectsNode::
+GetSpatialObject()
+{
+  if (this->SpatialObject.IsNull() && this->GetPolyData())
+    {
+    this->UpdateSpatialObjectFromPolyData();
+    }
+
+  return this->SpatialObject.GetPointer();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::SetSpatialObject(TubeNetType* spatialObject)
+{
+  if (this->SpatialObject.GetPointer() == spatialObject)
+    {
+    return;
+    }
+
+  this->SpatialObject = spatialObject;
+  this->Modified();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::ApplySpatialObjectPolicy()
+{
+  if (this->SpatialObjectPolicy == this->spatialObjectPolicyRelease &&
+      this->GetPolyData())
+    {
+    vtkDebugMacro(<< this->GetClassName() << "Releasing the SpatialObject");
+    this->SpatialObject = NULL;
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::UpdateSpatialObjectFromPolyData()
+{
+  typedef itk::VesselTubeSpatialObject<3>      TubeType;
+  typedef itk::VesselTubeSpatialObjectPoint<3> TubePointType;
+
+  vtkPolyData* polyData = this->GetPolyData();
+  if (!polyData || !polyData->GetLines())
+    {
+    return;
+    }
+
+  vtkDebugMacro(<< this->GetClassName()
+                << "Rebuilding the SpatialObject from the polydata");
+
+  vtkPointData* pointData = polyData->GetPointData();
+  vtkDataArray* tubeIDs = pointData->GetArray("TubeIDs");
+  vtkDataArray* tubeRadius = pointData->GetArray("TubeRadius");
+  vtkDataArray* tan1 = pointData->GetArray("Tan1");
+  vtkDataArray* tan2 = pointData->GetArray("Tan2");
+  vtkDataArray* medialness = pointData->GetArray("Medialness");
+  vtkDataArray* ridgeness = pointData->GetArray("Ridgeness");
+  vtkDataArray* tubeParentIDs =
+    polyData->GetCellData()->GetArray("TubeParentIDs");
+
+  TubeNetType::Pointer group = TubeNetType::New();
+
+  vtkCellArray* lines = polyData->GetLines();
+  vtkIdType npts = 0;
+  vtkIdType* pts = NULL;
+  int cellIndex = 0;
+  for (lines->InitTraversal(); lines->GetNextCell(npts, pts); ++cellIndex)
+    {
+    if (npts < 1)
+      {
+      continue;
+      }
+
+    TubeType::Pointer tube = TubeType::New();
+    tube->SetId(tubeIDs ?
+      static_cast<int>(tubeIDs->GetTuple1(pts[0])) : cellIndex);
+    if (tubeParentIDs)
+      {
+      tube->SetParentId(
+        static_cast<int>(tubeParentIDs->GetTuple1(cellIndex)));
+      }
+
+    TubeType::PointListType tubePoints(npts);
+    for (vtkIdType i = 0; i < npts; ++i)
+      {
+      const vtkIdType pointId = pts[i];
+      TubePointType& tubePoint = tubePoints[i];
+
+      double* position = polyData->GetPoint(pointId);
+      tubePoint.SetPosition(position[0], position[1], position[2]);
+      tubePoint.SetID(pointId);
+
+      if (tubeRadius)
+        {
+        tubePoint.SetRadius(tubeRadius->GetTuple1(pointId));
+        }
+      if (medialness)
+        {
+        tubePoint.SetMedialness(medialness->GetTuple1(pointId));
+        }
+      if (ridgeness)
+        {
+        tubePoint.SetRidgeness(ridgeness->GetTuple1(pointId));
+        }
+      if (tan1 && tan2)
+        {
+        TubePointType::CovariantVectorType normal;
+        double* n1 = tan1->GetTuple3(pointId);
+        normal[0] = n1[0]; normal[1] = n1[1]; normal[2] = n1[2];
+        tubePoint.SetNormal1(normal);
+
+        double* n2 = tan2->GetTuple3(pointId);
+        normal[0] = n2[0]; normal[1] = n2[1]; normal[2] = n2[2];
+        tubePoint.SetNormal2(normal);
+        }
+      }
+
+    tube->SetPoints(tubePoints);
+    group->AddSpatialObject(tube);
+    }
+
+  this->SpatialObject = group;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::GetMemoryUsage(MemoryUsageType& usage,
+                                               bool includeDisplayNodes)
+{
+  usage["SpatialObject"] += this->GetSpatialObjectMemorySize();
+
+  vtkPolyData* polyData = this->GetPolyData();
+  if (polyData)
+    {
+    if (polyData->GetPoints())
+      {
+      usage["Points"] +=
+        polyData->GetPoints()->GetData()->GetActualMemorySize();
+      }
+    if (polyData->GetLines())
+      {
+      usage["Lines"] += polyData->GetLines()->GetActualMemorySize();
+      }
+
+    vtkPointData* pointData = polyData->GetPointData();
+    for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+      {
+      vtkDataArray* array = pointData->GetArray(i);
+      if (array && array->GetName())
+        {
+        usage[std::string("PointData/") + array->GetName()] +=
+          array->GetActualMemorySize();
+        }
+      }
+    }
+
+  usage["ShuffledIds"] += this->ShuffledIds->GetActualMemorySize();
+
+  unsigned long historySize =
+    this->Internal->GetMemorySize(this->Internal->CurrentEdit);
+  for (size_t i = 0; i < this->Internal->UndoEdits.size(); ++i)
+    {
+    historySize += this->Internal->GetMemorySize(this->Internal->UndoEdits[i]);
+    }
+  for (size_t i = 0; i < this->Internal->RedoEdits.size(); ++i)
+    {
+    historySize += this->Internal->GetMemorySize(this->Internal->RedoEdits[i]);
+    }
+  usage["TubeEditHistory"] += historySize;
+  usage["TubeAttributes"] += this->Internal->GetTubeAttributesMemorySize();
+  vtkInternal::MaskedState* maskedStates[2] =
+    {&this->Internal->VisibleState, &this->Internal->HighlightedState};
+  size_t maskedStatesSize =
+    this->Internal->MaskedTubeLocations.capacity() * sizeof(vtkIdType);
+  for (int i = 0; i < 2; ++i)
+    {
+    maskedStatesSize += maskedStates[i]->Kept.capacity() / 8 +
+      (maskedStates[i]->KeptCells.Tree.capacity() +
+       maskedStates[i]->KeptSizes.Tree.capacity()) * sizeof(vtkIdType);
+    }
+  usage["TubeMasks"] += static_cast<unsigned long>(
+    ((this->Internal->HiddenTubes.Bits.capacity() +
+      this->Internal->HighlightedTubes.Bits.capacity() +
+      this->Internal->SelectedTubes.Bits.capacity()) / 8 +
+     maskedStatesSize) / 1024);
+  // The points and point data arrays are shared with the polydata.
+  vtkPolyData* maskedPolyData[2] =
+    {this->Internal->VisiblePolyData, this->Internal->HighlightedPolyData};
+  for (int i = 0; i < 2; ++i)
+    {
+    vtkDataArray* pointMask =
+      maskedPolyData[i]->GetPointData()->GetArray("TubeVisibilityMask");
+    usage["MaskedLines"] +=
+      (maskedPolyData[i]->GetLines() ?
+       maskedPolyData[i]->GetLines()->GetActualMemorySize() : 0) +
+      maskedPolyData[i]->GetCellData()->GetActualMemorySize() +
+      (pointMask ? pointMask->GetActualMemorySize() : 0);
+    }
+
+  if (!includeDisplayNodes)
+    {
+    return;
+    }
+
+  for (int i = 0; i < this->GetNumberOfDisplayNodes(); ++i)
+    {
+    vtkMRMLSpatialObjectsDisplayNode* displayNode =
+      vtkMRMLSpatialObjectsDisplayNode::SafeDownCast(
+        this->GetNthDisplayNode(i));
+    if (displayNode)
+      {
+      displayNode->GetMemoryUsage(usage);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned long vtkMRMLSpatialObjectsNode::
+GetMemorySize(bool includeDisplayNodes)
+{
+  MemoryUsageType usage;
+  this->GetMemoryUsage(usage, includeDisplayNodes);
+
+  unsigned long size = 0;
+  for (MemoryUsageType::const_iterator it = usage.begin();
+       it != usage.end(); ++it)
+    {
+    size += it->second;
+    }
+
+  return size;
+}
+
+//------------------------------------------------------------------------------
+unsigned long vtkMRMLSpatialObjectsNode::GetSpatialObjectMemorySize()
+{
+  typedef itk::VesselTubeSpatialObject<3>      TubeType;
+  typedef itk::VesselTubeSpatialObjectPoint<3> TubePointType;
+
+  // Don't use GetSpatialObject(), it would rebuild a released object.
+  if (this->SpatialObject.IsNull())
+    {
+    return 0;
+    }
+
+  char childName[] = "Tube";
+  TubeNetType::ChildrenListType* tubeList =
+    this->SpatialObject->GetChildren(999999, childName);
+
+  unsigned long size = sizeof(TubeNetType);
+  for (TubeNetType::ChildrenListType::iterator tubeIT = tubeList->begin();
+       tubeIT != tubeList->end(); ++tubeIT)
+    {
+    TubeType* tube = static_cast<TubeType*>((*tubeIT).GetPointer());
+    size += sizeof(TubeType) +
+            tube->GetPoints().capacity() * sizeof(TubePointType);
+    }
+  delete tubeList;
+
+  return size / 1024;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::IsDataShared()
+{
+  return this->PolyData != NULL &&
+         this->SharedDataToken->GetReferenceCount() > 1;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::DetachSharedData()
+{
+  if (!this->IsDataShared())
+    {
+    return;
+    }
+
+  vtkDebugMacro(<< this->GetClassName() << "Detaching shared polydata");
+
+  // Keep the same polydata container so that the display node pipelines
+  // stay connected, only its buffers are replaced.
+  vtkPolyData* detachedPolyData = vtkPolyData::New();
+  detachedPolyData->DeepCopy(this->PolyData);
+  this->PolyData->ShallowCopy(detachedPolyData);
+  detachedPolyData->Delete();
+
+  vtkObject* token = vtkObject::New();
+  this->SetSharedDataToken(token);
+  token->Delete();
+}
+
+//------------------------------------------------------------------------------
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Move the tuples [from, end[ of an array by delta tuples, growing or
+// shrinking the array accordingly. The moved range is left as is.
+void ShiftTuples(vtkDataArray* array, vtkIdType from, vtkIdType delta)
+{
+  if (delta == 0)
+    {
+    return;
+    }
+
+  const vtkIdType numberOfTuples = array->GetNumberOfTuples();
+  const vtkIdType numberOfMovedTuples = numberOfTuples - from;
+  const int numberOfComponents = array->GetNumberOfComponents();
+
+  if (delta > 0)
+    {
+    // Resize keeps the values, SetNumberOfTuples alone would not.
+    if ((numberOfTuples + delta) * numberOfComponents > array->GetSize())
+      {
+      array->Resize(numberOfTuples + delta);
+      }
+    array->SetNumberOfTuples(numberOfTuples + delta);
+    }
+
+  if (numberOfMovedTuples > 0)
+    {
+    if (array->GetDataType() == VTK_BIT)
+      {
+      for (vtkIdType i = 0; i < numberOfMovedTuples; ++i)
+        {
+        const vtkIdType id = delta > 0 ? numberOfTuples - 1 - i : from + i;
+        array->SetTuple(id + delta, id, array);
+        }
+      }
+    else
+      {
+      const size_t tupleSize =
+        array->GetDataTypeSize() * numberOfComponents;
+      char* data = static_cast<char*>(array->GetVoidPointer(0));
+      memmove(data + (from + delta) * tupleSize,
+              data + from * tupleSize,
+              numberOfMovedTuples * tupleSize);
+      }
+    }
+
+  if (delta < 0)
+    {
+    array->SetNumberOfTuples(numberOfTuples + delta);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Copy count tuples of source into dest, or set them to 0 if source is NULL
+// or doesn't match dest.
+void CopyTuples(vtkDataArray* source, vtkIdType sourceStart,
+                vtkDataArray* dest, vtkIdType destStart, vtkIdType count)
+{
+  const int numberOfComponents = dest->GetNumberOfComponents();
+  if (source && source->GetNumberOfComponents() == numberOfComponents)
+    {
+    for (vtkIdType i = 0; i < count; ++i)
+      {
+      dest->SetTuple(destStart + i, source->GetTuple(sourceStart + i));
+      }
+    return;
+    }
+
+  std::vector<double> zero(numberOfComponents, 0.);
+  for (vtkIdType i = 0; i < count; ++i)
+    {
+    dest->SetTuple(destStart + i, &zero[0]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void CopyArraysStructure(vtkDataSetAttributes* source,
+                         vtkDataSetAttributes* dest)
+{
+  for (int i = 0; i < source->GetNumberOfArrays(); ++i)
+    {
+    vtkDataArray* array = source->GetArray(i);
+    if (!array || !array->GetName())
+      {
+      continue;
+      }
+
+    vtkDataArray* newArray = array->NewInstance();
+    newArray->SetName(array->GetName());
+    newArray->SetNumberOfComponents(array->GetNumberOfComponents());
+    dest->AddArray(newArray);
+    newArray->Delete();
+    }
+
+  if (source->GetScalars() && source->GetScalars()->GetName())
+    {
+    dest->SetActiveScalars(source->GetScalars()->GetName());
+    }
+}
+
+//------------------------------------------------------------------------------
+// Move the data of the range [start, start + removed[ of each array of
+// attributes to make room for inserted tuples, and fill them from the
+// arrays of source with the same name.
+void ReplaceTuples(vtkDataSetAttributes* attributes,
+                   vtkDataSetAttributes* source, vtkIdType sourceStart,
+                   vtkIdType start, vtkIdType removed, vtkIdType inserted)
+{
+  for (int i = 0; i < attributes->GetNumberOfArrays(); ++i)
+    {
+    vtkDataArray* array = attributes->GetArray(i);
+    if (!array)
+      {
+      continue;
+      }
+
+    ShiftTuples(array, start + removed, inserted - removed);
+    vtkDataArray* sourceArray = (source && array->GetName()) ?
+      source->GetArray(array->GetName()) : NULL;
+    CopyTuples(sourceArray, sourceStart, array, start, inserted);
+    array->Modified();
+    }
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::vtkInternal::
+PatchMaskedPolyData(vtkPolyData* input, vtkPolyData* output, bool highlighted,
+                    MaskedState& state,
+                    const std::vector<vtkIdType>& modifiedTubes)
+{
+  const vtkIdType* inputConnectivity = input->GetLines()->GetPointer();
+  vtkCellArray* lines = output->GetLines();
+  vtkIdTypeArray* connectivity = lines->GetData();
+  vtkDataArray* pointMask = highlighted ? NULL :
+    output->GetPointData()->GetArray("TubeVisibilityMask");
+  vtkIdType numberOfKeptTubes = lines->GetNumberOfCells();
+  bool modified = false;
+
+  for (size_t i = 0; i < modifiedTubes.size(); ++i)
+    {
+    const vtkIdType tubeId = modifiedTubes[i];
+    if (tubeId < 0 || tubeId >= static_cast<vtkIdType>(state.Kept.size()) ||
+        this->IsKept(tubeId, highlighted) == state.Kept[tubeId])
+      {
+      continue;
+      }
+    const bool kept = !state.Kept[tubeId];
+    const vtkIdType location = this->MaskedTubeLocations[tubeId];
+    const vtkIdType size = this->MaskedTubeLocations[tubeId + 1] - location;
+    const vtkIdType keptCellId = state.KeptCells.Sum(tubeId);
+    const vtkIdType keptLocation = state.KeptSizes.Sum(tubeId);
+
+    // Only the lines and cell data that follow the tube are moved.
+    ShiftTuples(connectivity, keptLocation + (kept ? 0 : size),
+                kept ? size : -size);
+    numberOfKeptTubes += kept ? 1 : -1;
+    vtkIdType* keptConnectivity = lines->WritePointer(
+      numberOfKeptTubes, connectivity->GetNumberOfTuples());
+    if (kept)
+      {
+      memcpy(keptConnectivity + keptLocation, inputConnectivity + location,
+             size * sizeof(vtkIdType));
+      }
+    ReplaceTuples(output->GetCellData(), input->GetCellData(), tubeId,
+                  keptCellId, kept ? 0 : 1, kept ? 1 : 0);
+    for (vtkIdType j = 1; pointMask && j < size; ++j)
+      {
+      pointMask->SetTuple1(inputConnectivity[location + j], kept ? 1 : 0);
+      }
+
+    state.Kept[tubeId] = kept;
+    state.KeptCells.Add(tubeId, kept ? 1 : -1);
+    state.KeptSizes.Add(tubeId, kept ? size : -size);
+    modified = true;
+    }
+
+  if (!modified)
+    {
+    return;
+    }
+  lines->Modified();
+  if (pointMask)
+    {
+    pointMask->Modified();
+    }
+  // The cells cache is out of date
+  output->DeleteCells();
+  output->Modified();
+}
+
+//------------------------------------------------------------------------------
+vtkIdType vtkMRMLSpatialObjectsNode::GetNumberOfTubes()
+{
+  vtkPolyData* polyData = this->GetPolyData();
+  return (polyData && polyData->GetLines()) ?
+    polyData->GetLines()->GetNumberOfCells() : 0;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::GetTubeLocation(vtkIdType tubeId,
+                                                vtkIdType& location,
+                                                vtkIdType& firstPointId,
+                                                vtkIdType& numberOfPoints)
+{
+  if (tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return false;
+    }
+
+  // The points of the tubes are contiguous: the first point of a tube is
+  // the number of points used by the previous tubes.
+  const vtkIdType* connectivity =
+    this->GetPolyData()->GetLines()->GetPointer();
+  location = 0;
+  firstPointId = 0;
+  for (vtkIdType i = 0; i < tubeId; ++i)
+    {
+    firstPointId += connectivity[location];
+    location += connectivity[location] + 1;
+    }
+  numberOfPoints = connectivity[location];
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::GetTubePoints(vtkIdType tubeId,
+                                              vtkIdType& firstPointId,
+                                              vtkIdType& numberOfPoints)
+{
+  vtkIdType location = 0;
+  return this->GetTubeLocation(tubeId, location, firstPointId, numberOfPoints);
+}
+
+//------------------------------------------------------------------------------
+vtkPolyData* vtkMRMLSpatialObjectsNode::NewTubesPolyData()
+{
+  vtkPolyData* tubes = vtkPolyData::New();
+
+  vtkPoints* points = vtkPoints::New();
+  if (this->GetPolyData() && this->GetPolyData()->GetPoints())
+    {
+    points->SetDataType(this->GetPolyData()->GetPoints()->GetDataType());
+    }
+  tubes->SetPoints(points);
+  points->Delete();
+
+  vtkCellArray* lines = vtkCellArray::New();
+  tubes->SetLines(lines);
+  lines->Delete();
+
+  if (this->GetPolyData())
+    {
+    CopyArraysStructure(this->GetPolyData()->GetPointData(),
+                        tubes->GetPointData());
+    CopyArraysStructure(this->GetPolyData()->GetCellData(),
+                        tubes->GetCellData());
+    }
+
+  return tubes;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::AppendTubePoints(vtkPolyData* tubes,
+                                                 vtkIdType firstPointId,
+                                                 vtkIdType numberOfPoints,
+                                                 bool reverse)
+{
+  vtkPolyData* polyData = this->GetPolyData();
+  vtkPointData* pointData = polyData->GetPointData();
+  vtkPointData* tubesPointData = tubes->GetPointData();
+
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+    const vtkIdType pointId = reverse ?
+      firstPointId + numberOfPoints - 1 - i : firstPointId + i;
+
+    tubes->GetPoints()->InsertNextPoint(polyData->GetPoint(pointId));
+    for (int j = 0; j < tubesPointData->GetNumberOfArrays(); ++j)
+      {
+      vtkDataArray* array = tubesPointData->GetArray(j);
+      vtkDataArray* sourceArray = pointData->GetArray(array->GetName());
+      if (sourceArray)
+        {
+        array->InsertNextTuple(pointId, sourceArray);
+        }
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::AppendTubeCell(vtkPolyData* tubes,
+                                               vtkIdType firstPointId,
+                                               vtkIdType numberOfPoints,
+                                               vtkIdType sourceTubeId)
+{
+  vtkCellArray* lines = tubes->GetLines();
+  lines->InsertNextCell(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+    lines->InsertCellPoint(firstPointId + i);
+    }
+
+  vtkPolyData* polyData = this->GetPolyData();
+  const vtkIdType sourceCellId = polyData->GetNumberOfVerts() + sourceTubeId;
+  vtkCellData* tubesCellData = tubes->GetCellData();
+  for (int i = 0; i < tubesCellData->GetNumberOfArrays(); ++i)
+    {
+    vtkDataArray* array = tubesCellData->GetArray(i);
+    vtkDataArray* sourceArray =
+      polyData->GetCellData()->GetArray(array->GetName());
+    if (sourceArray)
+      {
+      array->InsertNextTuple(sourceCellId, sourceArray);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkPolyData* vtkMRMLSpatialObjectsNode::ExtractTubes(vtkIdType firstTubeId,
+                                                     vtkIdType numberOfTubes)
+{
+  vtkIdType location = 0;
+  vtkIdType firstPointId = 0;
+  vtkIdType numberOfPoints = 0;
+  if (numberOfTubes < 0 ||
+      firstTubeId + numberOfTubes > this->GetNumberOfTubes() ||
+      (numberOfTubes > 0 &&
+       !this->GetTubeLocation(firstTubeId, location,
+                              firstPointId, numberOfPoints)))
+    {
+    vtkErrorMacro(<< "ExtractTubes: invalid tube range [" << firstTubeId
+                  << ", " << firstTubeId + numberOfTubes << "[");
+    return NULL;
+    }
+
+  vtkPolyData* tubes = this->NewTubesPolyData();
+
+  const vtkIdType* connectivity =
+    this->GetPolyData()->GetLines()->GetPointer();
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    numberOfPoints = connectivity[location];
+
+    this->AppendTubeCell(tubes, tubes->GetNumberOfPoints(), numberOfPoints,
+                         firstTubeId + i);
+    this->AppendTubePoints(tubes, firstPointId, numberOfPoints);
+
+    firstPointId += numberOfPoints;
+    location += numberOfPoints + 1;
+    }
+
+  return tubes;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::ReplaceTubes(vtkIdType firstTubeId,
+                                             vtkIdType numberOfTubes,
+                                             vtkPolyData* tubes)
+{
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsNode::ReplaceTubes");
+
+  vtkPolyData* polyData = this->GetPolyData();
+  const vtkIdType oldNumberOfTubes = this->GetNumberOfTubes();
+  if (!polyData || !polyData->GetLines() || !polyData->GetPoints() ||
+      firstTubeId < 0 || numberOfTubes < 0 ||
+      firstTubeId + numberOfTubes > oldNumberOfTubes)
+    {
+    vtkErrorMacro(<< "ReplaceTubes: invalid tube range [" << firstTubeId
+                  << ", " << firstTubeId + numberOfTubes << "[");
+    return false;
+    }
+
+  // The buffers are edited in place
+  this->DetachSharedData();
+
+  this->BeginTubeEdit();
+  if (this->Internal->RecordEdits && this->MaximumNumberOfTubeEdits > 0)
+    {
+    vtkInternal::TubeEditStep step;
+    step.FirstTubeId = firstTubeId;
+    step.NumberOfTubes = tubes && tubes->GetLines() ?
+      tubes->GetLines()->GetNumberOfCells() : 0;
+    step.Tubes.TakeReference(this->ExtractTubes(firstTubeId, numberOfTubes));
+    this->Internal->CurrentEdit.push_back(step);
+    }
+
+  vtkCellArray* lines = polyData->GetLines();
+  const vtkIdType oldConnectivitySize =
+    lines->GetNumberOfConnectivityEntries();
+
+  // Location of the replaced tubes, the end of the arrays when appending
+  vtkIdType location = oldConnectivitySize;
+  vtkIdType firstPointId = polyData->GetNumberOfPoints();
+  vtkIdType numberOfPoints = 0;
+  this->GetTubeLocation(firstTubeId, location, firstPointId, numberOfPoints);
+
+  vtkIdType* connectivity = lines->GetPointer();
+  vtkIdType removedConnectivitySize = 0;
+  vtkIdType removedNumberOfPoints = 0;
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    const vtkIdType npts = connectivity[location + removedConnectivitySize];
+    removedNumberOfPoints += npts;
+    removedConnectivitySize += npts + 1;
+    }
+
+  vtkCellArray* insertedLines = tubes ? tubes->GetLines() : NULL;
+  const vtkIdType insertedNumberOfTubes =
+    insertedLines ? insertedLines->GetNumberOfCells() : 0;
+  const vtkIdType insertedConnectivitySize =
+    insertedLines ? insertedLines->GetNumberOfConnectivityEntries() : 0;
+  const vtkIdType insertedNumberOfPoints =
+    insertedLines ? tubes->GetNumberOfPoints() : 0;
+
+  const vtkIdType pointDelta = insertedNumberOfPoints - removedNumberOfPoints;
+  const vtkIdType tubeDelta = insertedNumberOfTubes - numberOfTubes;
+
+  // Points and point data
+  ShiftTuples(polyData->GetPoints()->GetData(),
+              firstPointId + removedNumberOfPoints, pointDelta);
+  CopyTuples(insertedNumberOfPoints ? tubes->GetPoints()->GetData() : NULL, 0,
+             polyData->GetPoints()->GetData(), firstPointId,
+             insertedNumberOfPoints);
+  polyData->GetPoints()->Modified();
+
+  ReplaceTuples(polyData->GetPointData(),
+                tubes ? tubes->GetPointData() : NULL, 0,
+                firstPointId, removedNumberOfPoints, insertedNumberOfPoints);
+
+  // Cell data, the lines follow the vertices in the cell ids
+  ReplaceTuples(polyData->GetCellData(),
+                tubes ? tubes->GetCellData() : NULL,
+                tubes ? tubes->GetNumberOfVerts() : 0,
+                polyData->GetNumberOfVerts() + firstTubeId,
+                numberOfTubes, insertedNumberOfTubes);
+
+  // Connectivity: move the following cells, write the inserted ones and
+  // renumber the points of the following cells.
+  ShiftTuples(lines->GetData(), location + removedConnectivitySize,
+              insertedConnectivitySize - removedConnectivitySize);
+  const vtkIdType newConnectivitySize = oldConnectivitySize +
+    insertedConnectivitySize - removedConnectivitySize;
+  connectivity = lines->WritePointer(oldNumberOfTubes + tubeDelta,
+                                     newConnectivitySize);
+
+  vtkIdType insertLocation = location;
+  if (insertedLines)
+    {
+    vtkIdType npts = 0;
+    vtkIdType* pts = NULL;
+    for (insertedLines->InitTraversal(); insertedLines->GetNextCell(npts, pts);)
+      {
+      connectivity[insertLocation++] = npts;
+      for (vtkIdType i = 0; i < npts; ++i)
+        {
+        connectivity[insertLocation++] = firstPointId + pts[i];
+        }
+      }
+    }
+
+  if (pointDelta != 0)
+    {
+    for (vtkIdType cellLocation = insertLocation;
+         cellLocation < newConnectivitySize;
+         cellLocation += connectivity[cellLocation] + 1)
+      {
+      for (vtkIdType i = 1; i <= connectivity[cellLocation]; ++i)
+        {
+        connectivity[cellLocation + i] += pointDelta;
+        }
+      }
+    }
+  lines->Modified();
+
+  // The inserted tubes may come from another node or an undo.
+  vtkDataArray* insertedTubeIDs =
+    tubes ? tubes->GetPointData()->GetArray("TubeIDs") : NULL;
+  if (this->Internal->NextTubeID >= 0. && insertedTubeIDs)
+    {
+    for (vtkIdType i = 0; i < insertedTubeIDs->GetNumberOfTuples(); ++i)
+      {
+      this->Internal->NextTubeID = std::max(
+        this->Internal->NextTubeID, insertedTubeIDs->GetTuple1(i) + 1.);
+      }
+    }
+
+  // Subsampling: drop the removed tubes, renumber the following ones and
+  // insert the new ones at random positions. Replacing tubes one for one
+  // keeps the subsampling as is.
+  if (tubeDelta != 0)
+    {
+    vtkIdType numberOfShuffledIds = 0;
+    for (vtkIdType i = 0; i < this->ShuffledIds->GetNumberOfTuples(); ++i)
+      {
+      vtkIdType id = this->ShuffledIds->GetValue(i);
+      if (id >= firstTubeId && id < firstTubeId + numberOfTubes)
+        {
+        continue;
+        }
+      if (id >= firstTubeId + numberOfTubes)
+        {
+        id += tubeDelta;
+        }
+      this->ShuffledIds->SetValue(numberOfShuffledIds++, id);
+      }
+    this->ShuffledIds->SetNumberOfTuples(numberOfShuffledIds);
+    for (vtkIdType i = 0; i < insertedNumberOfTubes; ++i)
+      {
+      const vtkIdType position =
+        this->Internal->InsertionGenerator(numberOfShuffledIds + 1);
+      if (position == numberOfShuffledIds)
+        {
+        this->ShuffledIds->InsertNextValue(firstTubeId + i);
+        }
+      else
+        {
+        this->ShuffledIds->InsertNextValue(
+          this->ShuffledIds->GetValue(position));
+        this->ShuffledIds->SetValue(position, firstTubeId + i);
+        }
+      ++numberOfShuffledIds;
+      }
+    }
+
+  // The cells cache and the SpatialObject are out of date
+  polyData->DeleteCells();
+  this->SpatialObject = NULL;
+
+  this->Internal->TubeAttributesModified = true;
+
+  // Keep the masks on the same tubes.
+  const bool masksModified =
+    this->Internal->HiddenTubes.Replace(
+      firstTubeId, numberOfTubes, insertedNumberOfTubes) |
+    this->Internal->HighlightedTubes.Replace(
+      firstTubeId, numberOfTubes, insertedNumberOfTubes);
+  const bool selectionModified =
+    this->Internal->SelectedTubes.Replace(
+      firstTubeId, numberOfTubes, insertedNumberOfTubes);
+
+  vtkIdType editedRange[3] =
+    {firstTubeId, numberOfTubes, insertedNumberOfTubes};
+  polyData->Modified();
+  // The lines of the masked outputs are out of date.
+  if (this->Internal->HiddenTubes.Count > 0 ||
+      this->Internal->HighlightedTubes.Count > 0 ||
+      this->Internal->SelectedTubes.Count > 0 ||
+      masksModified || selectionModified)
+    {
+    this->UpdateSubsampling();
+    }
+  this->InvokeEvent(vtkMRMLSpatialObjectsNode::TubesModifiedEvent,
+                    editedRange);
+  if (masksModified)
+    {
+    this->InvokeEvent(vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+    }
+  if (selectionModified)
+    {
+    this->InvokeEvent(vtkMRMLSpatialObjectsNode::TubeSelectionModifiedEvent);
+    }
+
+  this->EndTubeEdit();
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::DeleteTube(vtkIdType tubeId)
+{
+  return this->ReplaceTubes(tubeId, 1, NULL);
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::TrimTube(vtkIdType tubeId,
+                                         vtkIdType firstPointIndex,
+                                         vtkIdType numberOfPoints)
+{
+  vtkIdType firstPointId = 0;
+  vtkIdType tubeNumberOfPoints = 0;
+  if (!this->GetTubePoints(tubeId, firstPointId, tubeNumberOfPoints) ||
+      firstPointIndex < 0 || numberOfPoints < 2 ||
+      firstPointIndex + numberOfPoints > tubeNumberOfPoints)
+    {
+    vtkErrorMacro(<< "TrimTube: invalid point range for tube " << tubeId);
+    return false;
+    }
+
+  vtkPolyData* tubes = this->NewTubesPolyData();
+  this->AppendTubePoints(tubes, firstPointId + firstPointIndex,
+                         numberOfPoints);
+  this->AppendTubeCell(tubes, 0, numberOfPoints, tubeId);
+
+  const bool res = this->ReplaceTubes(tubeId, 1, tubes);
+  tubes->Delete();
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+vtkIdType vtkMRMLSpatialObjectsNode::SplitTube(vtkIdType tubeId,
+                                               vtkIdType pointIndex)
+{
+  vtkIdType firstPointId = 0;
+  vtkIdType numberOfPoints = 0;
+  if (!this->GetTubePoints(tubeId, firstPointId, numberOfPoints) ||
+      pointIndex < 1 || pointIndex > numberOfPoints - 2)
+    {
+    vtkErrorMacro(<< "SplitTube: invalid split point for tube " << tubeId);
+    return -1;
+    }
+
+  vtkPolyData* tubes = this->NewTubesPolyData();
+  this->AppendTubePoints(tubes, firstPointId, pointIndex + 1);
+  this->AppendTubeCell(tubes, 0, pointIndex + 1, tubeId);
+  this->AppendTubePoints(tubes, firstPointId + pointIndex,
+                         numberOfPoints - pointIndex);
+  this->AppendTubeCell(tubes, pointIndex + 1, numberOfPoints - pointIndex,
+                       tubeId);
+
+  vtkDataArray* tubeIDs = tubes->GetPointData()->GetArray("TubeIDs");
+  if (tubeIDs)
+    {
+    const double newTubeID = this->Internal->AllocateTubeID(
+      this->GetPolyData()->GetPointData()->GetArray("TubeIDs"));
+    for (vtkIdType i = pointIndex + 1; i < tubes->GetNumberOfPoints(); ++i)
+      {
+      tubeIDs->SetTuple1(i, newTubeID);
+      }
+    }
+
+  const bool res = this->ReplaceTubes(tubeId, 1, tubes);
+  tubes->Delete();
+
+  return res ? tubeId + 1 : -1;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::MergeTubes(vtkIdType tubeId,
+                                           vtkIdType otherTubeId)
+{
+  vtkIdType firstPointId = 0;
+  vtkIdType numberOfPoints = 0;
+  vtkIdType otherFirstPointId = 0;
+  vtkIdType otherNumberOfPoints = 0;
+  if (tubeId == otherTubeId ||
+      !this->GetTubePoints(tubeId, firstPointId, numberOfPoints) ||
+      !this->GetTubePoints(otherTubeId, otherFirstPointId,
+                           otherNumberOfPoints) ||
+      numberOfPoints < 1 || otherNumberOfPoints < 1)
+    {
+    vtkErrorMacro(<< "MergeTubes: can't merge tubes " << tubeId
+                  << " and " << otherTubeId);
+    return false;
+    }
+
+  // Join the closest extremities
+  vtkPolyData* polyData = this->GetPolyData();
+  double begin[3], end[3], otherBegin[3], otherEnd[3];
+  polyData->GetPoint(firstPointId, begin);
+  polyData->GetPoint(firstPointId + numberOfPoints - 1, end);
+  polyData->GetPoint(otherFirstPointId, otherBegin);
+  polyData->GetPoint(otherFirstPointId + otherNumberOfPoints - 1, otherEnd);
+
+  const double distances[4] =
+    {
+    vtkMath::Distance2BetweenPoints(end, otherBegin),
+    vtkMath::Distance2BetweenPoints(end, otherEnd),
+    vtkMath::Distance2BetweenPoints(begin, otherBegin),
+    vtkMath::Distance2BetweenPoints(begin, otherEnd)
+    };
+  const int closest = static_cast<int>(
+    std::min_element(distances, distances + 4) - distances);
+  const bool reverse = (closest >= 2);
+  const bool otherReverse = (closest == 1 || closest == 3);
+
+  // Don't duplicate the junction point if the tubes are connected
+  if (distances[closest] == 0. && otherNumberOfPoints > 1)
+    {
+    if (!otherReverse)
+      {
+      ++otherFirstPointId;
+      }
+    --otherNumberOfPoints;
+    }
+
+  vtkPolyData* tubes = this->NewTubesPolyData();
+  this->AppendTubePoints(tubes, firstPointId, numberOfPoints, reverse);
+  this->AppendTubePoints(tubes, otherFirstPointId, otherNumberOfPoints,
+                         otherReverse);
+  this->AppendTubeCell(tubes, 0, numberOfPoints + otherNumberOfPoints,
+                       tubeId);
+
+  vtkDataArray* tubeIDs = tubes->GetPointData()->GetArray("TubeIDs");
+  if (tubeIDs)
+    {
+    const double tubeID = tubeIDs->GetTuple1(0);
+    for (vtkIdType i = numberOfPoints; i < tubes->GetNumberOfPoints(); ++i)
+      {
+      tubeIDs->SetTuple1(i, tubeID);
+      }
+    }
+
+  // Same number of tubes: the id of the other tube is not affected
+  this->BeginTubeEdit();
+  const bool res = this->ReplaceTubes(tubeId, 1, tubes) &&
+                   this->DeleteTube(otherTubeId);
+  this->EndTubeEdit();
+  tubes->Delete();
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::SetTubeRadius(vtkIdType tubeId, double radius)
+{
+  vtkPolyData* tubes = this->ExtractTubes(tubeId, 1);
+  vtkDataArray* tubeRadius =
+    tubes ? tubes->GetPointData()->GetArray("TubeRadius") : NULL;
+  if (!tubeRadius)
+    {
+    vtkErrorMacro(<< "SetTubeRadius: no radius for tube " << tubeId);
+    if (tubes)
+      {
+      tubes->Delete();
+      }
+    return false;
+    }
+
+  for (vtkIdType i = 0; i < tubeRadius->GetNumberOfTuples(); ++i)
+    {
+    tubeRadius->SetTuple1(i, radius);
+    }
+
+  const bool res = this->ReplaceTubes(tubeId, 1, tubes);
+  tubes->Delete();
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::ScaleTubeRadius(vtkIdType tubeId,
+                                                double factor)
+{
+  vtkPolyData* tubes = this->ExtractTubes(tubeId, 1);
+  vtkDataArray* tubeRadius =
+    tubes ? tubes->GetPointData()->GetArray("TubeRadius") : NULL;
+  if (!tubeRadius)
+    {
+    vtkErrorMacro(<< "ScaleTubeRadius: no radius for tube " << tubeId);
+    if (tubes)
+      {
+      tubes->Delete();
+      }
+    return false;
+    }
+
+  for (vtkIdType i = 0; i < tubeRadius->GetNumberOfTuples(); ++i)
+    {
+    tubeRadius->SetTuple1(i, tubeRadius->GetTuple1(i) * factor);
+    }
+
+  const bool res = this->ReplaceTubes(tubeId, 1, tubes);
+  tubes->Delete();
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::BeginTubeEdit()
+{
+  ++this->Internal->EditNestingLevel;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::EndTubeEdit()
+{
+  if (this->Internal->EditNestingLevel == 0)
+    {
+    vtkErrorMacro(<< "EndTubeEdit: no matching BeginTubeEdit");
+    return;
+    }
+  if (--this->Internal->EditNestingLevel > 0 ||
+      this->Internal->CurrentEdit.empty())
+    {
+    return;
+    }
+
+  this->Internal->UndoEdits.push_back(vtkInternal::TubeEdit());
+  this->Internal->UndoEdits.back().swap(this->Internal->CurrentEdit);
+  this->Internal->RedoEdits.clear();
+
+  while (static_cast<int>(this->Internal->UndoEdits.size()) >
+         this->MaximumNumberOfTubeEdits)
+    {
+    this->Internal->UndoEdits.pop_front();
+    }
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::CanUndoTubeEdit()
+{
+  return this->Internal->EditNestingLevel == 0 &&
+         !this->Internal->UndoEdits.empty();
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::CanRedoTubeEdit()
+{
+  return this->Internal->EditNestingLevel == 0 &&
+         !this->Internal->RedoEdits.empty();
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::UndoTubeEdit()
+{
+  if (!this->CanUndoTubeEdit())
+    {
+    return false;
+    }
+
+  vtkInternal::TubeEdit edit;
+  edit.swap(this->Internal->UndoEdits.back());
+  this->Internal->UndoEdits.pop_back();
+
+  this->Internal->RedoEdits.push_back(vtkInternal::TubeEdit());
+  return this->Internal->RevertEdit(this, edit,
+                                    this->Internal->RedoEdits.back());
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::RedoTubeEdit()
+{
+  if (!this->CanRedoTubeEdit())
+    {
+    return false;
+    }
+
+  vtkInternal::TubeEdit edit;
+  edit.swap(this->Internal->RedoEdits.back());
+  this->Internal->RedoEdits.pop_back();
+
+  this->Internal->UndoEdits.push_back(vtkInternal::TubeEdit());
+  return this->Internal->RevertEdit(this, edit,
+                                    this->Internal->UndoEdits.back());
+}
+
+//------------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNode::GetNumberOfUndoTubeEdits()
+{
+  return static_cast<int>(this->Internal->UndoEdits.size());
+}
+
+//------------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNode::GetNumberOfRedoTubeEdits()
+{
+  return static_cast<int>(this->Internal->RedoEdits.size());
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::ClearTubeEditHistory()
+{
+  this->Internal->UndoEdits.clear();
+  this->Internal->RedoEdits.clear();
+  this->Internal->CurrentEdit.clear();
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::SetMaximumNumberOfTubeEdits(int maximum)
+{
+  maximum = std::max(maximum, 0);
+  if (this->MaximumNumberOfTubeEdits == maximum)
+    {
+    return;
+    }
+
+  this->MaximumNumberOfTubeEdits = maximum;
+  while (static_cast<int>(this->Internal->UndoEdits.size()) > maximum)
+    {
+    this->Internal->UndoEdits.pop_front();
+    }
+  while (static_cast<int>(this->Internal->RedoEdits.size()) > maximum)
+    {
+    this->Internal->RedoEdits.pop_front();
+    }
+  this->Modified();
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::UpdateTubeAttributes()
+{
+  vtkInternal* internal = this->Internal;
+  vtkPolyData* polyData = this->GetPolyData();
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  if (numberOfTubes == 0)
+    {
+    if (!internal->TubeIdentifiers.empty())
+      {
+      internal->ClearTubeAttributes();
+      }
+    return false;
+    }
+  if (!internal->TubeAttributesModified &&
+      internal->TubeAttributesPolyData == polyData &&
+      static_cast<vtkIdType>(internal->TubeIdentifiers.size()) ==
+        numberOfTubes &&
+      polyData->GetMTime() <= internal->TubeAttributesTime.GetMTime())
+    {
+    return true;
+    }
+
+  vtkSpatialObjectsTraceScope(
+    "vtkMRMLSpatialObjectsNode::UpdateTubeAttributes");
+
+  vtkDataArray* tubeIDs = polyData->GetPointData()->GetArray("TubeIDs");
+  vtkDataArray* tubeRadius = polyData->GetPointData()->GetArray("TubeRadius");
+  vtkDataArray* tubeParentIDs =
+    polyData->GetCellData()->GetArray("TubeParentIDs");
+  if (tubeParentIDs && tubeParentIDs->GetNumberOfTuples() < numberOfTubes)
+    {
+    tubeParentIDs = NULL;
+    }
+
+  internal->TubeIdentifiers.resize(numberOfTubes);
+  internal->TubeParentIdentifiers.resize(numberOfTubes);
+  internal->TubeLengths.resize(numberOfTubes);
+  internal->TubeMeanRadii.resize(numberOfTubes);
+  internal->TubeIndices.resize(numberOfTubes);
+
+  const vtkIdType* connectivity = polyData->GetLines()->GetPointer();
+  vtkIdType location = 0;
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    const vtkIdType npts = connectivity[location];
+    const vtkIdType* pts = connectivity + location + 1;
+    location += npts + 1;
+
+    internal->TubeIdentifiers[i] = (tubeIDs && npts > 0) ?
+      static_cast<int>(tubeIDs->GetTuple1(pts[0])) : static_cast<int>(i);
+    internal->TubeParentIdentifiers[i] = tubeParentIDs ?
+      static_cast<int>(tubeParentIDs->GetTuple1(i)) : -1;
+    internal->TubeIndices[i] =
+      std::make_pair(internal->TubeIdentifiers[i], i);
+
+    double length = 0.;
+    double radius = 0.;
+    double previous[3];
+    double current[3];
+    for (vtkIdType j = 0; j < npts; ++j)
+      {
+      polyData->GetPoint(pts[j], current);
+      if (j > 0)
+        {
+        length += sqrt(vtkMath::Distance2BetweenPoints(previous, current));
+        }
+      previous[0] = current[0];
+      previous[1] = current[1];
+      previous[2] = current[2];
+      if (tubeRadius)
+        {
+        radius += tubeRadius->GetTuple1(pts[j]);
+        }
+      }
+    internal->TubeLengths[i] = length;
+    internal->TubeMeanRadii[i] = npts > 0 ? radius / npts : 0.;
+    }
+  std::sort(internal->TubeIndices.begin(), internal->TubeIndices.end());
+
+  // Parents
+  internal->TubeParents.assign(numberOfTubes, -1);
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    if (internal->TubeParentIdentifiers[i] == -1)
+      {
+      continue;
+      }
+    std::vector<std::pair<int, vtkIdType> >::const_iterator parent =
+      std::lower_bound(internal->TubeIndices.begin(),
+                       internal->TubeIndices.end(),
+                       std::make_pair(internal->TubeParentIdentifiers[i],
+                                      static_cast<vtkIdType>(0)));
+    if (parent != internal->TubeIndices.end() &&
+        parent->first == internal->TubeParentIdentifiers[i] &&
+        parent->second != i)
+      {
+      internal->TubeParents[i] = parent->second;
+      }
+    }
+
+  // Orders: walk up to a tube whose order is known. A tube whose parent is
+  // on the path being walked closes a cycle, it becomes a root.
+  internal->TubeOrders.assign(numberOfTubes, -1);
+  std::vector<char> onPath(numberOfTubes, 0);
+  std::vector<vtkIdType> path;
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    path.clear();
+    vtkIdType tube = i;
+    while (tube >= 0 && internal->TubeOrders[tube] < 0 && !onPath[tube])
+      {
+      onPath[tube] = 1;
+      path.push_back(tube);
+      tube = internal->TubeParents[tube];
+      }
+    int order = -1;
+    if (tube >= 0 && internal->TubeOrders[tube] >= 0)
+      {
+      order = internal->TubeOrders[tube];
+      }
+    else if (tube >= 0)
+      {
+      internal->TubeParents[path.back()] = -1;
+      }
+    for (std::vector<vtkIdType>::reverse_iterator it = path.rbegin();
+         it != path.rend(); ++it)
+      {
+      internal->TubeOrders[*it] = ++order;
+      onPath[*it] = 0;
+      }
+    }
+
+  // Children
+  internal->TubeChildrenOffsets.assign(numberOfTubes + 2, 0);
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    const vtkIdType parent = internal->TubeParents[i] >= 0 ?
+      internal->TubeParents[i] : numberOfTubes;
+    ++internal->TubeChildrenOffsets[parent + 1];
+    }
+  for (vtkIdType i = 0; i <= numberOfTubes; ++i)
+    {
+    internal->TubeChildrenOffsets[i + 1] += internal->TubeChildrenOffsets[i];
+    }
+  internal->TubeChildren.resize(numberOfTubes);
+  std::vector<vtkIdType> childCounts(numberOfTubes + 1, 0);
+  for (vtkIdType i = 0; i < numberOfTubes; ++i)
+    {
+    const vtkIdType parent = internal->TubeParents[i] >= 0 ?
+      internal->TubeParents[i] : numberOfTubes;
+    internal->TubeChildren[internal->TubeChildrenOffsets[parent] +
+                           childCounts[parent]++] = i;
+    }
+
+  internal->TubeAttributesPolyData = polyData;
+  internal->TubeAttributesModified = false;
+  internal->TubeAttributesTime.Modified();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNode::GetTubeIdentifier(vtkIdType tubeId)
+{
+  if (!this->UpdateTubeAttributes() ||
+      tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return -1;
+    }
+  return this->Internal->TubeIdentifiers[tubeId];
+}
+
+//------------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNode::GetTubeParentIdentifier(vtkIdType tubeId)
+{
+  if (!this->UpdateTubeAttributes() ||
+      tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return -1;
+    }
+  return this->Internal->TubeParentIdentifiers[tubeId];
+}
+
+//------------------------------------------------------------------------------
+vtkIdType vtkMRMLSpatialObjectsNode::GetTubeParent(vtkIdType tubeId)
+{
+  if (!this->UpdateTubeAttributes() ||
+      tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return -1;
+    }
+  return this->Internal->TubeParents[tubeId];
+}
+
+//------------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNode::GetTubeOrder(vtkIdType tubeId)
+{
+  if (!this->UpdateTubeAttributes() ||
+      tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return -1;
+    }
+  return this->Internal->TubeOrders[tubeId];
+}
+
+//------------------------------------------------------------------------------
+double vtkMRMLSpatialObjectsNode::GetTubeLength(vtkIdType tubeId)
+{
+  if (!this->UpdateTubeAttributes() ||
+      tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return 0.;
+    }
+  return this->Internal->TubeLengths[tubeId];
+}
+
+//------------------------------------------------------------------------------
+double vtkMRMLSpatialObjectsNode::GetTubeMeanRadius(vtkIdType tubeId)
+{
+  if (!this->UpdateTubeAttributes() ||
+      tubeId < 0 || tubeId >= this->GetNumberOfTubes())
+    {
+    return 0.;
+    }
+  return this->Internal->TubeMeanRadii[tubeId];
+}
 
 //------------------------------------------------------------------------------
-vtkMRMLSpatialObjectsNode::vtkMRMLSpatialObjectsNode()
+vtkIdType vtkMRMLSpatialObjectsNode::GetNumberOfTubeChildren(vtkIdType tubeId)
 {
-  this->PrepareSubsampling();
-  this->SubsamplingRatio = 1;
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  if (!this->UpdateTubeAttributes() || tubeId < -1 || tubeId >= numberOfTubes)
+    {
+    return 0;
+    }
+  const vtkIdType parent = tubeId >= 0 ? tubeId : numberOfTubes;
+  return this->Internal->TubeChildrenOffsets[parent + 1] -
+         this->Internal->TubeChildrenOffsets[parent];
 }
 
 //------------------------------------------------------------------------------
-vtkMRMLSpatialObjectsNode::~vtkMRMLSpatialObjectsNode()
+vtkIdType vtkMRMLSpatialObjectsNode::GetTubeChild(vtkIdType tubeId,
+                                                  vtkIdType index)
 {
-  this->CleanSubsampling();
+  const vtkIdType numberOfChildren = this->GetNumberOfTubeChildren(tubeId);
+  if (index < 0 || index >= numberOfChildren)
+    {
+    return -1;
+    }
+  const vtkIdType parent = tubeId >= 0 ? tubeId : this->GetNumberOfTubes();
+  return this->Internal->TubeChildren[
+    this->Internal->TubeChildrenOffsets[parent] + index];
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLSpatialObjectsNode::WriteXML(ostream& of, int nIndent)
+vtkIdType vtkMRMLSpatialObjectsNode::FindTube(int identifier)
 {
-  Superclass::WriteXML(of, nIndent);
+  if (!this->UpdateTubeAttributes())
+    {
+    return -1;
+    }
+  std::vector<std::pair<int, vtkIdType> >::const_iterator it =
+    std::lower_bound(this->Internal->TubeIndices.begin(),
+                     this->Internal->TubeIndices.end(),
+                     std::make_pair(identifier, static_cast<vtkIdType>(0)));
+  return (it != this->Internal->TubeIndices.end() && it->first == identifier) ?
+    it->second : -1;
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLSpatialObjectsNode::ReadXMLAttributes(const char** atts)
+void vtkMRMLSpatialObjectsNode::TubeMasksModified(unsigned long event)
 {
-  int disabledModify = this->StartModify();
+  // The masks record the modified tubes, see UpdateMaskedPolyData().
+  // The highlighted and selected tubes are drawn by the highlight display
+  // node.
+  if (this->GetScene() && !this->GetHighlightDisplayNode() &&
+      (this->Internal->HighlightedTubes.Count > 0 ||
+       this->Internal->SelectedTubes.Count > 0))
+    {
+    this->AddHighlightDisplayNode();
+    }
 
-  Superclass::ReadXMLAttributes(atts);
+  // Deferred while batching
+  this->UpdateSubsampling();
 
-  const char* attName;
-  const char* attValue;
-  while (*atts != NULL) 
+  this->InvokeEvent(event);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::SetTubeVisibility(vtkIdType tubeId,
+                                                  bool visible)
+{
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  if (tubeId < 0 || tubeId >= numberOfTubes ||
+      !this->Internal->HiddenTubes.Set(tubeId, !visible, numberOfTubes))
     {
-    attName = *(atts++);
-    attValue = *(atts++);
+    return;
+    }
+  this->TubeMasksModified(vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+}
 
-    if (!strcmp(attName, "SubsamplingRatio"))
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::GetTubeVisibility(vtkIdType tubeId)
+{
+  return tubeId >= 0 && tubeId < this->GetNumberOfTubes() &&
+    !this->Internal->HiddenTubes.Get(tubeId);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::SetTubesVisibility(vtkIdTypeArray* tubeIds,
+                                                   bool visible)
+{
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  bool modified = false;
+  for (vtkIdType i = 0; tubeIds && i < tubeIds->GetNumberOfTuples(); ++i)
+    {
+    const vtkIdType tubeId = tubeIds->GetValue(i);
+    if (tubeId >= 0 && tubeId < numberOfTubes)
       {
-      this->SubsamplingRatio = atof(attValue);
+      modified |=
+        this->Internal->HiddenTubes.Set(tubeId, !visible, numberOfTubes);
       }
     }
-
-  this->EndModify(disabledModify);
+  if (modified)
+    {
+    this->TubeMasksModified(
+      vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+    }
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLSpatialObjectsNode::Copy(vtkMRMLNode *anode)
+void vtkMRMLSpatialObjectsNode::SetTubeBranchVisibility(vtkIdType tubeId,
+                                                        bool visible)
 {
-  int disabledModify = this->StartModify();
-
-  Superclass::Copy(anode);
-
-  vtkMRMLSpatialObjectsNode *node =
-    vtkMRMLSpatialObjectsNode::SafeDownCast(anode);
-
-  if (node)
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  if (tubeId < 0 || tubeId >= numberOfTubes || !this->UpdateTubeAttributes())
     {
-    this->SetSubsamplingRatio(node->SubsamplingRatio);
+    return;
     }
 
-  this->EndModify(disabledModify);
+  vtkInternal* internal = this->Internal;
+  bool modified = false;
+  std::vector<vtkIdType> branch(1, tubeId);
+  while (!branch.empty())
+    {
+    const vtkIdType tube = branch.back();
+    branch.pop_back();
+    modified |= internal->HiddenTubes.Set(tube, !visible, numberOfTubes);
+    branch.insert(branch.end(),
+                  internal->TubeChildren.begin() +
+                    internal->TubeChildrenOffsets[tube],
+                  internal->TubeChildren.begin() +
+                    internal->TubeChildrenOffsets[tube + 1]);
+    }
+  if (modified)
+    {
+    this->TubeMasksModified(
+      vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+    }
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLSpatialObjectsNode::PrintSelf(ostream& os, vtkIndent indent)
+void vtkMRMLSpatialObjectsNode::ShowAllTubes()
 {
-  Superclass::PrintSelf(os,indent);
+  if (this->Internal->HiddenTubes.Count == 0)
+    {
+    return;
+    }
+  this->Internal->HiddenTubes.Clear();
+  this->TubeMasksModified(vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLSpatialObjectsNode::UpdateScene(vtkMRMLScene *scene)
+vtkIdType vtkMRMLSpatialObjectsNode::GetNumberOfHiddenTubes()
 {
-  Superclass::UpdateScene(scene);
-
-  int disabledModify = this->StartModify();
+  return this->Internal->HiddenTubes.Count;
+}
 
-  // We are forcing the update of the fields as UpdateScene
-  // should only be called after loading data
-  double ActualSubsamplingRatio = this->SubsamplingRatio;
-  this->SubsamplingRatio = 0.;
-  this->SetSubsamplingRatio(ActualSubsamplingRatio);
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::SetTubeHighlight(vtkIdType tubeId,
+                                                 bool highlight)
+{
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  if (tubeId < 0 || tubeId >= numberOfTubes ||
+      !this->Internal->HighlightedTubes.Set(tubeId, highlight,
+                                            numberOfTubes))
+    {
+    return;
+    }
+  this->TubeMasksModified(vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+}
 
-  this->EndModify(disabledModify);
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::GetTubeHighlight(vtkIdType tubeId)
+{
+  return tubeId < this->GetNumberOfTubes() &&
+    this->Internal->HighlightedTubes.Get(tubeId);
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLSpatialObjectsNode::UpdateReferences()
+void vtkMRMLSpatialObjectsNode::SetTubesHighlight(vtkIdTypeArray* tubeIds,
+                                                  bool highlight)
 {
-  for(int ii = 0; ii < this->GetNumberOfDisplayNodes(); ++ii)
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  bool modified = false;
+  for (vtkIdType i = 0; tubeIds && i < tubeIds->GetNumberOfTuples(); ++i)
     {
-    vtkMRMLSpatialObjectsDisplayNode *node = vtkMRMLSpatialObjectsDisplayNode::
-      SafeDownCast(this->GetNthDisplayNode(ii));
-    if (node)
+    const vtkIdType tubeId = tubeIds->GetValue(i);
+    if (tubeId >= 0 && tubeId < numberOfTubes)
       {
-      node->SetInputPolyData(this->GetFilteredPolyData());
+      modified |= this->Internal->HighlightedTubes.Set(tubeId, highlight,
+                                                       numberOfTubes);
       }
     }
-
-  Superclass::UpdateReferences();
+  if (modified)
+    {
+    this->TubeMasksModified(
+      vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+    }
 }
 
 //------------------------------------------------------------------------------
-vtkPolyData* vtkMRMLSpatialObjectsNode::GetFilteredPolyData()
+vtkIdType vtkMRMLSpatialObjectsNode::GetNumberOfHighlightedTubes()
 {
-  return this->PolyData;
-  //return this->CleanPolyDataPostSubsampling->GetOutput();
+  return this->Internal->HighlightedTubes.Count;
 }
 
 //------------------------------------------------------------------------------
-vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
-GetLineDisplayNode()
+void vtkMRMLSpatialObjectsNode::ClearTubeHighlight()
 {
-  int nnodes = this->GetNumberOfDisplayNodes();
-  vtkMRMLSpatialObjectsLineDisplayNode *node = NULL;
+  if (this->Internal->HighlightedTubes.Count == 0)
+    {
+    return;
+    }
+  this->Internal->HighlightedTubes.Clear();
+  this->TubeMasksModified(vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent);
+}
 
-  for (int n = 0; n < nnodes; ++n)
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::SetSelectedTubes(vtkIdTypeArray* tubeIds)
+{
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  vtkInternal::TubeMask selectedTubes;
+  for (vtkIdType i = 0; tubeIds && i < tubeIds->GetNumberOfTuples(); ++i)
     {
-    node = vtkMRMLSpatialObjectsLineDisplayNode::SafeDownCast(
-             this->GetNthDisplayNode(n));
-    if (node)
+    const vtkIdType tubeId = tubeIds->GetValue(i);
+    if (tubeId >= 0 && tubeId < numberOfTubes)
       {
-      break;
+      selectedTubes.Set(tubeId, true, numberOfTubes);
       }
     }
 
-  return node;
+  vtkInternal::TubeMask& currentSelectedTubes = this->Internal->SelectedTubes;
+  if (selectedTubes.Count == currentSelectedTubes.Count &&
+      (selectedTubes.Count == 0 ||
+       selectedTubes.Bits == currentSelectedTubes.Bits))
+    {
+    return;
+    }
+  currentSelectedTubes.Bits.swap(selectedTubes.Bits);
+  currentSelectedTubes.Count = selectedTubes.Count;
+  currentSelectedTubes.SetAllModified();
+  this->TubeMasksModified(
+    vtkMRMLSpatialObjectsNode::TubeSelectionModifiedEvent);
 }
 
 //------------------------------------------------------------------------------
-vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
-GetTubeDisplayNode()
+void vtkMRMLSpatialObjectsNode::SetTubesSelection(vtkIdTypeArray* tubeIds,
+                                                  bool selected)
 {
-  int nnodes = this->GetNumberOfDisplayNodes();
-  vtkMRMLSpatialObjectsTubeDisplayNode *node = NULL;
-
-  for (int n = 0; n < nnodes; ++n)
+  const vtkIdType numberOfTubes = this->GetNumberOfTubes();
+  bool modified = false;
+  for (vtkIdType i = 0; tubeIds && i < tubeIds->GetNumberOfTuples(); ++i)
     {
-    node = vtkMRMLSpatialObjectsTubeDisplayNode::SafeDownCast(
-             this->GetNthDisplayNode(n));
-    if (node) 
+    const vtkIdType tubeId = tubeIds->GetValue(i);
+    if (tubeId >= 0 && tubeId < numberOfTubes)
       {
-      break;
+      modified |= this->Internal->SelectedTubes.Set(tubeId, selected,
+                                                    numberOfTubes);
       }
     }
-
-  return node;
+  if (modified)
+    {
+    this->TubeMasksModified(
+      vtkMRMLSpatialObjectsNode::TubeSelectionModifiedEvent);
+    }
 }
 
-//----------------------------------------------------------------------------
-vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
-GetGlyphDisplayNode()
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::GetSelectedTubes(vtkIdTypeArray* tubeIds)
 {
-  int nnodes = this->GetNumberOfDisplayNodes();
-  vtkMRMLSpatialObjectsGlyphDisplayNode *node = NULL;
-
-  for (int n = 0; n < nnodes; ++n)
+  if (!tubeIds)
     {
-    node = vtkMRMLSpatialObjectsGlyphDisplayNode::SafeDownCast(
-            this->GetNthDisplayNode(n));
-    if (node) 
+    return;
+    }
+  const vtkInternal::TubeMask& selectedTubes = this->Internal->SelectedTubes;
+  tubeIds->SetNumberOfComponents(1);
+  tubeIds->SetNumberOfTuples(selectedTubes.Count);
+  vtkIdType index = 0;
+  for (size_t i = 0; index < selectedTubes.Count; ++i)
+    {
+    if (selectedTubes.Bits[i])
       {
-      break;
+      tubeIds->SetValue(index++, static_cast<vtkIdType>(i));
       }
     }
-
-  return node;
 }
 
 //------------------------------------------------------------------------------
-vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
-AddLineDisplayNode()
+vtkIdType vtkMRMLSpatialObjectsNode::GetNumberOfSelectedTubes()
 {
-  vtkMRMLSpatialObjectsDisplayNode *node = this->GetLineDisplayNode();
-  if (node == NULL)
-    {
-    node = vtkMRMLSpatialObjectsLineDisplayNode::New();
-
-    if (this->GetScene())
-      {
-      this->GetScene()->AddNode(node);
-      node->Delete();
+  return this->Internal->SelectedTubes.Count;
+}
 
-      vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphSOPN;
-      this->GetScene()->AddNode(glyphSOPN.GetPointer());
-      node->
-        SetAndObserveSpatialObjectsDisplayPropertiesNodeID(glyphSOPN->GetID());
-      node->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::IsTubeSelected(vtkIdType tubeId)
+{
+  return tubeId < this->GetNumberOfTubes() &&
+    this->Internal->SelectedTubes.Get(tubeId);
+}
 
-      this->AddAndObserveDisplayNodeID(node->GetID());
-      node->SetInputPolyData(this->GetFilteredPolyData());
-      }
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::ClearTubeSelection()
+{
+  if (this->Internal->SelectedTubes.Count == 0)
+    {
+    return;
     }
+  this->Internal->SelectedTubes.Clear();
+  this->TubeMasksModified(
+    vtkMRMLSpatialObjectsNode::TubeSelectionModifiedEvent);
+}
 
-  return node;
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::ProcessMRMLEvents(vtkObject* caller,
+                                                  unsigned long event,
+                                                  void* callData)
+{
+  // The tube edits of a batch modify the polydata in place, the display
+  // pipelines are updated once by EndBatchUpdate().
+  if (this->IsBatchUpdating() && this->PolyData != NULL &&
+      caller == this->PolyData && event == vtkCommand::ModifiedEvent)
+    {
+    this->Internal->PolyDataModifiedPending = true;
+    return;
+    }
+  this->Superclass::ProcessMRMLEvents(caller, event, callData);
 }
 
-//----------------------------------------------------------------------------
-vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
-AddTubeDisplayNode()
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::StartBatchUpdate()
 {
-  vtkMRMLSpatialObjectsDisplayNode *node = this->GetTubeDisplayNode();
-  if (node == NULL)
+  if (this->Internal->BatchUpdateLevel++ > 0)
     {
-    node = vtkMRMLSpatialObjectsTubeDisplayNode::New();
-    if (this->GetScene())
-      {
-      this->GetScene()->AddNode(node);
-      node->Delete();
+    return;
+    }
 
-      vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphSOPN;
-      this->GetScene()->AddNode(glyphSOPN.GetPointer());
-      node->
-        SetAndObserveSpatialObjectsDisplayPropertiesNodeID(glyphSOPN->GetID());
-      node->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
+  this->Internal->BatchDisabledModify = this->StartModify();
+  this->Internal->SubsamplingPending = false;
+  this->Internal->PolyDataModifiedPending = false;
 
-      this->AddAndObserveDisplayNodeID(node->GetID());
-      node->SetInputPolyData(this->GetFilteredPolyData());
+  for (int i = 0; i < this->GetNumberOfDisplayNodes(); ++i)
+    {
+    vtkMRMLSpatialObjectsDisplayNode* node =
+      vtkMRMLSpatialObjectsDisplayNode::SafeDownCast(
+        this->GetNthDisplayNode(i));
+    if (node)
+      {
+      node->StartBatchUpdate();
+      this->Internal->BatchedDisplayNodes.push_back(node);
       }
     }
-
-  return node;
 }
 
-//----------------------------------------------------------------------------
-vtkMRMLSpatialObjectsDisplayNode* vtkMRMLSpatialObjectsNode::
-AddGlyphDisplayNode()
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsNode::EndBatchUpdate()
 {
-  vtkMRMLSpatialObjectsDisplayNode *node = this->GetGlyphDisplayNode();
-  if (node == NULL)
+  if (this->Internal->BatchUpdateLevel <= 0)
     {
-    node = vtkMRMLSpatialObjectsGlyphDisplayNode::New();
-    if (this->GetScene())
-      {
-      this->GetScene()->AddNode(node);
-      node->Delete();
+    vtkErrorMacro("EndBatchUpdate: no matching StartBatchUpdate()");
+    return;
+    }
+  if (--this->Internal->BatchUpdateLevel > 0)
+    {
+    return;
+    }
 
-      vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> glyphSOPN;
-      this->GetScene()->AddNode(glyphSOPN.GetPointer());
-      node->
-        SetAndObserveSpatialObjectsDisplayPropertiesNodeID(glyphSOPN->GetID());
-      node->SetAndObserveColorNodeID("vtkMRMLColorTableNodeRainbow");
+  // UpdateSubsampling() fires the PolyDataModifiedEvent postponed by
+  // ProcessMRMLEvents().
+  if (this->Internal->PolyDataModifiedPending)
+    {
+    this->Internal->PolyDataModifiedPending = false;
+    this->ModifiedSinceReadOn();
+    this->Internal->SubsamplingPending = true;
+    }
 
-      this->AddAndObserveDisplayNodeID(node->GetID());
-      node->SetInputPolyData(this->GetFilteredPolyData());
-      }
+  // Push the inputs before the display nodes update their pipeline.
+  if (this->Internal->SubsamplingPending)
+    {
+    this->Internal->SubsamplingPending = false;
+    this->UpdateSubsampling();
     }
 
-  return node;
+  std::vector<vtkSmartPointer<vtkMRMLSpatialObjectsDisplayNode> > nodes;
+  nodes.swap(this->Internal->BatchedDisplayNodes);
+  for (size_t i = 0; i < nodes.size(); ++i)
+    {
+    nodes[i]->EndBatchUpdate();
+    }
+
+  this->EndModify(this->Internal->BatchDisabledModify);
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsNode::IsBatchUpdating()
+{
+  return this->Internal->BatchUpdateLevel > 0;
 }
 
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsNode::SetAndObservePolyData(vtkPolyData* polyData)
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsNode::SetAndObservePolyData");
+
+  // Setting the ratio and the shuffled ids both update the subsampling.
+  this->StartBatchUpdate();
+
   vtkMRMLModelNode::SetAndObservePolyData(polyData);
+  this->Internal->NextTubeID = -1.;
+
+  // The edits, attributes and masks refer to the tubes of the previous
+  // polydata
+  this->ClearTubeEditHistory();
+  this->Internal->TubeAttributesModified = true;
+  this->ShowAllTubes();
+  this->ClearTubeHighlight();
+  this->ClearTubeSelection();
+
+  // New buffers, not shared with any other node.
+  vtkObject* token = vtkObject::New();
+  this->SetSharedDataToken(token);
+  token->Delete();
 
   if (!polyData)
     {
+    this->ShuffledIds->Initialize();
+    this->EndBatchUpdate();
     return;
     }
 
@@ -316,7 +3068,10 @@ void vtkMRMLSpatialObjectsNode::SetAndObservePolyData(vtkPolyData* polyData)
     idVector.push_back(i);
     }
 
-  random_shuffle(idVector.begin(), idVector.end());
+  // Same shuffle for the same tubes: a subsampled node restored from a
+  // scene shows the same tubes.
+  ShuffleGenerator generator;
+  std::random_shuffle(idVector.begin(), idVector.end(), generator);
 
   this->ShuffledIds->Initialize();
   this->ShuffledIds->SetNumberOfTuples(numberOfPairs);
@@ -328,6 +3083,8 @@ void vtkMRMLSpatialObjectsNode::SetAndObservePolyData(vtkPolyData* polyData)
   float subsamplingRatio = 1.f;
   this->SetSubsamplingRatio(subsamplingRatio);
   this->UpdateSubsampling();
+
+  this->EndBatchUpdate();
 }
 
 //------------------------------------------------------------------------------
@@ -364,28 +3121,45 @@ void vtkMRMLSpatialObjectsNode::PrepareSubsampling()
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsNode::UpdateSubsampling()
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsNode::UpdateSubsampling");
+
   if (!this->GetPolyData())
     {
     return;
     }
 
-  vtkDebugMacro(<< this->GetClassName() << "Updating the subsampling");
-
-  vtkMRMLSpatialObjectsDisplayNode *node = this->GetLineDisplayNode();
-  if (node != NULL)
+  if (this->IsBatchUpdating())
     {
-    node->SetInputPolyData(this->GetFilteredPolyData());
+    this->Internal->SubsamplingPending = true;
+    return;
     }
 
-  node = this->GetTubeDisplayNode();
-  if (node != NULL)
+  vtkDebugMacro(<< this->GetClassName() << "Updating the subsampling");
+
+  // The masked outputs are updated in place, their display pipelines
+  // update themselves.
+  vtkPolyData* filteredPolyData = this->GetFilteredPolyData();
+  vtkMRMLSpatialObjectsDisplayNode* nodes[4] =
     {
-    node->SetInputPolyData(this->GetFilteredPolyData());
-    }
-  node = this->GetGlyphDisplayNode();
-  if (node != NULL)
+    this->GetLineDisplayNode(),
+    this->GetTubeDisplayNode(),
+    this->GetGlyphDisplayNode(),
+    this->GetHighlightDisplayNode()
+    };
+  vtkPolyData* inputs[4] =
     {
-    node->SetInputPolyData(this->GetFilteredPolyData());
+    filteredPolyData,
+    filteredPolyData,
+    filteredPolyData,
+    nodes[3] ? this->GetHighlightedPolyData() : NULL
+    };
+  for (int i = 0; i < 4; ++i)
+    {
+    // Setting the same input would still update the display pipeline.
+    if (nodes[i] != NULL && nodes[i]->GetInputPolyData() != inputs[i])
+      {
+      nodes[i]->SetInputPolyData(inputs[i]);
+      }
     }
 
   this->InvokeEvent(vtkMRMLModelNode::PolyDataModifiedEvent, this);
@@ -418,4 +3192,6 @@ void vtkMRMLSpatialObjectsNode::CreateDefaultDisplayNodes()
   sodn->SetVisibility(0);
   sodn = this->AddGlyphDisplayNode();
   sodn->SetVisibility(0);
+  sodn = this->AddHighlightDisplayNode();
+  sodn->SetVisibility(1);
 }
@@ -38,6 +38,10 @@
 #include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
 #include <itkGroupSpatialObject.h>
 
+// STD includes
+#include <map>
+#include <string>
+
 class vtkMRMLSpatialObjectsDisplayNode;
 class vtkExtractSelectedPolyDataIds;
 class vtkMRMLAnnotationNode;
@@ -72,6 +76,9 @@ public:
   ///
   /// Copy the node's attributes to this object
   /// Does NOT copy: ID, FilePrefix, Name, ID
+  /// The points, cells and attribute arrays are not duplicated: they are
+  /// shared with \a node until one of the two nodes is edited
+  /// (see DetachSharedData()).
   virtual void Copy(vtkMRMLNode *node);
 
   ///
@@ -83,6 +90,12 @@ public:
   /// Finds the storage node and read the data
   virtual void UpdateScene(vtkMRMLScene *scene);
 
+  ///
+  /// Postpone the PolyDataModifiedEvent of the polydata modifications made
+  /// during a batch update to EndBatchUpdate().
+  virtual void ProcessMRMLEvents(vtkObject* caller, unsigned long event,
+                                 void* callData);
+
   ///
   /// Get node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName()
@@ -99,8 +112,17 @@ public:
 
   ///
   /// Get the subsampled PolyData converted from the real data in the node.
+  /// If tubes are hidden (see SetTubeVisibility()), the returned polydata
+  /// shares the points and point data of the node polydata but only has
+  /// the lines of the visible tubes.
   virtual vtkPolyData* GetFilteredPolyData();
 
+  ///
+  /// Get the polydata made of the lines of the visible tubes that are
+  /// highlighted or selected, sharing the points and point data of the
+  /// node polydata. It is the input of the highlight display node.
+  vtkPolyData* GetHighlightedPolyData();
+
   ///
   /// Get associated line display node or NULL if not set.
   vtkMRMLSpatialObjectsDisplayNode* GetLineDisplayNode();
@@ -113,6 +135,10 @@ public:
   /// Get associated glyph display node or NULL if not set.
   vtkMRMLSpatialObjectsDisplayNode* GetGlyphDisplayNode();
 
+  ///
+  /// Get associated highlight display node or NULL if not set.
+  vtkMRMLSpatialObjectsDisplayNode* GetHighlightDisplayNode();
+
   ///
   /// Add line display node if not already present and return it.
   vtkMRMLSpatialObjectsDisplayNode* AddLineDisplayNode();
@@ -125,6 +151,11 @@ public:
   /// Add glyph display node if not already present and return it.
   vtkMRMLSpatialObjectsDisplayNode* AddGlyphDisplayNode();
 
+  ///
+  /// Add highlight display node if not already present and return it.
+  /// It is added on the first highlight or selection of a node in a scene.
+  vtkMRMLSpatialObjectsDisplayNode* AddHighlightDisplayNode();
+
   ///
   /// Create and return default storage node or NULL if does not have one.
   virtual vtkMRMLStorageNode* CreateDefaultStorageNode();
@@ -135,32 +166,413 @@ public:
 
   // Description:
   // Get/Set the SpatialObject when a new node is set
-  vtkGetMacro(SpatialObject, TubeNetType*);
-  vtkSetMacro(SpatialObject, TubeNetType*);
+  // The SpatialObject is reference counted and shared between copies
+  // of the node, it must be considered as read-only.
+  // If the SpatialObject has been released (see SpatialObjectPolicy),
+  // GetSpatialObject() rebuilds it from the polydata.
+  virtual TubeNetType* GetSpatialObject();
+  virtual void SetSpatialObject(TubeNetType* spatialObject);
+
+  //----------------------------------------------------------------------------
+  /// Memory policy for the SpatialObject once it has been converted into
+  /// polydata:
+  /// 0) keep the SpatialObject in memory along with the polydata
+  /// 1) release the SpatialObject, it is rebuilt from the polydata
+  ///    only when requested (e.g. to write the node)
+  //----------------------------------------------------------------------------
+  enum
+  {
+    spatialObjectPolicyKeep = 0,
+    spatialObjectPolicyRelease = 1
+  };
+
+  vtkGetMacro(SpatialObjectPolicy, int);
+  vtkSetMacro(SpatialObjectPolicy, int);
+  void SetSpatialObjectPolicyToKeep()
+  {this->SetSpatialObjectPolicy(this->spatialObjectPolicyKeep);}
+  void SetSpatialObjectPolicyToRelease()
+  {this->SetSpatialObjectPolicy(this->spatialObjectPolicyRelease);}
+
+  ///
+  /// Release the SpatialObject if the policy does not keep it in memory.
+  void ApplySpatialObjectPolicy();
 
   /// Set and observe poly data for this model
   virtual void SetAndObservePolyData(vtkPolyData* polyData);
 
+  //----------------------------------------------------------------------------
+  /// Memory accounting
+  //----------------------------------------------------------------------------
+  typedef std::map<std::string, unsigned long> MemoryUsageType;
+
+  ///
+  /// Add to \a usage the memory, in kibibytes, used by the node: the
+  /// SpatialObject, the polydata points, lines and each point data array,
+  /// and the subsampling buffers. The buffers of the display nodes are
+  /// added if \a includeDisplayNodes is true.
+  /// Buffers shared with other nodes (see IsDataShared()) are counted by
+  /// each of the nodes sharing them.
+  virtual void GetMemoryUsage(MemoryUsageType& usage,
+                              bool includeDisplayNodes = true);
+
+  ///
+  /// Return the total memory, in kibibytes, reported by GetMemoryUsage().
+  unsigned long GetMemorySize(bool includeDisplayNodes = true);
+
+  ///
+  /// Return an estimation of the memory, in kibibytes, used by the
+  /// SpatialObject tube hierarchy. Return 0 if it has been released.
+  unsigned long GetSpatialObjectMemorySize();
+
+  ///
+  /// Return true if the points, cells or attribute arrays of the polydata
+  /// are shared with another node (e.g. after a Copy()).
+  bool IsDataShared();
+
+  ///
+  /// Give this node its own copy of the polydata buffers if they are
+  /// shared with another node. Must be called before editing the
+  /// polydata buffers in place.
+  virtual void DetachSharedData();
+
+  //----------------------------------------------------------------------------
+  /// Tube editing
+  /// A tube is a line cell of the polydata. The points of a tube are stored
+  /// contiguously and in order in the point arrays, as created by the
+  /// storage node; the edits below preserve that layout.
+  /// Only the edited ranges of the point arrays and cell connectivity are
+  /// updated: the points and cells following an edit are moved in place
+  /// instead of rebuilding the polydata.
+  /// Since the SpatialObject can't be edited incrementally, it is released
+  /// by an edit and rebuilt from the polydata when requested.
+  //----------------------------------------------------------------------------
+  enum
+  {
+    /// Invoked after an edit with a vtkIdType[3] as call data:
+    /// first edited tube, number of removed tubes, number of inserted tubes.
+    TubesModifiedEvent = 19100,
+    /// Invoked when the selected tubes change, see SetSelectedTubes().
+    TubeSelectionModifiedEvent,
+    /// Invoked when the visibility or the highlight of tubes change,
+    /// see SetTubeVisibility().
+    TubeMasksModifiedEvent,
+    /// Invoked by vtkSlicerSpatialObjectsTubePicker when a tube of the
+    /// node is picked, with a TubePickType* as call data.
+    TubePickedEvent
+  };
+
+  ///
+  /// Call data of TubePickedEvent.
+  struct TubePickType
+  {
+    vtkIdType TubeId;
+    /// Index, in the tube, of the centerline point nearest to the pick.
+    vtkIdType PointIndex;
+    /// Distance along the centerline from the first point of the tube.
+    double ArcLength;
+    /// Picked position on the centerline.
+    double Position[3];
+  };
+
+  ///
+  /// Return the number of tubes (line cells) of the polydata.
+  vtkIdType GetNumberOfTubes();
+
+  ///
+  /// Get the first point id and the number of points of a tube.
+  /// Return false if \a tubeId is not a valid tube.
+  bool GetTubePoints(vtkIdType tubeId,
+                     vtkIdType& firstPointId, vtkIdType& numberOfPoints);
+
+  ///
+  /// Return a new polydata containing a copy of the tubes
+  /// [firstTubeId, firstTubeId + numberOfTubes[ with their point and cell
+  /// data. The returned polydata must be deleted by the caller.
+  vtkPolyData* ExtractTubes(vtkIdType firstTubeId, vtkIdType numberOfTubes);
+
+  ///
+  /// Core edit: replace the tubes [firstTubeId, firstTubeId + numberOfTubes[
+  /// by the tubes of \a tubes (laid out as described above), or remove
+  /// them if \a tubes is NULL. The point and cell data arrays are matched
+  /// by name, missing values are set to 0.
+  /// Return false if the range is not valid.
+  virtual bool ReplaceTubes(vtkIdType firstTubeId, vtkIdType numberOfTubes,
+                            vtkPolyData* tubes);
+
+  ///
+  /// Remove a tube and its points.
+  bool DeleteTube(vtkIdType tubeId);
+
+  ///
+  /// Only keep the \a numberOfPoints points of the tube starting at
+  /// \a firstPointIndex (index relative to the tube).
+  bool TrimTube(vtkIdType tubeId,
+                vtkIdType firstPointIndex, vtkIdType numberOfPoints);
+
+  ///
+  /// Split a tube in two at the point \a pointIndex (index relative to the
+  /// tube), the split point being shared by both tubes. The second tube is
+  /// inserted right after the first one and gets a new TubeIDs value.
+  /// Return the id of the second tube or -1 on failure.
+  vtkIdType SplitTube(vtkIdType tubeId, vtkIdType pointIndex);
+
+  ///
+  /// Join two tubes by their closest extremities. The merged tube keeps the
+  /// position and the TubeIDs value of the first tube, the second tube is
+  /// removed.
+  bool MergeTubes(vtkIdType tubeId, vtkIdType otherTubeId);
+
+  ///
+  /// Set the radius of all the points of a tube.
+  bool SetTubeRadius(vtkIdType tubeId, double radius);
+
+  ///
+  /// Multiply the radius of all the points of a tube by \a factor.
+  bool ScaleTubeRadius(vtkIdType tubeId, double factor);
+
+  //----------------------------------------------------------------------------
+  /// Tube edits history
+  /// Each ReplaceTubes() records the tubes it removes and the number of tubes
+  /// it inserts: only the edited tubes are kept, not the whole polydata.
+  /// Undo and redo replace the edited range back with ReplaceTubes().
+  /// The history is cleared when a new polydata is set.
+  //----------------------------------------------------------------------------
+
+  ///
+  /// Group the following tube edits, up to the matching EndTubeEdit(),
+  /// into a single undoable edit. Calls can be nested.
+  void BeginTubeEdit();
+  void EndTubeEdit();
+
+  bool CanUndoTubeEdit();
+  bool CanRedoTubeEdit();
+
+  ///
+  /// Revert the last tube edit. Return false if there is nothing to undo.
+  bool UndoTubeEdit();
+
+  ///
+  /// Re-apply the last undone tube edit.
+  /// Return false if there is nothing to redo.
+  bool RedoTubeEdit();
+
+  int GetNumberOfUndoTubeEdits();
+  int GetNumberOfRedoTubeEdits();
+  void ClearTubeEditHistory();
+
+  ///
+  /// Maximum number of edits kept for undo, the oldest edits are discarded
+  /// first. 1000 by default, 0 disables the history.
+  vtkGetMacro(MaximumNumberOfTubeEdits, int);
+  virtual void SetMaximumNumberOfTubeEdits(int);
+
+  //----------------------------------------------------------------------------
+  /// Tube attributes
+  /// Per-tube values computed in a single pass over the polydata when first
+  /// requested, and cached until the polydata is modified.
+  /// The hierarchy is given by the "TubeParentIDs" cell array: the TubeIDs
+  /// value of the parent of each tube, or -1. Tubes whose parent can't be
+  /// found, or that are part of a cycle, are considered as roots.
+  //----------------------------------------------------------------------------
+
+  ///
+  /// Return the TubeIDs value of a tube, its index if there is no TubeIDs
+  /// array.
+  int GetTubeIdentifier(vtkIdType tubeId);
+
+  ///
+  /// Return the TubeParentIDs value of a tube, -1 if there is no parent.
+  int GetTubeParentIdentifier(vtkIdType tubeId);
+
+  ///
+  /// Return the index of the parent of a tube, -1 for the root tubes.
+  vtkIdType GetTubeParent(vtkIdType tubeId);
+
+  ///
+  /// Return the depth of a tube in the hierarchy, 0 for the root tubes.
+  int GetTubeOrder(vtkIdType tubeId);
+
+  ///
+  /// Return the centerline length of a tube.
+  double GetTubeLength(vtkIdType tubeId);
+
+  ///
+  /// Return the mean TubeRadius value of the points of a tube.
+  double GetTubeMeanRadius(vtkIdType tubeId);
+
+  ///
+  /// Return the number of children of a tube, or of root tubes if
+  /// \a tubeId is -1.
+  vtkIdType GetNumberOfTubeChildren(vtkIdType tubeId);
+
+  ///
+  /// Return the index of the \a index-th child of a tube, or of the
+  /// \a index-th root tube if \a tubeId is -1.
+  vtkIdType GetTubeChild(vtkIdType tubeId, vtkIdType index);
+
+  ///
+  /// Return the index of the tube with the TubeIDs value \a identifier,
+  /// -1 if none.
+  vtkIdType FindTube(int identifier);
+
+  //----------------------------------------------------------------------------
+  /// Tube masks
+  /// Per-tube visibility, highlight and selection flags, stored as bitsets.
+  /// They are kept in sync with the tube edits (a replaced tube keeps the
+  /// flags of the tube it replaces, the other inserted tubes are visible
+  /// and neither highlighted nor selected) and are cleared when a new
+  /// polydata is set.
+  /// Changing a flag does not regenerate any geometry: the masked outputs
+  /// (GetFilteredPolyData() and GetHighlightedPolyData()) share the points
+  /// and point data of the polydata, only their lines are filtered, once
+  /// per batch (see StartBatchUpdate()).
+  /// The masks are saved in the scene by TubeIDs value, and restored on
+  /// the tubes with these values whatever the order the tubes are read in.
+  //----------------------------------------------------------------------------
+
+  ///
+  /// Show or hide a tube, invalid indices are ignored.
+  /// Fire TubeMasksModifiedEvent if the visibility changes.
+  void SetTubeVisibility(vtkIdType tubeId, bool visible);
+  bool GetTubeVisibility(vtkIdType tubeId);
+
+  ///
+  /// Show or hide the tubes of \a tubeIds, firing a single event.
+  void SetTubesVisibility(vtkIdTypeArray* tubeIds, bool visible);
+
+  ///
+  /// Show or hide a tube and all its descendants (see GetTubeChild()).
+  void SetTubeBranchVisibility(vtkIdType tubeId, bool visible);
+
+  void ShowAllTubes();
+  vtkIdType GetNumberOfHiddenTubes();
+
+  ///
+  /// Highlight a tube, invalid indices are ignored.
+  /// Fire TubeMasksModifiedEvent if the highlight changes.
+  void SetTubeHighlight(vtkIdType tubeId, bool highlight);
+  bool GetTubeHighlight(vtkIdType tubeId);
+
+  ///
+  /// Highlight the tubes of \a tubeIds, firing a single event.
+  void SetTubesHighlight(vtkIdTypeArray* tubeIds, bool highlight);
+
+  vtkIdType GetNumberOfHighlightedTubes();
+  void ClearTubeHighlight();
+
+  ///
+  /// Replace the selected tubes, invalid indices are ignored.
+  /// Fire TubeSelectionModifiedEvent if the selection changes.
+  void SetSelectedTubes(vtkIdTypeArray* tubeIds);
+
+  ///
+  /// Add the tubes of \a tubeIds to the selection, or remove them if
+  /// \a selected is false. Unlike SetSelectedTubes(), only the given tubes
+  /// are visited.
+  /// Fire TubeSelectionModifiedEvent if the selection changes.
+  void SetTubesSelection(vtkIdTypeArray* tubeIds, bool selected);
+
+  ///
+  /// Fill \a tubeIds with the selected tubes, in increasing order.
+  void GetSelectedTubes(vtkIdTypeArray* tubeIds);
+
+  vtkIdType GetNumberOfSelectedTubes();
+  bool IsTubeSelected(vtkIdType tubeId);
+  void ClearTubeSelection();
+
+  //----------------------------------------------------------------------------
+  /// Batch updates
+  //----------------------------------------------------------------------------
+
+  ///
+  /// Accumulate the modifications of the node and of its spatial objects
+  /// display nodes until the matching EndBatchUpdate(). The subsampling
+  /// and the display pipelines are updated once, and a single
+  /// PolyDataModifiedEvent is fired, by the outermost EndBatchUpdate().
+  /// Calls can be nested.
+  /// \sa vtkMRMLSpatialObjectsDisplayNode::StartBatchUpdate()
+  void StartBatchUpdate();
+  void EndBatchUpdate();
+  bool IsBatchUpdating();
+
 protected:
   vtkMRMLSpatialObjectsNode();
   ~vtkMRMLSpatialObjectsNode();
   vtkMRMLSpatialObjectsNode(const vtkMRMLSpatialObjectsNode&);
   void operator=(const vtkMRMLSpatialObjectsNode&);
 
+  class vtkInternal;
+  vtkInternal* Internal;
+
   // Description
   // Contains the SpatialObject structure used to generate the differents
   // PolyData for visualization and allow keeping further informations
   // for object processing and editions.
-  TubeNetType* SpatialObject;
+  TubeNetType::Pointer SpatialObject;
+
+  // Description
+  // Token shared by all the nodes referencing the same polydata buffers.
+  // Its reference count is the number of nodes sharing the buffers.
+  vtkObject* SharedDataToken;
+  virtual void SetSharedDataToken(vtkObject* token);
 
   vtkIdTypeArray* ShuffledIds;
 
+  ///
+  /// Create a SpatialObject made of vessel tubes from the polydata lines.
+  /// The tubes are created with a unit element spacing since the spacing
+  /// has already been applied on the polydata points.
+  virtual void UpdateSpatialObjectFromPolyData();
+
+  ///
+  /// Return a new empty polydata with the same point and cell data arrays
+  /// (name, type and number of components) as the node polydata.
+  vtkPolyData* NewTubesPolyData();
+
+  ///
+  /// Append the points [firstPointId, firstPointId + numberOfPoints[ of the
+  /// node polydata and their point data to \a tubes, in reverse order if
+  /// \a reverse is true.
+  void AppendTubePoints(vtkPolyData* tubes, vtkIdType firstPointId,
+                        vtkIdType numberOfPoints, bool reverse = false);
+
+  ///
+  /// Insert in \a tubes a line over the points
+  /// [firstPointId, firstPointId + numberOfPoints[ of \a tubes, with the
+  /// cell data of the tube \a sourceTubeId of the node polydata.
+  void AppendTubeCell(vtkPolyData* tubes, vtkIdType firstPointId,
+                      vtkIdType numberOfPoints, vtkIdType sourceTubeId);
+
+  ///
+  /// Find the location of a tube in the lines connectivity array.
+  bool GetTubeLocation(vtkIdType tubeId, vtkIdType& location,
+                       vtkIdType& firstPointId, vtkIdType& numberOfPoints);
+
+  ///
+  /// Compute the tube attributes if the polydata changed since the last
+  /// call. Return false if there is no tube.
+  bool UpdateTubeAttributes();
+
+  ///
+  /// Rebuild the lines of the masked outputs if the masks or the polydata
+  /// changed since the last call.
+  void UpdateMaskedPolyData();
+
+  ///
+  /// Update the masked outputs and the display nodes after a change of the
+  /// tube masks, then fire \a event.
+  void TubeMasksModified(unsigned long event);
+
+  int SpatialObjectPolicy;
+
   virtual void PrepareSubsampling();
   virtual void UpdateSubsampling();
   virtual void CleanSubsampling();
 
   vtkCleanPolyData* CleanPolyDataPostSubsampling;
   float SubsamplingRatio;
+
+  int MaximumNumberOfTubeEdits;
 };
 
 #endif
@@ -23,12 +23,21 @@
 #include "vtkMRMLSpatialObjectsStorageNode.h"
 #include "vtkMRMLSpatialObjectsNode.h"
 #include "vtkMRMLSpatialObjectsDisplayNode.h"
+#include "vtkSpatialObjectsTrace.h"
+#include "vtkSpatialObjectsTrcReader.h"
+#include "vtkSpatialObjectsTrcWriter.h"
+#include "vtkSpatialObjectsTreReader.h"
+#include "vtkSpatialObjectsTreWriter.h"
 
 // VTK includes
 #include <vtkAppendPolyData.h>
 #include <vtkCellArray.h>
+#include <vtkCellData.h>
 #include <vtkCleanPolyData.h>
 #include <vtkDoubleArray.h>
+#include <vtkIdList.h>
+#include <vtkIntArray.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPolyLine.h>
@@ -36,18 +45,229 @@
 #include <vtkSphereSource.h>
 #include <vtkStringArray.h>
 
+// STD includes
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
 // ITK includes
 #include <itkTubeSpatialObject.h>
 #include <itkSpatialObjectReader.h>
 #include <itkSpatialObjectWriter.h>
+#include <itksys/SystemTools.hxx>
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSpatialObjectsStorageNode);
 
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsStorageNode::vtkMRMLSpatialObjectsStorageNode()
+{
+  this->PointDataArrays = vtkSpatialObjectsTreReader::AllArrays;
+  this->MinimumNumberOfPoints = 2;
+  this->MinimumTubeLength = 0.;
+  this->DecimationTolerance = 0.;
+  this->UseROI = false;
+  for (int i = 0; i < 6; ++i)
+    {
+    this->ROI[i] = (i % 2) ? 1. : -1.;
+    }
+  this->TubeIDs = vtkIdList::New();
+  this->UseCache = false;
+  this->UseTubeIndex = true;
+  this->NumberOfThreads =
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsStorageNode::~vtkMRMLSpatialObjectsStorageNode()
+{
+  this->TubeIDs->Delete();
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsStorageNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "PointDataArrays: " << this->PointDataArrays << "\n";
+  os << indent << "MinimumNumberOfPoints: " << this->MinimumNumberOfPoints
+     << "\n";
+  os << indent << "MinimumTubeLength: " << this->MinimumTubeLength << "\n";
+  os << indent << "DecimationTolerance: " << this->DecimationTolerance
+     << "\n";
+  os << indent << "UseROI: " << this->UseROI << "\n";
+  os << indent << "ROI: " << this->ROI[0] << " " << this->ROI[1] << " "
+     << this->ROI[2] << " " << this->ROI[3] << " " << this->ROI[4] << " "
+     << this->ROI[5] << "\n";
+  os << indent << "TubeIDs: " << this->TubeIDs->GetNumberOfIds() << "\n";
+  os << indent << "UseCache: " << this->UseCache << "\n";
+  os << indent << "UseTubeIndex: " << this->UseTubeIndex << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::WriteXML(ostream& of, int nIndent)
+{
+  Superclass::WriteXML(of, nIndent);
+
+  vtkIndent indent(nIndent);
+  of << indent << " pointDataArrays=\"" << this->PointDataArrays << "\"";
+  of << indent << " minimumNumberOfPoints=\"" << this->MinimumNumberOfPoints
+     << "\"";
+  of << indent << " minimumTubeLength=\"" << this->MinimumTubeLength << "\"";
+  of << indent << " decimationTolerance=\"" << this->DecimationTolerance
+     << "\"";
+  of << indent << " useROI=\"" << (this->UseROI ? "true" : "false") << "\"";
+  of << indent << " roi=\"" << this->ROI[0] << " " << this->ROI[1] << " "
+     << this->ROI[2] << " " << this->ROI[3] << " " << this->ROI[4] << " "
+     << this->ROI[5] << "\"";
+  if (this->TubeIDs->GetNumberOfIds() > 0)
+    {
+    of << indent << " tubeIDs=\"";
+    for (vtkIdType i = 0; i < this->TubeIDs->GetNumberOfIds(); ++i)
+      {
+      of << (i ? " " : "") << this->TubeIDs->GetId(i);
+      }
+    of << "\"";
+    }
+  of << indent << " useCache=\"" << (this->UseCache ? "true" : "false")
+     << "\"";
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::ReadXMLAttributes(const char** atts)
+{
+  int disabledModify = this->StartModify();
+
+  Superclass::ReadXMLAttributes(atts);
+
+  const char* attName;
+  const char* attValue;
+  while (*atts != NULL)
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+
+    if (!strcmp(attName, "pointDataArrays"))
+      {
+      this->SetPointDataArrays(atoi(attValue));
+      }
+    else if (!strcmp(attName, "minimumNumberOfPoints"))
+      {
+      this->SetMinimumNumberOfPoints(atoi(attValue));
+      }
+    else if (!strcmp(attName, "minimumTubeLength"))
+      {
+      this->SetMinimumTubeLength(atof(attValue));
+      }
+    else if (!strcmp(attName, "decimationTolerance"))
+      {
+      this->SetDecimationTolerance(atof(attValue));
+      }
+    else if (!strcmp(attName, "useROI"))
+      {
+      this->SetUseROI(!strcmp(attValue, "true"));
+      }
+    else if (!strcmp(attName, "roi"))
+      {
+      char* end = const_cast<char*>(attValue);
+      for (int i = 0; i < 6; ++i)
+        {
+        this->ROI[i] = strtod(end, &end);
+        }
+      }
+    else if (!strcmp(attName, "tubeIDs"))
+      {
+      this->TubeIDs->Reset();
+      const char* begin = attValue;
+      char* end = 0;
+      for (long tubeID = strtol(begin, &end, 10); end != begin;
+           tubeID = strtol(begin, &end, 10))
+        {
+        this->TubeIDs->InsertNextId(tubeID);
+        begin = end;
+        }
+      }
+    else if (!strcmp(attName, "useCache"))
+      {
+      this->SetUseCache(!strcmp(attValue, "true"));
+      }
+    }
+
+  this->EndModify(disabledModify);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::Copy(vtkMRMLNode *anode)
+{
+  int disabledModify = this->StartModify();
+
+  Superclass::Copy(anode);
+
+  vtkMRMLSpatialObjectsStorageNode *node =
+    vtkMRMLSpatialObjectsStorageNode::SafeDownCast(anode);
+  if (node)
+    {
+    this->CopyReadOptions(node);
+    this->SetUseTubeIndex(node->UseTubeIndex);
+    this->SetNumberOfThreads(node->NumberOfThreads);
+    this->PartialFileName = node->PartialFileName;
+    }
+
+  this->EndModify(disabledModify);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::
+CopyReadOptions(vtkMRMLSpatialObjectsStorageNode* node)
+{
+  if (!node)
+    {
+    return;
+    }
+  int disabledModify = this->StartModify();
+  this->SetPointDataArrays(node->PointDataArrays);
+  this->SetMinimumNumberOfPoints(node->MinimumNumberOfPoints);
+  this->SetMinimumTubeLength(node->MinimumTubeLength);
+  this->SetDecimationTolerance(node->DecimationTolerance);
+  this->SetROI(node->ROI);
+  this->SetUseROI(node->UseROI);
+  this->SetUseCache(node->UseCache);
+  if (this->TubeIDs->GetNumberOfIds() || node->TubeIDs->GetNumberOfIds())
+    {
+    this->TubeIDs->DeepCopy(node->TubeIDs);
+    this->Modified();
+    }
+  this->EndModify(disabledModify);
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsStorageNode::HasReadOptions()const
+{
+  return this->PointDataArrays != vtkSpatialObjectsTreReader::AllArrays ||
+    this->MinimumNumberOfPoints > 2 ||
+    this->MinimumTubeLength > 0. ||
+    this->DecimationTolerance > 0. ||
+    this->UseROI ||
+    this->TubeIDs->GetNumberOfIds() > 0;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::ClearReadOptions()
+{
+  int disabledModify = this->StartModify();
+  this->SetPointDataArrays(vtkSpatialObjectsTreReader::AllArrays);
+  this->SetMinimumNumberOfPoints(2);
+  this->SetMinimumTubeLength(0.);
+  this->SetDecimationTolerance(0.);
+  this->SetUseROI(false);
+  if (this->TubeIDs->GetNumberOfIds())
+    {
+    this->TubeIDs->Reset();
+    this->Modified();
+    }
+  this->EndModify(disabledModify);
 }
 
 //------------------------------------------------------------------------------
@@ -60,6 +280,8 @@ CanReadInReferenceNode(vtkMRMLNode *refNode)
 //------------------------------------------------------------------------------
 int vtkMRMLSpatialObjectsStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsStorageNode::ReadDataInternal");
+
   vtkMRMLSpatialObjectsNode* spatialObjectsNode =
     vtkMRMLSpatialObjectsNode::SafeDownCast(refNode);
 
@@ -68,6 +290,12 @@ int vtkMRMLSpatialObjectsStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     return 0;
     }
 
+  this->PartialFileName.clear();
+  if (this->GetNumberOfFileNames() > 0)
+    {
+    return this->ReadMergedDataInternal(spatialObjectsNode);
+    }
+
   std::string fullName = this->GetFullNameFromFileName();
   if (fullName == std::string(""))
     {
@@ -87,197 +315,87 @@ int vtkMRMLSpatialObjectsStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   vtkDebugMacro("ReadData: extension = " << extension.c_str());
 
   int result = 1;
+  const bool cached = extension == std::string(".tre") && this->UseCache &&
+    this->ReadCache(spatialObjectsNode);
+  bool partial = cached && this->HasReadOptions();
   try
   {
-    if (extension == std::string(".tre"))
+    // The ITK objects are only needed if the node keeps them and the file
+    // is fully read, they are rebuilt from the polydata otherwise.
+    bool read = cached;
+    if (!read && extension == std::string(".tre") &&
+        (spatialObjectsNode->GetSpatialObjectPolicy() ==
+           vtkMRMLSpatialObjectsNode::spatialObjectPolicyRelease ||
+         this->HasReadOptions()))
       {
-      ReaderType::Pointer reader = ReaderType::New();
-      reader->SetFileName(fullName);
-      reader->Update();
-      // WARNING : Should we check if the tube contains less than 2 points...
-
-      // TODO WARNING:
-      // Method might use GetMaximumDepth from ITKv4.
-      char childName[] = "Tube";
-      TubeNetType::ChildrenListType* tubeList =
-        reader->GetGroup()->GetChildren(999999, childName);
-
-      // -----------------------------------------------------------------------
-      // Copy skeleton points from vessels into polydata structure
-      // -----------------------------------------------------------------------
-
-      // Initialize the SpatialObject
-      // Count number of points && remove dupplicate
-      int totalNumberOfPoints = 0;
-      for (TubeNetType::ChildrenListType::iterator tubeIT = tubeList->begin();
-           tubeIT != tubeList->end();
-           ++tubeIT )
+      vtkNew<vtkSpatialObjectsTreReader> reader;
+      reader->SetFileName(fullName.c_str());
+      reader->SetPointDataArrays(this->PointDataArrays);
+      reader->SetMinimumNumberOfPoints(this->MinimumNumberOfPoints);
+      reader->SetMinimumTubeLength(this->MinimumTubeLength);
+      reader->SetDecimationTolerance(this->DecimationTolerance);
+      reader->SetROI(this->ROI);
+      reader->SetUseROI(this->UseROI);
+      reader->SetTubeIDs(this->TubeIDs);
+      reader->SetNumberOfThreads(this->NumberOfThreads);
+      if (this->UseTubeIndex)
         {
-        TubeType* currTube =
-          static_cast<TubeType*>((*tubeIT).GetPointer());
-
-        currTube->RemoveDuplicatePoints();
-
-        if(currTube->GetNumberOfPoints() < 2)
-          continue;
-
-        totalNumberOfPoints += currTube->GetNumberOfPoints();
+        reader->SetIndexFileName((fullName + ".idx").c_str());
         }
-
-      // Create the points
-      vtkNew<vtkPoints> vesselsPoints;
-      vesselsPoints->SetNumberOfPoints(totalNumberOfPoints);
-
-      // Create the Lines
-      vtkNew<vtkCellArray> vesselLinesCA;
-
-      // Create scalar array that indicates the radius at each
-      // centerline point.
-      vtkNew<vtkDoubleArray> tubeRadius;
-      tubeRadius->SetName("TubeRadius");
-      tubeRadius->SetNumberOfTuples(totalNumberOfPoints);
-
-      // Create scalar array that indicates TubeID.
-      vtkNew<vtkDoubleArray> tubeIDs;
-      tubeIDs->SetName("TubeIDs");
-      tubeIDs->SetNumberOfTuples(totalNumberOfPoints);
-
-      // Create scalar array that indicates both tangeantes at each
-      // centerline point.
-      vtkNew<vtkDoubleArray> tan1;
-      tan1->SetName("Tan1");
-      tan1->SetNumberOfTuples(3 * totalNumberOfPoints);
-      tan1->SetNumberOfComponents(3);
-
-      vtkNew<vtkDoubleArray> tan2;
-      tan2->SetName("Tan2");
-      tan2->SetNumberOfTuples(3 * totalNumberOfPoints);
-      tan2->SetNumberOfComponents(3);
-
-      // Create scalar array that indicates Ridgness and medialness at each
-      // centerline point.
-      bool containsMidialnessInfo = false;
-      vtkNew<vtkDoubleArray> medialness;
-      medialness->SetName("Medialness");
-      medialness->SetNumberOfTuples(totalNumberOfPoints);
-
-      bool containsRidgnessInfo = false;
-      vtkNew<vtkDoubleArray> ridgeness;
-      ridgeness->SetName("Ridgeness");
-      ridgeness->SetNumberOfTuples(totalNumberOfPoints);
-
-      int pointID = 0;
-      for (TubeNetType::ChildrenListType::iterator tubeIT = tubeList->begin();
-           tubeIT != tubeList->end(); ++tubeIT )
+      read = reader->Read() != 0;
+      if (read)
         {
-        TubeType* currTube =
-          static_cast<TubeType*>((*tubeIT).GetPointer());
-
-        currTube->RemoveDuplicatePoints();
-
-        int tubeSize = currTube->GetNumberOfPoints();
-        if(tubeSize < 2)
-          continue;
-
-        currTube->ComputeTangentAndNormals();
-
-        // Create a pointID list [linear for a polyline]
-        vtkIdType* pointIDs = new vtkIdType[tubeSize];
-        vtkNew<vtkPolyLine> vesselLine;
-
-        // Get the tube element spacing information.
-        const double* axesRatio = currTube->GetSpacing();
-
-        int index = 0;
-        std::vector<TubePointType>::iterator  tubePointIterator;
-        for (tubePointIterator = currTube->GetPoints().begin();
-             tubePointIterator != currTube->GetPoints().end();
-             ++tubePointIterator, ++pointID, ++index)
-          {
-          PointType inputPoint = tubePointIterator->GetPosition();
-          pointIDs[index] = pointID;
-
-          // Insert points using the element spacing information.
-          vesselsPoints->SetPoint(pointID,
-                                  inputPoint[0],
-                                  inputPoint[1] * axesRatio[1] / axesRatio[0],
-                                  inputPoint[2] * axesRatio[2] / axesRatio[0]);
-
-          // TubeID
-          tubeIDs->SetTuple1(pointID, currTube->GetId());
-
-          // Radius
-          tubeRadius->SetTuple1(pointID, tubePointIterator->GetRadius());
-
-          // Tangeantes
-          tan1->SetTuple3(pointID,
-                          (*tubePointIterator).GetNormal1()[0],
-                          (*tubePointIterator).GetNormal1()[1],
-                          (*tubePointIterator).GetNormal1()[2]);
-
-          tan2->SetTuple3(pointID,
-                          (*tubePointIterator).GetNormal2()[0],
-                          (*tubePointIterator).GetNormal2()[1],
-                          (*tubePointIterator).GetNormal2()[2]);
-
-          // Medialness & Ridgness
-          if (tubePointIterator->GetMedialness() != 0)
-            {
-            containsMidialnessInfo = true;
-            }
-          medialness->SetTuple1(pointID, tubePointIterator->GetMedialness());
-
-          if (tubePointIterator->GetRidgeness() != 0)
-            {
-            containsRidgnessInfo = true;
-            }
-          ridgeness->SetTuple1(pointID, tubePointIterator->GetRidgeness());
-          }
-
-        vesselLine->Initialize(tubeSize,
-                               pointIDs,
-                               vesselsPoints.GetPointer());
-        vesselLinesCA->InsertNextCell(vesselLine.GetPointer());
-        delete[] pointIDs;
+        spatialObjectsNode->SetAndObservePolyData(reader->GetOutput());
+        spatialObjectsNode->SetSpatialObject(0);
+        partial = this->HasReadOptions();
         }
-
-      // Convert spatial objects to a PolyData
-      vtkNew<vtkPolyData> vesselsPD;
-      vesselsPD->SetLines(vesselLinesCA.GetPointer());
-      vesselsPD->SetPoints(vesselsPoints.GetPointer());
-
-      // Add the Radius information
-      vesselsPD->GetPointData()->AddArray(tubeRadius.GetPointer());
-      vesselsPD->GetPointData()->SetActiveScalars("TubeRadius");
-
-      // Add the TudeID information
-      vesselsPD->GetPointData()->AddArray(tubeIDs.GetPointer());
-
-      // Add Tangeantes information
-      vesselsPD->GetPointData()->AddArray(tan1.GetPointer());
-      vesselsPD->GetPointData()->AddArray(tan2.GetPointer());
-
-      // Add Medialness & Ridgness if contains information
-      if (containsMidialnessInfo == true)
+      else
         {
-        vesselsPD->GetPointData()->AddArray(medialness.GetPointer());
+        vtkDebugMacro("ReadData: " << fullName.c_str()
+                      << " is read by ITK");
         }
-
-      if (containsRidgnessInfo == true)
+      }
+    if (extension == std::string(".trc"))
+      {
+      vtkNew<vtkSpatialObjectsTrcReader> reader;
+      reader->SetFileName(fullName.c_str());
+      reader->SetNumberOfThreads(this->NumberOfThreads);
+      read = reader->Read() != 0;
+      if (read)
         {
-        vesselsPD->GetPointData()->AddArray(ridgeness.GetPointer());
+        spatialObjectsNode->SetAndObservePolyData(reader->GetOutput());
+        spatialObjectsNode->SetSpatialObject(0);
         }
+      else
+        {
+        result = 0;
+        }
+      }
+    if (extension == std::string(".tre") && !read)
+      {
+      if (this->HasReadOptions())
+        {
+        vtkWarningMacro("ReadData: " << fullName.c_str() << " is read by ITK,"
+                        << " the read options are ignored");
+        }
+      ReaderType::Pointer reader = ReaderType::New();
+      reader->SetFileName(fullName);
+        {
+        vtkSpatialObjectsTraceScope("SpatialObjectReader::Update");
+        reader->Update();
+        }
+      // WARNING : Should we check if the tube contains less than 2 points...
 
-      // Remove any duplicate points from polydata.
-      // The tubes generation will fails if any duplicates points are present.
-      // Cleaned before, could create degeneration problems with the cells
-      //vtkNew<vtkCleanPolyData> cleanedVesselPD;
-      //cleanedVesselPD->SetInput(vesselsPD.GetPointer());
-
-      vtkDebugMacro("Points: " << totalNumberOfPoints);
+      vtkNew<vtkPolyData> vesselsPD;
+      this->ConvertSpatialObjectToPolyData(reader->GetGroup(),
+                                           vesselsPD.GetPointer());
 
       spatialObjectsNode->SetAndObservePolyData(vesselsPD.GetPointer());
       spatialObjectsNode->SetSpatialObject(reader->GetGroup());
+
+      // The ITK tubes duplicate every point of the polydata, drop them
+      // now if the node does not need to keep them.
+      spatialObjectsNode->ApplySpatialObjectPolicy();
     }
   }
   catch(...)
@@ -285,6 +403,18 @@ int vtkMRMLSpatialObjectsStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     result = 0;
   }
 
+  if (result && partial)
+    {
+    this->PartialFileName = fullName;
+    }
+
+  // The next reads skip the conversion.
+  if (result && this->UseCache && !cached &&
+      extension == std::string(".tre"))
+    {
+    this->WriteCache(spatialObjectsNode);
+    }
+
   if (spatialObjectsNode->GetPolyData() != NULL)
     {
     // is there an active scalar array?
@@ -305,9 +435,315 @@ int vtkMRMLSpatialObjectsStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   return result;
 }
 
+//------------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsStorageNode::
+ReadMergedDataInternal(vtkMRMLSpatialObjectsNode* spatialObjectsNode)
+{
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsStorageNode::ReadMergedDataInternal");
+
+  vtkNew<vtkAppendPolyData> append;
+  int result = 1;
+  int numberOfInputs = 0;
+  double idOffset = 0.;
+  for (int i = 0; i < this->GetNumberOfFileNames(); ++i)
+    {
+    // Each file is read by a storage node of its own, with the read
+    // options of this one.
+    const std::string fileName = this->GetFullNameFromNthFileName(i);
+    vtkNew<vtkMRMLSpatialObjectsNode> fileNode;
+    fileNode->SetSpatialObjectPolicy(
+      vtkMRMLSpatialObjectsNode::spatialObjectPolicyRelease);
+    vtkNew<vtkMRMLSpatialObjectsStorageNode> fileStorageNode;
+    fileStorageNode->CopyReadOptions(this);
+    fileStorageNode->SetUseTubeIndex(this->UseTubeIndex);
+    fileStorageNode->SetNumberOfThreads(this->NumberOfThreads);
+    fileStorageNode->SetFileName(fileName.c_str());
+    if (!fileStorageNode->ReadData(fileNode.GetPointer()) ||
+        !fileNode->GetPolyData())
+      {
+      vtkErrorMacro("ReadData: can't read " << fileName.c_str()
+                    << ", its tubes are not merged");
+      result = 0;
+      continue;
+      }
+
+    vtkNew<vtkPolyData> polyData;
+    polyData->ShallowCopy(fileNode->GetPolyData());
+    const vtkIdType numberOfTubes = polyData->GetNumberOfCells();
+
+    // Shift the IDs after the IDs of the previous files.
+    vtkDataArray* tubeIDs = polyData->GetPointData()->GetArray("TubeIDs");
+    vtkDataArray* tubeParentIDs =
+      polyData->GetCellData()->GetArray("TubeParentIDs");
+    double maximumID = idOffset - 1.;
+    if (tubeIDs && tubeIDs->GetNumberOfTuples() > 0)
+      {
+      maximumID = tubeIDs->GetRange(0)[1] + idOffset;
+      }
+    if (idOffset != 0. && tubeIDs)
+      {
+      vtkDataArray* shiftedIDs = tubeIDs->NewInstance();
+      shiftedIDs->DeepCopy(tubeIDs);
+      for (vtkIdType j = 0; j < shiftedIDs->GetNumberOfTuples(); ++j)
+        {
+        // -1 is the ID of the tubes without ID.
+        const double tubeID = shiftedIDs->GetComponent(j, 0);
+        if (tubeID >= 0.)
+          {
+          shiftedIDs->SetComponent(j, 0, tubeID + idOffset);
+          }
+        }
+      polyData->GetPointData()->AddArray(shiftedIDs);
+      shiftedIDs->Delete();
+      }
+    if (idOffset != 0. && tubeParentIDs)
+      {
+      vtkDataArray* shiftedIDs = tubeParentIDs->NewInstance();
+      shiftedIDs->DeepCopy(tubeParentIDs);
+      for (vtkIdType j = 0; j < shiftedIDs->GetNumberOfTuples(); ++j)
+        {
+        const double parentID = shiftedIDs->GetComponent(j, 0);
+        if (parentID >= 0.)
+          {
+          shiftedIDs->SetComponent(j, 0, parentID + idOffset);
+          }
+        }
+      polyData->GetCellData()->AddArray(shiftedIDs);
+      shiftedIDs->Delete();
+      }
+    idOffset = std::max(idOffset, maximumID + 1.);
+
+    vtkNew<vtkIntArray> sourceFileIndex;
+    sourceFileIndex->SetName("SourceFileIndex");
+    sourceFileIndex->SetNumberOfTuples(numberOfTubes);
+    sourceFileIndex->FillComponent(0, i);
+    polyData->GetCellData()->AddArray(sourceFileIndex.GetPointer());
+
+    append->AddInput(polyData.GetPointer());
+    ++numberOfInputs;
+    }
+  if (numberOfInputs == 0)
+    {
+    return 0;
+    }
+
+  // The points, cells and arrays of the files are copied into the merged
+  // polydata, nothing is shared with them. The arrays missing from a file
+  // are dropped.
+  {
+  vtkSpatialObjectsTraceScope("vtkAppendPolyData::Update");
+  append->Update();
+  }
+  vtkNew<vtkPolyData> mergedPolyData;
+  mergedPolyData->ShallowCopy(append->GetOutput());
+  spatialObjectsNode->SetAndObservePolyData(mergedPolyData.GetPointer());
+  spatialObjectsNode->SetSpatialObject(0);
+  mergedPolyData->Modified();
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::
+ConvertSpatialObjectToPolyData(TubeNetType* group, vtkPolyData* polyData)
+{
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsStorageNode::ConvertSpatialObjectToPolyData");
+
+  // TODO WARNING:
+  // Method might use GetMaximumDepth from ITKv4.
+  char childName[] = "Tube";
+  TubeNetType::ChildrenListType* tubeList =
+    group->GetChildren(999999, childName);
+
+  // -----------------------------------------------------------------------
+  // Copy skeleton points from vessels into polydata structure
+  // -----------------------------------------------------------------------
+
+  // Initialize the SpatialObject
+  // Count number of points && remove dupplicate
+  int totalNumberOfPoints = 0;
+  for (TubeNetType::ChildrenListType::iterator tubeIT = tubeList->begin();
+       tubeIT != tubeList->end();
+       ++tubeIT )
+    {
+    TubeType* currTube =
+      static_cast<TubeType*>((*tubeIT).GetPointer());
+
+    currTube->RemoveDuplicatePoints();
+
+    if(currTube->GetNumberOfPoints() < 2)
+      continue;
+
+    totalNumberOfPoints += currTube->GetNumberOfPoints();
+    }
+
+  // Create the points
+  vtkNew<vtkPoints> vesselsPoints;
+  vesselsPoints->SetNumberOfPoints(totalNumberOfPoints);
+
+  // Create the Lines
+  vtkNew<vtkCellArray> vesselLinesCA;
+
+  // Create scalar array that indicates the radius at each
+  // centerline point.
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  tubeRadius->SetNumberOfTuples(totalNumberOfPoints);
+
+  // Create scalar array that indicates TubeID.
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  tubeIDs->SetNumberOfTuples(totalNumberOfPoints);
+
+  // Create scalar array that indicates both tangeantes at each
+  // centerline point.
+  vtkNew<vtkDoubleArray> tan1;
+  tan1->SetName("Tan1");
+  tan1->SetNumberOfTuples(3 * totalNumberOfPoints);
+  tan1->SetNumberOfComponents(3);
+
+  vtkNew<vtkDoubleArray> tan2;
+  tan2->SetName("Tan2");
+  tan2->SetNumberOfTuples(3 * totalNumberOfPoints);
+  tan2->SetNumberOfComponents(3);
+
+  // Create scalar array that indicates Ridgness and medialness at each
+  // centerline point.
+  bool containsMidialnessInfo = false;
+  vtkNew<vtkDoubleArray> medialness;
+  medialness->SetName("Medialness");
+  medialness->SetNumberOfTuples(totalNumberOfPoints);
+
+  bool containsRidgnessInfo = false;
+  vtkNew<vtkDoubleArray> ridgeness;
+  ridgeness->SetName("Ridgeness");
+  ridgeness->SetNumberOfTuples(totalNumberOfPoints);
+
+  // Create cell array that indicates the TubeID of the parent of each tube,
+  // -1 for the tubes without parent.
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+
+  int pointID = 0;
+  for (TubeNetType::ChildrenListType::iterator tubeIT = tubeList->begin();
+       tubeIT != tubeList->end(); ++tubeIT )
+    {
+    TubeType* currTube =
+      static_cast<TubeType*>((*tubeIT).GetPointer());
+
+    currTube->RemoveDuplicatePoints();
+
+    int tubeSize = currTube->GetNumberOfPoints();
+    if(tubeSize < 2)
+      continue;
+
+    currTube->ComputeTangentAndNormals();
+
+    // Create a pointID list [linear for a polyline]
+    vtkIdType* pointIDs = new vtkIdType[tubeSize];
+    vtkNew<vtkPolyLine> vesselLine;
+
+    // Get the tube element spacing information.
+    const double* axesRatio = currTube->GetSpacing();
+
+    int index = 0;
+    std::vector<TubePointType>::iterator  tubePointIterator;
+    for (tubePointIterator = currTube->GetPoints().begin();
+         tubePointIterator != currTube->GetPoints().end();
+         ++tubePointIterator, ++pointID, ++index)
+      {
+      PointType inputPoint = tubePointIterator->GetPosition();
+      pointIDs[index] = pointID;
+
+      // Insert points using the element spacing information.
+      vesselsPoints->SetPoint(pointID,
+                              inputPoint[0],
+                              inputPoint[1] * axesRatio[1] / axesRatio[0],
+                              inputPoint[2] * axesRatio[2] / axesRatio[0]);
+
+      // TubeID
+      tubeIDs->SetTuple1(pointID, currTube->GetId());
+
+      // Radius
+      tubeRadius->SetTuple1(pointID, tubePointIterator->GetRadius());
+
+      // Tangeantes
+      tan1->SetTuple3(pointID,
+                      (*tubePointIterator).GetNormal1()[0],
+                      (*tubePointIterator).GetNormal1()[1],
+                      (*tubePointIterator).GetNormal1()[2]);
+
+      tan2->SetTuple3(pointID,
+                      (*tubePointIterator).GetNormal2()[0],
+                      (*tubePointIterator).GetNormal2()[1],
+                      (*tubePointIterator).GetNormal2()[2]);
+
+      // Medialness & Ridgness
+      if (tubePointIterator->GetMedialness() != 0)
+        {
+        containsMidialnessInfo = true;
+        }
+      medialness->SetTuple1(pointID, tubePointIterator->GetMedialness());
+
+      if (tubePointIterator->GetRidgeness() != 0)
+        {
+        containsRidgnessInfo = true;
+        }
+      ridgeness->SetTuple1(pointID, tubePointIterator->GetRidgeness());
+      }
+
+    vesselLine->Initialize(tubeSize,
+                           pointIDs,
+                           vesselsPoints.GetPointer());
+    vesselLinesCA->InsertNextCell(vesselLine.GetPointer());
+    tubeParentIDs->InsertNextValue(currTube->GetParentId());
+    delete[] pointIDs;
+    }
+
+  // Convert spatial objects to a PolyData
+  polyData->SetLines(vesselLinesCA.GetPointer());
+  polyData->SetPoints(vesselsPoints.GetPointer());
+
+  // Add the Radius information
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+  polyData->GetPointData()->SetActiveScalars("TubeRadius");
+
+  // Add the TudeID information
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+
+  // Add the hierarchy information
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+
+  // Add Tangeantes information
+  polyData->GetPointData()->AddArray(tan1.GetPointer());
+  polyData->GetPointData()->AddArray(tan2.GetPointer());
+
+  // Add Medialness & Ridgness if contains information
+  if (containsMidialnessInfo == true)
+    {
+    polyData->GetPointData()->AddArray(medialness.GetPointer());
+    }
+
+  if (containsRidgnessInfo == true)
+    {
+    polyData->GetPointData()->AddArray(ridgeness.GetPointer());
+    }
+
+  // Remove any duplicate points from polydata.
+  // The tubes generation will fails if any duplicates points are present.
+  // Cleaned before, could create degeneration problems with the cells
+  //vtkNew<vtkCleanPolyData> cleanedVesselPD;
+  //cleanedVesselPD->SetInput(polyData);
+
+  vtkDebugMacro("Points: " << totalNumberOfPoints);
+
+  delete tubeList;
+}
+
 //------------------------------------------------------------------------------
 int vtkMRMLSpatialObjectsStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsStorageNode::WriteDataInternal");
+
   vtkMRMLSpatialObjectsNode* spatialObjects =
     vtkMRMLSpatialObjectsNode::SafeDownCast(refNode);
 
@@ -321,19 +757,49 @@ int vtkMRMLSpatialObjectsStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
   std::string extension =
     itksys::SystemTools::GetFilenameLastExtension(fullName);
 
+  // Don't replace a file by the part of it that was read.
+  if (this->HasReadOptions() && fullName == this->PartialFileName)
+    {
+    const std::string prefix =
+      fullName.substr(0, fullName.size() - extension.size()) + "_partial";
+    fullName = prefix + extension;
+    for (int i = 1; itksys::SystemTools::FileExists(fullName.c_str()); ++i)
+      {
+      std::ostringstream name;
+      name << prefix << i << extension;
+      fullName = name.str();
+      }
+    vtkWarningMacro("WriteData: " << this->PartialFileName.c_str()
+                    << " was partially read, it is written to "
+                    << fullName.c_str());
+    this->SetFileName(fullName.c_str());
+    }
+
   int result = 1;
   if (extension == ".tre")
     {
-    try
+    // Written from the polydata: the edits of the tubes and the additional
+    // point data arrays are saved, and the SpatialObject is not rebuilt.
+    vtkNew<vtkSpatialObjectsTreWriter> writer;
+    writer->SetFileName(fullName.c_str());
+    writer->SetNumberOfThreads(this->NumberOfThreads);
+    writer->SetInput(spatialObjects->GetPolyData());
+    result = writer->Write();
+    if (!result)
       {
-      WriterType::Pointer writer = WriterType::New();
-      writer->SetFileName(fullName.c_str());
-      writer->SetInput(spatialObjects->GetSpatialObject());
-      writer->Update();
+      vtkErrorMacro("Error occured writing Spatial Objects: "
+                    << fullName.c_str());
       }
-    catch (...)
+    }
+  else if (extension == ".trc")
+    {
+    vtkNew<vtkSpatialObjectsTrcWriter> writer;
+    writer->SetFileName(fullName.c_str());
+    writer->SetNumberOfThreads(this->NumberOfThreads);
+    writer->SetInput(spatialObjects->GetPolyData());
+    result = writer->Write();
+    if (!result)
       {
-      result = 0;
       vtkErrorMacro("Error occured writing Spatial Objects: "
                     << fullName.c_str());
       }
@@ -344,19 +810,131 @@ int vtkMRMLSpatialObjectsStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     vtkErrorMacro( << "No file extension recognized: " << fullName.c_str());
     }
 
+  // The merged tubes, or the tubes read with read options, are now read
+  // from FileName.
+  if (result)
+    {
+    this->ResetFileNameList();
+    this->ClearReadOptions();
+    this->PartialFileName.clear();
+    }
+
+  if (result && this->UseCache && extension == ".tre")
+    {
+    this->WriteCache(spatialObjects);
+    }
+
   return result;
 }
 
+//------------------------------------------------------------------------------
+std::string vtkMRMLSpatialObjectsStorageNode::GetCacheFileName()
+{
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+    {
+    return fullName;
+    }
+
+  // FNV-1a hash of the read options: the cache of other options is not
+  // read.
+  std::ostringstream options;
+  options.precision(17);
+  options << this->PointDataArrays << " " << this->MinimumNumberOfPoints
+          << " " << this->MinimumTubeLength << " "
+          << this->DecimationTolerance << " " << this->UseROI;
+  for (int i = 0; this->UseROI && i < 6; ++i)
+    {
+    options << " " << this->ROI[i];
+    }
+  for (vtkIdType i = 0; i < this->TubeIDs->GetNumberOfIds(); ++i)
+    {
+    options << " " << this->TubeIDs->GetId(i);
+    }
+  const std::string optionsString = options.str();
+  vtkTypeUInt32 hash = 2166136261u;
+  for (size_t i = 0; i < optionsString.size(); ++i)
+    {
+    hash = (hash ^ static_cast<unsigned char>(optionsString[i])) * 16777619u;
+    }
+
+  char suffix[16];
+  sprintf(suffix, ".%08x", static_cast<unsigned int>(hash));
+  return fullName + suffix + ".cache";
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLSpatialObjectsStorageNode::
+ReadCache(vtkMRMLSpatialObjectsNode* spatialObjectsNode)
+{
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsStorageNode::ReadCache");
+
+  const std::string fullName = this->GetFullNameFromFileName();
+  const std::string cacheName = this->GetCacheFileName();
+  int newer = 0;
+  if (cacheName.empty() ||
+      !itksys::SystemTools::FileExists(cacheName.c_str(), true) ||
+      !itksys::SystemTools::FileTimeCompare(cacheName.c_str(),
+                                            fullName.c_str(), &newer) ||
+      newer <= 0)
+    {
+    return false;
+    }
+
+  vtkNew<vtkSpatialObjectsTrcReader> reader;
+  reader->SetFileName(cacheName.c_str());
+  reader->SetNumberOfThreads(this->NumberOfThreads);
+  if (!reader->Read())
+    {
+    vtkWarningMacro("ReadData: can't read the cache " << cacheName.c_str()
+                    << ", " << fullName.c_str() << " is read instead");
+    return false;
+    }
+  spatialObjectsNode->SetAndObservePolyData(reader->GetOutput());
+  spatialObjectsNode->SetSpatialObject(0);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsStorageNode::
+WriteCache(vtkMRMLSpatialObjectsNode* spatialObjectsNode)
+{
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsStorageNode::WriteCache");
+
+  const std::string cacheName = this->GetCacheFileName();
+  if (cacheName.empty() || !spatialObjectsNode->GetPolyData())
+    {
+    return;
+    }
+
+  // The cache stands for the file, it is read back exactly.
+  vtkNew<vtkSpatialObjectsTrcWriter> writer;
+  writer->SetFileName(cacheName.c_str());
+  writer->SetInput(spatialObjectsNode->GetPolyData());
+  writer->LosslessOn();
+  writer->SetNumberOfThreads(this->NumberOfThreads);
+  if (!writer->Write())
+    {
+    // Not an error, the file is read instead.
+    vtkWarningMacro("WriteData: can't write the cache " << cacheName.c_str());
+    itksys::SystemTools::RemoveFile(cacheName.c_str());
+    }
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsStorageNode::InitializeSupportedReadFileTypes()
 {
   this->SupportedReadFileTypes->InsertNextValue("SpatialObject (.tre)");
+  this->SupportedReadFileTypes->InsertNextValue(
+    "Compressed SpatialObject (.trc)");
 }
 
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsStorageNode::InitializeSupportedWriteFileTypes()
 {
   this->SupportedWriteFileTypes->InsertNextValue("SpatialObject (.tre)");
+  this->SupportedWriteFileTypes->InsertNextValue(
+    "Compressed SpatialObject (.trc)");
 }
 
 //------------------------------------------------------------------------------
@@ -21,7 +21,39 @@
 /// MRML node for SpatialObjects storage on disk.
 ///
 /// The storage node has methods to read/write itkSpatialObjects from disk and
-/// generates the PolyData.
+/// generates the PolyData. The .tre files are written from the PolyData,
+/// see vtkSpatialObjectsTreWriter. The .trc files are the compressed
+/// columnar format of vtkSpatialObjectsTrcWriter, for archiving; the read
+/// options do not apply to them.
+///
+/// The read options of vtkSpatialObjectsTreReader reduce the data loaded.
+/// If any is set, the file is read by vtkSpatialObjectsTreReader whatever
+/// the spatial object policy and the spatial object is rebuilt from the
+/// reduced polydata; they are ignored if the file can only be read by ITK.
+/// The tubes read with read options are a part of the file: writing them
+/// to the file they were read from writes them to a new file instead,
+/// FileName followed by "_partial" (and a number if it exists), which
+/// becomes the FileName. Once written, the read options are cleared.
+/// vtkSpatialObjectsTreReader keeps the tube index of a file next to it,
+/// with the .idx extension appended, unless UseTubeIndex is false.
+///
+/// If files are added to the file list (see AddFileName()), their tubes
+/// are read and merged into the node instead of FileName, with the same
+/// read options and cache. The "SourceFileIndex" cell array gives the
+/// index in the list of the file of each tube, and the TubeIDs and
+/// TubeParentIDs of the files, but -1, are shifted so that they stay
+/// unique. Once the node is written to FileName, the file list is emptied:
+/// the tubes are then read from a single file and SourceFileIndex, which
+/// refers to the emptied list, is not written.
+///
+/// If UseCache is true, the polydata read from a .tre file, once
+/// converted and reduced by the read options, is also written to a
+/// lossless .trc cache next to the file (see GetCacheFileName()). The next
+/// reads, e.g. when a scene is restored, read the cache instead of
+/// converting the file again, as long as the cache is newer than the file:
+/// they give the same tubes as the first read. The merged tubes of a file
+/// list are not cached as a whole: each file is read from its own cache,
+/// and merging them only copies the arrays.
 
 #ifndef __vtkMRMLSpatialObjectsStorageNode_h
 #define __vtkMRMLSpatialObjectsStorageNode_h
@@ -32,6 +64,13 @@
 // SpatialObjects includes
 #include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
 
+// STD includes
+#include <string>
+
+class vtkIdList;
+class vtkMRMLSpatialObjectsNode;
+class vtkPolyData;
+
 #include <itkVesselTubeSpatialObject.h>
 #include <itkSpatialObjectReader.h>
 #include <itkSpatialObjectWriter.h>
@@ -56,6 +95,18 @@ public:
 
   virtual vtkMRMLNode* CreateNodeInstance();
 
+  ///
+  /// Read parameters from XML attributes
+  virtual void ReadXMLAttributes(const char** atts);
+
+  ///
+  /// Write this node's information to a MRML file in XML format.
+  virtual void WriteXML(ostream& of, int indent);
+
+  ///
+  /// Copy the node's attributes to this object
+  virtual void Copy(vtkMRMLNode *node);
+
   ///
   /// Get node XML tag name (like Storage, Model)
   virtual const char* GetNodeTagName() {return "SpatialObjectsStorage";};
@@ -68,9 +119,78 @@ public:
   /// Return true if the node can be read in
   virtual bool CanReadInReferenceNode(vtkMRMLNode *refNode);
 
+  ///
+  /// Fill \a polyData with the centerlines of the vessel tubes of \a group:
+  /// one line per tube with at least 2 points, the points of a tube being
+  /// contiguous, and the TubeRadius, TubeIDs, Tan1, Tan2, Medialness and
+  /// Ridgeness point data. The duplicate points of the tubes are removed
+  /// and their tangents and normals are computed.
+  void ConvertSpatialObjectToPolyData(TubeNetType* group,
+                                      vtkPolyData* polyData);
+
+  ///
+  /// Read options, see vtkSpatialObjectsTreReader.
+  vtkSetMacro(PointDataArrays, int);
+  vtkGetMacro(PointDataArrays, int);
+  vtkSetClampMacro(MinimumNumberOfPoints, int, 2, VTK_INT_MAX);
+  vtkGetMacro(MinimumNumberOfPoints, int);
+  vtkSetClampMacro(MinimumTubeLength, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(MinimumTubeLength, double);
+  vtkSetClampMacro(DecimationTolerance, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(DecimationTolerance, double);
+  vtkSetVector6Macro(ROI, double);
+  vtkGetVector6Macro(ROI, double);
+  vtkSetMacro(UseROI, bool);
+  vtkGetMacro(UseROI, bool);
+  vtkBooleanMacro(UseROI, bool);
+
+  ///
+  /// IDs of the tubes to read, all of them if empty (default).
+  vtkGetObjectMacro(TubeIDs, vtkIdList);
+
+  ///
+  /// Copy the read options of \a node, and whether it uses the cache.
+  void CopyReadOptions(vtkMRMLSpatialObjectsStorageNode* node);
+
+  ///
+  /// Return true if a read option is not the default: the file is then
+  /// partially read.
+  bool HasReadOptions()const;
+
+  ///
+  /// Reset the read options to their default: the whole file is read.
+  void ClearReadOptions();
+
+  ///
+  /// Read the .tre files from, and write them along with, a binary cache.
+  /// False by default.
+  vtkSetMacro(UseCache, bool);
+  vtkGetMacro(UseCache, bool);
+  vtkBooleanMacro(UseCache, bool);
+
+  ///
+  /// Read the tube index of the .tre files read by
+  /// vtkSpatialObjectsTreReader, and write it next to them if it is
+  /// missing or out of date. True by default.
+  vtkSetMacro(UseTubeIndex, bool);
+  vtkGetMacro(UseTubeIndex, bool);
+  vtkBooleanMacro(UseTubeIndex, bool);
+
+  ///
+  /// Number of threads reading and writing the .tre files, the number of
+  /// processors by default. 1 when the files are processed in parallel.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Cache of FileName for the current read options: FileName followed by
+  /// a hash of the read options and the .cache extension. Empty if there
+  /// is no FileName.
+  std::string GetCacheFileName();
+
 protected:
-  vtkMRMLSpatialObjectsStorageNode(){};
-  ~vtkMRMLSpatialObjectsStorageNode(){};
+  vtkMRMLSpatialObjectsStorageNode();
+  ~vtkMRMLSpatialObjectsStorageNode();
   vtkMRMLSpatialObjectsStorageNode(const vtkMRMLSpatialObjectsStorageNode&);
   void operator=(const vtkMRMLSpatialObjectsStorageNode&);
 
@@ -87,6 +207,29 @@ protected:
 
   /// Write data from a  referenced node
   virtual int WriteDataInternal(vtkMRMLNode *refNode);
+
+  /// Read and merge the files of the file list into the node.
+  int ReadMergedDataInternal(vtkMRMLSpatialObjectsNode* spatialObjectsNode);
+
+  /// Read the cache of FileName into the node if it is up to date.
+  /// Return false otherwise.
+  bool ReadCache(vtkMRMLSpatialObjectsNode* spatialObjectsNode);
+  /// Write the polydata of the node to the cache of FileName.
+  void WriteCache(vtkMRMLSpatialObjectsNode* spatialObjectsNode);
+
+  int PointDataArrays;
+  int MinimumNumberOfPoints;
+  double MinimumTubeLength;
+  double DecimationTolerance;
+  double ROI[6];
+  bool UseROI;
+  vtkIdList* TubeIDs;
+  bool UseCache;
+  bool UseTubeIndex;
+  int NumberOfThreads;
+
+  /// File last read with read options, it is not overwritten by its part.
+  std::string PartialFileName;
 };
 
 #endif
@@ -17,13 +17,15 @@
 
 ==============================================================================*/
 
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
 
 #include "vtkAssignAttribute.h"
 #include "vtkObjectFactory.h"
 #include "vtkCallbackCommand.h"
 #include "vtkCellData.h"
 #include "vtkPointData.h"
+#include "vtkPolyData.h"
 
 #include "vtkAssignAttribute.h"
 #include "vtkPolyDataTensorToColor.h"
@@ -33,6 +35,7 @@
 #include "vtkMRMLModelDisplayNode.h"
 #include "vtkMRMLSpatialObjectsDisplayPropertiesNode.h"
 #include "vtkMRMLSpatialObjectsTubeDisplayNode.h"
+#include "vtkSpatialObjectsTrace.h"
 #include "vtkPolyDataColorLinesByOrientation.h"
 
 //------------------------------------------------------------------------------
@@ -44,34 +47,32 @@ vtkMRMLSpatialObjectsTubeDisplayNode::vtkMRMLSpatialObjectsTubeDisplayNode()
 {
   this->ColorMode = vtkMRMLSpatialObjectsDisplayNode::colorModeSolid;
 
-  this->TubeFilter = vtkTubeFilter::New();
-  this->TubeFilter->SetVaryRadiusToVaryRadiusByAbsoluteScalar();
   this->TubeNumberOfSides = 6;
   this->TubeRadius = 0.5;
+  this->TubePreviewMode = 0;
 
   this->Ambient = 0.25;
   this->Diffuse = 0.8;
   this->Specular = 0.25;
   this->Power = 20;
 
-  // Pipeline
-  this->amontAssignAttribute = vtkAssignAttribute::New();
-  this->amontAssignAttribute->Assign("TubeRadius",
-                                     vtkDataSetAttributes::SCALARS,
-                                     vtkAssignAttribute::POINT_DATA);
-  this->TubeFilter->SetInputConnection(
-    this->amontAssignAttribute->GetOutputPort());
-
-  this->AssignAttribute->SetInputConnection(
-    this->TubeFilter->GetOutputPort());
+  // Pipeline, created when the node is first made visible
+  this->amontAssignAttribute = NULL;
+  this->TubeFilter = NULL;
 }
 
 //------------------------------------------------------------------------------
 vtkMRMLSpatialObjectsTubeDisplayNode::~vtkMRMLSpatialObjectsTubeDisplayNode()
 {
   this->RemoveObservers(vtkCommand::ModifiedEvent, this->MRMLCallbackCommand);
-  this->amontAssignAttribute->Delete();
-  this->TubeFilter->Delete();
+  if (this->amontAssignAttribute)
+    {
+    this->amontAssignAttribute->Delete();
+    }
+  if (this->TubeFilter)
+    {
+    this->TubeFilter->Delete();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -100,16 +101,11 @@ void vtkMRMLSpatialObjectsTubeDisplayNode::ReadXMLAttributes(const char** atts)
 
     if (!strcmp(attName, "tubeRadius"))
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> this->TubeRadius;
+      this->TubeRadius = atof(attValue);
       }
-
-    if (!strcmp(attName, "tubeNumberOfSides"))
+    else if (!strcmp(attName, "tubeNumberOfSides"))
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> this->TubeNumberOfSides;
+      this->TubeNumberOfSides = atoi(attValue);
       }
     }
 
@@ -141,18 +137,61 @@ PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "TubeNumberOfSides: " << this->TubeNumberOfSides << "\n";
   os << indent << "TubeRadius: " << this->TubeRadius << "\n";
+  os << indent << "TubePreviewMode: " << this->TubePreviewMode << "\n";
 }
 
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsTubeDisplayNode::SetInputToPolyDataPipeline(vtkPolyData* polyData)
 {
-  this->amontAssignAttribute->SetInput(polyData);
+  if (this->amontAssignAttribute)
+    {
+    this->amontAssignAttribute->SetInput(polyData);
+    }
+  else
+    {
+    this->AssignAttribute->SetInput(polyData);
+    }
 }
 
 //------------------------------------------------------------------------------
 vtkPolyData* vtkMRMLSpatialObjectsTubeDisplayNode::GetInputPolyData()
 {
-  return vtkPolyData::SafeDownCast(this->amontAssignAttribute->GetInput());
+  vtkAssignAttribute* input = this->amontAssignAttribute ?
+    this->amontAssignAttribute : this->AssignAttribute;
+  return vtkPolyData::SafeDownCast(input->GetInput());
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsTubeDisplayNode::CreatePipeline()
+{
+  vtkPolyData* polyData = this->GetInputPolyData();
+
+  this->amontAssignAttribute = vtkAssignAttribute::New();
+  this->amontAssignAttribute->Assign("TubeRadius",
+                                     vtkDataSetAttributes::SCALARS,
+                                     vtkAssignAttribute::POINT_DATA);
+  this->amontAssignAttribute->SetInput(polyData);
+
+  this->TubeFilter = vtkTubeFilter::New();
+  this->TubeFilter->SetVaryRadiusToVaryRadiusByAbsoluteScalar();
+  this->TubeFilter->SetInputConnection(
+    this->amontAssignAttribute->GetOutputPort());
+
+  this->AssignAttribute->SetInputConnection(
+    this->TubeFilter->GetOutputPort());
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsTubeDisplayNode::DeletePipeline()
+{
+  // Pass the input through until the node is shown again.
+  vtkPolyData* polyData = this->GetInputPolyData();
+  this->AssignAttribute->SetInput(polyData);
+
+  this->TubeFilter->Delete();
+  this->TubeFilter = NULL;
+  this->amontAssignAttribute->Delete();
+  this->amontAssignAttribute = NULL;
 }
 
 //------------------------------------------------------------------------------
@@ -164,11 +203,14 @@ vtkAlgorithmOutput* vtkMRMLSpatialObjectsTubeDisplayNode::GetOutputPort()
 //------------------------------------------------------------------------------
 void vtkMRMLSpatialObjectsTubeDisplayNode::UpdatePolyDataPipeline()
 {
+  vtkSpatialObjectsTraceScope("vtkMRMLSpatialObjectsTubeDisplayNode::UpdatePolyDataPipeline");
+
   if (!this->GetInputPolyData() || !this->Visibility)
     {
     return;
     }
 
+  this->AllocatePipeline();
   this->Superclass::UpdatePolyDataPipeline();
 
   // Set display properties according to the
@@ -177,6 +219,12 @@ void vtkMRMLSpatialObjectsTubeDisplayNode::UpdatePolyDataPipeline()
     SpatialObjectsDisplayPropertiesNode =
       this->GetSpatialObjectsDisplayPropertiesNode();
 
+  // The tube filter is the part of the pipeline regenerated when the tube
+  // settings change: the preview keeps it to 3 sides.
+  this->TubeFilter->SetRadius(this->GetTubeRadius());
+  this->TubeFilter->SetNumberOfSides(this->TubePreviewMode ?
+    std::min(3, this->GetTubeNumberOfSides()) : this->GetTubeNumberOfSides());
+
   const char * activeScalarName = this->GetActiveScalarName();
   this->AssignAttribute->Assign(activeScalarName,
                                 vtkDataSetAttributes::SCALARS,
@@ -205,8 +253,6 @@ void vtkMRMLSpatialObjectsTubeDisplayNode::UpdatePolyDataPipeline()
                vtkMRMLSpatialObjectsDisplayNode::colorModeScalarData)
       {
       this->ScalarVisibilityOn();
-      this->TubeFilter->SetRadius(this->GetTubeRadius());
-      this->TubeFilter->SetNumberOfSides(this->GetTubeNumberOfSides());
       this->AssignAttribute->Update();
       }
     }
@@ -215,3 +261,18 @@ void vtkMRMLSpatialObjectsTubeDisplayNode::UpdatePolyDataPipeline()
     this->ScalarVisibilityOff();
     }
 }
+
+//------------------------------------------------------------------------------
+void vtkMRMLSpatialObjectsTubeDisplayNode::
+GetMemoryUsage(MemoryUsageType& usage)
+{
+  this->Superclass::GetMemoryUsage(usage);
+
+  if (!this->TubeFilter)
+    {
+    return;
+    }
+  const std::string prefix = std::string(this->GetNodeTagName()) + "/";
+  usage[prefix + "TubeMesh"] +=
+    this->TubeFilter->GetOutput()->GetActualMemorySize();
+}
@@ -77,6 +77,10 @@ vtkMRMLSpatialObjectsTubeDisplayNode : public vtkMRMLSpatialObjectsDisplayNode
   /// Update the pipeline based on this node attributes
   virtual void UpdatePolyDataPipeline();
 
+  ///
+  /// Add the memory used by the tube mesh.
+  virtual void GetMemoryUsage(MemoryUsageType& usage);
+
   //----------------------------------------------------------------------------
   /// Display Information: Geometry to display (not mutually exclusive)
   //----------------------------------------------------------------------------
@@ -91,6 +95,14 @@ vtkMRMLSpatialObjectsTubeDisplayNode : public vtkMRMLSpatialObjectsDisplayNode
   vtkSetMacro(TubeNumberOfSides, int);
   vtkGetMacro(TubeNumberOfSides, int);
 
+  ///
+  /// Build triangular tubes, cheaper to regenerate, while the tube radius or
+  /// number of sides is interactively changed.
+  /// Not saved in the scene. Off by default.
+  vtkSetMacro(TubePreviewMode, int);
+  vtkGetMacro(TubePreviewMode, int);
+  vtkBooleanMacro(TubePreviewMode, int);
+
 protected:
   vtkMRMLSpatialObjectsTubeDisplayNode();
   ~vtkMRMLSpatialObjectsTubeDisplayNode();
@@ -105,9 +117,14 @@ protected:
   /// This is the polydata that needs to be connected with the mappers.
   virtual vtkAlgorithmOutput* GetOutputPort();
 
+  /// Create the tube filter when the node is first made visible.
+  virtual void CreatePipeline();
+  virtual void DeletePipeline();
+
   /// Properties
   int    TubeNumberOfSides;
   double TubeRadius;
+  int    TubePreviewMode;
 
   /// Pipeline
   vtkAssignAttribute* amontAssignAttribute;
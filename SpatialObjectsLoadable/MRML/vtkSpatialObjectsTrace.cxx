@@ -0,0 +1,200 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSpatialObjectsTrace.h"
+
+// VTK includes
+#include <vtkCriticalSection.h>
+#include <vtkMultiThreader.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+struct TraceEvent
+{
+  const char* Name;
+  double Start;
+  double Duration;
+  size_t Thread;
+};
+
+//------------------------------------------------------------------------------
+struct TraceState
+{
+  TraceState()
+    : Enabled(false), Origin(0.), NumberOfDroppedEvents(0)
+  {}
+
+  ~TraceState()
+  {
+    // Write the trace of the applications that don't call Stop()
+    vtkSpatialObjectsTrace::Stop();
+  }
+
+  // Written under Lock, read without it by IsEnabled() so that the probes
+  // of the worker threads don't contend when tracing is disabled. A probe
+  // racing with Start() or Stop() is recorded or not: AddEvent() checks
+  // the flag again under the lock.
+  volatile bool Enabled;
+  // Read and written under Lock.
+  std::string FileName;
+  double Origin;
+  std::vector<TraceEvent> Events;
+  unsigned long NumberOfDroppedEvents;
+  std::vector<vtkMultiThreaderIDType> Threads;
+  vtkSimpleCriticalSection Lock;
+};
+
+// Bound the memory used by a trace left enabled for a long time
+const size_t MaximumNumberOfEvents = 1000000;
+
+//------------------------------------------------------------------------------
+TraceState& GetTraceState()
+{
+  static TraceState state;
+  return state;
+}
+
+//------------------------------------------------------------------------------
+struct TraceInitializer
+{
+  TraceInitializer()
+  {
+    const char* fileName = getenv("SPATIALOBJECTS_TRACE_FILE");
+    if (fileName && *fileName)
+      {
+      vtkSpatialObjectsTrace::Start(fileName);
+      }
+  }
+};
+TraceInitializer Initializer;
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrace::Start(const char* fileName)
+{
+  TraceState& state = GetTraceState();
+
+  state.Lock.Lock();
+  state.FileName = fileName ? fileName : "";
+  state.Origin = GetTime();
+  state.Events.clear();
+  state.NumberOfDroppedEvents = 0;
+  state.Threads.clear();
+  state.Enabled = !state.FileName.empty();
+  state.Lock.Unlock();
+}
+
+//------------------------------------------------------------------------------
+bool vtkSpatialObjectsTrace::Stop()
+{
+  TraceState& state = GetTraceState();
+
+  state.Lock.Lock();
+  if (!state.Enabled)
+    {
+    state.Lock.Unlock();
+    return true;
+    }
+  state.Enabled = false;
+
+  std::ofstream output(state.FileName.c_str());
+  output << "{\"displayTimeUnit\": \"ms\", \"otherData\": "
+         << "{\"droppedEvents\": " << state.NumberOfDroppedEvents << "}, "
+         << "\"traceEvents\": [";
+  output.precision(3);
+  output.setf(std::ios::fixed, std::ios::floatfield);
+  for (size_t i = 0; i < state.Events.size(); ++i)
+    {
+    const TraceEvent& event = state.Events[i];
+    output << (i ? ",\n" : "\n")
+           << "{\"name\": \"" << event.Name << "\""
+           << ", \"cat\": \"SpatialObjects\", \"ph\": \"X\""
+           << ", \"ts\": " << (event.Start - state.Origin) * 1e6
+           << ", \"dur\": " << event.Duration * 1e6
+           << ", \"pid\": 1, \"tid\": " << event.Thread << "}";
+    }
+  output << "\n]}\n";
+  const bool res = output.good();
+
+  state.Events.clear();
+  state.Lock.Unlock();
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSpatialObjectsTrace::IsEnabled()
+{
+  return GetTraceState().Enabled;
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrace::AddEvent(const char* name,
+                                      double start, double end)
+{
+  TraceState& state = GetTraceState();
+  const vtkMultiThreaderIDType threadId =
+    vtkMultiThreader::GetCurrentThreadID();
+
+  state.Lock.Lock();
+  if (!state.Enabled)
+    {
+    state.Lock.Unlock();
+    return;
+    }
+  if (state.Events.size() >= MaximumNumberOfEvents)
+    {
+    ++state.NumberOfDroppedEvents;
+    state.Lock.Unlock();
+    return;
+    }
+
+  TraceEvent event;
+  event.Name = name;
+  event.Start = start;
+  event.Duration = end - start;
+  for (event.Thread = 0; event.Thread < state.Threads.size(); ++event.Thread)
+    {
+    if (vtkMultiThreader::ThreadsEqual(state.Threads[event.Thread], threadId))
+      {
+      break;
+      }
+    }
+  if (event.Thread == state.Threads.size())
+    {
+    state.Threads.push_back(threadId);
+    }
+  state.Events.push_back(event);
+
+  state.Lock.Unlock();
+}
+
+//------------------------------------------------------------------------------
+double vtkSpatialObjectsTrace::GetTime()
+{
+  return vtkTimerLog::GetUniversalTime();
+}
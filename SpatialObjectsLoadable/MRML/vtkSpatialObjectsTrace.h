@@ -0,0 +1,99 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkSpatialObjectsTrace -
+/// Timing probes for the spatial objects hot paths.
+///
+/// The probes are always compiled in: when tracing is disabled, a probe
+/// only costs the read of a boolean, without lock. When enabled, each probe
+/// records its name, start time, duration and thread, and the events are
+/// written as a Chrome trace-event JSON file (chrome://tracing, Perfetto)
+/// when tracing is stopped or the application exits.
+///
+/// Tracing is enabled by setting the SPATIALOBJECTS_TRACE_FILE environment
+/// variable to the output file name, or with Start()/Stop().
+///
+/// Usage:
+/// \code
+/// void vtkMyClass::MyMethod()
+/// {
+///   vtkSpatialObjectsTraceScope("vtkMyClass::MyMethod");
+///   ...
+/// }
+/// \endcode
+
+#ifndef __vtkSpatialObjectsTrace_h
+#define __vtkSpatialObjectsTrace_h
+
+// Spatial Objects includes
+#include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
+
+// Unique probe name, several probes can be in the same scope.
+#define vtkSpatialObjectsTraceConcat(a, b) vtkSpatialObjectsTraceConcat2(a, b)
+#define vtkSpatialObjectsTraceConcat2(a, b) a##b
+#define vtkSpatialObjectsTraceScope(name) \
+  vtkSpatialObjectsTrace::Scope \
+    vtkSpatialObjectsTraceConcat(vtkSpatialObjectsTraceProbe, __LINE__)(name)
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT vtkSpatialObjectsTrace
+{
+public:
+  ///
+  /// Start recording the probes, the events are written into \a fileName
+  /// by Stop(). Events recorded by a previous Start() are discarded.
+  static void Start(const char* fileName);
+
+  ///
+  /// Stop recording and write the events. Return false if the file could
+  /// not be written.
+  static bool Stop();
+
+  ///
+  /// Return true between Start() and Stop(). Thread safe, like the other
+  /// methods, and lock free: the probes call it on every scope.
+  static bool IsEnabled();
+
+  ///
+  /// Time used by the probes, in seconds.
+  static double GetTime();
+
+  ///
+  /// Record an event, \a name must outlive the trace (e.g. a literal).
+  /// Times are in seconds, as returned by vtkTimerLog::GetUniversalTime().
+  static void AddEvent(const char* name, double start, double end);
+
+  /// Scoped probe, see vtkSpatialObjectsTraceScope.
+  class Scope
+  {
+  public:
+    Scope(const char* name)
+      : Name(name), Start(IsEnabled() ? GetTime() : -1.)
+    {}
+    ~Scope()
+    {
+      if (this->Start >= 0.)
+        {
+        AddEvent(this->Name, this->Start, GetTime());
+        }
+    }
+  private:
+    const char* Name;
+    double Start;
+  };
+};
+
+#endif
@@ -0,0 +1,278 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSpatialObjectsTrcCodec.h"
+
+// STD includes
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// Matches are at least 4 bytes long, within the last 64 KB.
+const size_t MinimumMatchLength = 4;
+const size_t MaximumOffset = 65535;
+const int HashBits = 16;
+
+//------------------------------------------------------------------------------
+inline vtkTypeUInt32 Read32(const unsigned char* p)
+{
+  vtkTypeUInt32 value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+//------------------------------------------------------------------------------
+inline size_t Hash(vtkTypeUInt32 sequence)
+{
+  return (sequence * 2654435761U) >> (32 - HashBits);
+}
+
+//------------------------------------------------------------------------------
+// Lengths of 15 and more continue on the next bytes, by steps of 255.
+void AppendLength(size_t length, vtkSpatialObjectsTrcCodec::Buffer& output)
+{
+  for (; length >= 255; length -= 255)
+    {
+    output.push_back(255);
+    }
+  output.push_back(static_cast<unsigned char>(length));
+}
+
+//------------------------------------------------------------------------------
+const unsigned char* ReadLength(const unsigned char* p,
+                                const unsigned char* end, size_t& length)
+{
+  unsigned char byte = 255;
+  while (byte == 255)
+    {
+    if (p >= end)
+      {
+      return 0;
+      }
+    byte = *p++;
+    length += byte;
+    }
+  return p;
+}
+
+//------------------------------------------------------------------------------
+// Sequence: token, literals, then the match, if any (the last sequence has
+// none).
+void AppendSequence(const unsigned char* literals, size_t literalLength,
+                    size_t offset, size_t matchLength,
+                    vtkSpatialObjectsTrcCodec::Buffer& output)
+{
+  const size_t extraMatchLength =
+    matchLength ? matchLength - MinimumMatchLength : 0;
+  output.push_back(static_cast<unsigned char>(
+    ((literalLength < 15 ? literalLength : 15) << 4) |
+    (extraMatchLength < 15 ? extraMatchLength : 15)));
+  if (literalLength >= 15)
+    {
+    AppendLength(literalLength - 15, output);
+    }
+  output.insert(output.end(), literals, literals + literalLength);
+  if (!matchLength)
+    {
+    return;
+    }
+  output.push_back(static_cast<unsigned char>(offset & 0xFF));
+  output.push_back(static_cast<unsigned char>(offset >> 8));
+  if (extraMatchLength >= 15)
+    {
+    AppendLength(extraMatchLength - 15, output);
+    }
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcCodec::Pack(const unsigned char* data, size_t size,
+                                     Buffer& output)
+{
+  // Positions + 1 of the last sequences of 4 bytes with the same hash
+  std::vector<vtkTypeUInt32> table(static_cast<size_t>(1) << HashBits, 0);
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + MinimumMatchLength <= size)
+    {
+    const vtkTypeUInt32 sequence = Read32(data + i);
+    const size_t hash = Hash(sequence);
+    const size_t candidate = table[hash];
+    table[hash] = static_cast<vtkTypeUInt32>(i + 1);
+    if (!candidate || i - (candidate - 1) > MaximumOffset ||
+        Read32(data + candidate - 1) != sequence)
+      {
+      ++i;
+      continue;
+      }
+    const size_t match = candidate - 1;
+    size_t length = MinimumMatchLength;
+    while (i + length < size && data[match + length] == data[i + length])
+      {
+      ++length;
+      }
+    AppendSequence(data + anchor, i - anchor, i - match, length, output);
+    i += length;
+    anchor = i;
+    }
+  AppendSequence(data + anchor, size - anchor, 0, 0, output);
+}
+
+//------------------------------------------------------------------------------
+bool vtkSpatialObjectsTrcCodec::Unpack(const unsigned char* packed,
+                                       size_t packedSize,
+                                       unsigned char* data, size_t size)
+{
+  const unsigned char* p = packed;
+  const unsigned char* end = packed + packedSize;
+  unsigned char* out = data;
+  unsigned char* outEnd = data + size;
+  while (p < end)
+    {
+    const unsigned char token = *p++;
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !(p = ReadLength(p, end, literalLength)))
+      {
+      return false;
+      }
+    if (literalLength > static_cast<size_t>(end - p) ||
+        literalLength > static_cast<size_t>(outEnd - out))
+      {
+      return false;
+      }
+    memcpy(out, p, literalLength);
+    out += literalLength;
+    p += literalLength;
+    if (p == end)
+      {
+      break;
+      }
+    if (end - p < 2)
+      {
+      return false;
+      }
+    const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+    p += 2;
+    size_t matchLength = token & 0x0F;
+    if (matchLength == 15 && !(p = ReadLength(p, end, matchLength)))
+      {
+      return false;
+      }
+    matchLength += MinimumMatchLength;
+    if (offset == 0 || offset > static_cast<size_t>(out - data) ||
+        matchLength > static_cast<size_t>(outEnd - out))
+      {
+      return false;
+      }
+    const unsigned char* match = out - offset;
+    if (offset >= matchLength)
+      {
+      memcpy(out, match, matchLength);
+      out += matchLength;
+      }
+    else
+      {
+      // Overlapping copy: repeats the last offset bytes
+      for (size_t i = 0; i < matchLength; ++i)
+        {
+        *out++ = *match++;
+        }
+      }
+    }
+  return out == outEnd;
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcCodec::EncodeOctahedral(const double normal[3],
+                                                 short encoded[2])
+{
+  const double norm = fabs(normal[0]) + fabs(normal[1]) + fabs(normal[2]);
+  if (norm == 0.)
+    {
+    encoded[0] = encoded[1] = 0;
+    return;
+    }
+  double u = normal[0] / norm;
+  double v = normal[1] / norm;
+  if (normal[2] < 0.)
+    {
+    const double foldedU = (1. - fabs(v)) * (u >= 0. ? 1. : -1.);
+    const double foldedV = (1. - fabs(u)) * (v >= 0. ? 1. : -1.);
+    u = foldedU;
+    v = foldedV;
+    }
+  encoded[0] = static_cast<short>(floor(u * 32767. + 0.5));
+  encoded[1] = static_cast<short>(floor(v * 32767. + 0.5));
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcCodec::DecodeOctahedral(const short encoded[2],
+                                                 double normal[3])
+{
+  double u = encoded[0] / 32767.;
+  double v = encoded[1] / 32767.;
+  const double w = 1. - fabs(u) - fabs(v);
+  if (w < 0.)
+    {
+    const double unfoldedU = (1. - fabs(v)) * (u >= 0. ? 1. : -1.);
+    const double unfoldedV = (1. - fabs(u)) * (v >= 0. ? 1. : -1.);
+    u = unfoldedU;
+    v = unfoldedV;
+    }
+  const double norm = sqrt(u * u + v * v + w * w);
+  normal[0] = u / norm;
+  normal[1] = v / norm;
+  normal[2] = w / norm;
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcCodec::AppendShuffled(const unsigned char* data,
+                                               size_t count, int size,
+                                               Buffer& output)
+{
+  if (count == 0)
+    {
+    return;
+    }
+  const size_t start = output.size();
+  output.resize(start + count * size);
+  unsigned char* shuffled = &output[0] + start;
+  for (int b = 0; b < size; ++b)
+    {
+    for (size_t i = 0; i < count; ++i)
+      {
+      *shuffled++ = data[i * size + b];
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcCodec::Unshuffle(const unsigned char* shuffled,
+                                          size_t count, int size,
+                                          unsigned char* data)
+{
+  for (int b = 0; b < size; ++b)
+    {
+    for (size_t i = 0; i < count; ++i)
+      {
+      data[i * size + b] = *shuffled++;
+      }
+    }
+}
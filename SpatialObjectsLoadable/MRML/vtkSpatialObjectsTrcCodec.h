@@ -0,0 +1,166 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkSpatialObjectsTrcCodec -
+/// Encodings of the .trc compressed spatial objects files.
+///
+/// A .trc file stores the columns of the tubes separately: the quantized
+/// values are delta encoded along the tubes and written as zigzag varints,
+/// the floating point values are byte shuffled, then each column is packed
+/// by a byte-level LZ77 codec (LZ4 block layout: a token with the literal
+/// and match lengths, the literals, a 16 bits offset) that decodes with
+/// plain copies. The unit normals are stored with the octahedral encoding.
+///
+/// See vtkSpatialObjectsTrcWriter and vtkSpatialObjectsTrcReader.
+
+#ifndef __vtkSpatialObjectsTrcCodec_h
+#define __vtkSpatialObjectsTrcCodec_h
+
+// VTK includes
+#include <vtkByteSwap.h>
+#include <vtkType.h>
+
+// Spatial Objects includes
+#include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
+
+// STD includes
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT vtkSpatialObjectsTrcCodec
+{
+public:
+  typedef std::vector<unsigned char> Buffer;
+
+  ///
+  /// Append the packed \a size bytes of \a data to \a output.
+  static void Pack(const unsigned char* data, size_t size, Buffer& output);
+
+  ///
+  /// Unpack the \a packedSize bytes of \a packed into the \a size bytes of
+  /// \a data. Return false if \a packed is corrupted.
+  static bool Unpack(const unsigned char* packed, size_t packedSize,
+                     unsigned char* data, size_t size);
+
+  ///
+  /// Append \a value to \a output as a varint: 7 bits per byte, the high
+  /// bit set on all the bytes but the last one.
+  static void AppendVarint(vtkTypeUInt64 value, Buffer& output)
+  {
+    while (value >= 0x80)
+      {
+      output.push_back(static_cast<unsigned char>(value | 0x80));
+      value >>= 7;
+      }
+    output.push_back(static_cast<unsigned char>(value));
+  }
+
+  ///
+  /// Read the varint at \a p into \a value. Return the end of the varint,
+  /// 0 if it goes past \a end.
+  static const unsigned char* ReadVarint(const unsigned char* p,
+                                         const unsigned char* end,
+                                         vtkTypeUInt64& value)
+  {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+      {
+      const unsigned char byte = *p++;
+      value |= static_cast<vtkTypeUInt64>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        {
+        return p;
+        }
+      }
+    return 0;
+  }
+
+  ///
+  /// Zigzag encoding: the small negative values are small unsigned values.
+  static vtkTypeUInt64 EncodeZigzag(vtkTypeInt64 value)
+  {
+    return (static_cast<vtkTypeUInt64>(value) << 1) ^
+      static_cast<vtkTypeUInt64>(value >> 63);
+  }
+  static vtkTypeInt64 DecodeZigzag(vtkTypeUInt64 value)
+  {
+    return static_cast<vtkTypeInt64>(value >> 1) ^
+      -static_cast<vtkTypeInt64>(value & 1);
+  }
+
+  ///
+  /// Octahedral encoding of the unit vector \a normal on 2 x 16 bits. The
+  /// null vectors are encoded as (0, 0, 1).
+  static void EncodeOctahedral(const double normal[3], short encoded[2]);
+  static void DecodeOctahedral(const short encoded[2], double normal[3]);
+
+  ///
+  /// Append \a value to \a output, in little-endian byte order.
+  template <class T>
+  static void AppendValue(T value, Buffer& output)
+  {
+    SwapLE(&value);
+    const unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+    output.insert(output.end(), bytes, bytes + sizeof(T));
+  }
+
+  ///
+  /// Read the little-endian value at \a p into \a value. Return the end of
+  /// the value, 0 if it goes past \a end.
+  template <class T>
+  static const unsigned char* ReadValue(const unsigned char* p,
+                                        const unsigned char* end, T& value)
+  {
+    if (static_cast<size_t>(end - p) < sizeof(T))
+      {
+      return 0;
+      }
+    memcpy(&value, p, sizeof(T));
+    SwapLE(&value);
+    return p + sizeof(T);
+  }
+
+  ///
+  /// Swap the bytes of \a value on the big-endian platforms.
+  template <class T>
+  static void SwapLE(T* value)
+  {
+    if (sizeof(T) == 2)
+      {
+      vtkByteSwap::Swap2LE(value);
+      }
+    else if (sizeof(T) == 4)
+      {
+      vtkByteSwap::Swap4LE(value);
+      }
+    else if (sizeof(T) == 8)
+      {
+      vtkByteSwap::Swap8LE(value);
+      }
+  }
+
+  ///
+  /// Append the \a count values of \a size bytes of \a data to \a output,
+  /// byte i of all the values, then byte i + 1...
+  static void AppendShuffled(const unsigned char* data, size_t count,
+                             int size, Buffer& output);
+  static void Unshuffle(const unsigned char* shuffled, size_t count,
+                        int size, unsigned char* data);
+};
+
+#endif
@@ -0,0 +1,560 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSpatialObjectsTrcReader.h"
+#include "vtkSpatialObjectsTrace.h"
+#include "vtkSpatialObjectsTrcCodec.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkSpatialObjectsTrcReader);
+
+namespace
+{
+
+typedef vtkSpatialObjectsTrcCodec Codec;
+
+//------------------------------------------------------------------------------
+// Packed column of the file and where it is decoded.
+struct Column
+{
+  enum Encoding
+  {
+    Delta = 0,
+    Float32,
+    Float64
+  };
+  const unsigned char* Packed;
+  vtkTypeUInt64 PackedSize;
+  vtkTypeUInt64 Size;
+  int Encoding;
+  // Delta: Count values, Target[i * Stride] = value * Scale
+  // Float32: Count values, Target[i]
+  // Float64: Count values, Target[i]
+  double* Target;
+  int Stride;
+  double Scale;
+  vtkTypeUInt64 Count;
+};
+
+//------------------------------------------------------------------------------
+bool Unpack(const Column& column, Codec::Buffer& data)
+{
+  data.resize(static_cast<size_t>(column.Size));
+  if (column.Size == 0)
+    {
+    return column.PackedSize == 0;
+    }
+  if (column.PackedSize == column.Size)
+    {
+    memcpy(&data[0], column.Packed, static_cast<size_t>(column.Size));
+    return true;
+    }
+  return Codec::Unpack(column.Packed, static_cast<size_t>(column.PackedSize),
+                       &data[0], static_cast<size_t>(column.Size));
+}
+
+//------------------------------------------------------------------------------
+bool Decode(const Column& column)
+{
+  Codec::Buffer data;
+  if (!Unpack(column, data))
+    {
+    return false;
+    }
+  const size_t count = static_cast<size_t>(column.Count);
+  if (column.Encoding == Column::Delta)
+    {
+    const unsigned char* p = data.empty() ? 0 : &data[0];
+    const unsigned char* end = p + data.size();
+    vtkTypeInt64 value = 0;
+    for (size_t i = 0; i < count; ++i)
+      {
+      vtkTypeUInt64 delta;
+      if (!(p = Codec::ReadVarint(p, end, delta)))
+        {
+        return false;
+        }
+      value += Codec::DecodeZigzag(delta);
+      column.Target[i * column.Stride] =
+        static_cast<double>(value) * column.Scale;
+      }
+    return p == end;
+    }
+  const int size =
+    column.Encoding == Column::Float32 ? sizeof(float) : sizeof(double);
+  if (data.size() != count * size)
+    {
+    return false;
+    }
+  if (count == 0)
+    {
+    return true;
+    }
+  if (column.Encoding == Column::Float64)
+    {
+    Codec::Unshuffle(&data[0], count, size,
+                     reinterpret_cast<unsigned char*>(column.Target));
+    for (size_t i = 0; i < count; ++i)
+      {
+      Codec::SwapLE(column.Target + i);
+      }
+    return true;
+    }
+  std::vector<float> values(count);
+  Codec::Unshuffle(&data[0], count, size,
+                   reinterpret_cast<unsigned char*>(&values[0]));
+  for (size_t i = 0; i < count; ++i)
+    {
+    Codec::SwapLE(&values[i]);
+    column.Target[i] = values[i];
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Columns decoded by the threads: thread i decodes the columns i,
+// i + NumberOfThreads...
+struct DecodeJob
+{
+  std::vector<Column> Columns;
+  std::vector<char> Errors;
+  int NumberOfThreads;
+
+  void DecodeColumns(int thread)
+  {
+    for (size_t i = thread; i < this->Columns.size();
+         i += this->NumberOfThreads)
+      {
+      if (!Decode(this->Columns[i]))
+        {
+        this->Errors[thread] = 1;
+        return;
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE DecodeColumnsThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<DecodeJob*>(info->UserData)->DecodeColumns(info->ThreadID);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//------------------------------------------------------------------------------
+const unsigned char* ReadColumn(const unsigned char* p,
+                                const unsigned char* end, Column& column)
+{
+  if (!p || !(p = Codec::ReadValue(p, end, column.Size)) ||
+      !(p = Codec::ReadValue(p, end, column.PackedSize)) ||
+      column.PackedSize > static_cast<vtkTypeUInt64>(end - p))
+    {
+    return 0;
+    }
+  column.Packed = p;
+  return p + column.PackedSize;
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTrcReader::vtkSpatialObjectsTrcReader()
+{
+  this->FileName = 0;
+  this->NumberOfThreads =
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->Output = vtkPolyData::New();
+}
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTrcReader::~vtkSpatialObjectsTrcReader()
+{
+  this->SetFileName(0);
+  this->Output->Delete();
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcReader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//------------------------------------------------------------------------------
+int vtkSpatialObjectsTrcReader::Read()
+{
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcReader::Read");
+
+  this->Output->Initialize();
+  if (!this->FileName || !*this->FileName)
+    {
+    vtkErrorMacro(<< "Read: no file name");
+    return 0;
+    }
+  Codec::Buffer content;
+  {
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcReader::ReadFile");
+  std::ifstream file(this->FileName, std::ios::in | std::ios::binary);
+  file.seekg(0, std::ios::end);
+  const std::streamoff size = file.tellg();
+  if (!file || size < 4)
+    {
+    vtkErrorMacro(<< "Read: can't read " << this->FileName);
+    return 0;
+    }
+  content.resize(static_cast<size_t>(size));
+  file.seekg(0, std::ios::beg);
+  file.read(reinterpret_cast<char*>(&content[0]), size);
+  if (!file)
+    {
+    vtkErrorMacro(<< "Read: can't read " << this->FileName);
+    return 0;
+    }
+  }
+
+  // Header
+  const unsigned char* p = &content[0];
+  const unsigned char* end = p + content.size();
+  vtkTypeUInt32 flags = 0;
+  double pointPrecision = 0.;
+  double radiusPrecision = 0.;
+  vtkTypeUInt64 numberOfTubes = 0;
+  vtkTypeUInt64 numberOfPoints = 0;
+  vtkTypeUInt32 numberOfExtraArrays = 0;
+  if (memcmp(p, "TRC1", 4) ||
+      !(p = Codec::ReadValue(p + 4, end, flags)) ||
+      !(p = Codec::ReadValue(p, end, pointPrecision)) ||
+      !(p = Codec::ReadValue(p, end, radiusPrecision)) ||
+      !(p = Codec::ReadValue(p, end, numberOfTubes)) ||
+      !(p = Codec::ReadValue(p, end, numberOfPoints)) ||
+      !(p = Codec::ReadValue(p, end, numberOfExtraArrays)))
+    {
+    vtkErrorMacro(<< "Read: " << this->FileName << " is not a .trc file");
+    return 0;
+    }
+  const vtkIdType pointCount = static_cast<vtkIdType>(numberOfPoints);
+  std::vector<vtkSmartPointer<vtkDoubleArray> > extraArrays;
+  for (vtkTypeUInt32 a = 0; a < numberOfExtraArrays && p; ++a)
+    {
+    vtkTypeUInt32 nameLength = 0;
+    vtkTypeUInt32 numberOfComponents = 0;
+    if (!(p = Codec::ReadValue(p, end, nameLength)) ||
+        nameLength > static_cast<vtkTypeUInt32>(end - p))
+      {
+      p = 0;
+      break;
+      }
+    const std::string name(reinterpret_cast<const char*>(p), nameLength);
+    p = Codec::ReadValue(p + nameLength, end, numberOfComponents);
+    if (!p || numberOfComponents == 0 || numberOfComponents > 1024)
+      {
+      p = 0;
+      break;
+      }
+    vtkSmartPointer<vtkDoubleArray> array =
+      vtkSmartPointer<vtkDoubleArray>::New();
+    array->SetName(name.c_str());
+    array->SetNumberOfComponents(numberOfComponents);
+    extraArrays.push_back(array);
+    }
+
+  // The counts are checked against the decoded size of the columns before
+  // anything is allocated: a tube takes at least 3 bytes in the tubes
+  // column, a coordinate at least 1 byte in the first points column, or 8
+  // bytes if lossless. The compressed size does not bound them, regular
+  // tubes take less than a byte per point.
+  const bool lossless = (flags & 0x10) != 0;
+  Column tubes;
+  Column firstPoints;
+  p = ReadColumn(p, end, tubes);
+  if (!p || !ReadColumn(p, end, firstPoints) ||
+      numberOfTubes > tubes.Size / 3 ||
+      numberOfPoints > firstPoints.Size / (lossless ? 24 : 1))
+    {
+    vtkErrorMacro(<< "Read: invalid tubes in " << this->FileName);
+    return 0;
+    }
+  for (size_t a = 0; a < extraArrays.size(); ++a)
+    {
+    extraArrays[a]->SetNumberOfTuples(pointCount);
+    }
+
+  // Tubes, decoded first for the lines
+  Codec::Buffer tubesData;
+  if (!Unpack(tubes, tubesData))
+    {
+    vtkErrorMacro(<< "Read: invalid tubes in " << this->FileName);
+    return 0;
+    }
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfTuples(
+    static_cast<vtkIdType>(numberOfTubes) + pointCount);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  tubeIDs->SetNumberOfTuples(pointCount);
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+  tubeParentIDs->SetNumberOfTuples(static_cast<vtkIdType>(numberOfTubes));
+  {
+  const unsigned char* t = tubesData.empty() ? 0 : &tubesData[0];
+  const unsigned char* tubesEnd = t + tubesData.size();
+  vtkTypeInt64 id = 0;
+  vtkIdType pointId = 0;
+  for (vtkTypeUInt64 tubeId = 0; tubeId < numberOfTubes; ++tubeId)
+    {
+    vtkTypeUInt64 count = 0;
+    vtkTypeUInt64 idDelta = 0;
+    vtkTypeUInt64 parentDelta = 0;
+    if (!(t = Codec::ReadVarint(t, tubesEnd, count)) ||
+        !(t = Codec::ReadVarint(t, tubesEnd, idDelta)) ||
+        !(t = Codec::ReadVarint(t, tubesEnd, parentDelta)) ||
+        count > static_cast<vtkTypeUInt64>(pointCount - pointId))
+      {
+      vtkErrorMacro(<< "Read: invalid tubes in " << this->FileName);
+      return 0;
+      }
+    id += Codec::DecodeZigzag(idDelta);
+    tubeParentIDs->SetValue(static_cast<vtkIdType>(tubeId),
+      static_cast<double>(id + Codec::DecodeZigzag(parentDelta)));
+    *cell++ = static_cast<vtkIdType>(count);
+    for (vtkTypeUInt64 i = 0; i < count; ++i, ++pointId)
+      {
+      tubeIDs->SetValue(pointId, static_cast<double>(id));
+      *cell++ = pointId;
+      }
+    }
+  if (pointId != pointCount)
+    {
+    vtkErrorMacro(<< "Read: invalid tubes in " << this->FileName);
+    return 0;
+    }
+  }
+
+  // The other columns, in the file order
+  vtkNew<vtkDoubleArray> points;
+  points->SetNumberOfComponents(3);
+  points->SetNumberOfTuples(pointCount);
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> tan1;
+  tan1->SetName("Tan1");
+  tan1->SetNumberOfComponents(3);
+  vtkNew<vtkDoubleArray> tan2;
+  tan2->SetName("Tan2");
+  tan2->SetNumberOfComponents(3);
+  vtkNew<vtkDoubleArray> medialness;
+  medialness->SetName("Medialness");
+  vtkNew<vtkDoubleArray> ridgeness;
+  ridgeness->SetName("Ridgeness");
+
+  // Lossless files store the points, radius and normals as doubles.
+  DecodeJob job;
+  Column column;
+  column.Count = numberOfPoints;
+  if (flags & 0x01)
+    {
+    tubeRadius->SetNumberOfTuples(pointCount);
+    }
+  if (flags & 0x02)
+    {
+    tan1->SetNumberOfTuples(pointCount);
+    tan2->SetNumberOfTuples(pointCount);
+    }
+  if (lossless)
+    {
+    column.Encoding = Column::Float64;
+    column.Count = 3 * numberOfPoints;
+    column.Target = points->GetPointer(0);
+    job.Columns.push_back(column);
+    if (flags & 0x01)
+      {
+      column.Count = numberOfPoints;
+      column.Target = tubeRadius->GetPointer(0);
+      job.Columns.push_back(column);
+      }
+    for (int k = 0; k < 2 && (flags & 0x02); ++k)
+      {
+      column.Count = 3 * numberOfPoints;
+      column.Target =
+        (k == 0 ? tan1.GetPointer() : tan2.GetPointer())->GetPointer(0);
+      job.Columns.push_back(column);
+      }
+    column.Count = numberOfPoints;
+    }
+  else
+    {
+    column.Encoding = Column::Delta;
+    column.Stride = 3;
+    column.Scale = pointPrecision;
+    for (int k = 0; k < 3; ++k)
+      {
+      column.Target = points->GetPointer(0) + k;
+      job.Columns.push_back(column);
+      }
+    if (flags & 0x01)
+      {
+      column.Target = tubeRadius->GetPointer(0);
+      column.Stride = 1;
+      column.Scale = radiusPrecision;
+      job.Columns.push_back(column);
+      }
+    if (flags & 0x02)
+      {
+      // The octahedral codes are decoded in the first 2 components.
+      column.Stride = 3;
+      column.Scale = 1.;
+      for (int k = 0; k < 4; ++k)
+        {
+        column.Target =
+          (k < 2 ? tan1.GetPointer() : tan2.GetPointer())->GetPointer(0) +
+          k % 2;
+        job.Columns.push_back(column);
+        }
+      }
+    }
+  column.Encoding = lossless ? Column::Float64 : Column::Float32;
+  if (flags & 0x04)
+    {
+    medialness->SetNumberOfTuples(pointCount);
+    column.Target = medialness->GetPointer(0);
+    job.Columns.push_back(column);
+    }
+  if (flags & 0x08)
+    {
+    ridgeness->SetNumberOfTuples(pointCount);
+    column.Target = ridgeness->GetPointer(0);
+    job.Columns.push_back(column);
+    }
+  column.Encoding = Column::Float64;
+  for (size_t a = 0; a < extraArrays.size(); ++a)
+    {
+    column.Target = extraArrays[a]->GetPointer(0);
+    column.Count = numberOfPoints * extraArrays[a]->GetNumberOfComponents();
+    job.Columns.push_back(column);
+    }
+  for (size_t i = 0; i < job.Columns.size() && p; ++i)
+    {
+    p = ReadColumn(p, end, job.Columns[i]);
+    }
+  if (!p)
+    {
+    vtkErrorMacro(<< "Read: truncated file " << this->FileName);
+    return 0;
+    }
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(this->NumberOfThreads);
+  job.NumberOfThreads = threader->GetNumberOfThreads();
+  if (job.NumberOfThreads > static_cast<int>(job.Columns.size()))
+    {
+    job.NumberOfThreads = static_cast<int>(job.Columns.size());
+    }
+  job.Errors.resize(job.NumberOfThreads, 0);
+  {
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcReader::DecodeColumns");
+  if (job.NumberOfThreads > 1)
+    {
+    threader->SetNumberOfThreads(job.NumberOfThreads);
+    threader->SetSingleMethod(DecodeColumnsThread, &job);
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    job.DecodeColumns(0);
+    }
+  }
+  for (int i = 0; i < job.NumberOfThreads; ++i)
+    {
+    if (job.Errors[i])
+      {
+      vtkErrorMacro(<< "Read: invalid columns in " << this->FileName);
+      return 0;
+      }
+    }
+  if ((flags & 0x02) && !lossless)
+    {
+    double* normals[2] = {tan1->GetPointer(0), tan2->GetPointer(0)};
+    for (int n = 0; n < 2; ++n)
+      {
+      for (vtkIdType i = 0; i < pointCount; ++i)
+        {
+        double* normal = normals[n] + 3 * i;
+        const short encoded[2] =
+          {static_cast<short>(normal[0]), static_cast<short>(normal[1])};
+        Codec::DecodeOctahedral(encoded, normal);
+        }
+      }
+    }
+
+  // Same arrays as vtkSpatialObjectsTreReader
+  vtkNew<vtkPoints> outputPoints;
+  outputPoints->SetData(points.GetPointer());
+  vtkNew<vtkCellArray> lines;
+  lines->SetCells(static_cast<vtkIdType>(numberOfTubes),
+                  connectivity.GetPointer());
+  this->Output->SetPoints(outputPoints.GetPointer());
+  this->Output->SetLines(lines.GetPointer());
+  vtkPointData* pointData = this->Output->GetPointData();
+  if (flags & 0x01)
+    {
+    pointData->AddArray(tubeRadius.GetPointer());
+    pointData->SetActiveScalars("TubeRadius");
+    }
+  pointData->AddArray(tubeIDs.GetPointer());
+  this->Output->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+  if (flags & 0x02)
+    {
+    pointData->AddArray(tan1.GetPointer());
+    pointData->AddArray(tan2.GetPointer());
+    }
+  if (flags & 0x04)
+    {
+    pointData->AddArray(medialness.GetPointer());
+    }
+  if (flags & 0x08)
+    {
+    pointData->AddArray(ridgeness.GetPointer());
+    }
+  for (size_t a = 0; a < extraArrays.size(); ++a)
+    {
+    pointData->AddArray(extraArrays[a]);
+    }
+  return 1;
+}
@@ -0,0 +1,76 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkSpatialObjectsTrcReader -
+/// Read the tubes of a .trc file, written by vtkSpatialObjectsTrcWriter,
+/// into a polydata.
+///
+/// The polydata has the same layout as the one of
+/// vtkSpatialObjectsTreReader: one line per tube, the points of a tube
+/// being contiguous, the point data in double arrays and the TubeParentIDs
+/// cell data. The columns are unpacked and decoded by NumberOfThreads
+/// threads, directly into the output arrays.
+
+#ifndef __vtkSpatialObjectsTrcReader_h
+#define __vtkSpatialObjectsTrcReader_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// Spatial Objects includes
+#include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
+
+class vtkPolyData;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT vtkSpatialObjectsTrcReader
+  : public vtkObject
+{
+public:
+  static vtkSpatialObjectsTrcReader *New();
+  vtkTypeMacro(vtkSpatialObjectsTrcReader, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  ///
+  /// Number of threads decoding the columns, the number of processors by
+  /// default.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Read FileName into the output. Return 0 if the file can't be read;
+  /// the output is then empty.
+  int Read();
+
+  ///
+  /// Polydata filled by Read().
+  vtkGetObjectMacro(Output, vtkPolyData);
+
+protected:
+  vtkSpatialObjectsTrcReader();
+  ~vtkSpatialObjectsTrcReader();
+  vtkSpatialObjectsTrcReader(const vtkSpatialObjectsTrcReader&);
+  void operator=(const vtkSpatialObjectsTrcReader&);
+
+  char* FileName;
+  int NumberOfThreads;
+  vtkPolyData* Output;
+};
+
+#endif
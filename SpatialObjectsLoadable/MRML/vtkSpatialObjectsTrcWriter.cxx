@@ -0,0 +1,448 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSpatialObjectsTrcWriter.h"
+#include "vtkSpatialObjectsTrace.h"
+#include "vtkSpatialObjectsTrcCodec.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkSpatialObjectsTrcWriter);
+
+namespace
+{
+
+typedef vtkSpatialObjectsTrcCodec Codec;
+
+// Point data arrays stored in their own columns or not saved.
+const char* const KnownArrayNames[] =
+  {"TubeIDs", "TubeRadius", "Ridgeness", "Medialness", "Tan1", "Tan2",
+   "TubeVisibilityMask", 0};
+
+//------------------------------------------------------------------------------
+bool IsInList(const char* name, const char* const* list)
+{
+  for (; *list; ++list)
+    {
+    if (!strcmp(name, *list))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+inline vtkTypeInt64 Quantize(double value, double precision)
+{
+  return static_cast<vtkTypeInt64>(floor(value / precision + 0.5));
+}
+
+//------------------------------------------------------------------------------
+// Append the components of the points \a pointIds of \a array to \a column,
+// as doubles byte shuffled in little-endian order.
+void AppendDoubles(vtkDataArray* array, const std::vector<vtkIdType>& pointIds,
+                   std::vector<double>& doubles, Codec::Buffer& column)
+{
+  const int numberOfComponents = array->GetNumberOfComponents();
+  doubles.resize(pointIds.size() * numberOfComponents);
+  for (size_t i = 0; i < pointIds.size(); ++i)
+    {
+    for (int k = 0; k < numberOfComponents; ++k)
+      {
+      double& value = doubles[i * numberOfComponents + k];
+      value = array->GetComponent(pointIds[i], k);
+      Codec::SwapLE(&value);
+      }
+    }
+  Codec::AppendShuffled(reinterpret_cast<unsigned char*>(&doubles[0]),
+                        doubles.size(), sizeof(double), column);
+}
+
+//------------------------------------------------------------------------------
+// Column of quantized values, delta encoded.
+struct DeltaColumn
+{
+  DeltaColumn() : Previous(0) {}
+  void Append(vtkTypeInt64 value)
+  {
+    Codec::AppendVarint(Codec::EncodeZigzag(value - this->Previous),
+                        this->Data);
+    this->Previous = value;
+  }
+  vtkTypeInt64 Previous;
+  Codec::Buffer Data;
+};
+
+//------------------------------------------------------------------------------
+// Columns packed by the threads: thread i packs the columns i,
+// i + NumberOfThreads...
+struct PackJob
+{
+  std::vector<Codec::Buffer*> Columns;
+  std::vector<Codec::Buffer> Packed;
+  int NumberOfThreads;
+
+  void PackColumns(int thread)
+  {
+    for (size_t i = thread; i < this->Columns.size();
+         i += this->NumberOfThreads)
+      {
+      const Codec::Buffer& column = *this->Columns[i];
+      if (!column.empty())
+        {
+        Codec::Pack(&column[0], column.size(), this->Packed[i]);
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE PackColumnsThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<PackJob*>(info->UserData)->PackColumns(info->ThreadID);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTrcWriter::vtkSpatialObjectsTrcWriter()
+{
+  this->FileName = 0;
+  this->Input = 0;
+  this->PointPrecision = 1e-4;
+  this->RadiusPrecision = 1e-4;
+  this->Lossless = false;
+  this->NumberOfThreads =
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+}
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTrcWriter::~vtkSpatialObjectsTrcWriter()
+{
+  this->SetFileName(0);
+  this->SetInput(0);
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTrcWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "Input: " << this->Input << "\n";
+  os << indent << "PointPrecision: " << this->PointPrecision << "\n";
+  os << indent << "RadiusPrecision: " << this->RadiusPrecision << "\n";
+  os << indent << "Lossless: " << this->Lossless << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//------------------------------------------------------------------------------
+vtkCxxSetObjectMacro(vtkSpatialObjectsTrcWriter, Input, vtkPolyData);
+
+//------------------------------------------------------------------------------
+int vtkSpatialObjectsTrcWriter::Write()
+{
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcWriter::Write");
+
+  if (!this->FileName || !*this->FileName)
+    {
+    vtkErrorMacro(<< "Write: no file name");
+    return 0;
+    }
+  vtkPolyData* polyData = this->Input;
+  if (!polyData || !polyData->GetPoints())
+    {
+    vtkErrorMacro(<< "Write: no input points");
+    return 0;
+    }
+
+  vtkPointData* pointData = polyData->GetPointData();
+  vtkDataArray* tubeRadius = pointData->GetArray("TubeRadius");
+  vtkDataArray* tan1 = pointData->GetArray("Tan1");
+  vtkDataArray* tan2 = pointData->GetArray("Tan2");
+  vtkDataArray* medialness = pointData->GetArray("Medialness");
+  vtkDataArray* ridgeness = pointData->GetArray("Ridgeness");
+  vtkDataArray* tubeIDs = pointData->GetArray("TubeIDs");
+  vtkDataArray* tubeParentIDs =
+    polyData->GetCellData()->GetArray("TubeParentIDs");
+  if (!tan1 || !tan2 ||
+      tan1->GetNumberOfComponents() != 3 || tan2->GetNumberOfComponents() != 3)
+    {
+    tan1 = tan2 = 0;
+    }
+  std::vector<vtkDataArray*> extraArrays;
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+    {
+    vtkDataArray* array = pointData->GetArray(i);
+    const char* name = array ? array->GetName() : 0;
+    if (name && *name && !IsInList(name, KnownArrayNames) &&
+        array->GetNumberOfComponents() > 0)
+      {
+      extraArrays.push_back(array);
+      }
+    }
+  unsigned int flags = 0;
+  flags |= tubeRadius ? 0x01 : 0;
+  flags |= tan1 ? 0x02 : 0;
+  flags |= medialness ? 0x04 : 0;
+  flags |= ridgeness ? 0x08 : 0;
+  flags |= this->Lossless ? 0x10 : 0;
+
+  // Encode the columns, walking the points along the tubes.
+  vtkCellArray* lines = polyData->GetLines();
+  const vtkIdType* connectivity = lines ? lines->GetPointer() : 0;
+  const vtkIdType connectivitySize =
+    lines ? lines->GetNumberOfConnectivityEntries() : 0;
+  Codec::Buffer tubes;
+  DeltaColumn coordinates[3];
+  DeltaColumn radius;
+  DeltaColumn normals[4];
+  Codec::Buffer pointsColumn;
+  Codec::Buffer radiusColumn;
+  Codec::Buffer normalsColumns[2];
+  Codec::Buffer medialnessColumn;
+  Codec::Buffer ridgenessColumn;
+  std::vector<Codec::Buffer> extraColumns(extraArrays.size());
+  std::vector<float> floats;
+  std::vector<double> doubles;
+  vtkTypeUInt64 numberOfTubes = 0;
+  vtkTypeUInt64 numberOfPoints = 0;
+  {
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcWriter::EncodeColumns");
+  vtkTypeInt64 previousId = 0;
+  std::vector<vtkIdType> pointIds;
+  for (vtkIdType location = 0; location < connectivitySize;
+       location += connectivity[location] + 1, ++numberOfTubes)
+    {
+    const vtkIdType count = connectivity[location];
+    const vtkIdType* ids = connectivity + location + 1;
+    const vtkTypeInt64 id = tubeIDs && count > 0 ?
+      Quantize(tubeIDs->GetComponent(ids[0], 0), 1.) : -1;
+    const vtkTypeInt64 parentId =
+      tubeParentIDs && numberOfTubes <
+        static_cast<vtkTypeUInt64>(tubeParentIDs->GetNumberOfTuples()) ?
+      Quantize(tubeParentIDs->GetComponent(numberOfTubes, 0), 1.) : -1;
+    Codec::AppendVarint(count, tubes);
+    Codec::AppendVarint(Codec::EncodeZigzag(id - previousId), tubes);
+    Codec::AppendVarint(Codec::EncodeZigzag(parentId - id), tubes);
+    previousId = id;
+    pointIds.insert(pointIds.end(), ids, ids + count);
+    numberOfPoints += count;
+    }
+
+  vtkPoints* points = polyData->GetPoints();
+  for (size_t i = 0; i < pointIds.size() && !this->Lossless; ++i)
+    {
+    const vtkIdType pointId = pointIds[i];
+    double point[3];
+    points->GetPoint(pointId, point);
+    for (int k = 0; k < 3; ++k)
+      {
+      coordinates[k].Append(Quantize(point[k], this->PointPrecision));
+      }
+    if (tubeRadius)
+      {
+      radius.Append(Quantize(tubeRadius->GetComponent(pointId, 0),
+                             this->RadiusPrecision));
+      }
+    if (tan1)
+      {
+      short encoded[4];
+      Codec::EncodeOctahedral(tan1->GetTuple3(pointId), encoded);
+      Codec::EncodeOctahedral(tan2->GetTuple3(pointId), encoded + 2);
+      for (int k = 0; k < 4; ++k)
+        {
+        normals[k].Append(encoded[k]);
+        }
+      }
+    }
+
+  // Floating point columns, byte shuffled in little-endian order
+  if (this->Lossless && !pointIds.empty())
+    {
+    AppendDoubles(points->GetData(), pointIds, doubles, pointsColumn);
+    if (tubeRadius)
+      {
+      AppendDoubles(tubeRadius, pointIds, doubles, radiusColumn);
+      }
+    if (tan1)
+      {
+      AppendDoubles(tan1, pointIds, doubles, normalsColumns[0]);
+      AppendDoubles(tan2, pointIds, doubles, normalsColumns[1]);
+      }
+    }
+  vtkDataArray* floatArrays[2] = {medialness, ridgeness};
+  Codec::Buffer* floatColumns[2] = {&medialnessColumn, &ridgenessColumn};
+  for (int a = 0; a < 2; ++a)
+    {
+    if (!floatArrays[a] || pointIds.empty())
+      {
+      continue;
+      }
+    if (this->Lossless)
+      {
+      AppendDoubles(floatArrays[a], pointIds, doubles, *floatColumns[a]);
+      continue;
+      }
+    floats.resize(pointIds.size());
+    for (size_t i = 0; i < pointIds.size(); ++i)
+      {
+      floats[i] = static_cast<float>(
+        floatArrays[a]->GetComponent(pointIds[i], 0));
+      Codec::SwapLE(&floats[i]);
+      }
+    Codec::AppendShuffled(reinterpret_cast<unsigned char*>(&floats[0]),
+                          floats.size(), sizeof(float), *floatColumns[a]);
+    }
+  for (size_t a = 0; a < extraArrays.size() && !pointIds.empty(); ++a)
+    {
+    AppendDoubles(extraArrays[a], pointIds, doubles, extraColumns[a]);
+    }
+  }
+
+  // Pack the columns, in the file order.
+  PackJob job;
+  job.Columns.push_back(&tubes);
+  if (this->Lossless)
+    {
+    job.Columns.push_back(&pointsColumn);
+    if (tubeRadius)
+      {
+      job.Columns.push_back(&radiusColumn);
+      }
+    for (int k = 0; k < 2 && tan1; ++k)
+      {
+      job.Columns.push_back(&normalsColumns[k]);
+      }
+    }
+  else
+    {
+    for (int k = 0; k < 3; ++k)
+      {
+      job.Columns.push_back(&coordinates[k].Data);
+      }
+    if (tubeRadius)
+      {
+      job.Columns.push_back(&radius.Data);
+      }
+    for (int k = 0; k < 4 && tan1; ++k)
+      {
+      job.Columns.push_back(&normals[k].Data);
+      }
+    }
+  if (medialness)
+    {
+    job.Columns.push_back(&medialnessColumn);
+    }
+  if (ridgeness)
+    {
+    job.Columns.push_back(&ridgenessColumn);
+    }
+  for (size_t a = 0; a < extraColumns.size(); ++a)
+    {
+    job.Columns.push_back(&extraColumns[a]);
+    }
+  job.Packed.resize(job.Columns.size());
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(this->NumberOfThreads);
+  job.NumberOfThreads = threader->GetNumberOfThreads();
+  if (job.NumberOfThreads > static_cast<int>(job.Columns.size()))
+    {
+    job.NumberOfThreads = static_cast<int>(job.Columns.size());
+    }
+  {
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcWriter::PackColumns");
+  if (job.NumberOfThreads > 1)
+    {
+    threader->SetNumberOfThreads(job.NumberOfThreads);
+    threader->SetSingleMethod(PackColumnsThread, &job);
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    job.PackColumns(0);
+    }
+  }
+
+  Codec::Buffer header;
+  header.insert(header.end(), "TRC1", "TRC1" + 4);
+  Codec::AppendValue(static_cast<vtkTypeUInt32>(flags), header);
+  Codec::AppendValue(this->PointPrecision, header);
+  Codec::AppendValue(this->RadiusPrecision, header);
+  Codec::AppendValue(numberOfTubes, header);
+  Codec::AppendValue(numberOfPoints, header);
+  Codec::AppendValue(static_cast<vtkTypeUInt32>(extraArrays.size()), header);
+  for (size_t a = 0; a < extraArrays.size(); ++a)
+    {
+    const std::string name = extraArrays[a]->GetName();
+    Codec::AppendValue(static_cast<vtkTypeUInt32>(name.size()), header);
+    header.insert(header.end(), name.begin(), name.end());
+    Codec::AppendValue(static_cast<vtkTypeUInt32>(
+      extraArrays[a]->GetNumberOfComponents()), header);
+    }
+
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTrcWriter::WriteFile");
+  std::ofstream file(this->FileName, std::ios::out | std::ios::binary);
+  if (!file)
+    {
+    vtkErrorMacro(<< "Write: can't open " << this->FileName);
+    return 0;
+    }
+  file.write(reinterpret_cast<const char*>(&header[0]), header.size());
+  for (size_t i = 0; i < job.Columns.size() && file; ++i)
+    {
+    // The columns that don't pack are stored as they are.
+    const Codec::Buffer& column = *job.Columns[i];
+    const Codec::Buffer& packed =
+      job.Packed[i].size() < column.size() ? job.Packed[i] : column;
+    Codec::Buffer sizes;
+    Codec::AppendValue(static_cast<vtkTypeUInt64>(column.size()), sizes);
+    Codec::AppendValue(static_cast<vtkTypeUInt64>(packed.size()), sizes);
+    file.write(reinterpret_cast<const char*>(&sizes[0]), sizes.size());
+    if (!packed.empty())
+      {
+      file.write(reinterpret_cast<const char*>(&packed[0]), packed.size());
+      }
+    }
+  file.close();
+  if (file.fail())
+    {
+    vtkErrorMacro(<< "Write: error writing " << this->FileName);
+    return 0;
+    }
+  return 1;
+}
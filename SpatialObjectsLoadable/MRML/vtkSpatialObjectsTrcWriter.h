@@ -0,0 +1,98 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkSpatialObjectsTrcWriter -
+/// Write the tubes of a spatial objects polydata into a compressed .trc
+/// file.
+///
+/// The points and the TubeRadius are quantized with PointPrecision and
+/// RadiusPrecision, the Tan1 and Tan2 normals are stored on 2 x 16 bits,
+/// the Medialness and Ridgeness as floats and the TubeIDs, TubeParentIDs
+/// as integers. The other numerical point data arrays are stored as
+/// doubles, without loss. See vtkSpatialObjectsTrcCodec for the encodings.
+/// If Lossless is on, the points, the TubeRadius, the normals, the
+/// Medialness and the Ridgeness are stored as doubles too: the file is read
+/// back exactly.
+///
+/// The columns are packed by NumberOfThreads threads.
+
+#ifndef __vtkSpatialObjectsTrcWriter_h
+#define __vtkSpatialObjectsTrcWriter_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// Spatial Objects includes
+#include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
+
+class vtkPolyData;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT vtkSpatialObjectsTrcWriter
+  : public vtkObject
+{
+public:
+  static vtkSpatialObjectsTrcWriter *New();
+  vtkTypeMacro(vtkSpatialObjectsTrcWriter, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  ///
+  /// Polydata whose lines are written, one tube per line.
+  virtual void SetInput(vtkPolyData* polyData);
+  vtkGetObjectMacro(Input, vtkPolyData);
+
+  ///
+  /// Quantization steps of the points and of the radius, 1e-4 by default.
+  vtkSetClampMacro(PointPrecision, double, 1e-12, VTK_DOUBLE_MAX);
+  vtkGetMacro(PointPrecision, double);
+  vtkSetClampMacro(RadiusPrecision, double, 1e-12, VTK_DOUBLE_MAX);
+  vtkGetMacro(RadiusPrecision, double);
+
+  ///
+  /// Store all the values as doubles, ignoring the precisions. Off by
+  /// default.
+  vtkSetMacro(Lossless, bool);
+  vtkGetMacro(Lossless, bool);
+  vtkBooleanMacro(Lossless, bool);
+
+  ///
+  /// Number of threads packing the columns, the number of processors by
+  /// default.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Write the input into FileName. Return 0 on error.
+  int Write();
+
+protected:
+  vtkSpatialObjectsTrcWriter();
+  ~vtkSpatialObjectsTrcWriter();
+  vtkSpatialObjectsTrcWriter(const vtkSpatialObjectsTrcWriter&);
+  void operator=(const vtkSpatialObjectsTrcWriter&);
+
+  char* FileName;
+  vtkPolyData* Input;
+  double PointPrecision;
+  double RadiusPrecision;
+  bool Lossless;
+  int NumberOfThreads;
+};
+
+#endif
@@ -0,0 +1,1408 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSpatialObjectsTreReader.h"
+#include "vtkSpatialObjectsTrace.h"
+#include "vtkSpatialObjectsTreWriter.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// ITK includes
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <cctype>
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+vtkStandardNewMacro(vtkSpatialObjectsTreReader);
+vtkCxxSetObjectMacro(vtkSpatialObjectsTreReader, TubeIDs, vtkIdList);
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+  MappedFile() : Data(0), Size(0)
+#ifdef _WIN32
+    , Mapping(0)
+#endif
+  {}
+
+  ~MappedFile()
+  {
+    if (!this->Data)
+      {
+      return;
+      }
+#ifdef _WIN32
+    UnmapViewOfFile(this->Data);
+    CloseHandle(this->Mapping);
+#else
+    munmap(const_cast<char*>(this->Data), this->Size);
+#endif
+  }
+
+  bool Open(const char* fileName)
+  {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file == INVALID_HANDLE_VALUE)
+      {
+      return false;
+      }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+      {
+      this->Mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+      if (this->Mapping)
+        {
+        this->Data = static_cast<const char*>(
+          MapViewOfFile(this->Mapping, FILE_MAP_READ, 0, 0, 0));
+        this->Size = static_cast<size_t>(size.QuadPart);
+        if (!this->Data)
+          {
+          CloseHandle(this->Mapping);
+          }
+        }
+      }
+    CloseHandle(file);
+#else
+    int file = open(fileName, O_RDONLY);
+    if (file < 0)
+      {
+      return false;
+      }
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+      {
+      void* data = mmap(0, static_cast<size_t>(status.st_size), PROT_READ,
+                        MAP_PRIVATE, file, 0);
+      if (data != MAP_FAILED)
+        {
+        this->Data = static_cast<const char*>(data);
+        this->Size = static_cast<size_t>(status.st_size);
+        madvise(data, this->Size, MADV_SEQUENTIAL);
+        }
+      }
+    close(file);
+#endif
+    return this->Data != 0;
+  }
+
+  const char* Data;
+  size_t Size;
+
+private:
+#ifdef _WIN32
+  HANDLE Mapping;
+#endif
+};
+
+//------------------------------------------------------------------------------
+// Columns of the vessel tube points read into the output.
+enum
+{
+  ColumnX = 0, ColumnY, ColumnZ, ColumnR, ColumnRn, ColumnMn,
+  ColumnV1x, ColumnV1y, ColumnV1z, ColumnV2x, ColumnV2y, ColumnV2z,
+  NumberOfKnownColumns
+};
+
+const char* const KnownColumnNames[NumberOfKnownColumns] =
+  {"x", "y", "z", "r", "rn", "mn", "v1x", "v1y", "v1z", "v2x", "v2y", "v2z"};
+
+// MetaIO fields that are not read, see vtkSpatialObjectsTreWriter.
+const char* const IgnoredColumnNames[] =
+  {"bn", "mk", "tx", "ty", "tz", "a1", "a2", "a3", "red", "green", "blue",
+   "alpha", "id", 0};
+
+//------------------------------------------------------------------------------
+// Output array filled by a column: Data[pointId * Stride].
+struct ColumnTarget
+{
+  double* Data;
+  int Stride;
+};
+
+//------------------------------------------------------------------------------
+struct Tube
+{
+  double Id;
+  double ParentId;
+  double Spacing[3];
+  std::string PointDim;
+  // Column of each word of PointDim, -1 for the ignored ones.
+  std::vector<int> Columns;
+  bool HasNormals;
+  // Bounds of the points, once the spacing is applied, and whether the
+  // tube is read or only parsed to build the index.
+  double Bounds[6];
+  bool Selected;
+  // Point block
+  const char* Begin;
+  const char* End;
+  vtkIdType NumberOfPoints;
+  // First point in the output arrays and number of points left once the
+  // duplicates are removed.
+  vtkIdType Offset;
+  vtkIdType NumberOfKeptPoints;
+};
+
+//------------------------------------------------------------------------------
+// Additional point data array, read from the "Name" or "Name:component"
+// columns.
+struct ExtraArray
+{
+  std::string Name;
+  int NumberOfComponents;
+  vtkSmartPointer<vtkDoubleArray> Array;
+};
+
+//------------------------------------------------------------------------------
+// Point blocks parsed by the threads: thread i parses the tubes
+// [RangeStarts[i], RangeStarts[i + 1][.
+struct ParseJob
+{
+  std::vector<Tube> Tubes;
+  // Target of each column, indexed by Tube::Columns.
+  std::vector<ColumnTarget> Targets;
+  // Arrays moved with the points: data and number of components.
+  std::vector<std::pair<double*, int> > Fields;
+  double* Points;
+  double* TubeRadius;
+  double* Tan1;
+  double* Tan2;
+
+  // Options of the reader
+  int MinimumNumberOfPoints;
+  double MinimumTubeLength;
+  double DecimationTolerance;
+  bool UseROI;
+  double ROI[6];
+
+  std::vector<vtkIdType> RangeStarts;
+  std::vector<char> Errors;
+
+  void ParseTubes(int range);
+  bool ParseTube(Tube& tube);
+  bool IsTubeSelected(const Tube& tube);
+  vtkIdType Decimate(const Tube& tube);
+  void ComputeNormals(const Tube& tube);
+
+  void CopyPoint(vtkIdType from, vtkIdType to)
+  {
+    for (size_t f = 0; f < this->Fields.size(); ++f)
+      {
+      const int n = this->Fields[f].second;
+      double* data = this->Fields[f].first;
+      memcpy(data + n * to, data + n * from, n * sizeof(double));
+      }
+  }
+};
+
+// Maximum number of consecutive points removed by the decimation, it
+// bounds the cost of checking the removed points.
+const vtkIdType MaximumDecimationRun = 64;
+
+//------------------------------------------------------------------------------
+bool IntersectBounds(const double bounds[6], const double roi[6])
+{
+  return bounds[0] <= roi[1] && bounds[1] >= roi[0] &&
+    bounds[2] <= roi[3] && bounds[3] >= roi[2] &&
+    bounds[4] <= roi[5] && bounds[5] >= roi[4];
+}
+
+//------------------------------------------------------------------------------
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+    ++p;
+    }
+  return p;
+}
+
+//------------------------------------------------------------------------------
+std::string Trim(const char* begin, const char* end)
+{
+  while (begin < end && isspace(static_cast<unsigned char>(*begin)))
+    {
+    ++begin;
+    }
+  while (end > begin && isspace(static_cast<unsigned char>(end[-1])))
+    {
+    --end;
+    }
+  return std::string(begin, end);
+}
+
+//------------------------------------------------------------------------------
+void ParseValues(const std::string& text, double* values, int count)
+{
+  const char* p = text.c_str();
+  const char* end = p + text.size();
+  for (int i = 0; i < count && p; ++i)
+    {
+    p = vtkSpatialObjectsTreReader::ParseValue(SkipSpaces(p, end), end,
+                                               values[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ParseTubesThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<ParseJob*>(info->UserData)->ParseTubes(info->ThreadID);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//------------------------------------------------------------------------------
+void ParseJob::ParseTubes(int range)
+{
+  for (vtkIdType tubeId = this->RangeStarts[range];
+       tubeId < this->RangeStarts[range + 1]; ++tubeId)
+    {
+    if (!this->ParseTube(this->Tubes[tubeId]))
+      {
+      this->Errors[range] = 1;
+      return;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool ParseJob::ParseTube(Tube& tube)
+{
+  const char* p = tube.Begin;
+  const char* end = tube.End;
+  const size_t numberOfColumns = tube.Columns.size();
+  for (vtkIdType pointId = tube.Offset;
+       pointId < tube.Offset + tube.NumberOfPoints; ++pointId)
+    {
+    for (size_t i = 0; i < numberOfColumns; ++i)
+      {
+      double value = 0.;
+      p = vtkSpatialObjectsTreReader::ParseValue(SkipSpaces(p, end), end,
+                                                 value);
+      if (!p)
+        {
+        return false;
+        }
+      if (tube.Columns[i] >= 0)
+        {
+        const ColumnTarget& target = this->Targets[tube.Columns[i]];
+        target.Data[pointId * target.Stride] = value;
+        }
+      }
+    }
+
+  // Remove the consecutive duplicate points, as
+  // itk::TubeSpatialObject::RemoveDuplicatePoints().
+  vtkIdType kept = 0;
+  for (vtkIdType i = 0; i < tube.NumberOfPoints; ++i)
+    {
+    const double* point = this->Points + 3 * (tube.Offset + i);
+    if (kept > 0)
+      {
+      const double* last = this->Points + 3 * (tube.Offset + kept - 1);
+      if (point[0] == last[0] && point[1] == last[1] && point[2] == last[2])
+        {
+        continue;
+        }
+      }
+    if (kept != i)
+      {
+      this->CopyPoint(tube.Offset + i, tube.Offset + kept);
+      }
+    ++kept;
+    }
+  tube.NumberOfKeptPoints = kept;
+
+  const double scaleY = tube.Spacing[1] / tube.Spacing[0];
+  const double scaleZ = tube.Spacing[2] / tube.Spacing[0];
+  for (int k = 0; k < 6; k += 2)
+    {
+    tube.Bounds[k] = VTK_DOUBLE_MAX;
+    tube.Bounds[k + 1] = -VTK_DOUBLE_MAX;
+    }
+  for (vtkIdType i = tube.Offset; i < tube.Offset + kept; ++i)
+    {
+    double* point = this->Points + 3 * i;
+    point[1] *= scaleY;
+    point[2] *= scaleZ;
+    for (int k = 0; k < 3; ++k)
+      {
+      tube.Bounds[2 * k] = std::min(tube.Bounds[2 * k], point[k]);
+      tube.Bounds[2 * k + 1] = std::max(tube.Bounds[2 * k + 1], point[k]);
+      }
+    }
+
+  if (!tube.Selected || !this->IsTubeSelected(tube))
+    {
+    tube.NumberOfKeptPoints = 0;
+    return true;
+    }
+  if (this->DecimationTolerance > 0.)
+    {
+    tube.NumberOfKeptPoints = this->Decimate(tube);
+    }
+
+  if (!this->Tan1)
+    {
+    return true;
+    }
+  bool hasNormals = false;
+  for (vtkIdType i = 3 * tube.Offset; tube.HasNormals && !hasNormals &&
+       i < 3 * (tube.Offset + tube.NumberOfKeptPoints); ++i)
+    {
+    hasNormals = this->Tan1[i] != 0. || this->Tan2[i] != 0.;
+    }
+  if (!hasNormals)
+    {
+    this->ComputeNormals(tube);
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool ParseJob::IsTubeSelected(const Tube& tube)
+{
+  const vtkIdType kept = tube.NumberOfKeptPoints;
+  if (kept < this->MinimumNumberOfPoints)
+    {
+    return false;
+    }
+  if (this->MinimumTubeLength <= 0. && !this->UseROI)
+    {
+    return true;
+    }
+  bool inside = !this->UseROI;
+  double length = 0.;
+  for (vtkIdType i = tube.Offset; i < tube.Offset + kept; ++i)
+    {
+    const double* point = this->Points + 3 * i;
+    if (!inside)
+      {
+      inside = point[0] >= this->ROI[0] && point[0] <= this->ROI[1] &&
+        point[1] >= this->ROI[2] && point[1] <= this->ROI[3] &&
+        point[2] >= this->ROI[4] && point[2] <= this->ROI[5];
+      }
+    if (i > tube.Offset)
+      {
+      length += sqrt(vtkMath::Distance2BetweenPoints(point, point - 3));
+      }
+    }
+  return inside && length >= this->MinimumTubeLength;
+}
+
+//------------------------------------------------------------------------------
+// Remove the points whose position, and radius, are within the tolerance
+// of the segment between the points kept around them. Return the number
+// of points left.
+vtkIdType ParseJob::Decimate(const Tube& tube)
+{
+  const vtkIdType first = tube.Offset;
+  const vtkIdType last = tube.Offset + tube.NumberOfKeptPoints - 1;
+  const double tolerance2 =
+    this->DecimationTolerance * this->DecimationTolerance;
+  // The removed points [lastKept + 1, i[ are still at their place, the
+  // kept points are packed after first.
+  vtkIdType lastKept = first;
+  vtkIdType packed = first;
+  for (vtkIdType i = first + 1; i < last; ++i)
+    {
+    const double* a = this->Points + 3 * packed;
+    const double* b = this->Points + 3 * (i + 1);
+    const double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const double length2 = vtkMath::Dot(ab, ab);
+    bool removed = i - lastKept < MaximumDecimationRun;
+    for (vtkIdType j = lastKept + 1; removed && j <= i; ++j)
+      {
+      const double* point = this->Points + 3 * j;
+      const double ap[3] = {point[0] - a[0], point[1] - a[1],
+                            point[2] - a[2]};
+      double t = length2 > 0. ? vtkMath::Dot(ap, ab) / length2 : 0.;
+      t = t < 0. ? 0. : (t > 1. ? 1. : t);
+      const double d[3] = {ap[0] - t * ab[0], ap[1] - t * ab[1],
+                           ap[2] - t * ab[2]};
+      removed = vtkMath::Dot(d, d) <= tolerance2;
+      if (removed && this->TubeRadius)
+        {
+        const double radius = this->TubeRadius[packed] +
+          t * (this->TubeRadius[i + 1] - this->TubeRadius[packed]);
+        removed = fabs(this->TubeRadius[j] - radius) <=
+          this->DecimationTolerance;
+        }
+      }
+    if (!removed)
+      {
+      ++packed;
+      if (packed != i)
+        {
+        this->CopyPoint(i, packed);
+        }
+      lastKept = i;
+      }
+    }
+  if (last > first)
+    {
+    ++packed;
+    if (packed != last)
+      {
+      this->CopyPoint(last, packed);
+      }
+    }
+  return packed - first + 1;
+}
+
+//------------------------------------------------------------------------------
+// Normals of the tubes saved without them: Tan1 is orthogonal to the
+// tangent and to its smallest axis, Tan2 to the tangent and Tan1.
+void ParseJob::ComputeNormals(const Tube& tube)
+{
+  const vtkIdType first = tube.Offset;
+  const vtkIdType last = tube.Offset + tube.NumberOfKeptPoints - 1;
+  for (vtkIdType i = first; i <= last; ++i)
+    {
+    const double* previous = this->Points + 3 * (i > first ? i - 1 : i);
+    const double* next = this->Points + 3 * (i < last ? i + 1 : i);
+    double tangent[3] =
+      {next[0] - previous[0], next[1] - previous[1], next[2] - previous[2]};
+    if (vtkMath::Normalize(tangent) == 0.)
+      {
+      tangent[0] = 1.;
+      }
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+      {
+      if (fabs(tangent[k]) < fabs(tangent[axis]))
+        {
+        axis = k;
+        }
+      }
+    double unit[3] = {0., 0., 0.};
+    unit[axis] = 1.;
+    double* normal1 = this->Tan1 + 3 * i;
+    double* normal2 = this->Tan2 + 3 * i;
+    vtkMath::Cross(tangent, unit, normal1);
+    vtkMath::Normalize(normal1);
+    vtkMath::Cross(tangent, normal1, normal2);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Order \a tubes as ConvertSpatialObjectToPolyData() lists the tubes read by
+// ITK: each tube is a child of the first tube with its ParentID and the
+// tubes are listed depth first, the roots and the children of a tube in
+// file order. The tubes whose parent is not a tube are roots.
+void SortTubes(std::vector<Tube>& tubes)
+{
+  std::map<double, size_t> tubeIndices;
+  for (size_t t = 0; t < tubes.size(); ++t)
+    {
+    tubeIndices.insert(std::make_pair(tubes[t].Id, t));
+    }
+  std::vector<std::vector<size_t> > children(tubes.size());
+  std::vector<size_t> roots;
+  for (size_t t = 0; t < tubes.size(); ++t)
+    {
+    std::map<double, size_t>::const_iterator parent =
+      tubes[t].ParentId >= 0. ? tubeIndices.find(tubes[t].ParentId) :
+      tubeIndices.end();
+    if (parent != tubeIndices.end() && parent->second != t)
+      {
+      children[parent->second].push_back(t);
+      }
+    else
+      {
+      roots.push_back(t);
+      }
+    }
+  std::vector<size_t> order;
+  order.reserve(tubes.size());
+  std::vector<char> listed(tubes.size(), 0);
+  std::vector<size_t> stack;
+  for (size_t r = 0; r < roots.size(); ++r)
+    {
+    stack.push_back(roots[r]);
+    while (!stack.empty())
+      {
+      const size_t t = stack.back();
+      stack.pop_back();
+      if (listed[t])
+        {
+        continue;
+        }
+      listed[t] = 1;
+      order.push_back(t);
+      stack.insert(stack.end(), children[t].rbegin(), children[t].rend());
+      }
+    }
+  // The tubes in a cycle of parents have no root, they are listed last.
+  for (size_t t = 0; t < tubes.size(); ++t)
+    {
+    if (!listed[t])
+      {
+      order.push_back(t);
+      }
+    }
+  bool sorted = true;
+  for (size_t i = 0; i < order.size() && sorted; ++i)
+    {
+    sorted = order[i] == i;
+    }
+  if (sorted)
+    {
+    return;
+    }
+
+  std::vector<Tube> sortedTubes(order.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    {
+    sortedTubes[i] = tubes[order[i]];
+    }
+  tubes.swap(sortedTubes);
+}
+
+//------------------------------------------------------------------------------
+// Tube index: a header identifying the indexed file, then one line per
+// tube with the offsets of its point block in the file, its number of
+// points, ID, parent ID, spacing, bounds and PointDim.
+const char TubeIndexSignature[] = "SpatialObjectsTubeIndex 1";
+const int NumberOfTubeIndexValues = 14;
+
+//------------------------------------------------------------------------------
+// Read the index of \a file into \a tubes. Return false if it is missing,
+// invalid or out of date.
+bool ReadTubeIndex(const char* indexFileName, const MappedFile& file,
+                   long fileTime, std::vector<Tube>& tubes)
+{
+  std::ifstream index(indexFileName, std::ios::in | std::ios::binary);
+  std::string line;
+  if (!std::getline(index, line) || line != TubeIndexSignature)
+    {
+    return false;
+    }
+  double header[3] = {0., 0., 0.};
+  for (int i = 0; i < 3 && std::getline(index, line); ++i)
+    {
+    const std::string::size_type equal = line.find('=');
+    if (equal == std::string::npos)
+      {
+      return false;
+      }
+    ParseValues(line.substr(equal + 1), header + i, 1);
+    }
+  if (header[0] != static_cast<double>(file.Size) ||
+      header[1] != static_cast<double>(fileTime) || header[2] < 0.)
+    {
+    return false;
+    }
+  const vtkIdType numberOfTubes = static_cast<vtkIdType>(header[2]);
+  tubes.resize(numberOfTubes);
+  for (vtkIdType t = 0; t < numberOfTubes; ++t)
+    {
+    if (!std::getline(index, line))
+      {
+      return false;
+      }
+    const char* p = line.c_str();
+    const char* end = p + line.size();
+    double values[NumberOfTubeIndexValues];
+    for (int i = 0; i < NumberOfTubeIndexValues; ++i)
+      {
+      p = vtkSpatialObjectsTreReader::ParseValue(SkipSpaces(p, end), end,
+                                                 values[i]);
+      if (!p)
+        {
+        return false;
+        }
+      }
+    if (values[0] < 0. || values[0] > values[1] ||
+        values[1] > static_cast<double>(file.Size) || values[5] == 0.)
+      {
+      return false;
+      }
+    Tube& tube = tubes[t];
+    tube.Begin = file.Data + static_cast<size_t>(values[0]);
+    tube.End = file.Data + static_cast<size_t>(values[1]);
+    tube.NumberOfPoints = static_cast<vtkIdType>(values[2]);
+    tube.Id = values[3];
+    tube.ParentId = values[4];
+    for (int k = 0; k < 3; ++k)
+      {
+      tube.Spacing[k] = values[5 + k];
+      }
+    for (int k = 0; k < 6; ++k)
+      {
+      tube.Bounds[k] = values[8 + k];
+      }
+    tube.PointDim = Trim(p, end);
+    tube.HasNormals = false;
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool WriteTubeIndex(const char* indexFileName, const MappedFile& file,
+                    long fileTime, const std::vector<Tube>& tubes)
+{
+  std::ofstream index(indexFileName, std::ios::out | std::ios::binary);
+  if (!index)
+    {
+    return false;
+    }
+  index << TubeIndexSignature << "\n"
+        << "FileSize = " << file.Size << "\n"
+        << "FileTime = " << fileTime << "\n"
+        << "NTubes = " << tubes.size() << "\n";
+  char buffer[64];
+  for (size_t t = 0; t < tubes.size(); ++t)
+    {
+    const Tube& tube = tubes[t];
+    double values[NumberOfTubeIndexValues] =
+      {static_cast<double>(tube.Begin - file.Data),
+       static_cast<double>(tube.End - file.Data),
+       static_cast<double>(tube.NumberOfPoints), tube.Id, tube.ParentId,
+       tube.Spacing[0], tube.Spacing[1], tube.Spacing[2],
+       tube.Bounds[0], tube.Bounds[1], tube.Bounds[2], tube.Bounds[3],
+       tube.Bounds[4], tube.Bounds[5]};
+    for (int i = 0; i < NumberOfTubeIndexValues; ++i)
+      {
+      index.write(buffer,
+                  vtkSpatialObjectsTreWriter::FormatValue(values[i], 17,
+                                                          buffer));
+      index << ' ';
+      }
+    index << tube.PointDim << "\n";
+    }
+  return !index.fail();
+}
+
+//------------------------------------------------------------------------------
+// Powers of 10 exactly represented by a double.
+const double ExactPowersOf10[] =
+  {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+   1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTreReader::vtkSpatialObjectsTreReader()
+{
+  this->FileName = 0;
+  this->IndexFileName = 0;
+  this->TubeIDs = 0;
+  this->NumberOfThreads =
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->PointDataArrays = AllArrays;
+  this->MinimumNumberOfPoints = 2;
+  this->MinimumTubeLength = 0.;
+  this->DecimationTolerance = 0.;
+  this->UseROI = false;
+  for (int i = 0; i < 6; ++i)
+    {
+    this->ROI[i] = (i % 2) ? 1. : -1.;
+    }
+  this->Output = vtkPolyData::New();
+}
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTreReader::~vtkSpatialObjectsTreReader()
+{
+  this->SetFileName(0);
+  this->SetIndexFileName(0);
+  this->SetTubeIDs(0);
+  this->Output->Delete();
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTreReader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "IndexFileName: "
+     << (this->IndexFileName ? this->IndexFileName : "(none)") << "\n";
+  os << indent << "TubeIDs: " << this->TubeIDs << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "PointDataArrays: " << this->PointDataArrays << "\n";
+  os << indent << "MinimumNumberOfPoints: " << this->MinimumNumberOfPoints
+     << "\n";
+  os << indent << "MinimumTubeLength: " << this->MinimumTubeLength << "\n";
+  os << indent << "DecimationTolerance: " << this->DecimationTolerance
+     << "\n";
+  os << indent << "UseROI: " << this->UseROI << "\n";
+  os << indent << "ROI: " << this->ROI[0] << " " << this->ROI[1] << " "
+     << this->ROI[2] << " " << this->ROI[3] << " " << this->ROI[4] << " "
+     << this->ROI[5] << "\n";
+}
+
+//------------------------------------------------------------------------------
+const char* vtkSpatialObjectsTreReader::ParseValue(const char* begin,
+                                                   const char* end,
+                                                   double& value)
+{
+  // Decimal mantissa and exponent, as long as the mantissa has at most 19
+  // significant digits.
+  const char* p = begin;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    {
+    negative = (*p == '-');
+    ++p;
+    }
+  vtkTypeUInt64 mantissa = 0;
+  int numberOfDigits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  const char* digits = p;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p)
+    {
+    if (numberOfDigits < 19)
+      {
+      mantissa = mantissa * 10 + (*p - '0');
+      numberOfDigits += (mantissa != 0);
+      }
+    else
+      {
+      ++exponent;
+      truncated = truncated || *p != '0';
+      }
+    }
+  bool hasDigits = p != digits;
+  if (p < end && *p == '.')
+    {
+    ++p;
+    for (digits = p; p < end && *p >= '0' && *p <= '9'; ++p)
+      {
+      if (numberOfDigits < 19)
+        {
+        mantissa = mantissa * 10 + (*p - '0');
+        numberOfDigits += (mantissa != 0);
+        --exponent;
+        }
+      else
+        {
+        truncated = truncated || *p != '0';
+        }
+      }
+    hasDigits = hasDigits || p != digits;
+    }
+  if (!hasDigits)
+    {
+    // nan, inf... are left to strtod
+    truncated = true;
+    }
+  else if (p < end && (*p == 'e' || *p == 'E'))
+    {
+    const char* q = p + 1;
+    bool negativeExponent = false;
+    if (q < end && (*q == '-' || *q == '+'))
+      {
+      negativeExponent = (*q == '-');
+      ++q;
+      }
+    if (q < end && *q >= '0' && *q <= '9')
+      {
+      int exponentValue = 0;
+      for (; q < end && *q >= '0' && *q <= '9'; ++q)
+        {
+        if (exponentValue < 100000)
+          {
+          exponentValue = exponentValue * 10 + (*q - '0');
+          }
+        }
+      exponent += negativeExponent ? -exponentValue : exponentValue;
+      p = q;
+      }
+    }
+
+  // The mantissa and the power of 10 are exact doubles: the product or the
+  // quotient is correctly rounded (Clinger's fast path).
+  if (!truncated && mantissa <= (static_cast<vtkTypeUInt64>(1) << 53) &&
+      exponent >= -22 && exponent <= 22)
+    {
+    value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / ExactPowersOf10[-exponent] :
+      value * ExactPowersOf10[exponent];
+    value = negative ? -value : value;
+    return p;
+    }
+
+  // Otherwise strtod, with the decimal point of the current locale.
+  char text[64];
+  size_t length = 0;
+  const char decimalPoint = localeconv()->decimal_point[0];
+  for (const char* c = begin;
+       c < end && length < sizeof(text) - 1 &&
+       *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n'; ++c)
+    {
+    text[length++] = (*c == '.') ? decimalPoint : *c;
+    }
+  text[length] = '\0';
+  char* textEnd = 0;
+  value = strtod(text, &textEnd);
+  if (textEnd == text)
+    {
+    return 0;
+    }
+  return begin + (textEnd - text);
+}
+
+//------------------------------------------------------------------------------
+int vtkSpatialObjectsTreReader::Read()
+{
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreReader::Read");
+
+  this->Output->Initialize();
+  if (!this->FileName || !*this->FileName)
+    {
+    vtkErrorMacro(<< "Read: no file name");
+    return 0;
+    }
+  MappedFile file;
+  if (!file.Open(this->FileName))
+    {
+    vtkErrorMacro(<< "Read: can't map " << this->FileName);
+    return 0;
+    }
+
+  // Locate the point blocks of the tubes from the index or from their
+  // headers.
+  ParseJob job;
+  const long fileTime = itksys::SystemTools::ModifiedTime(this->FileName);
+  const bool indexed = this->IndexFileName &&
+    ReadTubeIndex(this->IndexFileName, file, fileTime, job.Tubes);
+  if (!indexed)
+    {
+    job.Tubes.clear();
+    vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreReader::ReadHeaders");
+    const char* p = file.Data;
+    const char* end = file.Data + file.Size;
+    bool isTube = false;
+    Tube tube;
+    while (p < end)
+      {
+      const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+      lineEnd = lineEnd ? lineEnd : end;
+      const char* equal = static_cast<const char*>(memchr(p, '=', lineEnd - p));
+      if (!equal)
+        {
+        // Points of the other objects
+        p = lineEnd + 1;
+        continue;
+        }
+      const std::string key = Trim(p, equal);
+      const std::string value = Trim(equal + 1, lineEnd);
+      p = lineEnd + 1;
+
+      if (key == "ObjectType")
+        {
+        // VesselTube, DTITube... as ITK GetChildren(depth, "Tube")
+        isTube = value.find("Tube") != std::string::npos;
+        tube.Id = -1.;
+        tube.ParentId = -1.;
+        tube.Spacing[0] = tube.Spacing[1] = tube.Spacing[2] = 1.;
+        tube.PointDim.clear();
+        tube.HasNormals = false;
+        tube.NumberOfPoints = 0;
+        continue;
+        }
+      if (!isTube)
+        {
+        continue;
+        }
+      if ((key == "NDims" && value != "3") ||
+          (key == "BinaryData" && value == "True"))
+        {
+        vtkDebugMacro(<< "Read: unsupported " << key << " = " << value);
+        return 0;
+        }
+      else if (key == "ID")
+        {
+        ParseValues(value, &tube.Id, 1);
+        }
+      else if (key == "ParentID")
+        {
+        ParseValues(value, &tube.ParentId, 1);
+        }
+      else if (key == "ElementSpacing")
+        {
+        ParseValues(value, tube.Spacing, 3);
+        }
+      else if (key == "NPoints")
+        {
+        double count = 0.;
+        ParseValues(value, &count, 1);
+        tube.NumberOfPoints = static_cast<vtkIdType>(count);
+        }
+      else if (key == "PointDim")
+        {
+        tube.PointDim = value;
+        }
+      else if (key == "Points")
+        {
+        if (tube.Spacing[0] == 0.)
+          {
+          vtkDebugMacro(<< "Read: unsupported tube " << tube.Id);
+          return 0;
+          }
+        // One point per line
+        tube.Begin = p;
+        for (vtkIdType i = 0; i < tube.NumberOfPoints && p < end; ++i)
+          {
+          lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+          p = lineEnd ? lineEnd + 1 : end;
+          }
+        tube.End = p;
+        job.Tubes.push_back(tube);
+        isTube = false;
+        }
+      }
+    }
+
+  SortTubes(job.Tubes);
+
+  // Select the tubes from their IDs and, if they are indexed, from their
+  // bounds. The tubes not selected are not parsed, unless they are needed
+  // to build the index.
+  std::set<vtkIdType> tubeIds;
+  for (vtkIdType i = 0; this->TubeIDs && i < this->TubeIDs->GetNumberOfIds();
+       ++i)
+    {
+    tubeIds.insert(this->TubeIDs->GetId(i));
+    }
+  const bool buildIndex = this->IndexFileName && !indexed;
+  size_t numberOfSelectedTubes = 0;
+  for (size_t t = 0; t < job.Tubes.size(); ++t)
+    {
+    Tube& tube = job.Tubes[t];
+    tube.Selected = (tubeIds.empty() ||
+                     tubeIds.count(static_cast<vtkIdType>(tube.Id)) > 0) &&
+      (!indexed || !this->UseROI || IntersectBounds(tube.Bounds, this->ROI));
+    if (tube.Selected || buildIndex)
+      {
+      if (numberOfSelectedTubes != t)
+        {
+        job.Tubes[numberOfSelectedTubes] = tube;
+        }
+      ++numberOfSelectedTubes;
+      }
+    }
+  job.Tubes.resize(numberOfSelectedTubes);
+
+  // Map the columns of the tubes.
+  std::vector<ExtraArray> extraArrays;
+  std::map<std::string, int> columns;
+  for (int i = 0; i < NumberOfKnownColumns; ++i)
+    {
+    columns[KnownColumnNames[i]] = i;
+    }
+  for (int i = 0; IgnoredColumnNames[i]; ++i)
+    {
+    columns[IgnoredColumnNames[i]] = -1;
+    }
+  // The columns of the arrays that are not read are skipped.
+  const bool readTubeRadius = (this->PointDataArrays & TubeRadiusArray) != 0;
+  const bool readTangents = (this->PointDataArrays & TangentArrays) != 0;
+  const bool readAdditionalArrays =
+    (this->PointDataArrays & AdditionalArrays) != 0;
+  if (!readTubeRadius)
+    {
+    columns["r"] = -1;
+    }
+  for (int i = ColumnV1x; i <= ColumnV2z && !readTangents; ++i)
+    {
+    columns[KnownColumnNames[i]] = -1;
+    }
+  if (!(this->PointDataArrays & MedialnessArray))
+    {
+    columns["mn"] = -1;
+    }
+  if (!(this->PointDataArrays & RidgenessArray))
+    {
+    columns["rn"] = -1;
+    }
+  // Column of an additional array component: (array, component)
+  std::vector<std::pair<int, int> > extraColumns;
+  bool hasMedialness = false;
+  bool hasRidgeness = false;
+  vtkIdType numberOfPoints = 0;
+  for (size_t t = 0; t < job.Tubes.size(); ++t)
+    {
+    Tube& tube = job.Tubes[t];
+    tube.Columns.clear();
+    tube.HasNormals = false;
+    const char* word = tube.PointDim.c_str();
+    while (*word)
+      {
+      const char* wordEnd = word;
+      while (*wordEnd && *wordEnd != ' ' && *wordEnd != '\t')
+        {
+        ++wordEnd;
+        }
+      const std::string name(word, wordEnd);
+      std::map<std::string, int>::iterator it = columns.find(name);
+      if (it == columns.end() && !readAdditionalArrays)
+        {
+        it = columns.insert(std::make_pair(name, -1)).first;
+        }
+      else if (it == columns.end())
+        {
+        // Additional array, "Name" or "Name:component"
+        std::string arrayName = name;
+        int component = 0;
+        const std::string::size_type colon = name.rfind(':');
+        if (colon != std::string::npos && colon + 1 < name.size() &&
+            name.find_first_not_of("0123456789", colon + 1) ==
+              std::string::npos)
+          {
+          arrayName = name.substr(0, colon);
+          component = atoi(name.c_str() + colon + 1);
+          }
+        size_t array = 0;
+        while (array < extraArrays.size() &&
+               extraArrays[array].Name != arrayName)
+          {
+          ++array;
+          }
+        if (array == extraArrays.size())
+          {
+          ExtraArray extraArray;
+          extraArray.Name = arrayName;
+          extraArray.NumberOfComponents = 0;
+          extraArrays.push_back(extraArray);
+          }
+        if (component >= extraArrays[array].NumberOfComponents)
+          {
+          extraArrays[array].NumberOfComponents = component + 1;
+          }
+        const int column = NumberOfKnownColumns +
+          static_cast<int>(extraColumns.size());
+        extraColumns.push_back(
+          std::make_pair(static_cast<int>(array), component));
+        it = columns.insert(std::make_pair(name, column)).first;
+        }
+      tube.Columns.push_back(it->second);
+      tube.HasNormals = tube.HasNormals || it->second == ColumnV1x;
+      hasMedialness = hasMedialness || it->second == ColumnMn;
+      hasRidgeness = hasRidgeness || it->second == ColumnRn;
+      word = wordEnd;
+      while (*word == ' ' || *word == '\t')
+        {
+        ++word;
+        }
+      }
+    if (tube.Columns.size() < 3)
+      {
+      vtkDebugMacro(<< "Read: unsupported tube " << tube.Id);
+      return 0;
+      }
+    tube.Offset = numberOfPoints;
+    tube.NumberOfKeptPoints = 0;
+    numberOfPoints += tube.NumberOfPoints;
+    }
+
+  // Allocate the output arrays, the columns missing in some tubes are 0.
+  vtkNew<vtkDoubleArray> points;
+  points->SetNumberOfComponents(3);
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> ridgeness;
+  ridgeness->SetName("Ridgeness");
+  vtkNew<vtkDoubleArray> medialness;
+  medialness->SetName("Medialness");
+  vtkNew<vtkDoubleArray> tan1;
+  tan1->SetName("Tan1");
+  tan1->SetNumberOfComponents(3);
+  vtkNew<vtkDoubleArray> tan2;
+  tan2->SetName("Tan2");
+  tan2->SetNumberOfComponents(3);
+
+  std::vector<vtkDoubleArray*> arrays;
+  arrays.push_back(points.GetPointer());
+  if (readTubeRadius)
+    {
+    arrays.push_back(tubeRadius.GetPointer());
+    }
+  if (hasRidgeness)
+    {
+    arrays.push_back(ridgeness.GetPointer());
+    }
+  if (hasMedialness)
+    {
+    arrays.push_back(medialness.GetPointer());
+    }
+  if (readTangents)
+    {
+    arrays.push_back(tan1.GetPointer());
+    arrays.push_back(tan2.GetPointer());
+    }
+  for (size_t i = 0; i < extraArrays.size(); ++i)
+    {
+    extraArrays[i].Array = vtkSmartPointer<vtkDoubleArray>::New();
+    extraArrays[i].Array->SetName(extraArrays[i].Name.c_str());
+    extraArrays[i].Array->SetNumberOfComponents(
+      extraArrays[i].NumberOfComponents);
+    arrays.push_back(extraArrays[i].Array);
+    }
+  for (size_t i = 0; i < arrays.size(); ++i)
+    {
+    arrays[i]->SetNumberOfTuples(numberOfPoints);
+    const int n = arrays[i]->GetNumberOfComponents();
+    double* data = arrays[i]->GetPointer(0);
+    if (numberOfPoints > 0)
+      {
+      memset(data, 0, numberOfPoints * n * sizeof(double));
+      }
+    job.Fields.push_back(std::make_pair(data, n));
+    }
+
+  job.Points = points->GetPointer(0);
+  job.TubeRadius = readTubeRadius ? tubeRadius->GetPointer(0) : 0;
+  job.Tan1 = readTangents ? tan1->GetPointer(0) : 0;
+  job.Tan2 = readTangents ? tan2->GetPointer(0) : 0;
+  job.MinimumNumberOfPoints = this->MinimumNumberOfPoints;
+  job.MinimumTubeLength = this->MinimumTubeLength;
+  job.DecimationTolerance = this->DecimationTolerance;
+  job.UseROI = this->UseROI;
+  for (int i = 0; i < 6; ++i)
+    {
+    job.ROI[i] = this->ROI[i];
+    }
+  // Targets of the columns, indexed as Tube::Columns; the columns of the
+  // arrays that are not read have no target.
+  ColumnTarget target;
+  target.Stride = 3;
+  for (int k = 0; k < 3; ++k)
+    {
+    target.Data = job.Points + k;
+    job.Targets.push_back(target);
+    }
+  target.Stride = 1;
+  target.Data = job.TubeRadius;
+  job.Targets.push_back(target);
+  target.Data = ridgeness->GetPointer(0);
+  job.Targets.push_back(target);
+  target.Data = medialness->GetPointer(0);
+  job.Targets.push_back(target);
+  target.Stride = 3;
+  for (int k = 0; k < 3; ++k)
+    {
+    target.Data = job.Tan1 ? job.Tan1 + k : 0;
+    job.Targets.push_back(target);
+    }
+  for (int k = 0; k < 3; ++k)
+    {
+    target.Data = job.Tan2 ? job.Tan2 + k : 0;
+    job.Targets.push_back(target);
+    }
+  for (size_t i = 0; i < extraColumns.size(); ++i)
+    {
+    const ExtraArray& extraArray = extraArrays[extraColumns[i].first];
+    target.Data = extraArray.Array->GetPointer(0) + extraColumns[i].second;
+    target.Stride = extraArray.NumberOfComponents;
+    job.Targets.push_back(target);
+    }
+
+  // Parse the point blocks, the threads get about the same number of
+  // points.
+  const vtkIdType numberOfTubes = static_cast<vtkIdType>(job.Tubes.size());
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(this->NumberOfThreads);
+  int numberOfRanges = threader->GetNumberOfThreads();
+  if (numberOfTubes < numberOfRanges)
+    {
+    numberOfRanges = numberOfTubes > 0 ? static_cast<int>(numberOfTubes) : 1;
+    }
+  const vtkIdType pointsPerRange = numberOfPoints / numberOfRanges + 1;
+  job.RangeStarts.push_back(0);
+  vtkIdType rangePoints = 0;
+  for (vtkIdType tubeId = 0; tubeId < numberOfTubes; ++tubeId)
+    {
+    rangePoints += job.Tubes[tubeId].NumberOfPoints;
+    if (rangePoints >= pointsPerRange &&
+        static_cast<int>(job.RangeStarts.size()) < numberOfRanges)
+      {
+      job.RangeStarts.push_back(tubeId + 1);
+      rangePoints = 0;
+      }
+    }
+  while (static_cast<int>(job.RangeStarts.size()) <= numberOfRanges)
+    {
+    job.RangeStarts.push_back(numberOfTubes);
+    }
+  job.Errors.resize(numberOfRanges, 0);
+  {
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreReader::ParseTubes");
+  if (numberOfRanges > 1)
+    {
+    threader->SetNumberOfThreads(numberOfRanges);
+    threader->SetSingleMethod(ParseTubesThread, &job);
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    job.ParseTubes(0);
+    }
+  }
+  for (int i = 0; i < numberOfRanges; ++i)
+    {
+    if (job.Errors[i])
+      {
+      vtkErrorMacro(<< "Read: invalid points in " << this->FileName);
+      return 0;
+      }
+    }
+  if (buildIndex &&
+      !WriteTubeIndex(this->IndexFileName, file, fileTime, job.Tubes))
+    {
+    vtkDebugMacro(<< "Read: can't write " << this->IndexFileName);
+    }
+
+  // Pack the tubes with at least 2 points and create their lines.
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  tubeIDs->SetNumberOfTuples(numberOfPoints);
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfTuples(numberOfTubes + numberOfPoints);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  vtkIdType numberOfLines = 0;
+  vtkIdType pointId = 0;
+  for (vtkIdType tubeId = 0; tubeId < numberOfTubes; ++tubeId)
+    {
+    const Tube& tube = job.Tubes[tubeId];
+    const vtkIdType kept = tube.NumberOfKeptPoints;
+    if (kept < 2)
+      {
+      continue;
+      }
+    if (tube.Offset != pointId)
+      {
+      for (size_t f = 0; f < job.Fields.size(); ++f)
+        {
+        const int n = job.Fields[f].second;
+        double* data = job.Fields[f].first;
+        memmove(data + n * pointId, data + n * tube.Offset,
+                n * kept * sizeof(double));
+        }
+      }
+    *cell++ = kept;
+    for (vtkIdType i = 0; i < kept; ++i, ++pointId)
+      {
+      tubeIDs->SetValue(pointId, tube.Id);
+      *cell++ = pointId;
+      }
+    tubeParentIDs->InsertNextValue(tube.ParentId);
+    ++numberOfLines;
+    }
+  arrays.push_back(tubeIDs.GetPointer());
+  for (size_t i = 0; i < arrays.size(); ++i)
+    {
+    arrays[i]->SetNumberOfTuples(pointId);
+    if (pointId < numberOfPoints)
+      {
+      arrays[i]->Squeeze();
+      }
+    }
+  connectivity->SetNumberOfTuples(cell - connectivity->GetPointer(0));
+  connectivity->Squeeze();
+
+  // Same arrays as ConvertSpatialObjectToPolyData()
+  vtkNew<vtkPoints> outputPoints;
+  outputPoints->SetData(points.GetPointer());
+  vtkNew<vtkCellArray> lines;
+  lines->SetCells(numberOfLines, connectivity.GetPointer());
+  this->Output->SetPoints(outputPoints.GetPointer());
+  this->Output->SetLines(lines.GetPointer());
+  vtkPointData* pointData = this->Output->GetPointData();
+  if (readTubeRadius)
+    {
+    pointData->AddArray(tubeRadius.GetPointer());
+    pointData->SetActiveScalars("TubeRadius");
+    }
+  pointData->AddArray(tubeIDs.GetPointer());
+  this->Output->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+  if (readTangents)
+    {
+    pointData->AddArray(tan1.GetPointer());
+    pointData->AddArray(tan2.GetPointer());
+    }
+  double range[2];
+  if (hasMedialness)
+    {
+    medialness->GetRange(range);
+    if (range[0] != 0. || range[1] != 0.)
+      {
+      pointData->AddArray(medialness.GetPointer());
+      }
+    }
+  if (hasRidgeness)
+    {
+    ridgeness->GetRange(range);
+    if (range[0] != 0. || range[1] != 0.)
+      {
+      pointData->AddArray(ridgeness.GetPointer());
+      }
+    }
+  for (size_t i = 0; i < extraArrays.size(); ++i)
+    {
+    pointData->AddArray(extraArrays[i].Array);
+    }
+
+  vtkDebugMacro(<< "Read: " << numberOfLines << " tubes, " << pointId
+                << " points");
+  return 1;
+}
@@ -0,0 +1,169 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkSpatialObjectsTreReader -
+/// Read the tubes of an ASCII .tre file into a polydata.
+///
+/// The reader produces the polydata of
+/// vtkMRMLSpatialObjectsStorageNode::ConvertSpatialObjectToPolyData() on
+/// the group read by itk::SpatialObjectReader, without creating the ITK
+/// objects: one line per tube with at least 2 points once the consecutive
+/// duplicate points are removed, the element spacing applied to the points
+/// and the TubeRadius, TubeIDs, Tan1, Tan2, Medialness and Ridgeness point
+/// data and the TubeParentIDs cell data. The additional columns written by
+/// vtkSpatialObjectsTreWriter are read back into their point data arrays.
+/// The lines are in the ITK order, depth first in the tube hierarchy.
+///
+/// The polydata is not identical to the ITK one: the values are read in
+/// double precision, the normals saved in the file are kept and computed
+/// only for the tubes without normals, and the hierarchy is only made of
+/// tubes, a tube whose parent is another object, e.g. a group, is a root.
+/// The files with several such objects may then list the tubes in another
+/// order than ITK: match the tubes by TubeIDs rather than by line.
+///
+/// The file is memory mapped. A first pass locates the point blocks of the
+/// tubes from their headers, then the blocks are parsed by NumberOfThreads
+/// threads, directly into the output arrays. The values are parsed
+/// independently of the locale. The point blocks must have one point per
+/// line, as written by ITK and vtkSpatialObjectsTreWriter; binary files
+/// are not supported.
+///
+/// The options reduce the data read, e.g. for viewing: the point data
+/// arrays that are not read are not allocated, and the tubes that are not
+/// selected or the decimated points are dropped while the points are
+/// parsed.
+///
+/// The tube index, a sidecar file, records the offsets of the point block,
+/// the ID, the number of points and the bounds of each tube. It is written
+/// by the first read of the file and, while the file is unchanged, saves the
+/// next reads from parsing the headers and the tubes out of TubeIDs or of
+/// the ROI.
+
+#ifndef __vtkSpatialObjectsTreReader_h
+#define __vtkSpatialObjectsTreReader_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// Spatial Objects includes
+#include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
+
+class vtkIdList;
+class vtkPolyData;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT vtkSpatialObjectsTreReader
+  : public vtkObject
+{
+public:
+  static vtkSpatialObjectsTreReader *New();
+  vtkTypeMacro(vtkSpatialObjectsTreReader, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  ///
+  /// Tube index of FileName, not used if 0 (default). It is read if it is
+  /// up to date with FileName, written otherwise.
+  vtkSetStringMacro(IndexFileName);
+  vtkGetStringMacro(IndexFileName);
+
+  ///
+  /// Number of threads parsing the point blocks, the number of processors
+  /// by default.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Point data arrays to read, a combination of the flags below. All of
+  /// them by default.
+  enum
+  {
+    TubeRadiusArray = 0x01,
+    TangentArrays = 0x02,
+    MedialnessArray = 0x04,
+    RidgenessArray = 0x08,
+    AdditionalArrays = 0x10,
+    AllArrays = 0x1F
+  };
+  vtkSetMacro(PointDataArrays, int);
+  vtkGetMacro(PointDataArrays, int);
+
+  ///
+  /// Tubes with less points, once the duplicates are removed, or shorter
+  /// are not read. 2 and 0 by default.
+  vtkSetClampMacro(MinimumNumberOfPoints, int, 2, VTK_INT_MAX);
+  vtkGetMacro(MinimumNumberOfPoints, int);
+  vtkSetClampMacro(MinimumTubeLength, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(MinimumTubeLength, double);
+
+  ///
+  /// Points whose position and radius are within DecimationTolerance of
+  /// the segment between the points kept around them are not read.
+  /// 0 by default: all the points are read.
+  vtkSetClampMacro(DecimationTolerance, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(DecimationTolerance, double);
+
+  ///
+  /// If UseROI is true, only the tubes with a point inside the ROI bounds
+  /// (xmin, xmax, ymin, ymax, zmin, zmax) are read. False by default.
+  vtkSetVector6Macro(ROI, double);
+  vtkGetVector6Macro(ROI, double);
+  vtkSetMacro(UseROI, bool);
+  vtkGetMacro(UseROI, bool);
+  vtkBooleanMacro(UseROI, bool);
+
+  ///
+  /// If set and not empty, only the tubes with these IDs are read.
+  virtual void SetTubeIDs(vtkIdList* tubeIDs);
+  vtkGetObjectMacro(TubeIDs, vtkIdList);
+
+  ///
+  /// Read FileName into the output. Return 0 if the file can't be read,
+  /// e.g. if it is a binary file; the output is then empty.
+  int Read();
+
+  ///
+  /// Polydata filled by Read().
+  vtkGetObjectMacro(Output, vtkPolyData);
+
+  ///
+  /// Parse the number starting at \a begin, before \a end, into \a value.
+  /// Return the end of the number or 0 if there is no number at \a begin.
+  static const char* ParseValue(const char* begin, const char* end,
+                                double& value);
+
+protected:
+  vtkSpatialObjectsTreReader();
+  ~vtkSpatialObjectsTreReader();
+  vtkSpatialObjectsTreReader(const vtkSpatialObjectsTreReader&);
+  void operator=(const vtkSpatialObjectsTreReader&);
+
+  char* FileName;
+  char* IndexFileName;
+  vtkIdList* TubeIDs;
+  int NumberOfThreads;
+  int PointDataArrays;
+  int MinimumNumberOfPoints;
+  double MinimumTubeLength;
+  double DecimationTolerance;
+  double ROI[6];
+  bool UseROI;
+  vtkPolyData* Output;
+};
+
+#endif
@@ -0,0 +1,445 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSpatialObjectsTreWriter.h"
+#include "vtkSpatialObjectsTrace.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkSpatialObjectsTreWriter);
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Names of the MetaIO vessel tube point fields, an additional column with
+// one of these names would be read by ITK as that field.
+const char* const ReservedColumnNames[] =
+  {"x", "y", "z", "r", "rn", "mn", "bn", "mk", "v1x", "v1y", "v1z",
+   "v2x", "v2y", "v2z", "tx", "ty", "tz", "a1", "a2", "a3", "red", "green",
+   "blue", "alpha", "id", 0};
+
+// Arrays written in the MetaIO fields or not worth saving.
+const char* const KnownArrayNames[] =
+  {"TubeIDs", "TubeRadius", "Ridgeness", "Medialness", "Tan1", "Tan2",
+   "TubeVisibilityMask", 0};
+
+//------------------------------------------------------------------------------
+bool IsInList(const char* name, const char* const* list)
+{
+  for (; *list; ++list)
+    {
+    if (strcmp(name, *list) == 0)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Number of significant digits needed to read back exactly the values of
+// a data array of type \a dataType.
+int GetPrecision(int dataType)
+{
+  return dataType == VTK_FLOAT ? 9 : 17;
+}
+
+//------------------------------------------------------------------------------
+struct Column
+{
+  vtkDataArray* Array;
+  int Component;
+  int Precision;
+};
+
+//------------------------------------------------------------------------------
+// Tubes formatted by the threads: thread i formats the tubes
+// [RangeStarts[i], RangeStarts[i + 1][ into Buffers[i].
+struct FormatJob
+{
+  vtkPoints* Points;
+  int PointPrecision;
+  std::vector<Column> Columns;
+  std::string PointDim;
+
+  // IDs of the tubes, read before the threads start: GetTuple1() uses the
+  // shared tuple buffer of the array.
+  std::vector<double> TubeIDs;
+  std::vector<double> TubeParentIDs;
+
+  // Location of the tubes in the lines connectivity
+  vtkIdType* Connectivity;
+  std::vector<vtkIdType> Locations;
+
+  std::vector<vtkIdType> RangeStarts;
+  std::vector<std::string> Buffers;
+
+  void FormatTubes(int range);
+};
+
+//------------------------------------------------------------------------------
+void AppendValue(std::string& buffer, double value, int precision)
+{
+  char text[32];
+  buffer.append(text,
+    vtkSpatialObjectsTreWriter::FormatValue(value, precision, text));
+}
+
+//------------------------------------------------------------------------------
+void FormatJob::FormatTubes(int range)
+{
+  std::string& buffer = this->Buffers[range];
+  const vtkIdType firstTube = this->RangeStarts[range];
+  const vtkIdType lastTube = this->RangeStarts[range + 1];
+
+  // Most values need less than 16 characters.
+  vtkIdType numberOfPoints = 0;
+  for (vtkIdType tubeId = firstTube; tubeId < lastTube; ++tubeId)
+    {
+    numberOfPoints += this->Connectivity[this->Locations[tubeId]];
+    }
+  buffer.reserve(static_cast<size_t>(numberOfPoints) *
+                 (this->Columns.size() + 4) * 16 +
+                 static_cast<size_t>(lastTube - firstTube) * 256);
+
+  double point[3];
+  for (vtkIdType tubeId = firstTube; tubeId < lastTube; ++tubeId)
+    {
+    const vtkIdType* line = this->Connectivity + this->Locations[tubeId];
+    const vtkIdType npts = line[0];
+    const vtkIdType* pts = line + 1;
+
+    buffer += "ObjectType = Tube\nObjectSubTypeName = Vessel\nNDims = 3\n";
+    buffer += "ID = ";
+    AppendValue(buffer, this->TubeIDs[tubeId], 17);
+    buffer += "\nParentID = ";
+    AppendValue(buffer, this->TubeParentIDs[tubeId], 17);
+    buffer += "\nElementSpacing = 1 1 1\nPointDim = ";
+    buffer += this->PointDim;
+    buffer += "\nNPoints = ";
+    AppendValue(buffer, npts, 17);
+    buffer += "\nPoints = \n";
+
+    for (vtkIdType i = 0; i < npts; ++i)
+      {
+      this->Points->GetPoint(pts[i], point);
+      for (int k = 0; k < 3; ++k)
+        {
+        AppendValue(buffer, point[k], this->PointPrecision);
+        buffer += ' ';
+        }
+      for (std::vector<Column>::const_iterator it = this->Columns.begin();
+           it != this->Columns.end(); ++it)
+        {
+        AppendValue(buffer, it->Array->GetComponent(pts[i], it->Component),
+                    it->Precision);
+        buffer += ' ';
+        }
+      AppendValue(buffer, pts[i], 17);
+      buffer += '\n';
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE FormatTubesThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<FormatJob*>(info->UserData)->FormatTubes(info->ThreadID);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTreWriter::vtkSpatialObjectsTreWriter()
+{
+  this->FileName = 0;
+  this->Input = 0;
+  this->NumberOfThreads =
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+}
+
+//------------------------------------------------------------------------------
+vtkSpatialObjectsTreWriter::~vtkSpatialObjectsTreWriter()
+{
+  this->SetFileName(0);
+  this->SetInput(0);
+}
+
+//------------------------------------------------------------------------------
+void vtkSpatialObjectsTreWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "Input: " << this->Input << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//------------------------------------------------------------------------------
+vtkCxxSetObjectMacro(vtkSpatialObjectsTreWriter, Input, vtkPolyData);
+
+//------------------------------------------------------------------------------
+int vtkSpatialObjectsTreWriter::FormatValue(double value, int precision,
+                                            char* buffer)
+{
+  // The integers, e.g. the IDs, are exact without decimals and are much
+  // faster to format by hand.
+  if (value == floor(value) && fabs(value) < 1e15)
+    {
+    vtkTypeInt64 integer = static_cast<vtkTypeInt64>(value);
+    int length = 0;
+    if (integer < 0)
+      {
+      buffer[length++] = '-';
+      integer = -integer;
+      }
+    char digits[20];
+    int numberOfDigits = 0;
+    do
+      {
+      digits[numberOfDigits++] = static_cast<char>('0' + integer % 10);
+      integer /= 10;
+      }
+    while (integer);
+    while (numberOfDigits)
+      {
+      buffer[length++] = digits[--numberOfDigits];
+      }
+    buffer[length] = '\0';
+    return length;
+    }
+  // sprintf follows the LC_NUMERIC locale, that Qt sets to the one of the
+  // user on Unix: a ',' decimal separator would not be read back.
+  int length = sprintf(buffer, "%.*g", precision, value);
+  const char* decimalPoint = localeconv()->decimal_point;
+  if (decimalPoint && *decimalPoint && strcmp(decimalPoint, ".") != 0)
+    {
+    char* found = strstr(buffer, decimalPoint);
+    if (found)
+      {
+      const int size = static_cast<int>(strlen(decimalPoint));
+      *found = '.';
+      memmove(found + 1, found + size, buffer + length + 1 - (found + size));
+      length -= size - 1;
+      }
+    }
+  return length;
+}
+
+//------------------------------------------------------------------------------
+int vtkSpatialObjectsTreWriter::Write()
+{
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreWriter::Write");
+
+  if (!this->FileName || !*this->FileName)
+    {
+    vtkErrorMacro(<< "Write: no file name");
+    return 0;
+    }
+  vtkPolyData* polyData = this->Input;
+  if (!polyData || !polyData->GetPoints())
+    {
+    vtkErrorMacro(<< "Write: no input points");
+    return 0;
+    }
+
+  FormatJob job;
+  job.Points = polyData->GetPoints();
+  job.PointPrecision = GetPrecision(job.Points->GetDataType());
+  job.PointDim = "x y z";
+
+  // The MetaIO fields, then the other arrays.
+  vtkPointData* pointData = polyData->GetPointData();
+  const char* const fields[][2] =
+    {{"TubeRadius", "r"}, {"Ridgeness", "rn"}, {"Medialness", "mn"}};
+  for (int i = 0; i < 3; ++i)
+    {
+    vtkDataArray* array = pointData->GetArray(fields[i][0]);
+    if (array)
+      {
+      Column column = {array, 0, GetPrecision(array->GetDataType())};
+      job.Columns.push_back(column);
+      job.PointDim += std::string(" ") + fields[i][1];
+      }
+    }
+  vtkDataArray* tan1 = pointData->GetArray("Tan1");
+  vtkDataArray* tan2 = pointData->GetArray("Tan2");
+  if (tan1 && tan2 &&
+      tan1->GetNumberOfComponents() == 3 && tan2->GetNumberOfComponents() == 3)
+    {
+    for (int k = 0; k < 3; ++k)
+      {
+      Column column = {tan1, k, GetPrecision(tan1->GetDataType())};
+      job.Columns.push_back(column);
+      }
+    for (int k = 0; k < 3; ++k)
+      {
+      Column column = {tan2, k, GetPrecision(tan2->GetDataType())};
+      job.Columns.push_back(column);
+      }
+    job.PointDim += " v1x v1y v1z v2x v2y v2z";
+    }
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+    {
+    vtkDataArray* array = pointData->GetArray(i);
+    const char* name = array ? array->GetName() : 0;
+    if (!name || IsInList(name, KnownArrayNames))
+      {
+      continue;
+      }
+    if (!*name || strpbrk(name, " \t\r\n:") ||
+        IsInList(name, ReservedColumnNames))
+      {
+      vtkWarningMacro(<< "Write: the point data array \"" << name
+                      << "\" can't be written as a column");
+      continue;
+      }
+    const int numberOfComponents = array->GetNumberOfComponents();
+    for (int k = 0; k < numberOfComponents; ++k)
+      {
+      Column column = {array, k, GetPrecision(array->GetDataType())};
+      job.Columns.push_back(column);
+      job.PointDim += std::string(" ") + name;
+      if (numberOfComponents > 1)
+        {
+        char component[16];
+        sprintf(component, ":%d", k);
+        job.PointDim += component;
+        }
+      }
+    }
+  job.PointDim += " id";
+
+  // Index the tubes and split them into ranges of about the same number
+  // of points.
+  vtkCellArray* lines = polyData->GetLines();
+  job.Connectivity = lines ? lines->GetPointer() : 0;
+  const vtkIdType connectivitySize =
+    lines ? lines->GetNumberOfConnectivityEntries() : 0;
+  for (vtkIdType location = 0; location < connectivitySize;
+       location += job.Connectivity[location] + 1)
+    {
+    job.Locations.push_back(location);
+    }
+  const vtkIdType numberOfTubes =
+    static_cast<vtkIdType>(job.Locations.size());
+  vtkDataArray* tubeIDs = pointData->GetArray("TubeIDs");
+  vtkDataArray* tubeParentIDs =
+    polyData->GetCellData()->GetArray("TubeParentIDs");
+  if (tubeParentIDs && tubeParentIDs->GetNumberOfTuples() < numberOfTubes)
+    {
+    tubeParentIDs = 0;
+    }
+  job.TubeIDs.resize(numberOfTubes);
+  job.TubeParentIDs.resize(numberOfTubes, -1.);
+  for (vtkIdType tubeId = 0; tubeId < numberOfTubes; ++tubeId)
+    {
+    const vtkIdType* line = job.Connectivity + job.Locations[tubeId];
+    job.TubeIDs[tubeId] = tubeIDs && line[0] > 0 ?
+      tubeIDs->GetComponent(line[1], 0) : tubeId;
+    if (tubeParentIDs)
+      {
+      job.TubeParentIDs[tubeId] = tubeParentIDs->GetComponent(tubeId, 0);
+      }
+    }
+
+  // The threader may use less threads than requested.
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(this->NumberOfThreads);
+  int numberOfRanges = threader->GetNumberOfThreads();
+  if (numberOfTubes < numberOfRanges)
+    {
+    numberOfRanges = numberOfTubes > 0 ? static_cast<int>(numberOfTubes) : 1;
+    }
+  const vtkIdType pointsPerRange =
+    (connectivitySize - numberOfTubes) / numberOfRanges + 1;
+  job.RangeStarts.push_back(0);
+  vtkIdType rangePoints = 0;
+  for (vtkIdType tubeId = 0; tubeId < numberOfTubes; ++tubeId)
+    {
+    rangePoints += job.Connectivity[job.Locations[tubeId]];
+    if (rangePoints >= pointsPerRange &&
+        static_cast<int>(job.RangeStarts.size()) < numberOfRanges)
+      {
+      job.RangeStarts.push_back(tubeId + 1);
+      rangePoints = 0;
+      }
+    }
+  while (static_cast<int>(job.RangeStarts.size()) <= numberOfRanges)
+    {
+    job.RangeStarts.push_back(numberOfTubes);
+    }
+  job.Buffers.resize(numberOfRanges);
+
+  if (numberOfRanges > 1)
+    {
+    vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreWriter::FormatTubes");
+    threader->SetNumberOfThreads(numberOfRanges);
+    threader->SetSingleMethod(FormatTubesThread, &job);
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreWriter::FormatTubes");
+    job.FormatTubes(0);
+    }
+
+  vtkSpatialObjectsTraceScope("vtkSpatialObjectsTreWriter::WriteFile");
+  std::ofstream file(this->FileName, std::ios::out | std::ios::binary);
+  if (!file)
+    {
+    vtkErrorMacro(<< "Write: can't open " << this->FileName);
+    return 0;
+    }
+  file << "ObjectType = Scene\nNDims = 3\nNObjects = " << numberOfTubes
+       << "\n";
+  for (int i = 0; i < numberOfRanges && file; ++i)
+    {
+    file.write(job.Buffers[i].data(), job.Buffers[i].size());
+    // Release the memory as soon as possible
+    std::string().swap(job.Buffers[i]);
+    }
+  file.close();
+  if (file.fail())
+    {
+    vtkErrorMacro(<< "Write: error writing " << this->FileName);
+    return 0;
+    }
+  return 1;
+}
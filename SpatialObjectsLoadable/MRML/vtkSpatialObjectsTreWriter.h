@@ -0,0 +1,90 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+/// vtkSpatialObjectsTreWriter -
+/// Write the tubes of a spatial objects polydata into a .tre file.
+///
+/// Each line of the polydata is written as a MetaIO vessel tube, readable
+/// by itk::SpatialObjectReader: the points and the TubeRadius, Ridgeness,
+/// Medialness, Tan1 and Tan2 point data are written in the x y z r rn mn
+/// v1* v2* columns, the TubeIDs and TubeParentIDs in the ID and ParentID
+/// fields. The other numerical point data arrays are written as additional
+/// columns named after them ("Name" or "Name:component"), which ITK
+/// ignores.
+///
+/// The values are written with enough digits to be read back exactly
+/// (9 for float arrays, 17 for double arrays) and the integer values without
+/// decimals. The tubes are formatted in memory by NumberOfThreads threads,
+/// each thread formatting a contiguous range of tubes, then the ranges are
+/// written in order.
+
+#ifndef __vtkSpatialObjectsTreWriter_h
+#define __vtkSpatialObjectsTreWriter_h
+
+// VTK includes
+#include <vtkObject.h>
+
+// Spatial Objects includes
+#include "vtkSlicerSpatialObjectsModuleMRMLExport.h"
+
+class vtkPolyData;
+
+class VTK_SLICER_SPATIALOBJECTS_MODULE_MRML_EXPORT vtkSpatialObjectsTreWriter
+  : public vtkObject
+{
+public:
+  static vtkSpatialObjectsTreWriter *New();
+  vtkTypeMacro(vtkSpatialObjectsTreWriter, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  ///
+  /// Polydata whose lines are written, one tube per line.
+  virtual void SetInput(vtkPolyData* polyData);
+  vtkGetObjectMacro(Input, vtkPolyData);
+
+  ///
+  /// Number of threads formatting the tubes, the number of processors by
+  /// default. 1 formats the tubes in the calling thread.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Write the input into FileName. Return 0 on error.
+  int Write();
+
+  ///
+  /// Format \a value into \a buffer (at least 32 characters) with
+  /// \a precision significant digits, or without decimals if it is an
+  /// integer. The decimal separator is always '.', whatever the locale.
+  /// Return the number of characters written.
+  static int FormatValue(double value, int precision, char* buffer);
+
+protected:
+  vtkSpatialObjectsTreWriter();
+  ~vtkSpatialObjectsTreWriter();
+  vtkSpatialObjectsTreWriter(const vtkSpatialObjectsTreWriter&);
+  void operator=(const vtkSpatialObjectsTreWriter&);
+
+  char* FileName;
+  vtkPolyData* Input;
+  int NumberOfThreads;
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkSpatialObjectsTrcReader.h>
+#include <vtkSpatialObjectsTreWriter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// ITK includes
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tubes of IDs 10 to 10 + numberOfTubes - 1 with 3 + i points, tube i is
+// the parent of tube i + 1.
+bool WriteTubes(const std::string& filename, int numberOfTubes)
+{
+  vtkNew<vtkPolyData> polyData;
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3 + i);
+    for (int j = 0; j < 3 + i; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0.));
+      tubeIDs->InsertNextValue(10 + i);
+      tubeRadius->InsertNextValue(0.5);
+      }
+    tubeParentIDs->InsertNextValue(i == 0 ? -1 : 10 + i - 1);
+    }
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+
+  vtkNew<vtkSpatialObjectsTreWriter> writer;
+  writer->SetInput(polyData.GetPointer());
+  writer->SetFileName(filename.c_str());
+  return writer->Write() != 0;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int SpatialObjectsConverterTest1(int argc, char* argv[])
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: " << argv[0]
+              << " <SpatialObjectsConverter> <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Two inputs, converted in parallel
+  const std::string directory =
+    std::string(argv[2]) + "/SpatialObjectsConverterTest1";
+  const std::string inputDirectory = directory + "/inputs";
+  const std::string outputDirectory = directory + "/outputs";
+  itksys::SystemTools::RemoveADirectory(directory.c_str());
+  itksys::SystemTools::MakeDirectory(inputDirectory.c_str());
+  const int numberOfTubes[2] = {3, 5};
+  const char* names[2] = {"network0", "network1"};
+  for (int i = 0; i < 2; ++i)
+    {
+    if (!WriteTubes(inputDirectory + "/" + names[i] + ".tre",
+                    numberOfTubes[i]))
+      {
+      std::cerr << "Line " << __LINE__ << ": can't write the tubes"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  const std::string morphometrics = outputDirectory + "/morphometrics.csv";
+  const std::string command = std::string("\"") + argv[1] + "\"" +
+    " --format trc --threads 2" +
+    " --output-directory \"" + outputDirectory + "\"" +
+    " --morphometrics \"" + morphometrics + "\"" +
+    " \"" + inputDirectory + "\"";
+  if (std::system(command.c_str()) != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << command << " failed"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each input is converted, and left alone: no tube index is written
+  // next to it.
+  for (int i = 0; i < 2; ++i)
+    {
+    const std::string input = inputDirectory + "/" + names[i] + ".tre";
+    const std::string output = outputDirectory + "/" + names[i] + ".trc";
+    vtkNew<vtkSpatialObjectsTrcReader> reader;
+    reader->SetFileName(output.c_str());
+    if (!reader->Read() ||
+        reader->GetOutput()->GetNumberOfLines() != numberOfTubes[i] ||
+        reader->GetOutput()->GetNumberOfPoints() !=
+          numberOfTubes[i] * (numberOfTubes[i] + 5) / 2)
+      {
+      std::cerr << "Line " << __LINE__ << ": wrong conversion " << output
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (itksys::SystemTools::FileExists((input + ".idx").c_str()))
+      {
+      std::cerr << "Line " << __LINE__ << ": tube index written next to "
+                << input << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The .trc outputs are converted again, .trc to .trc, with the files
+  // read and written in parallel. The points are on the quantization grid
+  // already, they are read back exactly.
+  const std::string trcOutputDirectory = directory + "/trcOutputs";
+  const std::string trcCommand = std::string("\"") + argv[1] + "\"" +
+    " --format trc --threads 2" +
+    " --output-directory \"" + trcOutputDirectory + "\"" +
+    " \"" + outputDirectory + "/" + names[0] + ".trc\"" +
+    " \"" + outputDirectory + "/" + names[1] + ".trc\"";
+  if (std::system(trcCommand.c_str()) != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << trcCommand << " failed"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < 2; ++i)
+    {
+    const std::string input = outputDirectory + "/" + names[i] + ".trc";
+    const std::string output = trcOutputDirectory + "/" + names[i] + ".trc";
+    vtkNew<vtkSpatialObjectsTrcReader> inputReader;
+    inputReader->SetFileName(input.c_str());
+    vtkNew<vtkSpatialObjectsTrcReader> reader;
+    reader->SetFileName(output.c_str());
+    if (!inputReader->Read() || !reader->Read() ||
+        reader->GetOutput()->GetNumberOfLines() != numberOfTubes[i] ||
+        reader->GetOutput()->GetNumberOfPoints() !=
+          inputReader->GetOutput()->GetNumberOfPoints())
+      {
+      std::cerr << "Line " << __LINE__ << ": wrong conversion " << output
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    for (vtkIdType p = 0; p < reader->GetOutput()->GetNumberOfPoints(); ++p)
+      {
+      double* point = reader->GetOutput()->GetPoint(p);
+      double* inputPoint = inputReader->GetOutput()->GetPoint(p);
+      if (point[0] != inputPoint[0] || point[1] != inputPoint[1] ||
+          point[2] != inputPoint[2])
+        {
+        std::cerr << "Line " << __LINE__ << ": wrong point " << p
+                  << " in " << output << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // A header and one row per tube
+  std::ifstream csv(morphometrics.c_str());
+  std::string line;
+  int numberOfRows = 0;
+  while (std::getline(csv, line))
+    {
+    ++numberOfRows;
+    }
+  if (numberOfRows != 1 + numberOfTubes[0] + numberOfTubes[1])
+    {
+    std::cerr << "Line " << __LINE__ << ": " << numberOfRows
+              << " rows in " << morphometrics << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSpatialObjectsDisplayNode.h>
+#include <vtkMRMLSpatialObjectsDisplayPropertiesNode.h>
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsDisplayPropertiesNodeSharingTest1(
+  int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSpatialObjectsNode> node1;
+  vtkNew<vtkMRMLSpatialObjectsNode> node2;
+  scene->AddNode(node1.GetPointer());
+  scene->AddNode(node2.GetPointer());
+
+  // The display nodes with the default settings share one properties node.
+  vtkMRMLSpatialObjectsDisplayNode* displayNodes[4] =
+    {
+    node1->AddLineDisplayNode(), node1->AddTubeDisplayNode(),
+    node2->AddLineDisplayNode(), node2->AddTubeDisplayNode()
+    };
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* shared =
+    displayNodes[0]->GetSpatialObjectsDisplayPropertiesNode();
+  for (int i = 0; i < 4; ++i)
+    {
+    if (!shared ||
+        displayNodes[i]->GetSpatialObjectsDisplayPropertiesNode() != shared)
+      {
+      std::cerr << "Line " << __LINE__ << ": display node " << i
+                << " doesn't share the properties node" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  const char* className = "vtkMRMLSpatialObjectsDisplayPropertiesNode";
+  if (scene->GetNumberOfNodesByClass(className) != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": "
+              << scene->GetNumberOfNodesByClass(className)
+              << " properties nodes instead of 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The display node modified gets a copy, the others keep the settings.
+  const double scaleFactor = shared->GetGlyphScaleFactor();
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* copy =
+    displayNodes[3]->GetEditableSpatialObjectsDisplayPropertiesNode();
+  if (!copy || copy == shared || !copy->HasSameProperties(shared) ||
+      displayNodes[3]->GetSpatialObjectsDisplayPropertiesNode() != copy ||
+      scene->GetNumberOfNodesByClass(className) != 2)
+    {
+    std::cerr << "Line " << __LINE__ << ": properties node not copied"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  copy->SetGlyphScaleFactor(2. * scaleFactor);
+  if (shared->GetGlyphScaleFactor() != scaleFactor ||
+      displayNodes[3]->GetEditableSpatialObjectsDisplayPropertiesNode()
+        != copy)
+    {
+    std::cerr << "Line " << __LINE__ << ": copy-on-write failed"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A new display node with the modified settings shares the copy.
+  vtkNew<vtkMRMLSpatialObjectsDisplayPropertiesNode> properties;
+  properties->SetGlyphScaleFactor(2. * scaleFactor);
+  if (vtkMRMLSpatialObjectsDisplayPropertiesNode::GetSharedNode(
+        scene.GetPointer(), properties.GetPointer()) != copy ||
+      properties->GetScene() != NULL)
+    {
+    std::cerr << "Line " << __LINE__ << ": modified properties not shared"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Editing a network with the setters of its display node leaves the
+  // other network unchanged. An unchanged value doesn't copy anything.
+  displayNodes[0]->SetGlyphScaleFactor(scaleFactor);
+  displayNodes[0]->SetTubeGlyphRadius(shared->GetTubeGlyphRadius());
+  if (displayNodes[0]->GetSpatialObjectsDisplayPropertiesNode() != shared ||
+      scene->GetNumberOfNodesByClass(className) != 2)
+    {
+    std::cerr << "Line " << __LINE__ << ": unchanged properties copied"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const double radius = shared->GetTubeGlyphRadius();
+  const int geometry = shared->GetGlyphGeometry();
+  displayNodes[0]->SetTubeGlyphRadius(2. * radius);
+  displayNodes[0]->SetGlyphGeometry(
+    geometry == shared->GetFirstGlyphGeometry() ?
+    shared->GetLastGlyphGeometry() : shared->GetFirstGlyphGeometry());
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* edited =
+    displayNodes[0]->GetSpatialObjectsDisplayPropertiesNode();
+  if (!edited || edited == shared || edited == copy ||
+      edited->GetTubeGlyphRadius() != 2. * radius ||
+      edited->GetGlyphGeometry() == geometry ||
+      scene->GetNumberOfNodesByClass(className) != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": edited properties not copied"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 1; i < 3; ++i)
+    {
+    if (displayNodes[i]->GetSpatialObjectsDisplayPropertiesNode() != shared)
+      {
+      std::cerr << "Line " << __LINE__ << ": display node " << i
+                << " doesn't share the properties node anymore" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (shared->GetTubeGlyphRadius() != radius ||
+      shared->GetGlyphGeometry() != geometry ||
+      shared->GetGlyphScaleFactor() != scaleFactor ||
+      copy->GetTubeGlyphRadius() != radius)
+    {
+    std::cerr << "Line " << __LINE__ << ": other networks modified"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
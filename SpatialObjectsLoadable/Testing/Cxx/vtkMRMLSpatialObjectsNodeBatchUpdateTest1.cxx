@@ -0,0 +1,213 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSpatialObjectsLineDisplayNode.h>
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
+#include <vtkCommand.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Count the events received, per event id.
+void CountEvent(vtkObject* vtkNotUsed(caller), unsigned long eid,
+                void* clientData, void* vtkNotUsed(callData))
+{
+  std::map<unsigned long, int>* counts =
+    reinterpret_cast<std::map<unsigned long, int>*>(clientData);
+  ++(*counts)[eid];
+}
+
+//-----------------------------------------------------------------------------
+// Rebuild the displayed model on PolyDataModifiedEvent, as the model
+// displayable manager does, and record its number of lines.
+struct DisplayedModel
+{
+  vtkMRMLSpatialObjectsLineDisplayNode* DisplayNode;
+  std::vector<vtkIdType> NumberOfLines;
+};
+
+void RebuildModel(vtkObject* vtkNotUsed(caller),
+                  unsigned long vtkNotUsed(eid),
+                  void* clientData, void* vtkNotUsed(callData))
+{
+  DisplayedModel* model = reinterpret_cast<DisplayedModel*>(clientData);
+  vtkPolyData* output = model->DisplayNode->GetOutputPolyData();
+  output->Update();
+  model->NumberOfLines.push_back(output->GetNumberOfLines());
+}
+
+//-----------------------------------------------------------------------------
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3);
+    for (int j = 0; j < 3; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0));
+      }
+    }
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool CheckCount(std::map<unsigned long, int>& counts, unsigned long eid,
+                int expected, int line)
+{
+  if (counts[eid] != expected)
+    {
+    std::cerr << "Line " << line << ": event " << eid << " received "
+              << counts[eid] << " times instead of " << expected
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNodeBatchUpdateTest1(int vtkNotUsed(argc),
+                                              char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  vtkNew<vtkMRMLSpatialObjectsLineDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  scene->AddNode(node.GetPointer());
+  node->SetAndObserveDisplayNodeID(displayNode->GetID());
+
+  std::map<unsigned long, int> nodeCounts;
+  vtkNew<vtkCallbackCommand> nodeCallback;
+  nodeCallback->SetCallback(CountEvent);
+  nodeCallback->SetClientData(&nodeCounts);
+  node->AddObserver(vtkMRMLModelNode::PolyDataModifiedEvent,
+                    nodeCallback.GetPointer());
+  node->AddObserver(vtkCommand::ModifiedEvent, nodeCallback.GetPointer());
+
+  std::map<unsigned long, int> displayCounts;
+  vtkNew<vtkCallbackCommand> displayCallback;
+  displayCallback->SetCallback(CountEvent);
+  displayCallback->SetClientData(&displayCounts);
+  displayNode->AddObserver(vtkCommand::ModifiedEvent,
+                           displayCallback.GetPointer());
+
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 5);
+  node->SetAndObservePolyData(polyData.GetPointer());
+  if (node->IsBatchUpdating() ||
+      displayNode->GetInputPolyData() != node->GetFilteredPolyData())
+    {
+    std::cerr << "Line " << __LINE__ << ": input polydata not set"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Modifications in a batch are coalesced.
+  nodeCounts.clear();
+  displayCounts.clear();
+  node->StartBatchUpdate();
+  node->StartBatchUpdate();
+  node->SetSubsamplingRatio(0.5);
+  node->SetSubsamplingRatio(0.2);
+  displayNode->SetVisibility(0);
+  displayNode->SetColor(0.1, 0.2, 0.3);
+  node->EndBatchUpdate();
+  if (!node->IsBatchUpdating() || !displayNode->IsBatchUpdating() ||
+      !CheckCount(nodeCounts, vtkMRMLModelNode::PolyDataModifiedEvent,
+                  0, __LINE__) ||
+      !CheckCount(displayCounts, vtkCommand::ModifiedEvent, 0, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  node->EndBatchUpdate();
+  if (node->IsBatchUpdating() || displayNode->IsBatchUpdating() ||
+      !CheckCount(nodeCounts, vtkMRMLModelNode::PolyDataModifiedEvent,
+                  1, __LINE__) ||
+      !CheckCount(nodeCounts, vtkCommand::ModifiedEvent, 1, __LINE__) ||
+      !CheckCount(displayCounts, vtkCommand::ModifiedEvent, 1, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Several tube edits in a batch rebuild the displayed model once, with
+  // all the edits.
+  displayNode->SetVisibility(1);
+  DisplayedModel model;
+  model.DisplayNode = displayNode.GetPointer();
+  vtkNew<vtkCallbackCommand> rebuildCallback;
+  rebuildCallback->SetCallback(RebuildModel);
+  rebuildCallback->SetClientData(&model);
+  node->AddObserver(vtkMRMLModelNode::PolyDataModifiedEvent,
+                    rebuildCallback.GetPointer());
+
+  node->StartBatchUpdate();
+  node->SetTubeVisibility(0, false);
+  node->SetTubeVisibility(1, false);
+  node->SetTubeHighlight(2, true);
+  node->DeleteTube(4);
+  if (!model.NumberOfLines.empty())
+    {
+    std::cerr << "Line " << __LINE__ << ": model rebuilt during the batch"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  node->EndBatchUpdate();
+  if (model.NumberOfLines.size() != 1 || model.NumberOfLines[0] != 2 ||
+      displayNode->GetInputPolyData() != node->GetFilteredPolyData() ||
+      node->GetNumberOfTubes() != 4)
+    {
+    std::cerr << "Line " << __LINE__ << ": model rebuilt "
+              << model.NumberOfLines.size() << " times instead of once "
+              << "with 2 lines" << std::endl;
+    return EXIT_FAILURE;
+    }
+  node->RemoveObserver(rebuildCallback.GetPointer());
+
+  // An empty batch fires nothing.
+  nodeCounts.clear();
+  displayCounts.clear();
+  node->StartBatchUpdate();
+  node->EndBatchUpdate();
+  if (!CheckCount(nodeCounts, vtkMRMLModelNode::PolyDataModifiedEvent,
+                  0, __LINE__) ||
+      !CheckCount(nodeCounts, vtkCommand::ModifiedEvent, 0, __LINE__) ||
+      !CheckCount(displayCounts, vtkCommand::ModifiedEvent, 0, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
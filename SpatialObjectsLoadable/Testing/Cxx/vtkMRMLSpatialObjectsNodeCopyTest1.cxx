@@ -0,0 +1,133 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tube i has 3 points, TubeIDs = i and TubeRadius = 1.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3);
+    for (int j = 0; j < 3; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0));
+      tubeIDs->InsertNextValue(i);
+      tubeRadius->InsertNextValue(1);
+      }
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNodeCopyTest1(int vtkNotUsed(argc),
+                                       char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 3);
+
+  vtkNew<vtkMRMLSpatialObjectsNode> source;
+  source->SetAndObservePolyData(polyData.GetPointer());
+
+  // The copy shares the buffers, not the polydata container.
+  vtkNew<vtkMRMLSpatialObjectsNode> copy;
+  copy->Copy(source.GetPointer());
+  if (!copy->GetPolyData() ||
+      copy->GetPolyData() == source->GetPolyData() ||
+      copy->GetPolyData()->GetPoints() != source->GetPolyData()->GetPoints() ||
+      !copy->IsDataShared() || !source->IsDataShared() ||
+      copy->GetNumberOfTubes() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": the copy does not share the "
+              << "polydata buffers" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // An edit detaches the copy, the source is unchanged.
+  if (!copy->SetTubeRadius(1, 2.) ||
+      copy->IsDataShared() || source->IsDataShared() ||
+      copy->GetPolyData()->GetPoints() == source->GetPolyData()->GetPoints())
+    {
+    std::cerr << "Line " << __LINE__ << ": the edit did not detach the copy"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkDataArray* sourceRadius =
+    source->GetPolyData()->GetPointData()->GetArray("TubeRadius");
+  vtkDataArray* copyRadius =
+    copy->GetPolyData()->GetPointData()->GetArray("TubeRadius");
+  if (sourceRadius->GetTuple1(3) != 1. || copyRadius->GetTuple1(3) != 2.)
+    {
+    std::cerr << "Line " << __LINE__ << ": radius is "
+              << sourceRadius->GetTuple1(3) << " and "
+              << copyRadius->GetTuple1(3) << " instead of 1 and 2"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Copying a node without polydata does not keep the previous tubes.
+  vtkNew<vtkMRMLSpatialObjectsNode> emptyNode;
+  copy->Copy(emptyNode.GetPointer());
+  if (copy->GetPolyData() != NULL || copy->IsDataShared() ||
+      copy->GetNumberOfTubes() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": the copy kept its polydata"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The source is not affected.
+  if (source->GetPolyData() != polyData.GetPointer() ||
+      source->GetNumberOfTubes() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": the source was modified"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+#include <vtkSpatialObjectsTrcReader.h>
+#include <vtkSpatialObjectsTrcWriter.h>
+#include <vtkSpatialObjectsTreWriter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// ITK includes
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tubes of 4 points, the TubeIDs values are in the reverse order of the
+// tubes: 50 + numberOfTubes - 1 for the first tube, 50 for the last one.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(4);
+    for (int j = 0; j < 4; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0.5 * j));
+      tubeRadius->InsertNextValue(0.25 + 0.01 * i);
+      tubeIDs->InsertNextValue(50 + numberOfTubes - 1 - i);
+      }
+    }
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool SameArrays(vtkDataArray* array, vtkDataArray* other)
+{
+  if (!array || !other ||
+      array->GetNumberOfTuples() != other->GetNumberOfTuples() ||
+      array->GetNumberOfComponents() != other->GetNumberOfComponents())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < array->GetNumberOfTuples(); ++i)
+    {
+    for (int k = 0; k < array->GetNumberOfComponents(); ++k)
+      {
+      if (array->GetComponent(i, k) != other->GetComponent(i, k))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNodeScenePersistenceTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // 10 tubes of 4 points.
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 10);
+
+  const std::string fileName = std::string(argv[1]) +
+    "/vtkMRMLSpatialObjectsNodeScenePersistenceTest1.tre";
+  vtkNew<vtkSpatialObjectsTreWriter> writer;
+  writer->SetFileName(fileName.c_str());
+  writer->SetInput(polyData.GetPointer());
+  if (!writer->Write())
+    {
+    std::cerr << "Line " << __LINE__ << ": can't write " << fileName
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The first read writes the cache, the next ones read it.
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->SetFileName(fileName.c_str());
+  storageNode->SetUseCache(true);
+  const std::string cacheName = storageNode->GetCacheFileName();
+  itksys::SystemTools::RemoveFile(cacheName.c_str());
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  if (!storageNode->ReadData(node.GetPointer()) ||
+      node->GetNumberOfTubes() != 10 ||
+      !itksys::SystemTools::FileExists(cacheName.c_str(), true))
+    {
+    std::cerr << "Line " << __LINE__ << ": cache " << cacheName
+              << " not written" << std::endl;
+    return EXIT_FAILURE;
+    }
+  storageNode->SetMinimumNumberOfPoints(3);
+  if (storageNode->GetCacheFileName() == cacheName)
+    {
+    std::cerr << "Line " << __LINE__ << ": same cache for other options"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  storageNode->SetMinimumNumberOfPoints(2);
+
+  // The masks and the ratio are restored once the tubes are read, on the
+  // tubes with the saved TubeIDs values: hidden 52, 53 and 57 are the
+  // tubes 7, 6 and 2. The runs are clamped to the tubes and the missing
+  // values are ignored.
+  vtkNew<vtkMRMLScene> scene;
+  scene->AddNode(storageNode.GetPointer());
+  vtkNew<vtkMRMLSpatialObjectsNode> restoredNode;
+  const char* atts[] =
+    {
+    "SubsamplingRatio", "0.5",
+    "hiddenTubes", "52 2 57 1",
+    "highlightedTubes", "58 1000000000 1000 5",
+    "selectedTubes", "54 1",
+    NULL
+    };
+  restoredNode->ReadXMLAttributes(atts);
+  scene->AddNode(restoredNode.GetPointer());
+  restoredNode->SetAndObserveStorageNodeID(storageNode->GetID());
+  if (!storageNode->ReadData(restoredNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": cache not read" << std::endl;
+    return EXIT_FAILURE;
+    }
+  restoredNode->UpdateScene(scene.GetPointer());
+  if (restoredNode->GetNumberOfTubes() != 10 ||
+      restoredNode->GetSubsamplingRatio() != 0.5f ||
+      restoredNode->GetNumberOfHiddenTubes() != 3 ||
+      restoredNode->GetTubeVisibility(2) ||
+      restoredNode->GetTubeVisibility(6) ||
+      restoredNode->GetTubeVisibility(7) ||
+      !restoredNode->GetTubeVisibility(5) ||
+      restoredNode->GetNumberOfHighlightedTubes() != 2 ||
+      !restoredNode->GetTubeHighlight(0) ||
+      !restoredNode->GetTubeHighlight(1) ||
+      restoredNode->GetNumberOfSelectedTubes() != 1 ||
+      !restoredNode->IsTubeSelected(5))
+    {
+    std::cerr << "Line " << __LINE__ << ": state not restored" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The cache gives the same tubes as the first read.
+  vtkPointData* pointData = node->GetPolyData()->GetPointData();
+  vtkPointData* restoredPointData =
+    restoredNode->GetPolyData()->GetPointData();
+  if (!SameArrays(node->GetPolyData()->GetPoints()->GetData(),
+                  restoredNode->GetPolyData()->GetPoints()->GetData()) ||
+      !SameArrays(pointData->GetArray("TubeRadius"),
+                  restoredPointData->GetArray("TubeRadius")) ||
+      !SameArrays(pointData->GetArray("TubeIDs"),
+                  restoredPointData->GetArray("TubeIDs")))
+    {
+    std::cerr << "Line " << __LINE__ << ": cache differs from the file"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The same state is saved.
+  std::ostringstream xml;
+  restoredNode->WriteXML(xml, 0);
+  if (xml.str().find("hiddenTubes=\"52 2 57 1\"") == std::string::npos ||
+      xml.str().find("highlightedTubes=\"58 2\"") == std::string::npos ||
+      xml.str().find("selectedTubes=\"54 1\"") == std::string::npos ||
+      xml.str().find("SubsamplingRatio=\"0.5\"") == std::string::npos)
+    {
+    std::cerr << "Line " << __LINE__ << ": state not saved: " << xml.str()
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The cache is read instead of the file: replaced by 3 tubes, newer
+  // than the file, they are the ones read.
+  itksys::SystemTools::Delay(1100);
+  vtkNew<vtkPolyData> cachePolyData;
+  CreateTubes(cachePolyData.GetPointer(), 3);
+  vtkNew<vtkSpatialObjectsTrcWriter> cacheWriter;
+  cacheWriter->SetFileName(cacheName.c_str());
+  cacheWriter->SetInput(cachePolyData.GetPointer());
+  cacheWriter->LosslessOn();
+  vtkNew<vtkMRMLSpatialObjectsNode> cachedNode;
+  if (!cacheWriter->Write() ||
+      !storageNode->ReadData(cachedNode.GetPointer()) ||
+      cachedNode->GetNumberOfTubes() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": cache not read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Once the file is modified, the cache is out of date: the file is read
+  // and cached again.
+  itksys::SystemTools::Delay(1100);
+  vtkNew<vtkMRMLSpatialObjectsNode> fileNode;
+  vtkNew<vtkSpatialObjectsTrcReader> cacheReader;
+  cacheReader->SetFileName(cacheName.c_str());
+  if (!writer->Write() ||
+      !storageNode->ReadData(fileNode.GetPointer()) ||
+      fileNode->GetNumberOfTubes() != 10 ||
+      !cacheReader->Read() ||
+      cacheReader->GetOutput()->GetNumberOfLines() != 10)
+    {
+    std::cerr << "Line " << __LINE__ << ": out of date cache read"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,275 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tube i has tubeSizes[i] points along x at y = i, TubeIDs = 10 + i and
+// TubeRadius = 1 + i.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes,
+                 const int* tubeSizes)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(tubeSizes[i]);
+    for (int j = 0; j < tubeSizes[i]; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0));
+      tubeIDs->InsertNextValue(10 + i);
+      tubeRadius->InsertNextValue(1 + i);
+      }
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+// Check the number of points of each tube, that their points are contiguous
+// and that the arrays have one value per point.
+bool CheckTubes(vtkMRMLSpatialObjectsNode* node, int numberOfTubes,
+                const int* tubeSizes, int line)
+{
+  vtkPolyData* polyData = node->GetPolyData();
+  if (node->GetNumberOfTubes() != numberOfTubes)
+    {
+    std::cerr << "Line " << line << ": " << node->GetNumberOfTubes()
+              << " tubes instead of " << numberOfTubes << std::endl;
+    return false;
+    }
+
+  vtkIdType expectedFirstPointId = 0;
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  vtkCellArray* lines = polyData->GetLines();
+  lines->InitTraversal();
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->GetNextCell(npts, pts);
+    if (npts != tubeSizes[i])
+      {
+      std::cerr << "Line " << line << ": tube " << i << " has " << npts
+                << " points instead of " << tubeSizes[i] << std::endl;
+      return false;
+      }
+    for (vtkIdType j = 0; j < npts; ++j)
+      {
+      if (pts[j] != expectedFirstPointId + j)
+        {
+        std::cerr << "Line " << line << ": tube " << i
+                  << " points are not contiguous" << std::endl;
+        return false;
+        }
+      }
+    expectedFirstPointId += npts;
+    }
+
+  if (polyData->GetNumberOfPoints() != expectedFirstPointId ||
+      polyData->GetPointData()->GetArray("TubeIDs")->GetNumberOfTuples() !=
+        expectedFirstPointId ||
+      polyData->GetPointData()->GetArray("TubeRadius")->GetNumberOfTuples() !=
+        expectedFirstPointId)
+    {
+    std::cerr << "Line " << line << ": wrong number of points or values"
+              << std::endl;
+    return false;
+    }
+
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNodeTubeEditingTest1(int vtkNotUsed(argc),
+                                              char* vtkNotUsed(argv)[])
+{
+  const int tubeSizes[3] = {3, 4, 5};
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 3, tubeSizes);
+
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetAndObservePolyData(polyData.GetPointer());
+  if (!CheckTubes(node.GetPointer(), 3, tubeSizes, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Delete the middle tube: the last tube points are moved
+  if (!node->DeleteTube(1))
+    {
+    std::cerr << "DeleteTube failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int afterDelete[2] = {3, 5};
+  if (!CheckTubes(node.GetPointer(), 2, afterDelete, __LINE__) ||
+      node->GetPolyData()->GetPointData()->GetArray("TubeIDs")->
+        GetTuple1(3) != 12)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Split the last tube at its third point, the split point is shared
+  if (node->SplitTube(1, 2) != 2)
+    {
+    std::cerr << "SplitTube failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int afterSplit[3] = {3, 3, 3};
+  if (!CheckTubes(node.GetPointer(), 3, afterSplit, __LINE__) ||
+      node->GetPolyData()->GetPointData()->GetArray("TubeIDs")->
+        GetTuple1(6) != 13)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Merge back the split tubes, they are connected by their split point
+  if (!node->MergeTubes(1, 2))
+    {
+    std::cerr << "MergeTubes failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!CheckTubes(node.GetPointer(), 2, afterDelete, __LINE__) ||
+      node->GetPolyData()->GetPointData()->GetArray("TubeIDs")->
+        GetTuple1(7) != 12)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Trim the first tube
+  if (!node->TrimTube(0, 1, 2))
+    {
+    std::cerr << "TrimTube failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int afterTrim[2] = {2, 5};
+  if (!CheckTubes(node.GetPointer(), 2, afterTrim, __LINE__) ||
+      node->GetPolyData()->GetPoint(0)[0] != 1.)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Change the radius of the last tube only
+  if (!node->SetTubeRadius(1, 0.5) || !node->ScaleTubeRadius(1, 4.))
+    {
+    std::cerr << "SetTubeRadius failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkDataArray* tubeRadius =
+    node->GetPolyData()->GetPointData()->GetArray("TubeRadius");
+  if (tubeRadius->GetTuple1(0) != 1. || tubeRadius->GetTuple1(2) != 2.)
+    {
+    std::cerr << "Wrong radius after SetTubeRadius" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Invalid edits
+  if (node->DeleteTube(2) || node->SplitTube(0, 0) != -1 ||
+      node->TrimTube(1, 4, 2) || node->MergeTubes(1, 1))
+    {
+    std::cerr << "Invalid edits should fail" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Undo all the edits: delete, split, merge, trim, set and scale radius
+  if (node->GetNumberOfUndoTubeEdits() != 6)
+    {
+    std::cerr << node->GetNumberOfUndoTubeEdits()
+              << " edits to undo instead of 6" << std::endl;
+    return EXIT_FAILURE;
+    }
+  while (node->CanUndoTubeEdit())
+    {
+    if (!node->UndoTubeEdit())
+      {
+      std::cerr << "UndoTubeEdit failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (!CheckTubes(node.GetPointer(), 3, tubeSizes, __LINE__) ||
+      node->GetPolyData()->GetPointData()->GetArray("TubeIDs")->
+        GetTuple1(3) != 11 ||
+      node->GetPolyData()->GetPoint(11)[0] != 4.)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Redo them all
+  while (node->CanRedoTubeEdit())
+    {
+    if (!node->RedoTubeEdit())
+      {
+      std::cerr << "RedoTubeEdit failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  tubeRadius = node->GetPolyData()->GetPointData()->GetArray("TubeRadius");
+  if (!CheckTubes(node.GetPointer(), 2, afterTrim, __LINE__) ||
+      tubeRadius->GetTuple1(2) != 2.)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // A new edit discards the redo history, grouped edits are undone at once
+  node->UndoTubeEdit();
+  node->BeginTubeEdit();
+  node->DeleteTube(1);
+  node->DeleteTube(0);
+  node->EndTubeEdit();
+  if (node->CanRedoTubeEdit() || node->GetNumberOfTubes() != 0 ||
+      !node->UndoTubeEdit() ||
+      !CheckTubes(node.GetPointer(), 2, afterTrim, __LINE__))
+    {
+    std::cerr << "Grouped edit failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The split tubes get new IDs, the IDs of removed tubes are not reused
+  if (node->SplitTube(1, 2) != 2 ||
+      node->GetPolyData()->GetPointData()->GetArray("TubeIDs")->
+        GetTuple1(5) != 14)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong split tube ID" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
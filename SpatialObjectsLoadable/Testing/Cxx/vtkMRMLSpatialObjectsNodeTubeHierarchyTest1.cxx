@@ -0,0 +1,183 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+void CountEvent(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                void* clientData, void* vtkNotUsed(callData))
+{
+  ++(*reinterpret_cast<int*>(clientData));
+}
+
+//-----------------------------------------------------------------------------
+// Tube i has i + 2 points along x at y = i, TubeIDs = 10 + i,
+// TubeRadius = 1 + i and TubeParentIDs = parentIDs[i].
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes,
+                 const int* parentIDs)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(i + 2);
+    for (int j = 0; j < i + 2; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0));
+      tubeIDs->InsertNextValue(10 + i);
+      tubeRadius->InsertNextValue(1 + i);
+      }
+    tubeParentIDs->InsertNextValue(parentIDs[i]);
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool CheckValue(double value, double expected, const char* what, int line)
+{
+  if (value != expected)
+    {
+    std::cerr << "Line " << line << ": " << what << " is " << value
+              << " instead of " << expected << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNodeTubeHierarchyTest1(int vtkNotUsed(argc),
+                                                char* vtkNotUsed(argv)[])
+{
+  // 10 <- 11, 10 <- 12 <- 13, 14 has a missing parent, 15 and 16 are each
+  // other's parent.
+  const int parentIDs[7] = {-1, 10, 10, 12, 99, 16, 15};
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 7, parentIDs);
+
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetAndObservePolyData(polyData.GetPointer());
+
+  const vtkIdType expectedParents[5] = {-1, 0, 0, 2, -1};
+  const int expectedOrders[5] = {0, 1, 1, 2, 0};
+  for (vtkIdType i = 0; i < 5; ++i)
+    {
+    if (!CheckValue(node->GetTubeParent(i), expectedParents[i],
+                    "parent", __LINE__) ||
+        !CheckValue(node->GetTubeOrder(i), expectedOrders[i],
+                    "order", __LINE__) ||
+        !CheckValue(node->GetTubeIdentifier(i), 10 + i, "ID", __LINE__) ||
+        !CheckValue(node->GetTubeLength(i), i + 1, "length", __LINE__) ||
+        !CheckValue(node->GetTubeMeanRadius(i), i + 1, "radius", __LINE__))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The cycle is broken: one of the two tubes is a root.
+  if (!CheckValue((node->GetTubeParent(5) == -1) +
+                  (node->GetTubeParent(6) == -1), 1, "cycle roots",
+                  __LINE__) ||
+      !CheckValue(node->GetNumberOfTubeChildren(-1), 3, "roots", __LINE__) ||
+      !CheckValue(node->GetNumberOfTubeChildren(0), 2, "children",
+                  __LINE__) ||
+      !CheckValue(node->GetTubeChild(0, 1), 2, "child", __LINE__) ||
+      !CheckValue(node->FindTube(13), 3, "FindTube", __LINE__) ||
+      !CheckValue(node->FindTube(99), -1, "FindTube", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  int selectionEvents = 0;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(CountEvent);
+  callback->SetClientData(&selectionEvents);
+  node->AddObserver(vtkMRMLSpatialObjectsNode::TubeSelectionModifiedEvent,
+                    callback.GetPointer());
+
+  // Invalid and duplicated tubes are ignored.
+  vtkNew<vtkIdTypeArray> tubeIds;
+  tubeIds->InsertNextValue(3);
+  tubeIds->InsertNextValue(1);
+  tubeIds->InsertNextValue(1);
+  tubeIds->InsertNextValue(50);
+  node->SetSelectedTubes(tubeIds.GetPointer());
+  node->SetSelectedTubes(tubeIds.GetPointer());
+  if (!CheckValue(selectionEvents, 1, "selection events", __LINE__) ||
+      !CheckValue(node->GetNumberOfSelectedTubes(), 2, "selected",
+                  __LINE__) ||
+      !CheckValue(node->IsTubeSelected(3), 1, "tube 3 selected", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The selection and the attributes follow the edits.
+  node->DeleteTube(2);
+  if (!CheckValue(selectionEvents, 2, "selection events", __LINE__) ||
+      !CheckValue(node->IsTubeSelected(1), 1, "tube 1 selected", __LINE__) ||
+      !CheckValue(node->IsTubeSelected(2), 1, "tube 2 selected", __LINE__) ||
+      !CheckValue(node->IsTubeSelected(3), 0, "tube 3 selected", __LINE__) ||
+      !CheckValue(node->FindTube(13), 2, "FindTube", __LINE__) ||
+      !CheckValue(node->GetTubeParent(2), -1, "parent", __LINE__) ||
+      !CheckValue(node->GetNumberOfTubeChildren(0), 1, "children",
+                  __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // A new polydata clears the selection.
+  node->SetAndObservePolyData(polyData.GetPointer());
+  if (!CheckValue(selectionEvents, 3, "selection events", __LINE__) ||
+      !CheckValue(node->GetNumberOfSelectedTubes(), 0, "selected",
+                  __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+void CountEvent(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                void* clientData, void* vtkNotUsed(callData))
+{
+  ++(*reinterpret_cast<int*>(clientData));
+}
+
+//-----------------------------------------------------------------------------
+// Tube i has 3 points, TubeIDs = 10 + i, TubeRadius = 1 and
+// TubeParentIDs = parentIDs[i].
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes,
+                 const int* parentIDs)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3);
+    for (int j = 0; j < 3; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0));
+      tubeIDs->InsertNextValue(10 + i);
+      tubeRadius->InsertNextValue(1);
+      }
+    tubeParentIDs->InsertNextValue(parentIDs[i]);
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool CheckValue(double value, double expected, const char* what, int line)
+{
+  if (value != expected)
+    {
+    std::cerr << "Line " << line << ": " << what << " is " << value
+              << " instead of " << expected << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Check that the lines of output are the tubes of expectedIDs.
+bool CheckLines(vtkPolyData* output, int numberOfTubes,
+                const int* expectedIDs, int line)
+{
+  if (!CheckValue(output->GetLines()->GetNumberOfCells(), numberOfTubes,
+                  "number of lines", line))
+    {
+    return false;
+    }
+  vtkDataArray* tubeIDs = output->GetPointData()->GetArray("TubeIDs");
+  vtkDataArray* tubeParentIDs =
+    output->GetCellData()->GetArray("TubeParentIDs");
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  output->GetLines()->InitTraversal();
+  for (int i = 0; output->GetLines()->GetNextCell(npts, pts); ++i)
+    {
+    if (!CheckValue(npts, 3, "number of points", line) ||
+        !CheckValue(tubeIDs->GetTuple1(pts[0]), expectedIDs[i],
+                    "TubeIDs", line) ||
+        !CheckValue(tubeParentIDs->GetNumberOfTuples(), numberOfTubes,
+                    "number of cell data", line))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsNodeTubeMasksTest1(int vtkNotUsed(argc),
+                                            char* vtkNotUsed(argv)[])
+{
+  // 10 <- 11 <- 12, 13, 14
+  const int parentIDs[5] = {-1, 10, 11, -1, -1};
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 5, parentIDs);
+
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetAndObservePolyData(polyData.GetPointer());
+
+  int maskEvents = 0;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(CountEvent);
+  callback->SetClientData(&maskEvents);
+  node->AddObserver(vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent,
+                    callback.GetPointer());
+
+  // Nothing is filtered until tubes are hidden.
+  if (node->GetFilteredPolyData() != polyData.GetPointer() ||
+      !CheckValue(node->GetHighlightedPolyData()->GetNumberOfLines(), 0,
+                  "highlighted lines", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Hiding a branch hides the descendants, the points are shared.
+  node->SetTubeBranchVisibility(1, false);
+  node->SetTubeVisibility(1, false);
+  vtkPolyData* filteredPolyData = node->GetFilteredPolyData();
+  const int visibleIDs[3] = {10, 13, 14};
+  if (!CheckValue(maskEvents, 1, "mask events", __LINE__) ||
+      !CheckValue(node->GetNumberOfHiddenTubes(), 2, "hidden", __LINE__) ||
+      !CheckValue(node->GetTubeVisibility(2), 0, "visibility", __LINE__) ||
+      filteredPolyData == polyData.GetPointer() ||
+      filteredPolyData->GetPoints() != polyData->GetPoints() ||
+      !CheckLines(filteredPolyData, 3, visibleIDs, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  vtkDataArray* pointMask =
+    filteredPolyData->GetPointData()->GetArray("TubeVisibilityMask");
+  if (!pointMask ||
+      !CheckValue(pointMask->GetTuple1(0), 1, "point mask", __LINE__) ||
+      !CheckValue(pointMask->GetTuple1(3), 0, "point mask", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Hiding or showing a few tubes patches the lines in place.
+  vtkCellArray* filteredLines = filteredPolyData->GetLines();
+  node->SetTubeVisibility(4, false);
+  const int patchedIDs[2] = {10, 13};
+  if (node->GetFilteredPolyData()->GetLines() != filteredLines ||
+      !CheckLines(node->GetFilteredPolyData(), 2, patchedIDs, __LINE__) ||
+      !CheckValue(pointMask->GetTuple1(12), 0, "point mask", __LINE__) ||
+      !CheckValue(pointMask->GetTuple1(9), 1, "point mask", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  node->SetTubeVisibility(4, true);
+  if (node->GetFilteredPolyData()->GetLines() != filteredLines ||
+      !CheckLines(node->GetFilteredPolyData(), 3, visibleIDs, __LINE__) ||
+      !CheckValue(pointMask->GetTuple1(12), 1, "point mask", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Only the visible highlighted and selected tubes are highlighted.
+  node->SetTubeHighlight(2, true);
+  node->SetTubeHighlight(3, true);
+  vtkNew<vtkIdTypeArray> tubeIds;
+  tubeIds->InsertNextValue(4);
+  node->SetTubesSelection(tubeIds.GetPointer(), true);
+  const int highlightedIDs[2] = {13, 14};
+  if (!CheckValue(maskEvents, 5, "mask events", __LINE__) ||
+      !CheckValue(node->IsTubeSelected(4), 1, "selected", __LINE__) ||
+      !CheckLines(node->GetHighlightedPolyData(), 2, highlightedIDs,
+                  __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The masks follow the edits.
+  node->DeleteTube(0);
+  if (!CheckValue(node->GetTubeVisibility(0), 0, "visibility", __LINE__) ||
+      !CheckValue(node->GetTubeHighlight(2), 1, "highlight", __LINE__) ||
+      !CheckValue(node->IsTubeSelected(3), 1, "selected", __LINE__) ||
+      !CheckLines(node->GetFilteredPolyData(), 2, highlightedIDs,
+                  __LINE__) ||
+      !CheckLines(node->GetHighlightedPolyData(), 2, highlightedIDs,
+                  __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The replaced tube keeps its flags.
+  node->SetTubeRadius(0, 2.);
+  if (!CheckValue(node->GetTubeVisibility(0), 0, "visibility", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  node->ShowAllTubes();
+  if (node->GetFilteredPolyData() != node->GetPolyData())
+    {
+    std::cerr << "Line " << __LINE__ << ": the polydata is still filtered"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A new polydata clears the masks.
+  node->SetAndObservePolyData(polyData.GetPointer());
+  if (!CheckValue(node->GetNumberOfHighlightedTubes(), 0, "highlighted",
+                  __LINE__) ||
+      !CheckValue(node->GetHighlightedPolyData()->GetNumberOfLines(), 0,
+                  "highlighted lines", __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+#include <vtkSpatialObjectsTreWriter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tubes of IDs 10 to 10 + numberOfTubes - 1, tube i is the parent of
+// tube i + 1, or tubes without ID nor parent.
+bool WriteTubes(const std::string& filename, int numberOfTubes,
+                bool withIDs = true)
+{
+  vtkNew<vtkPolyData> polyData;
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3);
+    for (int j = 0; j < 3; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, i, 0.));
+      tubeIDs->InsertNextValue(withIDs ? 10 + i : -1);
+      tubeRadius->InsertNextValue(0.5);
+      }
+    tubeParentIDs->InsertNextValue(i == 0 || !withIDs ? -1 : 10 + i - 1);
+    }
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+
+  vtkNew<vtkSpatialObjectsTreWriter> writer;
+  writer->SetInput(polyData.GetPointer());
+  writer->SetFileName(filename.c_str());
+  return writer->Write() != 0;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsStorageNodeMergeTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const std::string directory(argv[1]);
+  const std::string prefix =
+    directory + "/vtkMRMLSpatialObjectsStorageNodeMergeTest1";
+  if (!WriteTubes(prefix + "_0.tre", 3) || !WriteTubes(prefix + "_1.tre", 2) ||
+      !WriteTubes(prefix + "_2.tre", 2, false))
+    {
+    std::cerr << "Line " << __LINE__ << ": can't write the tubes"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->SetFileName((prefix + ".tre").c_str());
+  storageNode->AddFileName((prefix + "_0.tre").c_str());
+  storageNode->AddFileName((prefix + "_1.tre").c_str());
+  storageNode->AddFileName((prefix + "_2.tre").c_str());
+  if (!storageNode->ReadData(node.GetPointer()) ||
+      node->GetNumberOfTubes() != 7)
+    {
+    std::cerr << "Line " << __LINE__ << ": 7 tubes expected, got "
+              << node->GetNumberOfTubes() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The IDs of the second file follow the IDs of the first one, the tubes
+  // without ID keep -1.
+  const int expectedIndices[] = {0, 0, 0, 1, 1, 2, 2};
+  const int expectedIDs[] = {10, 11, 12, 23, 24, -1, -1};
+  const int expectedParentIDs[] = {-1, 10, 11, -1, 23, -1, -1};
+  vtkDataArray* sourceFileIndex =
+    node->GetPolyData()->GetCellData()->GetArray("SourceFileIndex");
+  if (!sourceFileIndex)
+    {
+    std::cerr << "Line " << __LINE__ << ": no SourceFileIndex array"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < 7; ++i)
+    {
+    if (sourceFileIndex->GetComponent(i, 0) != expectedIndices[i] ||
+        node->GetTubeIdentifier(i) != expectedIDs[i] ||
+        node->GetTubeParentIdentifier(i) != expectedParentIDs[i])
+      {
+      std::cerr << "Line " << __LINE__ << ": tube " << i << " has index "
+                << sourceFileIndex->GetComponent(i, 0) << ", ID "
+                << node->GetTubeIdentifier(i) << " and parent ID "
+                << node->GetTubeParentIdentifier(i) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Once written, the merged tubes are read from a single file.
+  if (!storageNode->WriteData(node.GetPointer()) ||
+      storageNode->GetNumberOfFileNames() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": merged tubes not written"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkMRMLSpatialObjectsNode> mergedNode;
+  if (!storageNode->ReadData(mergedNode.GetPointer()) ||
+      mergedNode->GetNumberOfTubes() != 7 ||
+      mergedNode->GetTubeIdentifier(4) != 24)
+    {
+    std::cerr << "Line " << __LINE__ << ": merged file not read back"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSpatialObjectsTubeDisplayNode.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSpatialObjectsTubeDisplayNodeLazyPipelineTest1(
+  int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkPolyData> polyData;
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+  lines->InsertNextCell(4);
+  for (int i = 0; i < 4; ++i)
+    {
+    lines->InsertCellPoint(points->InsertNextPoint(i, 0, 0));
+    tubeRadius->InsertNextValue(1.);
+    }
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSpatialObjectsTubeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  displayNode->SetVisibility(0);
+  displayNode->SetInputPolyData(polyData.GetPointer());
+
+  // The output stays the same whether the pipeline is allocated or not.
+  vtkPolyData* output = displayNode->GetOutputPolyData();
+
+  // Hidden: the input is passed through, no tube is generated.
+  if (displayNode->IsPipelineAllocated() || !output ||
+      displayNode->GetInputPolyData() != polyData.GetPointer() ||
+      displayNode->GetHiddenTime() < 0.)
+    {
+    std::cerr << "Line " << __LINE__ << ": hidden node allocated a pipeline"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Shown: the tube filter is created.
+  displayNode->SetVisibility(1);
+  displayNode->UpdatePolyDataPipeline();
+  if (!displayNode->IsPipelineAllocated() ||
+      displayNode->GetInputPolyData() != polyData.GetPointer() ||
+      displayNode->GetHiddenTime() != 0. ||
+      displayNode->GetOutputPolyData() != output ||
+      displayNode->ReleasePipeline())
+    {
+    std::cerr << "Line " << __LINE__ << ": visible node has no pipeline"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Hidden for long enough: the pipeline is released.
+  displayNode->SetVisibility(0);
+  if (displayNode->ReleasePipeline(3600.) ||
+      !displayNode->ReleasePipeline(0.) ||
+      displayNode->IsPipelineAllocated() ||
+      displayNode->GetInputPolyData() != polyData.GetPointer() ||
+      displayNode->GetOutputPolyData() != output)
+    {
+    std::cerr << "Line " << __LINE__ << ": pipeline not released"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // And rebuilt on show.
+  displayNode->SetVisibility(1);
+  displayNode->UpdatePolyDataPipeline();
+  if (!displayNode->IsPipelineAllocated() ||
+      displayNode->GetInputPolyData() != polyData.GetPointer() ||
+      displayNode->GetOutputPolyData() != output)
+    {
+    std::cerr << "Line " << __LINE__ << ": pipeline not rebuilt"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The tube filter builds one ring of points per input point, triangular
+  // in preview mode.
+  displayNode->SetTubeNumberOfSides(8);
+  displayNode->UpdatePolyDataPipeline();
+  output->Update();
+  if (output->GetNumberOfPoints() != 4 * 8)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << output->GetNumberOfPoints()
+              << " tube points instead of " << 4 * 8 << std::endl;
+    return EXIT_FAILURE;
+    }
+  displayNode->TubePreviewModeOn();
+  displayNode->UpdatePolyDataPipeline();
+  output->Update();
+  if (output->GetNumberOfPoints() != 4 * 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << output->GetNumberOfPoints()
+              << " preview tube points instead of " << 4 * 3 << std::endl;
+    return EXIT_FAILURE;
+    }
+  displayNode->TubePreviewModeOff();
+  displayNode->UpdatePolyDataPipeline();
+  output->Update();
+  if (output->GetNumberOfPoints() != 4 * 8)
+    {
+    std::cerr << "Line " << __LINE__ << ": preview not left" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Benchmark of the load/convert/display pipeline of the spatial objects.
+//
+// Usage:
+//   vtkSlicerSpatialObjectsBenchmark <output.json> <temporary directory>
+//                                    [number of points]...
+//
+// For each number of points (1k, 10k, 100k and 1M by default), a synthetic
+// network of 100 points per tube is generated and each stage is timed
+// separately. The report gives for each stage its duration, its throughput
+// in points per second, the number of operator new calls it made and the
+// peak resident set size of the process after the stage. The buffers of the
+// VTK data arrays are allocated with malloc/realloc and are not counted in
+// the operator new calls, only in the peak resident set size.
+
+// SpatialObjects includes
+#include <vtkSlicerSpatialObjectsNetworkGenerator.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSpatialObjectsDisplayNode.h>
+#include <vtkMRMLSpatialObjectsDisplayPropertiesNode.h>
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <sys/resource.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Count the operator new calls of the whole process: the objects, the STL
+// containers and the ITK point lists, not the VTK array buffers.
+// The counter is not atomic: the storage node runs the readers and writers
+// in a single thread, see RunBenchmark().
+static unsigned long NumberOfNewCalls = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+  ++NumberOfNewCalls;
+  void* memory = malloc(size ? size : 1);
+  if (!memory)
+    {
+    throw std::bad_alloc();
+    }
+  return memory;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc)
+{
+  return operator new(size);
+}
+
+void operator delete(void* memory) throw()
+{
+  free(memory);
+}
+
+void operator delete[](void* memory) throw()
+{
+  free(memory);
+}
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Peak resident set size of the process in kibibytes
+unsigned long GetPeakRSS()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+    return 0;
+    }
+  return static_cast<unsigned long>(counters.PeakWorkingSetSize / 1024);
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+    return 0;
+    }
+# if defined(__APPLE__)
+  return static_cast<unsigned long>(usage.ru_maxrss / 1024);
+# else
+  return static_cast<unsigned long>(usage.ru_maxrss);
+# endif
+#endif
+}
+
+//-----------------------------------------------------------------------------
+class StageTimer
+{
+public:
+  StageTimer(std::ostream& report, const char* name, vtkIdType numberOfPoints,
+             bool first = false)
+    : Report(report), Name(name), NumberOfPoints(numberOfPoints)
+  {
+    if (!first)
+      {
+      this->Report << ",";
+      }
+    this->NewCalls = NumberOfNewCalls;
+    this->Start = vtkTimerLog::GetUniversalTime();
+  }
+
+  ~StageTimer()
+  {
+    const double seconds = vtkTimerLog::GetUniversalTime() - this->Start;
+    const unsigned long newCalls = NumberOfNewCalls - this->NewCalls;
+
+    this->Report << "\n        {\"name\": \"" << this->Name << "\""
+                 << ", \"seconds\": " << seconds
+                 << ", \"pointsPerSecond\": "
+                 << (seconds > 0. ? this->NumberOfPoints / seconds : 0.)
+                 << ", \"newCalls\": " << newCalls
+                 << ", \"peakRSSKiB\": " << GetPeakRSS() << "}";
+
+    std::cout << "  " << this->Name << ": " << seconds << " s" << std::endl;
+  }
+
+private:
+  std::ostream& Report;
+  const char* Name;
+  vtkIdType NumberOfPoints;
+  unsigned long NewCalls;
+  double Start;
+};
+
+//-----------------------------------------------------------------------------
+bool RunBenchmark(std::ostream& report, const std::string& directory,
+                  int numberOfPoints)
+{
+  const int numberOfPointsPerTube = 100;
+  const int numberOfTubes =
+    std::max(numberOfPoints / numberOfPointsPerTube, 1);
+  const vtkIdType totalNumberOfPoints =
+    static_cast<vtkIdType>(numberOfTubes) * numberOfPointsPerTube;
+
+  std::cout << totalNumberOfPoints << " points" << std::endl;
+
+  std::ostringstream filename;
+  filename << directory << "/vtkSlicerSpatialObjectsBenchmark_"
+           << totalNumberOfPoints << ".tre";
+  std::ostringstream outputFilename;
+  outputFilename << directory << "/vtkSlicerSpatialObjectsBenchmark_"
+                 << totalNumberOfPoints << "_output.tre";
+
+  // Input network, not timed
+  vtkNew<vtkSlicerSpatialObjectsNetworkGenerator> generator;
+  generator->SetNumberOfTubes(numberOfTubes);
+  generator->SetNumberOfTrees(std::max(numberOfTubes / 100, 1));
+  generator->SetNumberOfPointsPerTube(numberOfPointsPerTube);
+  generator->SetExtent(std::max(numberOfTubes / 10., 100.));
+  if (!generator->WriteFile(filename.str().c_str()))
+    {
+    return false;
+    }
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  scene->AddNode(node.GetPointer());
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  // A multithreaded .tre writer would race on NumberOfNewCalls.
+  storageNode->SetNumberOfThreads(1);
+  scene->AddNode(storageNode.GetPointer());
+  vtkNew<vtkPolyData> polyData;
+
+  report << "\n    {\"points\": " << totalNumberOfPoints
+         << ", \"tubes\": " << numberOfTubes
+         << ", \"stages\": [";
+
+  vtkMRMLSpatialObjectsStorageNode::ReaderType::Pointer reader =
+    vtkMRMLSpatialObjectsStorageNode::ReaderType::New();
+  {
+  StageTimer timer(report, "parse", totalNumberOfPoints, true);
+  reader->SetFileName(filename.str());
+  reader->Update();
+  }
+  {
+  StageTimer timer(report, "convert", totalNumberOfPoints);
+  storageNode->ConvertSpatialObjectToPolyData(reader->GetGroup(),
+                                              polyData.GetPointer());
+  }
+  {
+  StageTimer timer(report, "setAndObservePolyData", totalNumberOfPoints);
+  node->SetAndObservePolyData(polyData.GetPointer());
+  node->SetSpatialObject(reader->GetGroup());
+  }
+  {
+  StageTimer timer(report, "subsampling", totalNumberOfPoints);
+  node->SetSubsamplingRatio(0.5);
+  node->SetSubsamplingRatio(1.);
+  }
+
+  node->CreateDefaultDisplayNodes();
+  vtkMRMLSpatialObjectsDisplayNode* lineDisplayNode =
+    node->GetLineDisplayNode();
+  vtkMRMLSpatialObjectsDisplayNode* tubeDisplayNode =
+    node->GetTubeDisplayNode();
+  vtkMRMLSpatialObjectsDisplayNode* glyphDisplayNode =
+    node->GetGlyphDisplayNode();
+  {
+  StageTimer timer(report, "linePipeline", totalNumberOfPoints);
+  lineDisplayNode->SetVisibility(1);
+  lineDisplayNode->UpdatePolyDataPipeline();
+  lineDisplayNode->GetOutputPolyData()->Update();
+  }
+  {
+  StageTimer timer(report, "tubePipeline", totalNumberOfPoints);
+  tubeDisplayNode->SetVisibility(1);
+  tubeDisplayNode->UpdatePolyDataPipeline();
+  tubeDisplayNode->GetOutputPolyData()->Update();
+  }
+  {
+  // The glyphs themselves are generated by the mapper at render time
+  StageTimer timer(report, "glyphPipeline", totalNumberOfPoints);
+  glyphDisplayNode->SetVisibility(1);
+  glyphDisplayNode->UpdatePolyDataPipeline();
+  glyphDisplayNode->GetSpatialObjectsDisplayPropertiesNode()->
+    GetGlyphSource();
+  }
+  {
+  StageTimer timer(report, "write", totalNumberOfPoints);
+  storageNode->SetFileName(outputFilename.str().c_str());
+  storageNode->WriteData(node.GetPointer());
+  }
+
+  report << "\n      ]}";
+
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: " << argv[0]
+              << " <output.json> <temporary directory> [number of points]..."
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::vector<int> sizes;
+  for (int i = 3; i < argc; ++i)
+    {
+    sizes.push_back(atoi(argv[i]));
+    }
+  if (sizes.empty())
+    {
+    sizes.push_back(1000);
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+    }
+
+  std::ostringstream report;
+  report << "{\n  \"benchmark\": \"vtkSlicerSpatialObjectsBenchmark\","
+         << "\n  \"runs\": [";
+  for (size_t i = 0; i < sizes.size(); ++i)
+    {
+    if (i > 0)
+      {
+      report << ",";
+      }
+    if (!RunBenchmark(report, argv[2], sizes[i]))
+      {
+      std::cerr << "Benchmark failed for " << sizes[i] << " points"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  report << "\n  ]\n}\n";
+
+  std::ofstream output(argv[1]);
+  output << report.str();
+  if (!output)
+    {
+    std::cerr << "Failed to write " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// SpatialObjects includes
+#include <vtkSlicerSpatialObjectsMeshWriter.h>
+
+// VTK includes
+#include <vtkByteSwap.h>
+#include <vtkCellArray.h>
+#include <vtkConeSource.h>
+#include <vtkDoubleArray.h>
+#include <vtkLookupTable.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tube i has 5 + i points along x, at y = 3 * i, of radius 1.
+void CreateTubes(vtkPolyData* polyData)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> radius;
+  radius->SetName("TubeRadius");
+  vtkNew<vtkDoubleArray> curvature;
+  curvature->SetName("Curvature");
+  for (int i = 0; i < 3; ++i)
+    {
+    lines->InsertNextCell(5 + i);
+    for (int j = 0; j < 5 + i; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, 3. * i, 0.));
+      radius->InsertNextValue(1.);
+      curvature->InsertNextValue(j / 10.);
+      }
+    }
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(radius.GetPointer());
+  polyData->GetPointData()->AddArray(curvature.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+std::string ReadFile(const std::string& fileName)
+{
+  std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+//-----------------------------------------------------------------------------
+// Parse the JSON array of 3 numbers following \a key in \a json.
+bool ParseVector3(const std::string& json, const std::string& key,
+                  double values[3])
+{
+  std::string::size_type p = json.find("\"" + key + "\":[");
+  if (p == std::string::npos)
+    {
+    return false;
+    }
+  p += key.size() + 4;
+  for (int i = 0; i < 3; ++i)
+    {
+    p = json.find_first_not_of(" \t\r\n", p);
+    // JSON numbers start with a minus sign or a digit.
+    if (p == std::string::npos ||
+        (json[p] != '-' && (json[p] < '0' || json[p] > '9')))
+      {
+      return false;
+      }
+    const char* begin = json.c_str() + p;
+    char* end = 0;
+    values[i] = strtod(begin, &end);
+    p = json.find_first_not_of(" \t\r\n", p + (end - begin));
+    if (p == std::string::npos || json[p] != (i < 2 ? ',' : ']'))
+      {
+      return false;
+      }
+    ++p;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsMeshWriterTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string directory(argv[1]);
+
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer());
+  vtkNew<vtkLookupTable> lookupTable;
+  lookupTable->Build();
+
+  // Tubes of 4 sides in PLY, with the curvature and its colors:
+  // 18 rings of 4 vertices, 2 * 4 triangles between 2 rings.
+  const std::string plyFileName =
+    directory + "/vtkSlicerSpatialObjectsMeshWriterTest1.ply";
+  vtkNew<vtkSlicerSpatialObjectsMeshWriter> writer;
+  writer->SetInput(polyData.GetPointer());
+  writer->SetFileName(plyFileName.c_str());
+  writer->SetTubeNumberOfSides(4);
+  writer->SetScalarArrayName("Curvature");
+  writer->SetLookupTable(lookupTable.GetPointer());
+  writer->BakeColorsOn();
+  if (!writer->Write() ||
+      writer->GetNumberOfVertices() != 72 ||
+      writer->GetNumberOfPrimitives() != 120)
+    {
+    std::cerr << "Line " << __LINE__ << ": "
+              << writer->GetNumberOfVertices() << " vertices, "
+              << writer->GetNumberOfPrimitives() << " triangles"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string contents = ReadFile(plyFileName);
+  const std::string endHeader = "end_header\n";
+  const size_t headerSize = contents.find(endHeader) + endHeader.size();
+  // x y z nx ny nz red green blue alpha scalar
+  const size_t vertexSize = 32;
+  if (contents.find("element vertex 72\n") == std::string::npos ||
+      contents.find("element face 120\n") == std::string::npos ||
+      contents.size() != headerSize + 72 * vertexSize + 120 * 13)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong PLY file of "
+              << contents.size() << " bytes" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // The vertices of the first ring are at the radius of the tube axis.
+  for (int k = 0; k < 4; ++k)
+    {
+    float position[3];
+    memcpy(position, contents.c_str() + headerSize + k * vertexSize, 12);
+    vtkByteSwap::Swap4LERange(position, 3);
+    if (std::fabs(position[0]) > 1e-6 ||
+        std::fabs(position[1] * position[1] +
+                  position[2] * position[2] - 1.) > 1e-5)
+      {
+      std::cerr << "Line " << __LINE__ << ": vertex " << k << " at "
+                << position[0] << " " << position[1] << " " << position[2]
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Lines in glTF: 18 vertices, 15 segments.
+  const std::string glbFileName =
+    directory + "/vtkSlicerSpatialObjectsMeshWriterTest1.glb";
+  writer->SetFileName(glbFileName.c_str());
+  writer->SetGeometry(vtkSlicerSpatialObjectsMeshWriter::Lines);
+  writer->BakeColorsOff();
+  if (!writer->Write() ||
+      writer->GetNumberOfVertices() != 18 ||
+      writer->GetNumberOfPrimitives() != 15)
+    {
+    std::cerr << "Line " << __LINE__ << std::endl;
+    return EXIT_FAILURE;
+    }
+  contents = ReadFile(glbFileName);
+  vtkTypeUInt32 header[5];
+  memcpy(header, contents.c_str(), sizeof(header));
+  vtkByteSwap::Swap4LERange(header, 5);
+  const std::string json = contents.substr(20, header[3]);
+  double minimum[3];
+  double maximum[3];
+  if (contents.compare(0, 4, "glTF") != 0 || header[1] != 2 ||
+      header[2] != contents.size() || header[3] % 4 != 0 ||
+      json.find("\"mode\":1") == std::string::npos ||
+      json.find("\"count\":18,\"type\":\"VEC3\"") == std::string::npos ||
+      json.find("\"count\":30,\"type\":\"SCALAR\"") == std::string::npos ||
+      json.find("\"_SCALAR\"") == std::string::npos ||
+      !ParseVector3(json, "min", minimum) ||
+      !ParseVector3(json, "max", maximum) ||
+      maximum[0] != 6. || maximum[1] != 6. ||
+      minimum[0] > maximum[0] || minimum[1] > maximum[1] ||
+      minimum[2] > maximum[2])
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong glTF file " << json
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A cone at each point
+  vtkNew<vtkConeSource> cone;
+  cone->SetResolution(6);
+  cone->Update();
+  writer->SetGeometry(vtkSlicerSpatialObjectsMeshWriter::Glyphs);
+  writer->SetGlyphSource(cone->GetOutput());
+  if (!writer->Write() ||
+      writer->GetNumberOfVertices() !=
+        18 * cone->GetOutput()->GetNumberOfPoints())
+    {
+    std::cerr << "Line " << __LINE__ << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Unknown formats are not written.
+  writer->SetFileName((directory + "/mesh.obj").c_str());
+  if (writer->Write())
+    {
+    std::cerr << "Line " << __LINE__ << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
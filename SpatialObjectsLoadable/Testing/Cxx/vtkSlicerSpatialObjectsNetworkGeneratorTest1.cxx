@@ -0,0 +1,238 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// SpatialObjects includes
+#include <vtkSlicerSpatialObjectsNetworkGenerator.h>
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+// ITK includes
+#include <itkVesselTubeSpatialObject.h>
+
+// STD includes
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef vtkSlicerSpatialObjectsNetworkGenerator::TubeNetType TubeNetType;
+typedef itk::VesselTubeSpatialObject<3>                      TubeType;
+
+//-----------------------------------------------------------------------------
+bool GetTubes(TubeNetType* group, std::vector<TubeType*>& tubes)
+{
+  char childName[] = "Tube";
+  TubeNetType::ChildrenListType* tubeList =
+    group->GetChildren(999999, childName);
+  for (TubeNetType::ChildrenListType::iterator it = tubeList->begin();
+       it != tubeList->end(); ++it)
+    {
+    tubes.push_back(static_cast<TubeType*>((*it).GetPointer()));
+    }
+  delete tubeList;
+  return !tubes.empty();
+}
+
+//-----------------------------------------------------------------------------
+bool SameNetworks(TubeNetType* group, TubeNetType* otherGroup)
+{
+  std::vector<TubeType*> tubes;
+  std::vector<TubeType*> otherTubes;
+  if (!GetTubes(group, tubes) || !GetTubes(otherGroup, otherTubes) ||
+      tubes.size() != otherTubes.size())
+    {
+    return false;
+    }
+
+  for (size_t i = 0; i < tubes.size(); ++i)
+    {
+    if (tubes[i]->GetNumberOfPoints() != otherTubes[i]->GetNumberOfPoints())
+      {
+      return false;
+      }
+    for (size_t j = 0; j < tubes[i]->GetPoints().size(); ++j)
+      {
+      if (tubes[i]->GetPoints()[j].GetPosition() !=
+            otherTubes[i]->GetPoints()[j].GetPosition() ||
+          tubes[i]->GetPoints()[j].GetRadius() !=
+            otherTubes[i]->GetPoints()[j].GetRadius())
+        {
+        return false;
+        }
+      }
+    }
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// The branches are children of their parent tube, the roots of the group.
+bool CheckParents(TubeNetType* group, std::map<int, int>& parentIDs)
+{
+  std::vector<TubeType*> tubes;
+  if (!GetTubes(group, tubes))
+    {
+    return false;
+    }
+  for (size_t i = 0; i < tubes.size(); ++i)
+    {
+    TubeType* parent = dynamic_cast<TubeType*>(tubes[i]->GetParent());
+    const int parentID = parent ? parent->GetId() : -1;
+    if (tubes[i]->GetParentId() != parentID ||
+        (!parent && tubes[i]->GetParent() != group))
+      {
+      std::cerr << "Tube " << tubes[i]->GetId() << " has the parent id "
+                << tubes[i]->GetParentId() << " instead of " << parentID
+                << std::endl;
+      return false;
+      }
+    parentIDs[tubes[i]->GetId()] = parentID;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsNetworkGeneratorTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkSlicerSpatialObjectsNetworkGenerator> generator;
+  generator->SetSeed(42);
+  generator->SetNumberOfTubes(20);
+  generator->SetNumberOfTrees(2);
+  generator->SetNumberOfPointsPerTube(10);
+  generator->SetRadiusProfile(
+    vtkSlicerSpatialObjectsNetworkGenerator::radiusProfileTapered);
+  generator->GenerateMedialnessOn();
+
+  // Same seed, same network
+  TubeNetType::Pointer group = generator->GenerateSpatialObject();
+  TubeNetType::Pointer sameGroup = generator->GenerateSpatialObject();
+  std::vector<TubeType*> tubes;
+  if (!GetTubes(group, tubes) || tubes.size() != 20 ||
+      tubes[0]->GetNumberOfPoints() != 10)
+    {
+    std::cerr << "Wrong number of tubes or points" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!SameNetworks(group, sameGroup))
+    {
+    std::cerr << "The generator is not deterministic" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Different seed, different network
+  generator->SetSeed(43);
+  TubeNetType::Pointer otherGroup = generator->GenerateSpatialObject();
+  if (SameNetworks(group, otherGroup))
+    {
+    std::cerr << "The seed is not used" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Tree hierarchy: the branches of the 2 trees have a parent tube
+  std::map<int, int> parentIDs;
+  if (!CheckParents(otherGroup, parentIDs))
+    {
+    return EXIT_FAILURE;
+    }
+  int numberOfBranches = 0;
+  for (std::map<int, int>::const_iterator it = parentIDs.begin();
+       it != parentIDs.end(); ++it)
+    {
+    numberOfBranches += (it->second >= 0) ? 1 : 0;
+    }
+  if (numberOfBranches != 18)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << numberOfBranches
+              << " branches instead of 18" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Written network can be loaded
+  const std::string filename =
+    std::string(argv[1]) + "/vtkSlicerSpatialObjectsNetworkGeneratorTest1.tre";
+  if (!generator->WriteFile(filename.c_str()))
+    {
+    std::cerr << "Failed to write " << filename << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->SetFileName(filename.c_str());
+  if (!storageNode->ReadData(node.GetPointer()) || !node->GetPolyData() ||
+      node->GetPolyData()->GetNumberOfLines() != 20 ||
+      node->GetPolyData()->GetNumberOfPoints() != 200 ||
+      !node->GetPolyData()->GetPointData()->GetArray("Medialness"))
+    {
+    std::cerr << "Failed to read " << filename << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The hierarchy is written and read back
+  vtkPolyData* polyData = node->GetPolyData();
+  vtkDataArray* tubeIDs = polyData->GetPointData()->GetArray("TubeIDs");
+  vtkDataArray* tubeParentIDs =
+    polyData->GetCellData()->GetArray("TubeParentIDs");
+  if (!tubeIDs || !tubeParentIDs)
+    {
+    std::cerr << "Line " << __LINE__ << ": no TubeIDs or TubeParentIDs"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  vtkCellArray* lines = polyData->GetLines();
+  lines->InitTraversal();
+  for (vtkIdType i = 0; lines->GetNextCell(npts, pts); ++i)
+    {
+    const int tubeID = static_cast<int>(tubeIDs->GetTuple1(pts[0]));
+    const int parentID = static_cast<int>(
+      tubeParentIDs->GetTuple1(polyData->GetNumberOfVerts() + i));
+    if (parentIDs.find(tubeID) == parentIDs.end() ||
+        parentIDs[tubeID] != parentID)
+      {
+      std::cerr << "Line " << __LINE__ << ": tube " << tubeID
+                << " has the parent " << parentID << " after reading"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
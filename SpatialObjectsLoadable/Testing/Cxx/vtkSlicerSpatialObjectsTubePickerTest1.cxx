@@ -0,0 +1,182 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// Logic includes
+#include <vtkSlicerSpatialObjectsTubePicker.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+void StorePick(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+               void* clientData, void* callData)
+{
+  *reinterpret_cast<vtkMRMLSpatialObjectsNode::TubePickType*>(clientData) =
+    *reinterpret_cast<vtkMRMLSpatialObjectsNode::TubePickType*>(callData);
+}
+
+//-----------------------------------------------------------------------------
+// Tube i goes from (0, 4 i, 0) to (2, 4 i, 0) with 3 points of radius 1.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkDoubleArray> tubeIDs;
+  tubeIDs->SetName("TubeIDs");
+  vtkNew<vtkDoubleArray> tubeRadius;
+  tubeRadius->SetName("TubeRadius");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3);
+    for (int j = 0; j < 3; ++j)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(j, 4 * i, 0));
+      tubeIDs->InsertNextValue(i);
+      tubeRadius->InsertNextValue(1);
+      }
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(tubeIDs.GetPointer());
+  polyData->GetPointData()->AddArray(tubeRadius.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+// Pick along the ray parallel to z through (x, y) and check the result.
+bool CheckPick(vtkSlicerSpatialObjectsTubePicker* picker, double x, double y,
+               vtkIdType tubeId, vtkIdType pointIndex, double arcLength,
+               int line)
+{
+  const double p0[3] = {x, y, 10.};
+  const double p1[3] = {x, y, -10.};
+  const int picked = picker->Pick(p0, p1);
+  if (picked != (tubeId >= 0 ? 1 : 0) ||
+      picker->GetTubeId() != tubeId ||
+      (tubeId >= 0 &&
+       (picker->GetPointIndex() != pointIndex ||
+        std::fabs(picker->GetArcLength() - arcLength) > 1e-6)))
+    {
+    std::cerr << "Line " << line << ": picked tube "
+              << picker->GetTubeId() << " point "
+              << picker->GetPointIndex() << " arc length "
+              << picker->GetArcLength() << " instead of tube " << tubeId
+              << " point " << pointIndex << " arc length " << arcLength
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsTubePickerTest1(int vtkNotUsed(argc),
+                                           char* vtkNotUsed(argv)[])
+{
+  // Enough tubes for the hierarchy to have several levels.
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 50);
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetAndObservePolyData(polyData.GetPointer());
+
+  vtkNew<vtkSlicerSpatialObjectsTubePicker> picker;
+  picker->SetSpatialObjectsNode(node.GetPointer());
+
+  vtkMRMLSpatialObjectsNode::TubePickType pick;
+  pick.TubeId = -1;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(StorePick);
+  callback->SetClientData(&pick);
+  node->AddObserver(vtkMRMLSpatialObjectsNode::TubePickedEvent,
+                    callback.GetPointer());
+
+  if (!CheckPick(picker.GetPointer(), 1.6, 0., 0, 2, 1.6, __LINE__) ||
+      !CheckPick(picker.GetPointer(), 0.2, 4. * 37, 37, 0, 0.2, __LINE__) ||
+      !CheckPick(picker.GetPointer(), 1., 2., -1, -1, 0., __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  if (picker->GetNumberOfSegments() != 100 || pick.TubeId != 37 ||
+      pick.PointIndex != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << picker->GetNumberOfSegments()
+              << " segments, TubePickedEvent for tube " << pick.TubeId
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Within the radius and the tolerance, but not within the tolerance alone.
+  if (!CheckPick(picker.GetPointer(), 1.6, 1.2, 0, 2, 1.6, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  picker->UseTubeRadiusOff();
+  if (!CheckPick(picker.GetPointer(), 1.6, 1.2, -1, -1, 0., __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  picker->UseTubeRadiusOn();
+
+  // The first tube along the ray is picked.
+  const double p0[3] = {1., -10., 0.};
+  const double p1[3] = {1., 200., 0.};
+  if (!picker->Pick(p0, p1) || picker->GetTubeId() != 0 ||
+      std::fabs(picker->GetPickPosition()[0] - 1.) > 1e-6 ||
+      std::fabs(picker->GetPickPosition()[1]) > 1e-6)
+    {
+    std::cerr << "Line " << __LINE__ << ": picked tube "
+              << picker->GetTubeId() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The hidden tubes are not picked.
+  node->SetTubeVisibility(37, false);
+  if (!CheckPick(picker.GetPointer(), 0.2, 4. * 37, -1, -1, 0., __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  node->ShowAllTubes();
+
+  // The hierarchy follows the edits of the tubes.
+  node->DeleteTube(0);
+  if (!CheckPick(picker.GetPointer(), 1.6, 0., -1, -1, 0., __LINE__) ||
+      !CheckPick(picker.GetPointer(), 1.6, 4., 0, 2, 1.6, __LINE__) ||
+      picker->GetNumberOfSegments() != 98)
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// SpatialObjects includes
+#include <vtkSlicerSpatialObjectsVoxelizer.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+unsigned char GetVoxel(vtkImageData* image, double x, double y, double z)
+{
+  const double point[3] = {x, y, z};
+  const vtkIdType voxelId = image->FindPoint(const_cast<double*>(point));
+  return voxelId < 0 ? 255 : static_cast<unsigned char*>(
+    image->GetScalarPointer())[voxelId];
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerSpatialObjectsVoxelizerTest1(int vtkNotUsed(argc),
+                                          char* vtkNotUsed(argv)[])
+{
+  // A tube of radius 2 from (0, 0, 0) to (10, 0, 0)
+  vtkNew<vtkPolyData> polyData;
+  vtkNew<vtkPoints> points;
+  points->InsertNextPoint(0., 0., 0.);
+  points->InsertNextPoint(10., 0., 0.);
+  vtkNew<vtkCellArray> lines;
+  lines->InsertNextCell(2);
+  lines->InsertCellPoint(0);
+  lines->InsertCellPoint(1);
+  vtkNew<vtkDoubleArray> radius;
+  radius->SetName("TubeRadius");
+  radius->InsertNextValue(2.);
+  radius->InsertNextValue(2.);
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetPointData()->AddArray(radius.GetPointer());
+
+  vtkNew<vtkSlicerSpatialObjectsVoxelizer> voxelizer;
+  voxelizer->SetInput(polyData.GetPointer());
+  if (!voxelizer->Update())
+    {
+    std::cerr << "Line " << __LINE__ << ": Update failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkImageData* image = voxelizer->GetOutput();
+  int* dimensions = image->GetDimensions();
+  if (dimensions[0] != 15 || dimensions[1] != 5 || dimensions[2] != 5 ||
+      GetVoxel(image, 5., 0., 0.) != 1 ||
+      GetVoxel(image, -2., 0., 0.) != 1 ||
+      GetVoxel(image, 5., 2., 0.) != 1 ||
+      GetVoxel(image, 5., 2., 2.) != 0 ||
+      GetVoxel(image, -2., 1., 0.) != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong label map of "
+              << dimensions[0] << "x" << dimensions[1] << "x"
+              << dimensions[2] << " voxels" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Thin tubes keep a connected centerline.
+  radius->SetValue(0, 0.1);
+  radius->SetValue(1, 0.1);
+  radius->Modified();
+  if (!voxelizer->Update())
+    {
+    std::cerr << "Line " << __LINE__ << ": Update failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int x = 0; x <= 10; ++x)
+    {
+    if (GetVoxel(image, x, 0., 0.) != 1)
+      {
+      std::cerr << "Line " << __LINE__ << ": gap at " << x << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Too large label maps are not allocated.
+  voxelizer->SetSpacing(0.001, 0.001, 0.001);
+  if (voxelizer->Update())
+    {
+    std::cerr << "Line " << __LINE__ << ": label map too large" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,278 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+#include <vtkSpatialObjectsTrcReader.h>
+#include <vtkSpatialObjectsTrcWriter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tube i is a helix of 20 + i points, its parent is tube i - 1.
+// "Curvature" is an additional array.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  vtkNew<vtkCellArray> lines;
+  const char* names[] = {"TubeIDs", "TubeRadius", "Medialness", "Ridgeness",
+                         "Tan1", "Tan2", "Curvature"};
+  const int components[] = {1, 1, 1, 1, 3, 3, 1};
+  vtkDataArray* arrays[7];
+  for (int a = 0; a < 7; ++a)
+    {
+    vtkNew<vtkDoubleArray> array;
+    array->SetName(names[a]);
+    array->SetNumberOfComponents(components[a]);
+    polyData->GetPointData()->AddArray(array.GetPointer());
+    arrays[a] = array.GetPointer();
+    }
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(20 + i);
+    for (int j = 0; j < 20 + i; ++j)
+      {
+      const double angle = j / 5. + i;
+      lines->InsertCellPoint(points->InsertNextPoint(
+        10. * cos(angle), 10. * sin(angle), j / 3. - 2. * i));
+      arrays[0]->InsertNextTuple1(100 + 3 * i);
+      arrays[1]->InsertNextTuple1(1. + angle / 7.);
+      arrays[2]->InsertNextTuple1(angle / 11.);
+      arrays[3]->InsertNextTuple1(-angle / 13.);
+      arrays[4]->InsertNextTuple3(cos(angle), sin(angle), 0.);
+      arrays[5]->InsertNextTuple3(0., 0., j % 2 ? 1. : -1.);
+      arrays[6]->InsertNextTuple1(1. / (1. + angle));
+      }
+    tubeParentIDs->InsertNextValue(i == 0 ? -1 : 100 + 3 * (i - 1));
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool CloseArrays(vtkDataArray* array, vtkDataArray* other,
+                 double tolerance, const char* name)
+{
+  if (!array || !other ||
+      array->GetNumberOfTuples() != other->GetNumberOfTuples() ||
+      array->GetNumberOfComponents() != other->GetNumberOfComponents())
+    {
+    std::cerr << name << ": missing array or wrong size" << std::endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < array->GetNumberOfTuples(); ++i)
+    {
+    for (int k = 0; k < array->GetNumberOfComponents(); ++k)
+      {
+      if (std::fabs(array->GetComponent(i, k) - other->GetComponent(i, k)) >
+          tolerance)
+        {
+        std::cerr << name << ": value " << i << " is "
+                  << other->GetComponent(i, k) << " instead of "
+                  << array->GetComponent(i, k) << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::streamoff FileSize(const std::string& fileName)
+{
+  std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+  file.seekg(0, std::ios::end);
+  return file.tellg();
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSpatialObjectsTrcWriterTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string directory(argv[1]);
+
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 50);
+  const std::string filename =
+    directory + "/vtkSpatialObjectsTrcWriterTest1.trc";
+  vtkNew<vtkSpatialObjectsTrcWriter> writer;
+  writer->SetInput(polyData.GetPointer());
+  writer->SetFileName(filename.c_str());
+  writer->SetPointPrecision(1e-3);
+  vtkNew<vtkSpatialObjectsTrcReader> reader;
+  reader->SetFileName(filename.c_str());
+  for (int test = 0; test < 4; ++test)
+    {
+    const int threads = test % 2 ? 4 : 1;
+    const bool lossless = test >= 2;
+    writer->SetNumberOfThreads(threads);
+    writer->SetLossless(lossless);
+    reader->SetNumberOfThreads(threads);
+    if (!writer->Write() || !reader->Read())
+      {
+      std::cerr << "Line " << __LINE__ << ": " << threads << " threads"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    // Within the quantization steps, the IDs and the additional arrays
+    // are exact. Lossless files are read back exactly.
+    const double pointTolerance = lossless ? 0. : 0.5e-3 + 1e-9;
+    const double radiusTolerance = lossless ? 0. : 0.5e-4 + 1e-9;
+    const double floatTolerance = lossless ? 0. : 1e-6;
+    const double normalTolerance = lossless ? 0. : 1e-3;
+    vtkPolyData* output = reader->GetOutput();
+    vtkPointData* pointData = polyData->GetPointData();
+    vtkPointData* outputPointData = output->GetPointData();
+    if (!CloseArrays(polyData->GetPoints()->GetData(),
+                     output->GetPoints()->GetData(), pointTolerance,
+                     "Points") ||
+        !CloseArrays(polyData->GetLines()->GetData(),
+                     output->GetLines()->GetData(), 0., "Lines") ||
+        !CloseArrays(polyData->GetCellData()->GetArray("TubeParentIDs"),
+                     output->GetCellData()->GetArray("TubeParentIDs"), 0.,
+                     "TubeParentIDs") ||
+        !CloseArrays(pointData->GetArray("TubeIDs"),
+                     outputPointData->GetArray("TubeIDs"), 0., "TubeIDs") ||
+        !CloseArrays(pointData->GetArray("TubeRadius"),
+                     outputPointData->GetArray("TubeRadius"),
+                     radiusTolerance, "TubeRadius") ||
+        !CloseArrays(pointData->GetArray("Medialness"),
+                     outputPointData->GetArray("Medialness"),
+                     floatTolerance, "Medialness") ||
+        !CloseArrays(pointData->GetArray("Ridgeness"),
+                     outputPointData->GetArray("Ridgeness"),
+                     floatTolerance, "Ridgeness") ||
+        !CloseArrays(pointData->GetArray("Tan1"),
+                     outputPointData->GetArray("Tan1"), normalTolerance,
+                     "Tan1") ||
+        !CloseArrays(pointData->GetArray("Tan2"),
+                     outputPointData->GetArray("Tan2"), normalTolerance,
+                     "Tan2") ||
+        !CloseArrays(pointData->GetArray("Curvature"),
+                     outputPointData->GetArray("Curvature"), 0.,
+                     "Curvature"))
+      {
+      std::cerr << "Line " << __LINE__ << ": " << threads << " threads, "
+                << (lossless ? "lossless" : "quantized") << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The storage node writes and reads both formats, .trc is smaller.
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetAndObservePolyData(polyData.GetPointer());
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  const std::string treFilename =
+    directory + "/vtkSpatialObjectsTrcWriterTest1.tre";
+  storageNode->SetFileName(treFilename.c_str());
+  if (!storageNode->WriteData(node.GetPointer()))
+    {
+    return EXIT_FAILURE;
+    }
+  storageNode->SetFileName(filename.c_str());
+  vtkNew<vtkMRMLSpatialObjectsNode> readNode;
+  if (!storageNode->WriteData(node.GetPointer()) ||
+      !storageNode->ReadData(readNode.GetPointer()) ||
+      readNode->GetPolyData()->GetNumberOfLines() != 50 ||
+      FileSize(filename) * 3 > FileSize(treFilename))
+    {
+    std::cerr << "Line " << __LINE__ << ": " << FileSize(filename)
+              << " bytes for " << FileSize(treFilename) << " in .tre"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A long regular tube compresses to less than a byte per point, and is
+  // read back.
+  const vtkIdType numberOfPoints = 100000;
+  vtkNew<vtkPolyData> regularTube;
+  vtkNew<vtkPoints> regularPoints;
+  regularPoints->SetDataTypeToDouble();
+  vtkNew<vtkCellArray> regularLines;
+  vtkNew<vtkDoubleArray> regularRadius;
+  regularRadius->SetName("TubeRadius");
+  regularLines->InsertNextCell(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+    regularLines->InsertCellPoint(
+      regularPoints->InsertNextPoint(0.5 * i, 1., -2.));
+    regularRadius->InsertNextValue(1.5);
+    }
+  regularTube->SetPoints(regularPoints.GetPointer());
+  regularTube->SetLines(regularLines.GetPointer());
+  regularTube->GetPointData()->AddArray(regularRadius.GetPointer());
+  writer->SetInput(regularTube.GetPointer());
+  writer->SetLossless(false);
+  if (!writer->Write() || FileSize(filename) >= numberOfPoints ||
+      !reader->Read() ||
+      !CloseArrays(regularPoints->GetData(),
+                   reader->GetOutput()->GetPoints()->GetData(), 1e-9,
+                   "Points") ||
+      !CloseArrays(regularLines->GetData(),
+                   reader->GetOutput()->GetLines()->GetData(), 0., "Lines"))
+    {
+    std::cerr << "Line " << __LINE__ << ": regular tube of "
+              << FileSize(filename) << " bytes not read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Corrupted files are rejected.
+  {
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+  file << "TRC1 not a tube file";
+  }
+  if (reader->Read())
+    {
+    std::cerr << "Line " << __LINE__ << ": corrupted file read"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,527 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+#include <vtkSpatialObjectsTreReader.h>
+#include <vtkSpatialObjectsTreWriter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tube i has 3 + i points with values that need all their digits, its
+// parent is tube i - 1. "Curvature" and "Flow" are additional arrays.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  vtkNew<vtkCellArray> lines;
+  const char* names[] = {"TubeIDs", "TubeRadius", "Medialness", "Ridgeness",
+                         "Tan1", "Tan2", "Curvature", "Flow"};
+  const int components[] = {1, 1, 1, 1, 3, 3, 1, 2};
+  for (int a = 0; a < 8; ++a)
+    {
+    vtkNew<vtkDoubleArray> array;
+    array->SetName(names[a]);
+    array->SetNumberOfComponents(components[a]);
+    polyData->GetPointData()->AddArray(array.GetPointer());
+    }
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3 + i);
+    for (int j = 0; j < 3 + i; ++j)
+      {
+      const double value = (i + 1) / 3. + j / 7.;
+      lines->InsertCellPoint(points->InsertNextPoint(j + 0.1, value, -i));
+      for (int a = 0; a < 8; ++a)
+        {
+        vtkDataArray* array = polyData->GetPointData()->GetArray(a);
+        for (int k = 0; k < components[a]; ++k)
+          {
+          array->InsertNextTuple1(a == 0 ? 10 + i : value * (a + k) * 1e-3);
+          }
+        }
+      }
+    tubeParentIDs->InsertNextValue(i == 0 ? -1 : 10 + i - 1);
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool CheckParse(const char* text, double expected, int line)
+{
+  double value = 0.;
+  const char* end = text + strlen(text);
+  if (vtkSpatialObjectsTreReader::ParseValue(text, end, value) != end ||
+      value != expected)
+    {
+    std::cerr << "Line " << line << ": " << text << " parsed as " << value
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SameArrays(vtkDataArray* array, vtkDataArray* other, const char* name)
+{
+  if (!array || !other ||
+      array->GetNumberOfTuples() != other->GetNumberOfTuples() ||
+      array->GetNumberOfComponents() != other->GetNumberOfComponents())
+    {
+    std::cerr << name << ": missing array or wrong size" << std::endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < array->GetNumberOfTuples(); ++i)
+    {
+    for (int k = 0; k < array->GetNumberOfComponents(); ++k)
+      {
+      if (array->GetComponent(i, k) != other->GetComponent(i, k))
+        {
+        std::cerr << name << ": value " << i << " is "
+                  << other->GetComponent(i, k) << " instead of "
+                  << array->GetComponent(i, k) << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SamePolyData(vtkPolyData* polyData, vtkPolyData* other)
+{
+  const char* pointArrays[] = {"TubeIDs", "TubeRadius", "Medialness",
+                               "Ridgeness", "Tan1", "Tan2", "Curvature",
+                               "Flow"};
+  bool same =
+    SameArrays(polyData->GetPoints()->GetData(),
+               other->GetPoints()->GetData(), "Points") &&
+    SameArrays(polyData->GetLines()->GetData(),
+               other->GetLines()->GetData(), "Lines") &&
+    SameArrays(polyData->GetCellData()->GetArray("TubeParentIDs"),
+               other->GetCellData()->GetArray("TubeParentIDs"),
+               "TubeParentIDs");
+  for (int a = 0; a < 8 && same; ++a)
+    {
+    same = SameArrays(polyData->GetPointData()->GetArray(pointArrays[a]),
+                      other->GetPointData()->GetArray(pointArrays[a]),
+                      pointArrays[a]);
+    }
+  return same;
+}
+
+//-----------------------------------------------------------------------------
+std::string ReadFile(const std::string& filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSpatialObjectsTreReaderTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string directory(argv[1]);
+
+  if (!CheckParse("42", 42., __LINE__) ||
+      !CheckParse("-0.125", -0.125, __LINE__) ||
+      !CheckParse("0.1", 0.1, __LINE__) ||
+      !CheckParse("1.5e-3", 1.5e-3, __LINE__) ||
+      !CheckParse("0.33333333333333331", 1. / 3., __LINE__) ||
+      !CheckParse("12345678901234567890", 12345678901234567890., __LINE__) ||
+      !CheckParse("2.2250738585072014e-308", 2.2250738585072014e-308,
+                  __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  double value = 0.;
+  const char text[] = "x1";
+  if (vtkSpatialObjectsTreReader::ParseValue(text, text + 2, value) != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": x1 parsed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // What the writer writes is read back exactly, by any number of threads.
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 9);
+  const std::string filename =
+    directory + "/vtkSpatialObjectsTreReaderTest1.tre";
+  vtkNew<vtkSpatialObjectsTreWriter> writer;
+  writer->SetInput(polyData.GetPointer());
+  writer->SetFileName(filename.c_str());
+  if (!writer->Write())
+    {
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkSpatialObjectsTreReader> reader;
+  reader->SetFileName(filename.c_str());
+  for (int threads = 1; threads <= 4; threads += 3)
+    {
+    reader->SetNumberOfThreads(threads);
+    if (!reader->Read() ||
+        !SamePolyData(polyData.GetPointer(), reader->GetOutput()))
+      {
+      std::cerr << "Line " << __LINE__ << ": " << threads << " threads"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The storage node reads it without the ITK objects when the node does
+  // not keep them.
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetSpatialObjectPolicyToRelease();
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->SetFileName(filename.c_str());
+  if (!storageNode->ReadData(node.GetPointer()) ||
+      !SamePolyData(polyData.GetPointer(), node->GetPolyData()))
+    {
+    std::cerr << "Line " << __LINE__ << ": failed to read " << filename
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Partial read: the tubes are straight, tube i is (2 + i) * 1.0102 long
+  // and at z = -i: tubes 3 to 6 are selected and decimated to 2 points,
+  // the first and last ones (point 17 of the polydata for tube 3).
+  vtkNew<vtkSpatialObjectsTreReader> optionsReader;
+  optionsReader->SetFileName(filename.c_str());
+  optionsReader->SetPointDataArrays(
+    vtkSpatialObjectsTreReader::TubeRadiusArray);
+  optionsReader->SetMinimumNumberOfPoints(5);
+  optionsReader->SetMinimumTubeLength(4.5);
+  const double roi[6] = {-10., 10., -10., 10., -6.5, -0.5};
+  optionsReader->SetROI(const_cast<double*>(roi));
+  optionsReader->UseROIOn();
+  optionsReader->SetDecimationTolerance(1e-6);
+  vtkPolyData* reduced = optionsReader->GetOutput();
+  double lastPoint[3];
+  if (!optionsReader->Read() ||
+      reduced->GetNumberOfLines() != 4 || reduced->GetNumberOfPoints() != 8)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong tubes read with options"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  reduced->GetPoint(1, lastPoint);
+  if (reduced->GetPointData()->GetArray("TubeIDs")->GetTuple1(1) != 13. ||
+      lastPoint[0] != polyData->GetPoint(3 + 4 + 5 + 5)[0] ||
+      reduced->GetPointData()->GetArray("TubeRadius")->GetTuple1(1) !=
+        polyData->GetPointData()->GetArray("TubeRadius")->GetTuple1(
+          3 + 4 + 5 + 5) ||
+      reduced->GetPointData()->GetArray("Tan1") ||
+      reduced->GetPointData()->GetArray("Medialness") ||
+      reduced->GetPointData()->GetArray("Ridgeness") ||
+      reduced->GetPointData()->GetArray("Curvature"))
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong data read with options"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The storage node reads with its options whatever the node policy.
+  vtkNew<vtkMRMLSpatialObjectsNode> reducedNode;
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> optionsStorageNode;
+  optionsStorageNode->SetFileName(filename.c_str());
+  optionsStorageNode->SetMinimumNumberOfPoints(5);
+  if (!optionsStorageNode->HasReadOptions() ||
+      !optionsStorageNode->ReadData(reducedNode.GetPointer()) ||
+      reducedNode->GetPolyData()->GetNumberOfLines() != 7)
+    {
+    std::cerr << "Line " << __LINE__ << ": storage node options ignored"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Saving the reduced tubes leaves the file unchanged: they are written
+  // to a new file, read back without options.
+  const std::string fileContent = ReadFile(filename);
+  if (!optionsStorageNode->WriteData(reducedNode.GetPointer()) ||
+      ReadFile(filename) != fileContent ||
+      !optionsStorageNode->GetFileName() ||
+      filename == optionsStorageNode->GetFileName() ||
+      optionsStorageNode->HasReadOptions())
+    {
+    std::cerr << "Line " << __LINE__ << ": " << filename
+              << " overwritten by the reduced tubes" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkMRMLSpatialObjectsNode> partialNode;
+  if (!optionsStorageNode->ReadData(partialNode.GetPointer()) ||
+      partialNode->GetPolyData()->GetNumberOfLines() != 7)
+    {
+    std::cerr << "Line " << __LINE__ << ": failed to read "
+              << optionsStorageNode->GetFileName() << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::remove(optionsStorageNode->GetFileName());
+
+  // The tube index is written by the first read, then used to read the
+  // tubes by ID or by region; an index out of date is rebuilt.
+  const std::string indexFilename = filename + ".idx";
+  vtkNew<vtkSpatialObjectsTreReader> indexReader;
+  indexReader->SetFileName(filename.c_str());
+  indexReader->SetIndexFileName(indexFilename.c_str());
+  for (int pass = 0; pass < 3; ++pass)
+    {
+    if (pass == 2)
+      {
+      std::ofstream index(indexFilename.c_str(), std::ios::out);
+      index << "SpatialObjectsTubeIndex 1\nFileSize = 1\n";
+      }
+    else if (pass == 0)
+      {
+      std::remove(indexFilename.c_str());
+      }
+    if (!indexReader->Read() ||
+        !SamePolyData(polyData.GetPointer(), indexReader->GetOutput()) ||
+        !std::ifstream(indexFilename.c_str()))
+      {
+      std::cerr << "Line " << __LINE__ << ": failed to index " << filename
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  vtkNew<vtkIdList> tubeIDs;
+  tubeIDs->InsertNextId(12);
+  tubeIDs->InsertNextId(15);
+  indexReader->SetTubeIDs(tubeIDs.GetPointer());
+  vtkPolyData* indexed = indexReader->GetOutput();
+  if (!indexReader->Read() ||
+      indexed->GetNumberOfLines() != 2 || indexed->GetNumberOfPoints() != 13 ||
+      indexed->GetPointData()->GetArray("TubeIDs")->GetTuple1(0) != 12. ||
+      indexed->GetPointData()->GetArray("TubeIDs")->GetTuple1(12) != 15.)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong tubes read by ID"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  indexReader->SetTubeIDs(0);
+  const double slab[6] = {-10., 10., -10., 10., -2.5, -1.5};
+  indexReader->SetROI(const_cast<double*>(slab));
+  indexReader->UseROIOn();
+  if (!indexReader->Read() ||
+      indexed->GetNumberOfLines() != 1 || indexed->GetNumberOfPoints() != 5 ||
+      indexed->GetPointData()->GetArray("TubeIDs")->GetTuple1(0) != 12.)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong tubes read by region"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // An ITK file: a group, a tube with duplicate points, an element
+  // spacing and no normals, and a tube of 1 point.
+  std::string content =
+    "ObjectType = Scene\nNDims = 3\nNObjects = 3\n"
+    "ObjectType = Group\nNDims = 3\nID = 0\n"
+    "ObjectType = Tube\nObjectSubTypeName = Vessel\nNDims = 3\n"
+    "ID = 3\nParentID = 0\nElementSpacing = 1 2 1\n"
+    "PointDim = x y z r rn mn bn mk v1x v1y v1z v2x v2y v2z tx ty tz "
+    "a1 a2 a3 red green blue alpha id\nNPoints = 4\nPoints = \n"
+    "0 0 0 1 0 0.5 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 1 0\n"
+    "1 0 0 2 0 0.5 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 1 1\n"
+    "1 0 0 2 0 0.5 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 1 2\n"
+    "2 1 0 3 0 0.5 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0 1 3\n"
+    "ObjectType = Tube\nObjectSubTypeName = Vessel\nNDims = 3\n"
+    "ID = 4\nParentID = 3\nPointDim = x y z r\n"
+    "NPoints = 1\nPoints = \n5 5 5 1\n";
+  const std::string itkFilename =
+    directory + "/vtkSpatialObjectsTreReaderTest1_itk.tre";
+  const std::string crlfFilename =
+    directory + "/vtkSpatialObjectsTreReaderTest1_crlf.tre";
+  {
+  std::ofstream file(itkFilename.c_str(), std::ios::out | std::ios::binary);
+  file << content;
+  for (std::string::size_type i = content.find('\n');
+       i != std::string::npos; i = content.find('\n', i + 2))
+    {
+    content.insert(i, "\r");
+    }
+  std::ofstream crlfFile(crlfFilename.c_str(),
+                         std::ios::out | std::ios::binary);
+  crlfFile << content;
+  }
+  vtkNew<vtkSpatialObjectsTreReader> crlfReader;
+  crlfReader->SetFileName(crlfFilename.c_str());
+  if (!crlfReader->Read() ||
+      crlfReader->GetOutput()->GetNumberOfLines() != 1 ||
+      crlfReader->GetOutput()->GetNumberOfPoints() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": failed to read " << crlfFilename
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  reader->SetFileName(itkFilename.c_str());
+  if (!reader->Read())
+    {
+    return EXIT_FAILURE;
+    }
+  vtkPolyData* output = reader->GetOutput();
+  vtkDataArray* tan1 = output->GetPointData()->GetArray("Tan1");
+  vtkDataArray* tan2 = output->GetPointData()->GetArray("Tan2");
+  double point[3];
+  output->GetPoint(2, point);
+  if (output->GetNumberOfLines() != 1 || output->GetNumberOfPoints() != 3 ||
+      point[0] != 2. || point[1] != 2. ||
+      output->GetPointData()->GetArray("TubeIDs")->GetTuple1(0) != 3. ||
+      output->GetPointData()->GetArray("TubeRadius")->GetTuple1(2) != 3. ||
+      !output->GetPointData()->GetArray("Medialness") ||
+      output->GetPointData()->GetArray("Ridgeness") ||
+      output->GetCellData()->GetArray("TubeParentIDs")->GetTuple1(0) != 0. ||
+      !tan1 || !tan2 ||
+      std::fabs(vtkMath::Norm(tan1->GetTuple3(1)) - 1.) > 1e-6 ||
+      std::fabs(vtkMath::Norm(tan2->GetTuple3(1)) - 1.) > 1e-6 ||
+      std::fabs(vtkMath::Dot(tan1->GetTuple3(1), tan2->GetTuple3(1))) > 1e-6)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong tubes read from "
+              << itkFilename << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Same tubes as the ITK reader
+  vtkNew<vtkMRMLSpatialObjectsNode> itkNode;
+  storageNode->SetFileName(itkFilename.c_str());
+  if (!storageNode->ReadData(itkNode.GetPointer()) ||
+      itkNode->GetPolyData()->GetNumberOfLines() != 1 ||
+      itkNode->GetPolyData()->GetNumberOfPoints() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": ITK read different tubes"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (vtkIdType i = 0; i < 3; ++i)
+    {
+    if (vtkMath::Distance2BetweenPoints(output->GetPoint(i),
+          itkNode->GetPolyData()->GetPoint(i)) > 1e-10)
+      {
+      std::cerr << "Line " << __LINE__ << ": point " << i
+                << " differs from ITK" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The tubes are listed in the ITK order: depth first in the hierarchy,
+  // tube 5 listed before its parent 7 is read after it.
+  {
+  std::ofstream file(itkFilename.c_str(), std::ios::out | std::ios::binary);
+  file << "ObjectType = Scene\nNDims = 3\nNObjects = 6\n"
+       << "ObjectType = Group\nNDims = 3\nID = 0\n";
+  const int ids[][2] = {{5, 7}, {7, 0}, {6, 0}, {8, 5}, {9, 7}};
+  for (int t = 0; t < 5; ++t)
+    {
+    file << "ObjectType = Tube\nNDims = 3\nID = " << ids[t][0]
+         << "\nParentID = " << ids[t][1]
+         << "\nPointDim = x y z r\nNPoints = 2\nPoints = \n"
+         << ids[t][0] << " 0 0 1\n" << ids[t][0] << " 1 0 2\n";
+    }
+  }
+  if (!reader->Read() ||
+      !storageNode->ReadData(itkNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": failed to read " << itkFilename
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int itkOrder[] = {7, 5, 8, 9, 6};
+  vtkPolyData* itkOutput = itkNode->GetPolyData();
+  if (output->GetNumberOfLines() != 5 || itkOutput->GetNumberOfLines() != 5 ||
+      output->GetNumberOfPoints() != itkOutput->GetNumberOfPoints())
+    {
+    std::cerr << "Line " << __LINE__ << ": ITK read different tubes"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (vtkIdType i = 0; i < output->GetNumberOfPoints(); ++i)
+    {
+    const double tubeId =
+      output->GetPointData()->GetArray("TubeIDs")->GetTuple1(i);
+    const double itkTubeId =
+      itkOutput->GetPointData()->GetArray("TubeIDs")->GetTuple1(i);
+    if (tubeId != itkOrder[i / 2] || tubeId != itkTubeId ||
+        vtkMath::Distance2BetweenPoints(output->GetPoint(i),
+          itkOutput->GetPoint(i)) > 1e-10)
+      {
+      std::cerr << "Line " << __LINE__ << ": point " << i
+                << " differs from ITK" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (!SameArrays(itkOutput->GetCellData()->GetArray("TubeParentIDs"),
+                  output->GetCellData()->GetArray("TubeParentIDs"),
+                  "TubeParentIDs") ||
+      !SameArrays(itkOutput->GetPointData()->GetArray("TubeRadius"),
+                  output->GetPointData()->GetArray("TubeRadius"),
+                  "TubeRadius"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Binary files are left to ITK.
+  {
+  std::ofstream file(itkFilename.c_str(), std::ios::out | std::ios::binary);
+  file << "ObjectType = Tube\nNDims = 3\nBinaryData = True\n"
+       << "PointDim = x y z r\nNPoints = 0\nPoints = \n";
+  }
+  if (reader->Read())
+    {
+    std::cerr << "Line " << __LINE__ << ": binary file read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
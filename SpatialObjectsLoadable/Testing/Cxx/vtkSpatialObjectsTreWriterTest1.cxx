@@ -0,0 +1,384 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+#include <vtkSpatialObjectsTreReader.h>
+#include <vtkSpatialObjectsTreWriter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Tube i has 3 + i points with values that need all their digits, its
+// parent is tube i - 1. "Curvature" and "Flow" are additional arrays.
+void CreateTubes(vtkPolyData* polyData, int numberOfTubes)
+{
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  vtkNew<vtkCellArray> lines;
+  const char* names[] = {"TubeIDs", "TubeRadius", "Medialness", "Ridgeness",
+                         "Tan1", "Tan2", "Curvature", "Flow"};
+  const int components[] = {1, 1, 1, 1, 3, 3, 1, 2};
+  for (int a = 0; a < 8; ++a)
+    {
+    vtkNew<vtkDoubleArray> array;
+    array->SetName(names[a]);
+    array->SetNumberOfComponents(components[a]);
+    polyData->GetPointData()->AddArray(array.GetPointer());
+    }
+  vtkNew<vtkDoubleArray> tubeParentIDs;
+  tubeParentIDs->SetName("TubeParentIDs");
+
+  for (int i = 0; i < numberOfTubes; ++i)
+    {
+    lines->InsertNextCell(3 + i);
+    for (int j = 0; j < 3 + i; ++j)
+      {
+      const double value = (i + 1) / 3. + j / 7.;
+      lines->InsertCellPoint(points->InsertNextPoint(j + 0.1, value, -i));
+      for (int a = 0; a < 8; ++a)
+        {
+        vtkDataArray* array = polyData->GetPointData()->GetArray(a);
+        for (int k = 0; k < components[a]; ++k)
+          {
+          array->InsertNextTuple1(a == 0 ? 10 + i : value * (a + k));
+          }
+        }
+      }
+    tubeParentIDs->InsertNextValue(i == 0 ? -1 : 10 + i - 1);
+    }
+
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->GetCellData()->AddArray(tubeParentIDs.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool CheckFormat(double value, int precision, const char* expected, int line)
+{
+  char buffer[32];
+  vtkSpatialObjectsTreWriter::FormatValue(value, precision, buffer);
+  if ((expected && std::string(buffer) != expected) ||
+      (!expected && strtod(buffer, 0) != value))
+    {
+    std::cerr << "Line " << line << ": " << value << " formatted as "
+              << buffer << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Set a numeric locale with a ',' decimal separator, as Qt does on Unix
+// with the locale of the user. Return false if none is installed.
+bool SetCommaLocale()
+{
+  const char* const locales[] =
+    {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8",
+     "fr_FR", "German", 0};
+  for (int i = 0; locales[i]; ++i)
+    {
+    if (setlocale(LC_NUMERIC, locales[i]) &&
+        strcmp(localeconv()->decimal_point, ",") == 0)
+      {
+      return true;
+      }
+    }
+  setlocale(LC_NUMERIC, "C");
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// First point of each tube, by tube ID.
+std::map<int, vtkIdType> GetFirstPoints(vtkPolyData* polyData)
+{
+  std::map<int, vtkIdType> firstPoints;
+  vtkDataArray* tubeIDs = polyData->GetPointData()->GetArray("TubeIDs");
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  for (polyData->GetLines()->InitTraversal();
+       tubeIDs && polyData->GetLines()->GetNextCell(npts, pts);)
+    {
+    firstPoints[static_cast<int>(tubeIDs->GetComponent(pts[0], 0))] = pts[0];
+    }
+  return firstPoints;
+}
+
+//-----------------------------------------------------------------------------
+// The normals and the additional arrays of \a read are exactly those of
+// \a written.
+bool SameArrays(vtkPolyData* written, vtkPolyData* read)
+{
+  std::map<int, vtkIdType> writtenFirstPoints = GetFirstPoints(written);
+  std::map<int, vtkIdType> readFirstPoints = GetFirstPoints(read);
+  if (writtenFirstPoints.size() != readFirstPoints.size() ||
+      read->GetNumberOfPoints() != written->GetNumberOfPoints())
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong number of tubes or points"
+              << std::endl;
+    return false;
+    }
+  const char* names[] = {"Tan1", "Tan2", "Curvature", "Flow"};
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  for (written->GetLines()->InitTraversal();
+       written->GetLines()->GetNextCell(npts, pts);)
+    {
+    const int tubeId = static_cast<int>(
+      written->GetPointData()->GetArray("TubeIDs")->GetComponent(pts[0], 0));
+    if (readFirstPoints.find(tubeId) == readFirstPoints.end())
+      {
+      std::cerr << "Line " << __LINE__ << ": tube " << tubeId
+                << " not read" << std::endl;
+      return false;
+      }
+    const vtkIdType first = readFirstPoints[tubeId];
+    for (int a = 0; a < 4; ++a)
+      {
+      vtkDataArray* writtenArray = written->GetPointData()->GetArray(names[a]);
+      vtkDataArray* readArray = read->GetPointData()->GetArray(names[a]);
+      if (!readArray ||
+          readArray->GetNumberOfComponents() !=
+            writtenArray->GetNumberOfComponents())
+        {
+        std::cerr << "Line " << __LINE__ << ": wrong array " << names[a]
+                  << std::endl;
+        return false;
+        }
+      for (vtkIdType i = 0; i < npts; ++i)
+        {
+        for (int k = 0; k < writtenArray->GetNumberOfComponents(); ++k)
+          {
+          if (readArray->GetComponent(first + i, k) !=
+              writtenArray->GetComponent(pts[i], k))
+            {
+            std::cerr << "Line " << __LINE__ << ": wrong " << names[a]
+                      << " at point " << i << " of tube " << tubeId
+                      << std::endl;
+            return false;
+            }
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ReadFile(const std::string& filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSpatialObjectsTreWriterTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The values are read back exactly.
+  if (!CheckFormat(-42., 17, "-42", __LINE__) ||
+      !CheckFormat(0., 17, "0", __LINE__) ||
+      !CheckFormat(0.1, 17, 0, __LINE__) ||
+      !CheckFormat(1. / 3., 17, 0, __LINE__) ||
+      !CheckFormat(-1e-300, 17, 0, __LINE__) ||
+      !CheckFormat(1e20, 17, 0, __LINE__) ||
+      !CheckFormat(static_cast<float>(1. / 3.), 9, 0, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkPolyData> polyData;
+  CreateTubes(polyData.GetPointer(), 7);
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetAndObservePolyData(polyData.GetPointer());
+
+  // The threads don't change the file.
+  const std::string directory(argv[1]);
+  vtkNew<vtkSpatialObjectsTreWriter> writer;
+  writer->SetInput(polyData.GetPointer());
+  writer->SetNumberOfThreads(1);
+  writer->SetFileName(
+    (directory + "/vtkSpatialObjectsTreWriterTest1_1.tre").c_str());
+  if (!writer->Write())
+    {
+    return EXIT_FAILURE;
+    }
+  writer->SetNumberOfThreads(4);
+  writer->SetFileName(
+    (directory + "/vtkSpatialObjectsTreWriterTest1_4.tre").c_str());
+  if (!writer->Write())
+    {
+    return EXIT_FAILURE;
+    }
+  const std::string content =
+    ReadFile(directory + "/vtkSpatialObjectsTreWriterTest1_1.tre");
+  if (content.empty() ||
+      content != ReadFile(directory + "/vtkSpatialObjectsTreWriterTest1_4.tre"))
+    {
+    std::cerr << "The files written by 1 and 4 threads differ" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (content.find("PointDim = x y z r rn mn v1x v1y v1z v2x v2y v2z "
+                   "Curvature Flow:0 Flow:1 id\n") == std::string::npos)
+    {
+    std::cerr << "Wrong columns" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The locale does not change the file.
+  if (SetCommaLocale())
+    {
+    const bool formatted = CheckFormat(0.5, 17, "0.5", __LINE__) &&
+      CheckFormat(-0.125, 17, "-0.125", __LINE__);
+    writer->SetFileName(
+      (directory + "/vtkSpatialObjectsTreWriterTest1_comma.tre").c_str());
+    const bool written = writer->Write() != 0;
+    setlocale(LC_NUMERIC, "C");
+    if (!formatted || !written ||
+        content !=
+          ReadFile(directory + "/vtkSpatialObjectsTreWriterTest1_comma.tre"))
+      {
+      std::cerr << "Line " << __LINE__ << ": the file written with a ','"
+                << " decimal separator locale differs" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  else
+    {
+    std::cout << "No ',' decimal separator locale, locale not tested"
+              << std::endl;
+    }
+
+  // The normals and the additional columns are read back exactly.
+  vtkNew<vtkSpatialObjectsTreReader> treReader;
+  treReader->SetFileName(
+    (directory + "/vtkSpatialObjectsTreWriterTest1_4.tre").c_str());
+  if (!treReader->Read() ||
+      !SameArrays(polyData.GetPointer(), treReader->GetOutput()))
+    {
+    std::cerr << "Failed to read back the normals" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The edits are saved and read by ITK.
+  node->SetTubeRadius(2, 5.);
+  const std::string filename =
+    directory + "/vtkSpatialObjectsTreWriterTest1.tre";
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->SetFileName(filename.c_str());
+  if (!storageNode->WriteData(node.GetPointer()))
+    {
+    std::cerr << "Failed to write " << filename << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLSpatialObjectsNode> readNode;
+  if (!storageNode->ReadData(readNode.GetPointer()) ||
+      !readNode->GetPolyData() ||
+      readNode->GetPolyData()->GetNumberOfLines() != 7 ||
+      readNode->GetPolyData()->GetNumberOfPoints() !=
+        polyData->GetNumberOfPoints())
+    {
+    std::cerr << "Failed to read " << filename << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // ITK reads single precision values and orders the tubes by hierarchy.
+  vtkPolyData* written = node->GetPolyData();
+  vtkPolyData* read = readNode->GetPolyData();
+  std::map<int, vtkIdType> writtenFirstPoints;
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  for (written->GetLines()->InitTraversal();
+       written->GetLines()->GetNextCell(npts, pts);)
+    {
+    writtenFirstPoints[static_cast<int>(written->GetPointData()->
+      GetArray("TubeIDs")->GetTuple1(pts[0]))] = pts[0];
+    }
+  const char* arrays[] = {"TubeRadius", "Medialness", "Ridgeness"};
+  vtkIdType cellId = 0;
+  for (read->GetLines()->InitTraversal();
+       read->GetLines()->GetNextCell(npts, pts); ++cellId)
+    {
+    const int tubeId = static_cast<int>(
+      read->GetPointData()->GetArray("TubeIDs")->GetTuple1(pts[0]));
+    const int parentId = static_cast<int>(
+      read->GetCellData()->GetArray("TubeParentIDs")->GetTuple1(cellId));
+    if (writtenFirstPoints.find(tubeId) == writtenFirstPoints.end() ||
+        parentId != (tubeId == 10 ? -1 : tubeId - 1))
+      {
+      std::cerr << "Wrong tube " << tubeId << " parent " << parentId
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    const vtkIdType first = writtenFirstPoints[tubeId];
+    for (vtkIdType i = 0; i < npts; ++i)
+      {
+      double* p = read->GetPoint(pts[i]);
+      double* q = written->GetPoint(first + i);
+      bool same = std::fabs(p[0] - q[0]) + std::fabs(p[1] - q[1]) +
+        std::fabs(p[2] - q[2]) < 1e-5;
+      for (int a = 0; a < 3; ++a)
+        {
+        same = same && std::fabs(
+          read->GetPointData()->GetArray(arrays[a])->GetTuple1(pts[i]) -
+          written->GetPointData()->GetArray(arrays[a])->GetTuple1(first + i))
+          < 1e-5;
+        }
+      if (!same)
+        {
+        std::cerr << "Wrong point " << i << " of tube " << tubeId
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
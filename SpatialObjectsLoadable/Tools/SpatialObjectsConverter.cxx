@@ -0,0 +1,485 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Command line converter and batch processor of spatial objects files,
+// built without Qt on the MRML and Logic libraries of the module.
+//
+// Usage:
+//   SpatialObjectsConverter [options] <file or directory>...
+//
+// Each file, or each .tre and .trc file of a directory, is read, optionally
+// subsampled, then converted, measured and/or voxelized. The files are
+// processed in parallel by a pool of --threads threads. Run with --help
+// for the options.
+
+// SpatialObjects includes
+#include <vtkSlicerSpatialObjectsMeshWriter.h>
+#include <vtkSlicerSpatialObjectsVoxelizer.h>
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkCriticalSection.h>
+#include <vtkImageData.h>
+#include <vtkMetaImageWriter.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// ITK includes
+#include <itksys/CommandLineArguments.hxx>
+#include <itksys/Directory.hxx>
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+struct Options
+{
+  std::string OutputDirectory;
+  std::string Format;
+  std::string Geometry;
+  std::string ScalarArrayName;
+  std::string Morphometrics;
+  double VoxelSpacing;
+  double DecimationTolerance;
+  int SubsamplingStep;
+  int NumberOfThreads;
+  // Threads reading and writing each file: 1 when the files are processed
+  // in parallel, not to run NumberOfThreads times too many threads.
+  int NumberOfFileThreads;
+};
+
+//-----------------------------------------------------------------------------
+// Processing of one input file, its messages and morphometrics rows.
+struct Job
+{
+  std::string FileName;
+  std::string Log;
+  std::string Rows;
+  bool Success;
+};
+
+//-----------------------------------------------------------------------------
+// Jobs shared by the threads, each thread takes the next one.
+struct JobPool
+{
+  const Options* Settings;
+  std::vector<Job> Jobs;
+  size_t NextJob;
+  vtkSimpleCriticalSection Lock;
+};
+
+//-----------------------------------------------------------------------------
+// Keep every step-th point of each tube and its last point.
+vtkSmartPointer<vtkPolyData> Subsample(vtkPolyData* input, int step)
+{
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetDataType(input->GetPoints()->GetDataType());
+  vtkNew<vtkCellArray> lines;
+  output->GetPointData()->CopyAllocate(input->GetPointData());
+  output->GetCellData()->CopyAllocate(input->GetCellData());
+
+  vtkCellArray* inputLines = input->GetLines();
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  vtkIdType lineId = 0;
+  for (inputLines->InitTraversal(); inputLines->GetNextCell(npts, pts);
+       ++lineId)
+    {
+    if (npts == 0)
+      {
+      continue;
+      }
+    const vtkIdType count =
+      (npts - 1) / step + 1 + ((npts - 1) % step ? 1 : 0);
+    lines->InsertNextCell(count);
+    for (vtkIdType j = 0; j < npts; j += step)
+      {
+      const vtkIdType pointId = points->InsertNextPoint(
+        input->GetPoint(pts[j]));
+      output->GetPointData()->CopyData(input->GetPointData(), pts[j],
+                                       pointId);
+      lines->InsertCellPoint(pointId);
+      }
+    if ((npts - 1) % step)
+      {
+      const vtkIdType pointId = points->InsertNextPoint(
+        input->GetPoint(pts[npts - 1]));
+      output->GetPointData()->CopyData(input->GetPointData(),
+                                       pts[npts - 1], pointId);
+      lines->InsertCellPoint(pointId);
+      }
+    output->GetCellData()->CopyData(input->GetCellData(), lineId,
+                                    lines->GetNumberOfCells() - 1);
+    }
+  output->SetPoints(points.GetPointer());
+  output->SetLines(lines.GetPointer());
+  return output;
+}
+
+//-----------------------------------------------------------------------------
+// One row per tube: file, tube, id, parent_id, order, points, length,
+// mean_radius, children.
+std::string Measure(const std::string& fileName,
+                    vtkMRMLSpatialObjectsNode* node)
+{
+  std::ostringstream rows;
+  rows.precision(9);
+  for (vtkIdType tube = 0; tube < node->GetNumberOfTubes(); ++tube)
+    {
+    vtkIdType firstPointId = 0;
+    vtkIdType numberOfPoints = 0;
+    node->GetTubePoints(tube, firstPointId, numberOfPoints);
+    rows << "\"" << fileName << "\"," << tube << ","
+         << node->GetTubeIdentifier(tube) << ","
+         << node->GetTubeParentIdentifier(tube) << ","
+         << node->GetTubeOrder(tube) << "," << numberOfPoints << ","
+         << node->GetTubeLength(tube) << ","
+         << node->GetTubeMeanRadius(tube) << ","
+         << node->GetNumberOfTubeChildren(tube) << "\n";
+    }
+  return rows.str();
+}
+
+//-----------------------------------------------------------------------------
+bool ProcessFile(const Options& options, Job& job)
+{
+  std::ostringstream log;
+  const std::string& fileName = job.FileName;
+  std::string directory = options.OutputDirectory;
+  if (directory.empty())
+    {
+    directory = itksys::SystemTools::GetFilenamePath(fileName);
+    }
+  if (!directory.empty())
+    {
+    directory += "/";
+    }
+  const std::string baseName = directory +
+    itksys::SystemTools::GetFilenameWithoutLastExtension(fileName);
+
+  // Read, without keeping the ITK objects nor writing the tube index
+  // next to the input.
+  vtkNew<vtkMRMLSpatialObjectsNode> node;
+  node->SetSpatialObjectPolicyToRelease();
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> storageNode;
+  storageNode->SetFileName(fileName.c_str());
+  storageNode->UseTubeIndexOff();
+  storageNode->SetNumberOfThreads(options.NumberOfFileThreads);
+  storageNode->SetDecimationTolerance(options.DecimationTolerance);
+  if (!storageNode->ReadData(node.GetPointer()) || !node->GetPolyData())
+    {
+    log << fileName << ": can't be read\n";
+    job.Log = log.str();
+    return false;
+    }
+  if (options.SubsamplingStep > 1)
+    {
+    node->SetAndObservePolyData(
+      Subsample(node->GetPolyData(), options.SubsamplingStep));
+    }
+  log << fileName << ": " << node->GetNumberOfTubes() << " tubes, "
+      << node->GetPolyData()->GetNumberOfPoints() << " points\n";
+
+  if (!options.Morphometrics.empty())
+    {
+    job.Rows = Measure(fileName, node.GetPointer());
+    }
+
+  bool success = true;
+  if (options.VoxelSpacing > 0.)
+    {
+    const std::string imageFileName = baseName + ".mha";
+    vtkNew<vtkSlicerSpatialObjectsVoxelizer> voxelizer;
+    voxelizer->SetInput(node->GetPolyData());
+    voxelizer->SetSpacing(options.VoxelSpacing, options.VoxelSpacing,
+                          options.VoxelSpacing);
+    if (voxelizer->Update())
+      {
+      vtkNew<vtkMetaImageWriter> imageWriter;
+      imageWriter->SetInput(voxelizer->GetOutput());
+      imageWriter->SetFileName(imageFileName.c_str());
+      imageWriter->Write();
+      }
+    if (!itksys::SystemTools::FileExists(imageFileName.c_str(), true))
+      {
+      log << imageFileName << ": can't be written\n";
+      success = false;
+      }
+    }
+
+  if (!options.Format.empty())
+    {
+    const std::string outputFileName = baseName + options.Format;
+    int written = 0;
+    if (itksys::SystemTools::CollapseFullPath(outputFileName.c_str()) ==
+        itksys::SystemTools::CollapseFullPath(fileName.c_str()))
+      {
+      log << outputFileName << ": would overwrite the input\n";
+      }
+    else if (options.Format == ".ply" || options.Format == ".glb")
+      {
+      vtkNew<vtkSlicerSpatialObjectsMeshWriter> meshWriter;
+      meshWriter->SetInput(node->GetPolyData());
+      meshWriter->SetFileName(outputFileName.c_str());
+      meshWriter->SetGeometry(
+        options.Geometry == "lines" ? vtkSlicerSpatialObjectsMeshWriter::Lines :
+        options.Geometry == "glyphs" ?
+          vtkSlicerSpatialObjectsMeshWriter::Glyphs :
+          vtkSlicerSpatialObjectsMeshWriter::Tubes);
+      if (!options.ScalarArrayName.empty())
+        {
+        meshWriter->SetScalarArrayName(options.ScalarArrayName.c_str());
+        }
+      written = meshWriter->Write();
+      }
+    else
+      {
+      storageNode->SetFileName(outputFileName.c_str());
+      written = storageNode->WriteData(node.GetPointer());
+      }
+    if (written)
+      {
+      log << outputFileName << ": written\n";
+      }
+    else
+      {
+      log << outputFileName << ": can't be written\n";
+      success = false;
+      }
+    }
+
+  job.Log = log.str();
+  return success;
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ProcessFilesThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  JobPool* pool = static_cast<JobPool*>(info->UserData);
+  while (true)
+    {
+    pool->Lock.Lock();
+    const size_t jobIndex = pool->NextJob++;
+    pool->Lock.Unlock();
+    if (jobIndex >= pool->Jobs.size())
+      {
+      break;
+      }
+    Job& job = pool->Jobs[jobIndex];
+    job.Success = ProcessFile(*pool->Settings, job);
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//-----------------------------------------------------------------------------
+// Add the file, or the .tre and .trc files of the directory.
+void AddInput(const std::string& path, std::vector<Job>& jobs)
+{
+  Job job;
+  job.Success = false;
+  if (!itksys::SystemTools::FileIsDirectory(path.c_str()))
+    {
+    job.FileName = path;
+    jobs.push_back(job);
+    return;
+    }
+  itksys::Directory directory;
+  directory.Load(path.c_str());
+  std::vector<std::string> fileNames;
+  for (unsigned long i = 0; i < directory.GetNumberOfFiles(); ++i)
+    {
+    const std::string fileName = directory.GetFile(i);
+    const std::string extension =
+      itksys::SystemTools::GetFilenameLastExtension(fileName);
+    if (extension == ".tre" || extension == ".trc")
+      {
+      fileNames.push_back(path + "/" + fileName);
+      }
+    }
+  std::sort(fileNames.begin(), fileNames.end());
+  for (size_t i = 0; i < fileNames.size(); ++i)
+    {
+    job.FileName = fileNames[i];
+    jobs.push_back(job);
+    }
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  Options options;
+  options.VoxelSpacing = 0.;
+  options.DecimationTolerance = 0.;
+  options.SubsamplingStep = 1;
+  options.NumberOfThreads =
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  bool help = false;
+
+  typedef itksys::CommandLineArguments Arguments;
+  Arguments arguments;
+  arguments.Initialize(argc, argv);
+  arguments.StoreUnusedArguments(true);
+  arguments.AddBooleanArgument("--help", &help, "Print this help.");
+  arguments.AddArgument("--output-directory", Arguments::SPACE_ARGUMENT,
+    &options.OutputDirectory,
+    "Directory of the output files, the directory of each input file by "
+    "default.");
+  arguments.AddArgument("--format", Arguments::SPACE_ARGUMENT,
+    &options.Format,
+    "Convert the files to .tre, .trc, .ply or .glb.");
+  arguments.AddArgument("--geometry", Arguments::SPACE_ARGUMENT,
+    &options.Geometry,
+    "Mesh written in .ply and .glb: lines, tubes (default) or glyphs.");
+  arguments.AddArgument("--scalars", Arguments::SPACE_ARGUMENT,
+    &options.ScalarArrayName,
+    "Point data array written with the .ply and .glb vertices.");
+  arguments.AddArgument("--morphometrics", Arguments::SPACE_ARGUMENT,
+    &options.Morphometrics,
+    "Write the ID, parent, order, number of points, length, mean radius "
+    "and number of children of each tube to this CSV file.");
+  arguments.AddArgument("--voxelize", Arguments::SPACE_ARGUMENT,
+    &options.VoxelSpacing,
+    "Rasterize the tubes into a .mha label map of this spacing.");
+  arguments.AddArgument("--subsample", Arguments::SPACE_ARGUMENT,
+    &options.SubsamplingStep,
+    "Keep one point every n points of each tube, and its last point.");
+  arguments.AddArgument("--decimate", Arguments::SPACE_ARGUMENT,
+    &options.DecimationTolerance,
+    "Drop the .tre points within this tolerance of their neighbors, see "
+    "vtkSpatialObjectsTreReader.");
+  arguments.AddArgument("--threads", Arguments::SPACE_ARGUMENT,
+    &options.NumberOfThreads,
+    "Number of files processed in parallel, the number of processors by "
+    "default.");
+
+  if (!arguments.Parse())
+    {
+    std::cerr << "Invalid arguments, see --help." << std::endl;
+    return EXIT_FAILURE;
+    }
+  int numberOfInputs = 0;
+  char** inputs = 0;
+  arguments.GetUnusedArguments(&numberOfInputs, &inputs);
+  JobPool pool;
+  pool.Settings = &options;
+  pool.NextJob = 0;
+  // The first unused argument is the program name.
+  for (int i = 1; i < numberOfInputs; ++i)
+    {
+    AddInput(inputs[i], pool.Jobs);
+    }
+  arguments.DeleteRemainingArguments(numberOfInputs, &inputs);
+  if (help || pool.Jobs.empty())
+    {
+    std::cout << "Usage: " << argv[0]
+              << " [options] <file or directory>...\n\n"
+              << "Options:\n" << arguments.GetHelp() << std::endl;
+    return help ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  options.Format = itksys::SystemTools::LowerCase(options.Format);
+  if (!options.Format.empty() && options.Format[0] != '.')
+    {
+    options.Format = "." + options.Format;
+    }
+  if (!options.Format.empty() && options.Format != ".tre" &&
+      options.Format != ".trc" && options.Format != ".ply" &&
+      options.Format != ".glb")
+    {
+    std::cerr << "Unknown format " << options.Format << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!options.OutputDirectory.empty())
+    {
+    itksys::SystemTools::MakeDirectory(options.OutputDirectory.c_str());
+    }
+
+  vtkNew<vtkMultiThreader> threader;
+  int numberOfThreads = std::max(1, options.NumberOfThreads);
+  if (numberOfThreads > static_cast<int>(pool.Jobs.size()))
+    {
+    numberOfThreads = static_cast<int>(pool.Jobs.size());
+    }
+  options.NumberOfFileThreads = numberOfThreads > 1 ? 1 :
+    vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  if (numberOfThreads > 1)
+    {
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(ProcessFilesThread, &pool);
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    vtkMultiThreader::ThreadInfo info;
+    info.ThreadID = 0;
+    info.UserData = &pool;
+    ProcessFilesThread(&info);
+    }
+
+  // Report in the order of the inputs
+  int numberOfFailures = 0;
+  for (size_t i = 0; i < pool.Jobs.size(); ++i)
+    {
+    (pool.Jobs[i].Success ? std::cout : std::cerr) << pool.Jobs[i].Log;
+    numberOfFailures += pool.Jobs[i].Success ? 0 : 1;
+    }
+  if (!options.Morphometrics.empty())
+    {
+    std::ofstream csv(options.Morphometrics.c_str());
+    csv << "file,tube,id,parent_id,order,points,length,mean_radius,"
+        << "children\n";
+    for (size_t i = 0; i < pool.Jobs.size(); ++i)
+      {
+      csv << pool.Jobs[i].Rows;
+      }
+    if (!csv)
+      {
+      std::cerr << options.Morphometrics << ": can't be written"
+                << std::endl;
+      ++numberOfFailures;
+      }
+    }
+  if (numberOfFailures)
+    {
+    std::cerr << numberOfFailures << " of " << pool.Jobs.size()
+              << " files failed" << std::endl;
+    }
+  return numberOfFailures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -21,6 +21,11 @@
 #include "qMRMLSceneSpatialObjectsModel.h"
 #include "qMRMLSceneDisplayableModel_p.h"
 
+// Qt includes
+#include <QPair>
+#include <QSet>
+#include <QTimer>
+
 // MRML includes
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSpatialObjectsNode.h>
@@ -46,6 +51,11 @@ public:
   int TubeVisibilityColumn;
   int GlyphVisibilityColumn;
 
+  bool DeferItemUpdates;
+  bool ItemUpdateScheduled;
+  /// (node ID, column) of the cells waiting for their update. Nodes are
+  /// referenced by ID as they can be removed before the update happens.
+  QSet<QPair<QString, int> > PendingItems;
 };
 
 //------------------------------------------------------------------------------
@@ -57,6 +67,8 @@ qMRMLSceneSpatialObjectsModelPrivate
   this->TubeVisibilityColumn = -1;
   this->GlyphVisibilityColumn = -1;
   this->ColorColumn = -1;
+  this->DeferItemUpdates = true;
+  this->ItemUpdateScheduled = false;
 }
 
 //------------------------------------------------------------------------------
@@ -137,6 +149,8 @@ QFlags<Qt::ItemFlag> qMRMLSceneSpatialObjectsModel::nodeFlags(vtkMRMLNode* node,
 void qMRMLSceneSpatialObjectsModel
 ::updateItemDataFromNode(QStandardItem* item, vtkMRMLNode* node, int column)
 {
+  Q_D(qMRMLSceneSpatialObjectsModel);
+
   vtkMRMLSpatialObjectsNode *soNode =
     vtkMRMLSpatialObjectsNode::SafeDownCast(node);
   if (!soNode)
@@ -144,61 +158,141 @@ void qMRMLSceneSpatialObjectsModel
     return;
     }
 
+  if (column != this->colorColumn() &&
+      column != this->lineVisibilityColumn() &&
+      column != this->tubeVisibilityColumn() &&
+      column != this->glyphVisibilityColumn())
+    {
+    this->Superclass::updateItemDataFromNode(item, node, column);
+    return;
+    }
+
+  if (!d->DeferItemUpdates || !soNode->GetID())
+    {
+    this->updateSpatialObjectsItem(item, soNode, column);
+    return;
+    }
+
+  // Every modification of the node or of its display nodes ends up here for
+  // each column: only record the cell and update it once, later.
+  d->PendingItems.insert(qMakePair(QString(soNode->GetID()), column));
+  if (!d->ItemUpdateScheduled)
+    {
+    d->ItemUpdateScheduled = true;
+    QTimer::singleShot(0, this, SLOT(updatePendingItems()));
+    }
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneSpatialObjectsModel::updatePendingItems()
+{
+  Q_D(qMRMLSceneSpatialObjectsModel);
+
+  d->ItemUpdateScheduled = false;
+  if (d->PendingItems.isEmpty())
+    {
+    return;
+    }
+  QSet<QPair<QString, int> > pendingItems;
+  pendingItems.swap(d->PendingItems);
+  if (!this->mrmlScene())
+    {
+    return;
+    }
+
+  foreach(const QPair<QString, int>& pendingItem, pendingItems)
+    {
+    vtkMRMLNode* node =
+      this->mrmlScene()->GetNodeByID(pendingItem.first.toLatin1().constData());
+    if (!vtkMRMLSpatialObjectsNode::SafeDownCast(node))
+      {
+      continue;
+      }
+    QStandardItem* item = this->itemFromNode(node, pendingItem.second);
+    if (!item)
+      {
+      continue;
+      }
+    // The item is updated from the node, there is no need to go through
+    // itemChanged() and push its data back to the node. Only the cells that
+    // really changed are repainted.
+    const bool wasBlocking = this->blockSignals(true);
+    const bool changed =
+      this->updateSpatialObjectsItem(item, node, pendingItem.second);
+    this->blockSignals(wasBlocking);
+    if (changed)
+      {
+      const QModelIndex index = item->index();
+      emit dataChanged(index, index);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneSpatialObjectsModel::
+updateSpatialObjectsItem(QStandardItem* item, vtkMRMLNode* node, int column)
+{
+  vtkMRMLSpatialObjectsNode *soNode =
+    vtkMRMLSpatialObjectsNode::SafeDownCast(node);
+  if (!soNode)
+    {
+    return false;
+    }
+
   if (column == this->colorColumn())
     {
     vtkMRMLSpatialObjectsDisplayNode* displayNode =
         soNode->GetTubeDisplayNode();
+    if (!displayNode)
+      {
+      return false;
+      }
 
-    if (displayNode)
+    bool changed = false;
+    double* rgbF = displayNode->GetColor();
+    QColor color =
+      QColor::fromRgbF(rgbF[0], rgbF[1], rgbF[2], displayNode->GetOpacity());
+    if (item->data(Qt::DecorationRole).value<QColor>() != color)
       {
-      double* rgbF = displayNode->GetColor();
-      QColor color =
-        QColor::fromRgbF(rgbF[0], rgbF[1], rgbF[2], displayNode->GetOpacity());
       item->setData(color, Qt::DecorationRole);
+      changed = true;
+      }
+    if (item->toolTip().isEmpty())
+      {
       item->setToolTip("Color");
+      }
 
-      if (displayNode->GetColorMode() ==
-            vtkMRMLSpatialObjectsDisplayNode::colorModeSolid)
-        {
-        item->setEnabled(true);
-        }
-      else
-        {
-        item->setEnabled(false);
-        }
+    const bool enabled = (displayNode->GetColorMode() ==
+                          vtkMRMLSpatialObjectsDisplayNode::colorModeSolid);
+    if (item->isEnabled() != enabled)
+      {
+      item->setEnabled(enabled);
+      changed = true;
       }
+    return changed;
     }
-  else if (column == this->lineVisibilityColumn())
+
+  vtkMRMLSpatialObjectsDisplayNode* displayNode = 0;
+  if (column == this->lineVisibilityColumn())
     {
-    vtkMRMLSpatialObjectsDisplayNode* displayNode =
-      soNode->GetLineDisplayNode();
-    if (displayNode)
-      {
-      this->updateVilibilityFromNode(item, displayNode);
-      }
-  }
+    displayNode = soNode->GetLineDisplayNode();
+    }
   else if (column == this->tubeVisibilityColumn())
     {
-    vtkMRMLSpatialObjectsDisplayNode* displayNode =
-      soNode->GetTubeDisplayNode();
-    if (displayNode)
-      {
-      this->updateVilibilityFromNode(item, displayNode);
-      }
+    displayNode = soNode->GetTubeDisplayNode();
     }
   else if (column == this->glyphVisibilityColumn())
     {
-    vtkMRMLSpatialObjectsDisplayNode* displayNode =
-      soNode->GetGlyphDisplayNode();
-    if (displayNode)
-      {
-      this->updateVilibilityFromNode(item, displayNode);
-      }
+    displayNode = soNode->GetGlyphDisplayNode();
     }
-  else
+  if (!displayNode)
     {
-    this->Superclass::updateItemDataFromNode(item, node, column);
+    return false;
     }
+
+  const qint64 oldIconKey = item->icon().cacheKey();
+  this->updateVilibilityFromNode(item, displayNode);
+  return item->icon().cacheKey() != oldIconKey;
 }
 
 //------------------------------------------------------------------------------
@@ -422,3 +516,28 @@ int qMRMLSceneSpatialObjectsModel::maxColumnId()const
 
   return maxId;
 }
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneSpatialObjectsModel::deferItemUpdates()const
+{
+  Q_D(const qMRMLSceneSpatialObjectsModel);
+  return d->DeferItemUpdates;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneSpatialObjectsModel::setDeferItemUpdates(bool defer)
+{
+  Q_D(qMRMLSceneSpatialObjectsModel);
+  d->DeferItemUpdates = defer;
+  if (!defer)
+    {
+    this->updatePendingItems();
+    }
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSceneSpatialObjectsModel::pendingItemUpdateCount()const
+{
+  Q_D(const qMRMLSceneSpatialObjectsModel);
+  return d->PendingItems.size();
+}
@@ -55,6 +55,14 @@ Q_OBJECT
   Q_PROPERTY (int glyphVisibilityColumn READ glyphVisibilityColumn
               WRITE setGlyphVisibilityColumn)
 
+  /// If true (default), the color and visibility columns are not updated
+  /// when a node is added or modified but once control returns to the
+  /// event loop. All the modifications of a node made in between, e.g.
+  /// while a scene is loaded, result into a single update of the cells
+  /// whose value really changed.
+  Q_PROPERTY (bool deferItemUpdates READ deferItemUpdates
+              WRITE setDeferItemUpdates)
+
 public:
   typedef qMRMLSceneDisplayableModel Superclass;
   qMRMLSceneSpatialObjectsModel(QObject *parent=0);
@@ -72,6 +80,16 @@ public:
   int glyphVisibilityColumn()const;
   void setGlyphVisibilityColumn(int column);
 
+  bool deferItemUpdates()const;
+  void setDeferItemUpdates(bool defer);
+
+  /// Return the number of cells waiting for their deferred update.
+  int pendingItemUpdateCount()const;
+
+public slots:
+  /// Update now the cells whose update has been deferred.
+  void updatePendingItems();
+
 protected:
   qMRMLSceneSpatialObjectsModel(qMRMLSceneSpatialObjectsModelPrivate* pimpl,
                                 QObject *parent=0);
@@ -92,6 +110,12 @@ protected:
                                 vtkMRMLNode* node,
                                 bool slice = false);
 
+  /// Update the cell of a spatial objects column from the node.
+  /// Return true if the data of the item has changed.
+  bool updateSpatialObjectsItem(QStandardItem* item,
+                                vtkMRMLNode* node,
+                                int column);
+
 private:
   Q_DECLARE_PRIVATE(qMRMLSceneSpatialObjectsModel);
   Q_DISABLE_COPY(qMRMLSceneSpatialObjectsModel);
@@ -0,0 +1,659 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QTimer>
+
+// qMRML includes
+#include "qMRMLSpatialObjectsTubeModel.h"
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkPolyData.h>
+
+// STD includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+// Compare two tubes by their value.
+struct TubeValueCompare
+{
+  const std::vector<double>* Values;
+  bool Descending;
+
+  bool operator()(vtkIdType tube, vtkIdType otherTube) const
+  {
+    return this->Descending ?
+      (*this->Values)[otherTube] < (*this->Values)[tube] :
+      (*this->Values)[tube] < (*this->Values)[otherTube];
+  }
+};
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+class qMRMLSpatialObjectsTubeModelPrivate
+{
+  Q_DECLARE_PUBLIC(qMRMLSpatialObjectsTubeModel);
+
+protected:
+  qMRMLSpatialObjectsTubeModel* const q_ptr;
+
+public:
+  qMRMLSpatialObjectsTubeModelPrivate(qMRMLSpatialObjectsTubeModel& object);
+
+  /// Compute the shown tubes and their rows.
+  void buildRows();
+  /// Sort the rows of each parent, and update RowOfTube.
+  void sortRows();
+
+  /// Index of the rows of a parent tube, -1 being the root.
+  vtkIdType group(vtkIdType parentTube)const;
+
+  vtkMRMLSpatialObjectsNode* Node;
+  bool Hierarchical;
+  int SortColumn;
+  Qt::SortOrder SortOrder;
+  int FilterColumn;
+  double FilterMinimum;
+  double FilterMaximum;
+  bool UpdateScheduled;
+  /// Polydata of the node when the rows were built, to ignore the
+  /// PolyDataModifiedEvent that don't change it (e.g. tube masks).
+  vtkPolyData* PolyData;
+  unsigned long PolyDataTime;
+
+  vtkIdType NumberOfTubes;
+  /// The rows under the tube i are Rows[RowOffsets[i]] to
+  /// Rows[RowOffsets[i + 1] - 1]. The top-level rows are under the tube
+  /// NumberOfTubes.
+  std::vector<vtkIdType> RowOffsets;
+  std::vector<vtkIdType> Rows;
+  /// Row of each tube under its parent, -1 if the tube is hidden.
+  std::vector<vtkIdType> RowOfTube;
+  /// Parent of each tube in the model, -1 for the top-level rows.
+  std::vector<vtkIdType> ParentOfTube;
+};
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeModelPrivate::
+qMRMLSpatialObjectsTubeModelPrivate(qMRMLSpatialObjectsTubeModel& object)
+  : q_ptr(&object)
+{
+  this->Node = 0;
+  this->Hierarchical = true;
+  this->SortColumn = -1;
+  this->SortOrder = Qt::AscendingOrder;
+  this->FilterColumn = -1;
+  this->FilterMinimum = 0.;
+  this->FilterMaximum = 0.;
+  this->UpdateScheduled = false;
+  this->PolyData = 0;
+  this->PolyDataTime = 0;
+  this->NumberOfTubes = 0;
+}
+
+//------------------------------------------------------------------------------
+vtkIdType qMRMLSpatialObjectsTubeModelPrivate::group(vtkIdType parentTube)const
+{
+  return parentTube >= 0 ? parentTube : this->NumberOfTubes;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModelPrivate::buildRows()
+{
+  Q_Q(qMRMLSpatialObjectsTubeModel);
+
+  const vtkIdType numberOfTubes =
+    this->Node ? this->Node->GetNumberOfTubes() : 0;
+  this->NumberOfTubes = numberOfTubes;
+  this->PolyData = this->Node ? this->Node->GetPolyData() : 0;
+  this->PolyDataTime = this->PolyData ? this->PolyData->GetMTime() : 0;
+
+  this->ParentOfTube.assign(numberOfTubes, -1);
+  if (this->Hierarchical)
+    {
+    for (vtkIdType tube = 0; tube < numberOfTubes; ++tube)
+      {
+      this->ParentOfTube[tube] = this->Node->GetTubeParent(tube);
+      }
+    }
+
+  // The ancestors of a shown tube are shown.
+  std::vector<char> shown(numberOfTubes, this->FilterColumn < 0 ? 1 : 0);
+  if (this->FilterColumn >= 0)
+    {
+    for (vtkIdType tube = 0; tube < numberOfTubes; ++tube)
+      {
+      const double value = q->value(tube, this->FilterColumn);
+      if (value < this->FilterMinimum || value > this->FilterMaximum)
+        {
+        continue;
+        }
+      for (vtkIdType ancestor = tube; ancestor >= 0 && !shown[ancestor];
+           ancestor = this->ParentOfTube[ancestor])
+        {
+        shown[ancestor] = 1;
+        }
+      }
+    }
+
+  this->RowOffsets.assign(numberOfTubes + 2, 0);
+  for (vtkIdType tube = 0; tube < numberOfTubes; ++tube)
+    {
+    if (shown[tube])
+      {
+      ++this->RowOffsets[this->group(this->ParentOfTube[tube]) + 1];
+      }
+    }
+  for (vtkIdType i = 0; i <= numberOfTubes; ++i)
+    {
+    this->RowOffsets[i + 1] += this->RowOffsets[i];
+    }
+  this->Rows.resize(this->RowOffsets[numberOfTubes + 1]);
+  std::vector<vtkIdType> rowCounts(numberOfTubes + 1, 0);
+  for (vtkIdType tube = 0; tube < numberOfTubes; ++tube)
+    {
+    if (shown[tube])
+      {
+      const vtkIdType parent = this->group(this->ParentOfTube[tube]);
+      this->Rows[this->RowOffsets[parent] + rowCounts[parent]++] = tube;
+      }
+    }
+
+  this->RowOfTube.assign(numberOfTubes, -1);
+  this->sortRows();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModelPrivate::sortRows()
+{
+  Q_Q(qMRMLSpatialObjectsTubeModel);
+
+  std::vector<double> values;
+  TubeValueCompare compare;
+  compare.Values = &values;
+  compare.Descending = (this->SortOrder == Qt::DescendingOrder);
+  if (this->SortColumn >= 0)
+    {
+    values.resize(this->NumberOfTubes);
+    for (vtkIdType tube = 0; tube < this->NumberOfTubes; ++tube)
+      {
+      values[tube] = q->value(tube, this->SortColumn);
+      }
+    }
+
+  for (vtkIdType parent = 0; parent <= this->NumberOfTubes; ++parent)
+    {
+    std::vector<vtkIdType>::iterator begin =
+      this->Rows.begin() + this->RowOffsets[parent];
+    std::vector<vtkIdType>::iterator end =
+      this->Rows.begin() + this->RowOffsets[parent + 1];
+    // Ties are kept in the tube order
+    std::sort(begin, end);
+    if (this->SortColumn >= 0)
+      {
+      std::stable_sort(begin, end, compare);
+      }
+    for (std::vector<vtkIdType>::iterator it = begin; it != end; ++it)
+      {
+      this->RowOfTube[*it] = it - begin;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeModel::qMRMLSpatialObjectsTubeModel(QObject *vparent)
+  : Superclass(vparent)
+  , d_ptr(new qMRMLSpatialObjectsTubeModelPrivate(*this))
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+  d->buildRows();
+}
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeModel::~qMRMLSpatialObjectsTubeModel()
+{}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode* qMRMLSpatialObjectsTubeModel::
+spatialObjectsNode()const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+  return d->Node;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::setSpatialObjectsNode(vtkMRMLNode* node)
+{
+  this->setSpatialObjectsNode(vtkMRMLSpatialObjectsNode::SafeDownCast(node));
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::
+setSpatialObjectsNode(vtkMRMLSpatialObjectsNode* node)
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  if (d->Node == node)
+    {
+    return;
+    }
+
+  qvtkReconnect(d->Node, node,
+                vtkMRMLSpatialObjectsNode::TubesModifiedEvent,
+                this, SLOT(onTubesModified()));
+  qvtkReconnect(d->Node, node,
+                vtkMRMLModelNode::PolyDataModifiedEvent,
+                this, SLOT(onPolyDataModified()));
+  qvtkReconnect(d->Node, node,
+                vtkMRMLSpatialObjectsNode::TubeMasksModifiedEvent,
+                this, SLOT(onTubeMasksModified()));
+  d->Node = node;
+
+  this->updateRows();
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSpatialObjectsTubeModel::hierarchical()const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+  return d->Hierarchical;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::setHierarchical(bool hierarchical)
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+  if (d->Hierarchical == hierarchical)
+    {
+    return;
+    }
+  d->Hierarchical = hierarchical;
+  this->updateRows();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::setFilter(int column,
+                                             double minimum, double maximum)
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+  if (d->FilterColumn == column &&
+      d->FilterMinimum == minimum && d->FilterMaximum == maximum)
+    {
+    return;
+    }
+  d->FilterColumn = column;
+  d->FilterMinimum = minimum;
+  d->FilterMaximum = maximum;
+  this->updateRows();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::clearFilter()
+{
+  this->setFilter(-1, 0., 0.);
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSpatialObjectsTubeModel::filterColumn()const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+  return d->FilterColumn;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::valueRange(int column, double& minimum,
+                                              double& maximum)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  minimum = 0.;
+  maximum = 0.;
+  const vtkIdType numberOfTubes =
+    d->Node ? d->Node->GetNumberOfTubes() : 0;
+  for (vtkIdType tube = 0; tube < numberOfTubes; ++tube)
+    {
+    const double tubeValue = this->value(tube, column);
+    if (tube == 0 || tubeValue < minimum)
+      {
+      minimum = tubeValue;
+      }
+    if (tube == 0 || tubeValue > maximum)
+      {
+      maximum = tubeValue;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+double qMRMLSpatialObjectsTubeModel::value(vtkIdType tubeId, int column)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  if (!d->Node)
+    {
+    return 0.;
+    }
+  switch (column)
+    {
+    case IDColumn:
+      return d->Node->GetTubeIdentifier(tubeId);
+    case ParentIDColumn:
+      return d->Node->GetTubeParentIdentifier(tubeId);
+    case OrderColumn:
+      return d->Node->GetTubeOrder(tubeId);
+    case LengthColumn:
+      return d->Node->GetTubeLength(tubeId);
+    case RadiusColumn:
+      return d->Node->GetTubeMeanRadius(tubeId);
+    default:
+      break;
+    }
+  return 0.;
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSpatialObjectsTubeModel::indexFromTube(vtkIdType tubeId,
+                                                        int column)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  if (tubeId < 0 || tubeId >= d->NumberOfTubes || d->RowOfTube[tubeId] < 0)
+    {
+    return QModelIndex();
+    }
+  return this->createIndex(d->RowOfTube[tubeId], column,
+                           static_cast<quint32>(tubeId));
+}
+
+//------------------------------------------------------------------------------
+vtkIdType qMRMLSpatialObjectsTubeModel::
+tubeFromIndex(const QModelIndex& index)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  if (!index.isValid() || index.model() != this)
+    {
+    return -1;
+    }
+  const vtkIdType tubeId = static_cast<vtkIdType>(index.internalId());
+  return tubeId < d->NumberOfTubes ? tubeId : -1;
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSpatialObjectsTubeModel::index(int row, int column,
+                                                const QModelIndex& parent)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  if (row < 0 || column < 0 || column >= ColumnCount ||
+      (parent.isValid() && parent.column() != 0))
+    {
+    return QModelIndex();
+    }
+  const vtkIdType parentTube =
+    parent.isValid() ? this->tubeFromIndex(parent) : -1;
+  if (parent.isValid() && parentTube < 0)
+    {
+    return QModelIndex();
+    }
+  const vtkIdType group = d->group(parentTube);
+  if (row >= d->RowOffsets[group + 1] - d->RowOffsets[group])
+    {
+    return QModelIndex();
+    }
+  return this->createIndex(row, column,
+    static_cast<quint32>(d->Rows[d->RowOffsets[group] + row]));
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSpatialObjectsTubeModel::parent(const QModelIndex& child)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  const vtkIdType tubeId = this->tubeFromIndex(child);
+  if (tubeId < 0 || d->ParentOfTube[tubeId] < 0)
+    {
+    return QModelIndex();
+    }
+  return this->indexFromTube(d->ParentOfTube[tubeId]);
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSpatialObjectsTubeModel::rowCount(const QModelIndex& parent)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  if (parent.column() > 0)
+    {
+    return 0;
+    }
+  const vtkIdType parentTube =
+    parent.isValid() ? this->tubeFromIndex(parent) : -1;
+  if (parent.isValid() && parentTube < 0)
+    {
+    return 0;
+    }
+  const vtkIdType group = d->group(parentTube);
+  return static_cast<int>(d->RowOffsets[group + 1] - d->RowOffsets[group]);
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSpatialObjectsTubeModel::columnCount(const QModelIndex&)const
+{
+  return ColumnCount;
+}
+
+//------------------------------------------------------------------------------
+QVariant qMRMLSpatialObjectsTubeModel::data(const QModelIndex& index,
+                                            int role)const
+{
+  Q_D(const qMRMLSpatialObjectsTubeModel);
+
+  const vtkIdType tubeId = this->tubeFromIndex(index);
+  // The rows are only updated once control returns to the event loop, the
+  // tube may not exist anymore.
+  if (tubeId < 0 || !d->Node || tubeId >= d->Node->GetNumberOfTubes())
+    {
+    return QVariant();
+    }
+
+  if (role == Qt::TextAlignmentRole && index.column() != IDColumn)
+    {
+    return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+    }
+  if (role == Qt::CheckStateRole && index.column() == IDColumn)
+    {
+    return d->Node->GetTubeVisibility(tubeId) ? Qt::Checked : Qt::Unchecked;
+    }
+  if (role != Qt::DisplayRole && role != Qt::ToolTipRole)
+    {
+    return QVariant();
+    }
+
+  switch (index.column())
+    {
+    case IDColumn:
+      return d->Node->GetTubeIdentifier(tubeId);
+    case ParentIDColumn:
+      {
+      const int parentId = d->Node->GetTubeParentIdentifier(tubeId);
+      return parentId != -1 ? QVariant(parentId) : QVariant();
+      }
+    case OrderColumn:
+      return d->Node->GetTubeOrder(tubeId);
+    case LengthColumn:
+      return QString::number(d->Node->GetTubeLength(tubeId), 'f', 2);
+    case RadiusColumn:
+      return QString::number(d->Node->GetTubeMeanRadius(tubeId), 'f', 3);
+    default:
+      break;
+    }
+  return QVariant();
+}
+
+//------------------------------------------------------------------------------
+QVariant qMRMLSpatialObjectsTubeModel::headerData(int section,
+                                                  Qt::Orientation orientation,
+                                                  int role)const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+    return QVariant();
+    }
+  switch (section)
+    {
+    case IDColumn:
+      return tr("ID");
+    case ParentIDColumn:
+      return tr("Parent");
+    case OrderColumn:
+      return tr("Order");
+    case LengthColumn:
+      return tr("Length");
+    case RadiusColumn:
+      return tr("Radius");
+    default:
+      break;
+    }
+  return QVariant();
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSpatialObjectsTubeModel::setData(const QModelIndex& index,
+                                           const QVariant& value, int role)
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  const vtkIdType tubeId = this->tubeFromIndex(index);
+  if (role != Qt::CheckStateRole || index.column() != IDColumn ||
+      tubeId < 0 || !d->Node || tubeId >= d->Node->GetNumberOfTubes())
+    {
+    return false;
+    }
+  const bool visible = (value.toInt() == Qt::Checked);
+  // dataChanged() is emitted by onTubeMasksModified()
+  if (d->Hierarchical)
+    {
+    d->Node->SetTubeBranchVisibility(tubeId, visible);
+    }
+  else
+    {
+    d->Node->SetTubeVisibility(tubeId, visible);
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+Qt::ItemFlags qMRMLSpatialObjectsTubeModel::flags(const QModelIndex& index)const
+{
+  if (!index.isValid())
+    {
+    return 0;
+    }
+  if (index.column() == IDColumn)
+    {
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+    }
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::sort(int column, Qt::SortOrder order)
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  if (d->SortColumn == column && d->SortOrder == order)
+    {
+    return;
+    }
+
+  // The tubes keep their parent, only the rows move.
+  emit layoutAboutToBeChanged();
+  const QModelIndexList oldIndexes = this->persistentIndexList();
+  d->SortColumn = column;
+  d->SortOrder = order;
+  d->sortRows();
+  QModelIndexList newIndexes;
+  foreach(const QModelIndex& oldIndex, oldIndexes)
+    {
+    newIndexes << this->indexFromTube(this->tubeFromIndex(oldIndex),
+                                      oldIndex.column());
+    }
+  this->changePersistentIndexList(oldIndexes, newIndexes);
+  emit layoutChanged();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::updateRows()
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  d->UpdateScheduled = false;
+  this->beginResetModel();
+  d->buildRows();
+  this->endResetModel();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::onTubesModified()
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  // Coalesce the edits made before control returns to the event loop
+  if (!d->UpdateScheduled)
+    {
+    d->UpdateScheduled = true;
+    QTimer::singleShot(0, this, SLOT(updateRows()));
+    }
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::onPolyDataModified()
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  vtkPolyData* polyData = d->Node ? d->Node->GetPolyData() : 0;
+  if (polyData == d->PolyData &&
+      (!polyData || polyData->GetMTime() == d->PolyDataTime))
+    {
+    return;
+    }
+  this->onTubesModified();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeModel::onTubeMasksModified()
+{
+  Q_D(qMRMLSpatialObjectsTubeModel);
+
+  // A whole branch may have changed, the range makes the views repaint
+  // all their visible items instead of looking up each changed tube.
+  const int rows = this->rowCount();
+  if (rows > 0 && !d->UpdateScheduled)
+    {
+    emit dataChanged(this->index(0, IDColumn),
+                     this->index(rows - 1, IDColumn));
+    }
+}
@@ -0,0 +1,129 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qMRMLSpatialObjectsTubeModel_h
+#define __qMRMLSpatialObjectsTubeModel_h
+
+// Qt includes
+#include <QAbstractItemModel>
+
+// CTK includes
+#include <ctkVTKObject.h>
+
+// VTK includes
+#include <vtkType.h>
+
+#include "qSlicerSpatialObjectsModuleWidgetsExport.h"
+
+class qMRMLSpatialObjectsTubeModelPrivate;
+class vtkMRMLNode;
+class vtkMRMLSpatialObjectsNode;
+
+/// Model listing the tubes of a spatial objects node, one row per tube.
+/// No item is allocated per row: the rows are indices in arrays computed
+/// from the tube attributes of the node
+/// (see vtkMRMLSpatialObjectsNode::GetTubeParent()), and the internal id
+/// of a model index is the tube index.
+/// In hierarchical mode, the tubes are children of their parent tube.
+/// The check box of the ID column shows or hides a tube, and its
+/// descendants in hierarchical mode
+/// (see vtkMRMLSpatialObjectsNode::SetTubeBranchVisibility()).
+/// The rows are sorted and filtered by the model itself, a
+/// QSortFilterProxyModel is not needed (and would not scale).
+class Q_SLICER_MODULE_SPATIALOBJECTS_WIDGETS_EXPORT
+qMRMLSpatialObjectsTubeModel : public QAbstractItemModel
+{
+  Q_OBJECT
+  QVTK_OBJECT
+
+  /// If true (default), the tubes are listed under their parent tube.
+  /// Otherwise all the tubes are top-level rows.
+  Q_PROPERTY(bool hierarchical READ hierarchical WRITE setHierarchical)
+
+public:
+  typedef QAbstractItemModel Superclass;
+  qMRMLSpatialObjectsTubeModel(QObject *parent=0);
+  virtual ~qMRMLSpatialObjectsTubeModel();
+
+  enum Column
+  {
+    IDColumn = 0,
+    ParentIDColumn,
+    OrderColumn,
+    LengthColumn,
+    RadiusColumn,
+    ColumnCount
+  };
+
+  vtkMRMLSpatialObjectsNode* spatialObjectsNode()const;
+
+  bool hierarchical()const;
+  void setHierarchical(bool hierarchical);
+
+  /// Only show the tubes whose value in \a column is in
+  /// [minimum, maximum]. In hierarchical mode, the ancestors of the shown
+  /// tubes are shown too.
+  void setFilter(int column, double minimum, double maximum);
+  void clearFilter();
+  int filterColumn()const;
+
+  /// Return the range of the values of all the tubes in \a column.
+  void valueRange(int column, double& minimum, double& maximum)const;
+
+  /// Value used to sort and filter a tube in \a column.
+  double value(vtkIdType tubeId, int column)const;
+
+  /// Return the index of a tube, an invalid index if the tube is hidden.
+  QModelIndex indexFromTube(vtkIdType tubeId, int column = 0)const;
+  /// Return the tube of an index, -1 if the index is invalid.
+  vtkIdType tubeFromIndex(const QModelIndex& index)const;
+
+  virtual QModelIndex index(int row, int column,
+                            const QModelIndex& parent = QModelIndex())const;
+  virtual QModelIndex parent(const QModelIndex& child)const;
+  virtual int rowCount(const QModelIndex& parent = QModelIndex())const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex())const;
+  virtual QVariant data(const QModelIndex& index,
+                        int role = Qt::DisplayRole)const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation,
+                              int role = Qt::DisplayRole)const;
+  virtual bool setData(const QModelIndex& index, const QVariant& value,
+                       int role = Qt::EditRole);
+  virtual Qt::ItemFlags flags(const QModelIndex& index)const;
+  virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+public slots:
+  void setSpatialObjectsNode(vtkMRMLNode* node);
+  void setSpatialObjectsNode(vtkMRMLSpatialObjectsNode* node);
+
+  /// Recompute the rows from the node now.
+  void updateRows();
+
+protected slots:
+  void onTubesModified();
+  void onPolyDataModified();
+  void onTubeMasksModified();
+
+protected:
+  QScopedPointer<qMRMLSpatialObjectsTubeModelPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qMRMLSpatialObjectsTubeModel);
+  Q_DISABLE_COPY(qMRMLSpatialObjectsTubeModel);
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QHeaderView>
+#include <QItemSelection>
+
+// qMRML includes
+#include "qMRMLSpatialObjectsTubeModel.h"
+#include "qMRMLSpatialObjectsTubeTreeView.h"
+
+// MRML includes
+#include <vtkMRMLSpatialObjectsNode.h>
+
+// VTK includes
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+class qMRMLSpatialObjectsTubeTreeViewPrivate
+{
+  Q_DECLARE_PUBLIC(qMRMLSpatialObjectsTubeTreeView);
+
+protected:
+  qMRMLSpatialObjectsTubeTreeView* const q_ptr;
+
+public:
+  qMRMLSpatialObjectsTubeTreeViewPrivate(
+    qMRMLSpatialObjectsTubeTreeView& object);
+  void init();
+
+  qMRMLSpatialObjectsTubeModel* Model;
+  vtkMRMLSpatialObjectsNode* Node;
+  bool UpdatingSelection;
+};
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeTreeViewPrivate::qMRMLSpatialObjectsTubeTreeViewPrivate(
+  qMRMLSpatialObjectsTubeTreeView& object)
+  : q_ptr(&object)
+{
+  this->Model = 0;
+  this->Node = 0;
+  this->UpdatingSelection = false;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeTreeViewPrivate::init()
+{
+  Q_Q(qMRMLSpatialObjectsTubeTreeView);
+
+  this->Model = new qMRMLSpatialObjectsTubeModel(q);
+  q->setModel(this->Model);
+
+  // All the rows have the same height: the view doesn't have to measure
+  // them, which is what keeps scrolling through 100k rows smooth.
+  q->setUniformRowHeights(true);
+  q->setAllColumnsShowFocus(true);
+  q->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  q->setSelectionBehavior(QAbstractItemView::SelectRows);
+  q->setSortingEnabled(true);
+  q->header()->setSortIndicator(qMRMLSpatialObjectsTubeModel::IDColumn,
+                                Qt::AscendingOrder);
+
+  QObject::connect(q->selectionModel(),
+                   SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
+                   q, SLOT(updateNodeFromSelection()));
+  QObject::connect(this->Model, SIGNAL(modelReset()),
+                   q, SLOT(updateSelectionFromNode()));
+}
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeTreeView::
+qMRMLSpatialObjectsTubeTreeView(QWidget *parentWidget)
+  : Superclass(parentWidget)
+  , d_ptr(new qMRMLSpatialObjectsTubeTreeViewPrivate(*this))
+{
+  Q_D(qMRMLSpatialObjectsTubeTreeView);
+  d->init();
+}
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeTreeView::~qMRMLSpatialObjectsTubeTreeView()
+{}
+
+//------------------------------------------------------------------------------
+qMRMLSpatialObjectsTubeModel* qMRMLSpatialObjectsTubeTreeView::
+tubeModel()const
+{
+  Q_D(const qMRMLSpatialObjectsTubeTreeView);
+  return d->Model;
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsNode* qMRMLSpatialObjectsTubeTreeView::
+spatialObjectsNode()const
+{
+  Q_D(const qMRMLSpatialObjectsTubeTreeView);
+  return d->Node;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeTreeView::setSpatialObjectsNode(vtkMRMLNode* node)
+{
+  this->setSpatialObjectsNode(vtkMRMLSpatialObjectsNode::SafeDownCast(node));
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeTreeView::
+setSpatialObjectsNode(vtkMRMLSpatialObjectsNode* node)
+{
+  Q_D(qMRMLSpatialObjectsTubeTreeView);
+
+  if (d->Node == node)
+    {
+    return;
+    }
+
+  qvtkReconnect(d->Node, node,
+                vtkMRMLSpatialObjectsNode::TubeSelectionModifiedEvent,
+                this, SLOT(updateSelectionFromNode()));
+  d->Node = node;
+
+  // Resetting the model restores the selection.
+  d->Model->setSpatialObjectsNode(node);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeTreeView::updateSelectionFromNode()
+{
+  Q_D(qMRMLSpatialObjectsTubeTreeView);
+
+  if (d->UpdatingSelection)
+    {
+    return;
+    }
+
+  vtkNew<vtkIdTypeArray> tubeIds;
+  if (d->Node)
+    {
+    d->Node->GetSelectedTubes(tubeIds.GetPointer());
+    }
+
+  // Merge the rows of the tubes into ranges, as selecting 10k rows one by
+  // one would be slow.
+  std::vector<std::pair<vtkIdType, int> > rows;
+  rows.reserve(tubeIds->GetNumberOfTuples());
+  for (vtkIdType i = 0; i < tubeIds->GetNumberOfTuples(); ++i)
+    {
+    const QModelIndex index = d->Model->indexFromTube(tubeIds->GetValue(i));
+    if (index.isValid())
+      {
+      rows.push_back(std::make_pair(d->Model->tubeFromIndex(index.parent()),
+                                    index.row()));
+      }
+    }
+  std::sort(rows.begin(), rows.end());
+
+  QItemSelection selection;
+  const int lastColumn = d->Model->columnCount() - 1;
+  for (size_t first = 0; first < rows.size();)
+    {
+    size_t last = first;
+    while (last + 1 < rows.size() &&
+           rows[last + 1].first == rows[first].first &&
+           rows[last + 1].second == rows[last].second + 1)
+      {
+      ++last;
+      }
+    const QModelIndex parent = d->Model->indexFromTube(rows[first].first);
+    selection.select(d->Model->index(rows[first].second, 0, parent),
+                     d->Model->index(rows[last].second, lastColumn, parent));
+    first = last + 1;
+    }
+
+  d->UpdatingSelection = true;
+  this->selectionModel()->select(selection,
+                                 QItemSelectionModel::ClearAndSelect);
+  d->UpdatingSelection = false;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSpatialObjectsTubeTreeView::updateNodeFromSelection()
+{
+  Q_D(qMRMLSpatialObjectsTubeTreeView);
+
+  if (d->UpdatingSelection || !d->Node)
+    {
+    return;
+    }
+
+  vtkNew<vtkIdTypeArray> tubeIds;
+
+  // The selected tubes filtered out of the view stay selected.
+  vtkNew<vtkIdTypeArray> selectedTubeIds;
+  d->Node->GetSelectedTubes(selectedTubeIds.GetPointer());
+  for (vtkIdType i = 0; i < selectedTubeIds->GetNumberOfTuples(); ++i)
+    {
+    const vtkIdType tubeId = selectedTubeIds->GetValue(i);
+    if (!d->Model->indexFromTube(tubeId).isValid())
+      {
+      tubeIds->InsertNextValue(tubeId);
+      }
+    }
+
+  foreach(const QItemSelectionRange& range, this->selectionModel()->selection())
+    {
+    for (int row = range.top(); row <= range.bottom(); ++row)
+      {
+      const vtkIdType tubeId = d->Model->tubeFromIndex(
+        d->Model->index(row, 0, range.parent()));
+      if (tubeId >= 0)
+        {
+        tubeIds->InsertNextValue(tubeId);
+        }
+      }
+    }
+
+  d->UpdatingSelection = true;
+  d->Node->SetSelectedTubes(tubeIds.GetPointer());
+  d->UpdatingSelection = false;
+}
@@ -0,0 +1,70 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qMRMLSpatialObjectsTubeTreeView_h
+#define __qMRMLSpatialObjectsTubeTreeView_h
+
+// Qt includes
+#include <QTreeView>
+
+// CTK includes
+#include <ctkVTKObject.h>
+
+#include "qSlicerSpatialObjectsModuleWidgetsExport.h"
+
+class qMRMLSpatialObjectsTubeModel;
+class qMRMLSpatialObjectsTubeTreeViewPrivate;
+class vtkMRMLNode;
+class vtkMRMLSpatialObjectsNode;
+
+/// \ingroup Slicer_QtModules_SpatialObjects
+/// Tree of the tubes of a spatial objects node, sortable by clicking the
+/// header. The selected rows and the selected tubes of the node
+/// (see vtkMRMLSpatialObjectsNode::SetSelectedTubes()) are kept in sync.
+class Q_SLICER_MODULE_SPATIALOBJECTS_WIDGETS_EXPORT
+qMRMLSpatialObjectsTubeTreeView : public QTreeView
+{
+  Q_OBJECT
+  QVTK_OBJECT
+
+public:
+  typedef QTreeView Superclass;
+  qMRMLSpatialObjectsTubeTreeView(QWidget *parent=0);
+  virtual ~qMRMLSpatialObjectsTubeTreeView();
+
+  qMRMLSpatialObjectsTubeModel* tubeModel()const;
+  vtkMRMLSpatialObjectsNode* spatialObjectsNode()const;
+
+public slots:
+  void setSpatialObjectsNode(vtkMRMLNode* node);
+  void setSpatialObjectsNode(vtkMRMLSpatialObjectsNode* node);
+
+  /// Select the rows of the selected tubes of the node.
+  void updateSelectionFromNode();
+
+protected slots:
+  void updateNodeFromSelection();
+
+protected:
+  QScopedPointer<qMRMLSpatialObjectsTubeTreeViewPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qMRMLSpatialObjectsTubeTreeView);
+  Q_DISABLE_COPY(qMRMLSpatialObjectsTubeTreeView);
+};
+
+#endif
@@ -17,8 +17,12 @@
 
 ==============================================================================*/
 
+// Qt includes
+#include <QMap>
+
 // qMRML includes
 #include "qSlicerSpatialObjectsGlyphWidget.h"
+#include "qSlicerSpatialObjectsUpdateThrottler.h"
 #include "ui_qSlicerSpatialObjectsGlyphWidget.h"
 
 // MRML includes
@@ -41,9 +45,37 @@ public:
   void init();
   bool centeredOrigin(double* origin) const;
 
+  /// Record the value of a slider being dragged, it is pushed to MRML by
+  /// the throttler.
+  void setPendingValue(int property, double value);
+  /// The final value of property has been pushed, leave the preview mode
+  /// if no other property is pending.
+  void finishPendingValue(int property);
+  /// Push the value of property to MRML with the setters of the display
+  /// node, which don't modify the other display nodes.
+  void setProperty(int property, double value);
+  double property(int property) const;
+  /// Give the display node a properties node of its own before property
+  /// is set to a different value, if it shares it with other display nodes.
+  /// To be called before the modifications of the properties node are
+  /// batched.
+  void detachSharedProperties(int property, double value);
+
+  enum
+  {
+    ScaleFactorProperty = 0,
+    SpacingProperty,
+    SidesProperty,
+    RadiusProperty,
+    GeometryProperty,
+    PreviewProperty
+  };
+
   vtkMRMLSpatialObjectsDisplayNode* SpatialObjectsDisplayNode;
   vtkMRMLSpatialObjectsDisplayPropertiesNode*
     SpatialObjectsDisplayPropertiesNode;
+  QMap<int, double> PendingValues;
+  bool DetachingProperties;
 };
 
 //------------------------------------------------------------------------------
@@ -54,6 +86,7 @@ qSlicerSpatialObjectsGlyphWidgetPrivate(
 {
   this->SpatialObjectsDisplayNode = 0;
   this->SpatialObjectsDisplayPropertiesNode = 0;
+  this->DetachingProperties = false;
 }
 
 //------------------------------------------------------------------------------
@@ -77,6 +110,135 @@ void qSlicerSpatialObjectsGlyphWidgetPrivate::init()
   QObject::connect(this->GlyphRadiusSlider,
                    SIGNAL(valueChanged(double)), q,
                    SLOT(setTubeGlyphRadius(double)));
+
+  // While a slider is dragged, preview updates are throttled. The final
+  // value is pushed when the slider is released.
+  this->ScaleFactorSlider->setTracking(false);
+  this->SpacingSlider->setTracking(false);
+  this->GlyphSidesSlider->setTracking(false);
+  this->GlyphRadiusSlider->setTracking(false);
+  QObject::connect(this->ScaleFactorSlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onGlyphScaleFactorChanging(double)));
+  QObject::connect(this->SpacingSlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onGlyphSpacingChanging(double)));
+  QObject::connect(this->GlyphSidesSlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onTubeGlyphNumberOfSidesChanging(double)));
+  QObject::connect(this->GlyphRadiusSlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onTubeGlyphRadiusChanging(double)));
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidgetPrivate::
+setPendingValue(int property, double value)
+{
+  Q_Q(qSlicerSpatialObjectsGlyphWidget);
+
+  if (!this->SpatialObjectsDisplayPropertiesNode)
+    {
+    return;
+    }
+  this->PendingValues[property] = value;
+  qSlicerSpatialObjectsUpdateThrottler::instance()->requestUpdate(
+    q, "applyPendingValues");
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidgetPrivate::finishPendingValue(int property)
+{
+  Q_Q(qSlicerSpatialObjectsGlyphWidget);
+
+  this->PendingValues.remove(property);
+  if (this->PendingValues.isEmpty())
+    {
+    qSlicerSpatialObjectsUpdateThrottler::instance()->cancel(q);
+    this->setProperty(PreviewProperty, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidgetPrivate::setProperty(int property,
+                                                          double value)
+{
+  vtkMRMLSpatialObjectsDisplayNode* node = this->SpatialObjectsDisplayNode;
+  if (!node)
+    {
+    return;
+    }
+  switch (property)
+    {
+    case ScaleFactorProperty:
+      node->SetGlyphScaleFactor(value);
+      break;
+    case SpacingProperty:
+      node->SetLineGlyphResolution(static_cast<int>(value));
+      break;
+    case SidesProperty:
+      node->SetTubeGlyphNumberOfSides(static_cast<int>(value));
+      break;
+    case RadiusProperty:
+      node->SetTubeGlyphRadius(value);
+      break;
+    case GeometryProperty:
+      node->SetGlyphGeometry(static_cast<int>(value));
+      break;
+    case PreviewProperty:
+      node->SetPreviewMode(static_cast<int>(value));
+      break;
+    default:
+      break;
+    }
+}
+
+//------------------------------------------------------------------------------
+double qSlicerSpatialObjectsGlyphWidgetPrivate::property(int property) const
+{
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* node =
+    this->SpatialObjectsDisplayPropertiesNode;
+  switch (property)
+    {
+    case ScaleFactorProperty:
+      return node->GetGlyphScaleFactor();
+    case SpacingProperty:
+      return node->GetLineGlyphResolution();
+    case SidesProperty:
+      return node->GetTubeGlyphNumberOfSides();
+    case RadiusProperty:
+      return node->GetTubeGlyphRadius();
+    case GeometryProperty:
+      return node->GetGlyphGeometry();
+    case PreviewProperty:
+      return node->GetPreviewMode();
+    default:
+      return 0.;
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidgetPrivate::
+detachSharedProperties(int property, double value)
+{
+  if (!this->SpatialObjectsDisplayNode ||
+      this->SpatialObjectsDisplayNode->GetSpatialObjectsDisplayPropertiesNode()
+        != this->SpatialObjectsDisplayPropertiesNode ||
+      this->property(property) == value)
+    {
+    return;
+    }
+
+  // The copy has the same settings: the widget is not updated from it and
+  // the pending values are kept.
+  this->DetachingProperties = true;
+  vtkMRMLSpatialObjectsDisplayPropertiesNode* node = this->
+    SpatialObjectsDisplayNode->GetEditableSpatialObjectsDisplayPropertiesNode();
+  this->DetachingProperties = false;
+  if (node)
+    {
+    this->SpatialObjectsDisplayPropertiesNode = node;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -156,6 +318,10 @@ setSpatialObjectsDisplayPropertiesNode(
 {
   Q_D(qSlicerSpatialObjectsGlyphWidget);
 
+  // Previews are not carried over to another node.
+  d->PendingValues.clear();
+  qSlicerSpatialObjectsUpdateThrottler::instance()->cancel(this);
+
   d->SpatialObjectsDisplayPropertiesNode = node;
   
   // Selection of the Glyph type
@@ -184,8 +350,11 @@ void qSlicerSpatialObjectsGlyphWidget::setGlyphType(int type)
     {
     return;
     }
+  d->detachSharedProperties(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::GeometryProperty, type);
 
-  d->SpatialObjectsDisplayPropertiesNode->SetGlyphGeometry(type);
+  d->setProperty(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::GeometryProperty, type);
   QWidget* widget = d->GlyphSubPropertiesWidget->findChild<QWidget*>(
     d->SpatialObjectsDisplayPropertiesNode->GetGlyphGeometryAsString());
 
@@ -204,54 +373,147 @@ void qSlicerSpatialObjectsGlyphWidget::setGlyphType(int type)
 void qSlicerSpatialObjectsGlyphWidget::setGlyphScaleFactor(double scale)
 {
   Q_D(qSlicerSpatialObjectsGlyphWidget);
-  
+
   if (!d->SpatialObjectsDisplayPropertiesNode)
     {
     return;
     }
-
-  d->SpatialObjectsDisplayPropertiesNode->SetGlyphScaleFactor(scale);
+  d->detachSharedProperties(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::ScaleFactorProperty, scale);
+
+  int wasModifying = d->SpatialObjectsDisplayPropertiesNode->StartModify();
+  d->setProperty(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::ScaleFactorProperty, scale);
+  d->finishPendingValue(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::ScaleFactorProperty);
+  d->SpatialObjectsDisplayPropertiesNode->EndModify(wasModifying);
 }
 
 //------------------------------------------------------------------------------
 void qSlicerSpatialObjectsGlyphWidget::setGlyphSpacing(double spacing)
 {
   Q_D(qSlicerSpatialObjectsGlyphWidget);
-  
+
   if (!d->SpatialObjectsDisplayPropertiesNode)
     {
     return;
     }
-
-  d->SpatialObjectsDisplayPropertiesNode->SetLineGlyphResolution(
-    static_cast<int>(spacing));
+  d->detachSharedProperties(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::SpacingProperty, spacing);
+
+  int wasModifying = d->SpatialObjectsDisplayPropertiesNode->StartModify();
+  d->setProperty(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::SpacingProperty, spacing);
+  d->finishPendingValue(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::SpacingProperty);
+  d->SpatialObjectsDisplayPropertiesNode->EndModify(wasModifying);
 }
 
 //------------------------------------------------------------------------------
 void qSlicerSpatialObjectsGlyphWidget::setTubeGlyphNumberOfSides(double sides)
 {
   Q_D(qSlicerSpatialObjectsGlyphWidget);
-  
+
   if (!d->SpatialObjectsDisplayPropertiesNode)
     {
     return;
     }
-
-  d->SpatialObjectsDisplayPropertiesNode->SetTubeGlyphNumberOfSides(
-    static_cast<int>(sides));
+  d->detachSharedProperties(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::SidesProperty, sides);
+
+  int wasModifying = d->SpatialObjectsDisplayPropertiesNode->StartModify();
+  d->setProperty(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::SidesProperty, sides);
+  d->finishPendingValue(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::SidesProperty);
+  d->SpatialObjectsDisplayPropertiesNode->EndModify(wasModifying);
 }
 
 //------------------------------------------------------------------------------
 void qSlicerSpatialObjectsGlyphWidget::setTubeGlyphRadius(double radius)
 {
   Q_D(qSlicerSpatialObjectsGlyphWidget);
-  
+
   if (!d->SpatialObjectsDisplayPropertiesNode)
     {
     return;
     }
+  d->detachSharedProperties(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::RadiusProperty, radius);
+
+  int wasModifying = d->SpatialObjectsDisplayPropertiesNode->StartModify();
+  d->setProperty(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::RadiusProperty, radius);
+  d->finishPendingValue(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::RadiusProperty);
+  d->SpatialObjectsDisplayPropertiesNode->EndModify(wasModifying);
+}
 
-  d->SpatialObjectsDisplayPropertiesNode->SetTubeGlyphRadius(radius);
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidget::onGlyphScaleFactorChanging(double scale)
+{
+  Q_D(qSlicerSpatialObjectsGlyphWidget);
+  d->setPendingValue(qSlicerSpatialObjectsGlyphWidgetPrivate::
+                     ScaleFactorProperty, scale);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidget::onGlyphSpacingChanging(double spacing)
+{
+  Q_D(qSlicerSpatialObjectsGlyphWidget);
+  d->setPendingValue(qSlicerSpatialObjectsGlyphWidgetPrivate::
+                     SpacingProperty, spacing);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidget::
+onTubeGlyphNumberOfSidesChanging(double sides)
+{
+  Q_D(qSlicerSpatialObjectsGlyphWidget);
+  d->setPendingValue(qSlicerSpatialObjectsGlyphWidgetPrivate::
+                     SidesProperty, sides);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidget::onTubeGlyphRadiusChanging(double radius)
+{
+  Q_D(qSlicerSpatialObjectsGlyphWidget);
+  d->setPendingValue(qSlicerSpatialObjectsGlyphWidgetPrivate::
+                     RadiusProperty, radius);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsGlyphWidget::applyPendingValues(bool preview)
+{
+  Q_D(qSlicerSpatialObjectsGlyphWidget);
+
+  if (!d->SpatialObjectsDisplayPropertiesNode)
+    {
+    d->PendingValues.clear();
+    return;
+    }
+  d->detachSharedProperties(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::PreviewProperty, preview ? 1 : 0);
+  QMap<int, double>::const_iterator it;
+  for (it = d->PendingValues.constBegin();
+       it != d->PendingValues.constEnd(); ++it)
+    {
+    d->detachSharedProperties(it.key(), it.value());
+    }
+
+  int wasModifying = d->SpatialObjectsDisplayPropertiesNode->StartModify();
+  d->setProperty(
+    qSlicerSpatialObjectsGlyphWidgetPrivate::PreviewProperty, preview ? 1 : 0);
+  for (it = d->PendingValues.constBegin();
+       it != d->PendingValues.constEnd(); ++it)
+    {
+    d->setProperty(it.key(), it.value());
+    }
+  if (!preview)
+    {
+    d->PendingValues.clear();
+    }
+  d->SpatialObjectsDisplayPropertiesNode->EndModify(wasModifying);
 }
 
 //------------------------------------------------------------------------------
@@ -259,7 +521,7 @@ void qSlicerSpatialObjectsGlyphWidget::updateWidgetFromMRMLDisplayNode()
 {
   Q_D(qSlicerSpatialObjectsGlyphWidget);
 
-  if (!d->SpatialObjectsDisplayNode)
+  if (!d->SpatialObjectsDisplayNode || d->DetachingProperties)
     {
     return;
     }
@@ -69,6 +69,14 @@ protected slots:
   void updateWidgetFromMRMLDisplayNode();
   void updateWidgetFromMRMLDisplayPropertiesNode();
 
+  /// Preview the values of the sliders being dragged.
+  void onGlyphScaleFactorChanging(double);
+  void onGlyphSpacingChanging(double);
+  void onTubeGlyphNumberOfSidesChanging(double);
+  void onTubeGlyphRadiusChanging(double);
+  /// Called by qSlicerSpatialObjectsUpdateThrottler.
+  void applyPendingValues(bool preview);
+
 protected:
   QScopedPointer<qSlicerSpatialObjectsGlyphWidgetPrivate> d_ptr;
 
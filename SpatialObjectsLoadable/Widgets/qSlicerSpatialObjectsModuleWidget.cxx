@@ -18,9 +18,18 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QTreeWidgetItem>
+
+// SlicerQt includes
+#include <qMRMLThreeDView.h>
+#include <qMRMLThreeDWidget.h>
+#include <qSlicerApplication.h>
+#include <qSlicerLayoutManager.h>
+
 #include "qSlicerSpatialObjectsModuleWidget.h"
 #include "ui_qSlicerSpatialObjectsModule.h"
 #include "qMRMLSceneSpatialObjectsModel.h"
+#include "qMRMLSpatialObjectsTubeModel.h"
 
 // MRML includes
 #include "vtkMRMLNode.h"
@@ -30,6 +39,17 @@
 #include "vtkMRMLSpatialObjectsTubeDisplayNode.h"
 #include "vtkMRMLScene.h"
 
+// Logic includes
+#include "vtkSlicerSpatialObjectsLogic.h"
+#include "vtkSlicerSpatialObjectsTubePicker.h"
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkSmartPointer.h>
+
 //------------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_SpatialObjects
 class qSlicerSpatialObjectsModuleWidgetPrivate :
@@ -45,7 +65,14 @@ public:
     qSlicerSpatialObjectsModuleWidget& object);
   void init();
 
+  static QString formatMemorySize(unsigned long kibibytes);
+
   vtkMRMLSpatialObjectsNode* spatialObjectsNode;
+
+  vtkSmartPointer<vtkSlicerSpatialObjectsTubePicker> TubePicker;
+  /// Position of the last button press, a click is a press and a release
+  /// at the same position.
+  int PressPosition[2];
 };
 
 //------------------------------------------------------------------------------
@@ -55,6 +82,8 @@ qSlicerSpatialObjectsModuleWidgetPrivate
   : q_ptr(&object)
 {
   this->spatialObjectsNode = NULL;
+  this->TubePicker = vtkSmartPointer<vtkSlicerSpatialObjectsTubePicker>::New();
+  this->PressPosition[0] = this->PressPosition[1] = -1;
 }
 
 //------------------------------------------------------------------------------
@@ -72,6 +101,40 @@ void qSlicerSpatialObjectsModuleWidgetPrivate::init()
   // Hide the GlyphTab since, the glyph representations
   // are not build/implemented yet.
   this->TractDisplayModesTabWidget->removeTab(2);
+
+  this->TubeFilterRangeWidget->setTracking(false);
+  QObject::connect(this->TubeFilterColumnComboBox,
+                   SIGNAL(currentIndexChanged(int)),
+                   q, SLOT(onTubeFilterColumnChanged(int)));
+  QObject::connect(this->TubeFilterRangeWidget,
+                   SIGNAL(valuesChanged(double,double)),
+                   q, SLOT(onTubeFilterRangeChanged(double,double)));
+  QObject::connect(this->TubeHierarchyCheckBox, SIGNAL(toggled(bool)),
+                   this->TubeTreeView->tubeModel(),
+                   SLOT(setHierarchical(bool)));
+  QObject::connect(this->TubePickingCheckBox, SIGNAL(toggled(bool)),
+                   q, SLOT(setTubePickingEnabled(bool)));
+
+  QObject::connect(this->RefreshMemoryButton, SIGNAL(clicked()),
+                   q, SLOT(updateMemoryUsage()));
+  QObject::connect(this->MemoryCollapsibleButton,
+                   SIGNAL(contentsCollapsed(bool)),
+                   q, SLOT(updateMemoryUsage()));
+}
+
+//------------------------------------------------------------------------------
+QString qSlicerSpatialObjectsModuleWidgetPrivate::
+formatMemorySize(unsigned long kibibytes)
+{
+  if (kibibytes >= 1024 * 1024)
+    {
+    return QString("%1 GiB").arg(kibibytes / (1024. * 1024.), 0, 'f', 2);
+    }
+  if (kibibytes >= 1024)
+    {
+    return QString("%1 MiB").arg(kibibytes / 1024., 0, 'f', 2);
+    }
+  return QString("%1 KiB").arg(kibibytes);
 }
 
 //------------------------------------------------------------------------------
@@ -125,6 +188,14 @@ setSpatialObjectsNode(vtkMRMLSpatialObjectsNode* spatialObjectsNode)
       setSpatialObjectsDisplayNode(spatialObjectsNode->GetGlyphDisplayNode());
     }
 
+  d->TubeTreeView->setSpatialObjectsNode(spatialObjectsNode);
+  d->TubePicker->SetSpatialObjectsNode(spatialObjectsNode);
+  d->TubePickLabel->setText("-");
+  // The range of the filter depends on the tubes
+  this->onTubeFilterColumnChanged(d->TubeFilterColumnComboBox->currentIndex());
+
+  this->updateMemoryUsage();
+
   emit currentNodeChanged(d->spatialObjectsNode);
 }
 
@@ -149,3 +220,178 @@ void qSlicerSpatialObjectsModuleWidget::setSolidTubeColor(bool solid)
       }
     }
 }
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsModuleWidget::updateMemoryUsage()
+{
+  Q_D(qSlicerSpatialObjectsModuleWidget);
+
+  // Walking the buffers is not free, only do it when the section is visible.
+  if (d->MemoryCollapsibleButton->collapsed())
+    {
+    return;
+    }
+
+  d->MemoryUsageTreeWidget->clear();
+  d->NodeMemoryLabel->setText("-");
+  if (d->spatialObjectsNode)
+    {
+    vtkMRMLSpatialObjectsNode::MemoryUsageType usage;
+    d->spatialObjectsNode->GetMemoryUsage(usage);
+
+    unsigned long size = 0;
+    for (vtkMRMLSpatialObjectsNode::MemoryUsageType::const_iterator it =
+           usage.begin(); it != usage.end(); ++it)
+      {
+      QTreeWidgetItem* item = new QTreeWidgetItem(d->MemoryUsageTreeWidget);
+      item->setText(0, QString(it->first.c_str()));
+      item->setText(1, d->formatMemorySize(it->second));
+      item->setTextAlignment(1, Qt::AlignRight);
+      size += it->second;
+      }
+    d->NodeMemoryLabel->setText(d->formatMemorySize(size));
+    }
+
+  vtkSlicerSpatialObjectsLogic* logic =
+    vtkSlicerSpatialObjectsLogic::SafeDownCast(this->logic());
+  d->SceneMemoryLabel->setText(
+    logic ? d->formatMemorySize(logic->GetSceneMemorySize()) : "-");
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsModuleWidget::onTubeFilterColumnChanged(int index)
+{
+  Q_D(qSlicerSpatialObjectsModuleWidget);
+
+  // The first entry is "None"
+  const int column = index - 1;
+  qMRMLSpatialObjectsTubeModel* model = d->TubeTreeView->tubeModel();
+  d->TubeFilterRangeWidget->setEnabled(column >= 0);
+  if (column < 0)
+    {
+    model->clearFilter();
+    return;
+    }
+
+  double minimum = 0.;
+  double maximum = 0.;
+  model->valueRange(column, minimum, maximum);
+
+  typedef qMRMLSpatialObjectsTubeModel TubeModel;
+  const bool integers = (column == TubeModel::IDColumn ||
+                         column == TubeModel::ParentIDColumn ||
+                         column == TubeModel::OrderColumn);
+  const bool wasBlocking = d->TubeFilterRangeWidget->blockSignals(true);
+  d->TubeFilterRangeWidget->setDecimals(integers ? 0 : 2);
+  d->TubeFilterRangeWidget->setSingleStep(
+    integers ? 1. : qMax((maximum - minimum) / 100., 0.01));
+  d->TubeFilterRangeWidget->setRange(minimum, maximum);
+  d->TubeFilterRangeWidget->setValues(minimum, maximum);
+  d->TubeFilterRangeWidget->blockSignals(wasBlocking);
+
+  model->setFilter(column, minimum, maximum);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsModuleWidget::
+onTubeFilterRangeChanged(double minimum, double maximum)
+{
+  Q_D(qSlicerSpatialObjectsModuleWidget);
+
+  const int column = d->TubeFilterColumnComboBox->currentIndex() - 1;
+  if (column >= 0)
+    {
+    d->TubeTreeView->tubeModel()->setFilter(column, minimum, maximum);
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsModuleWidget::setTubePickingEnabled(bool enabled)
+{
+  Q_D(qSlicerSpatialObjectsModuleWidget);
+
+  qSlicerLayoutManager* layoutManager =
+    qSlicerApplication::application() ?
+    qSlicerApplication::application()->layoutManager() : 0;
+  if (!layoutManager)
+    {
+    return;
+    }
+  for (int i = 0; i < layoutManager->threeDViewCount(); ++i)
+    {
+    vtkRenderWindowInteractor* interactor =
+      layoutManager->threeDWidget(i)->threeDView()->interactor();
+    // The view keeps rotating on a drag, only a click picks.
+    if (enabled)
+      {
+      qvtkConnect(interactor, vtkCommand::LeftButtonPressEvent,
+                  this, SLOT(onThreeDViewPressed(vtkObject*)));
+      qvtkConnect(interactor, vtkCommand::LeftButtonReleaseEvent,
+                  this, SLOT(onThreeDViewReleased(vtkObject*)));
+      }
+    else
+      {
+      qvtkDisconnect(interactor, vtkCommand::LeftButtonPressEvent,
+                     this, SLOT(onThreeDViewPressed(vtkObject*)));
+      qvtkDisconnect(interactor, vtkCommand::LeftButtonReleaseEvent,
+                     this, SLOT(onThreeDViewReleased(vtkObject*)));
+      }
+    }
+  d->PressPosition[0] = d->PressPosition[1] = -1;
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsModuleWidget::onThreeDViewPressed(vtkObject* caller)
+{
+  Q_D(qSlicerSpatialObjectsModuleWidget);
+
+  vtkRenderWindowInteractor* interactor =
+    vtkRenderWindowInteractor::SafeDownCast(caller);
+  if (interactor)
+    {
+    interactor->GetEventPosition(d->PressPosition);
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsModuleWidget::onThreeDViewReleased(vtkObject* caller)
+{
+  Q_D(qSlicerSpatialObjectsModuleWidget);
+
+  vtkRenderWindowInteractor* interactor =
+    vtkRenderWindowInteractor::SafeDownCast(caller);
+  if (!interactor || !d->spatialObjectsNode)
+    {
+    return;
+    }
+  int position[2];
+  interactor->GetEventPosition(position);
+  if (position[0] != d->PressPosition[0] ||
+      position[1] != d->PressPosition[1])
+    {
+    return;
+    }
+
+  // The lines are thinner than the radius of the tubes.
+  vtkMRMLSpatialObjectsDisplayNode* tubeDisplayNode =
+    d->spatialObjectsNode->GetTubeDisplayNode();
+  d->TubePicker->SetUseTubeRadius(
+    tubeDisplayNode && tubeDisplayNode->GetVisibility());
+  if (!d->TubePicker->Pick(position[0], position[1],
+                           interactor->FindPokedRenderer(position[0],
+                                                         position[1])))
+    {
+    d->TubePickLabel->setText(tr("No tube"));
+    return;
+    }
+
+  const vtkIdType tubeId = d->TubePicker->GetTubeId();
+  vtkNew<vtkIdTypeArray> tubeIds;
+  tubeIds->InsertNextValue(tubeId);
+  d->spatialObjectsNode->SetSelectedTubes(tubeIds.GetPointer());
+  d->TubePickLabel->setText(
+    tr("Tube %1, point %2, arc length %3")
+    .arg(d->spatialObjectsNode->GetTubeIdentifier(tubeId))
+    .arg(d->TubePicker->GetPointIndex())
+    .arg(d->TubePicker->GetArcLength(), 0, 'f', 2));
+}
@@ -22,6 +22,7 @@
 
 // CTK includes
 #include <ctkPimpl.h>
+#include <ctkVTKObject.h>
 
 // SlicerQt includes
 #include "qSlicerAbstractModuleWidget.h"
@@ -30,12 +31,14 @@
 class qSlicerSpatialObjectsModuleWidgetPrivate;
 class vtkMRMLNode;
 class vtkMRMLSpatialObjectsNode;
+class vtkObject;
 
 /// \ingroup Slicer_QtModules_SpatialObjects
 class Q_SLICER_MODULE_SPATIALOBJECTS_WIDGETS_EXPORT
 qSlicerSpatialObjectsModuleWidget : public qSlicerAbstractModuleWidget
 {
 Q_OBJECT
+QVTK_OBJECT
 
 public:
   typedef qSlicerAbstractModuleWidget Superclass;
@@ -49,6 +52,19 @@ public slots:
   void setSpatialObjectsNode(vtkMRMLSpatialObjectsNode*);
   void setSolidTubeColor(bool);
 
+  /// Refresh the memory usage of the current node and of the scene.
+  void updateMemoryUsage();
+
+  /// If enabled, a click in a 3D view picks a tube of the current node
+  /// and selects it (see vtkSlicerSpatialObjectsTubePicker).
+  void setTubePickingEnabled(bool enabled);
+
+protected slots:
+  void onTubeFilterColumnChanged(int index);
+  void onTubeFilterRangeChanged(double minimum, double maximum);
+  void onThreeDViewPressed(vtkObject* interactor);
+  void onThreeDViewReleased(vtkObject* interactor);
+
 signals:
   void currentNodeChanged(vtkMRMLNode*);
   void currentNodeChanged(vtkMRMLSpatialObjectsNode*);
@@ -0,0 +1,282 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+
+// qMRML includes
+#include "qSlicerSpatialObjectsUpdateThrottler.h"
+
+//------------------------------------------------------------------------------
+class qSlicerSpatialObjectsUpdateThrottlerPrivate
+{
+  Q_DECLARE_PUBLIC(qSlicerSpatialObjectsUpdateThrottler);
+
+protected:
+  qSlicerSpatialObjectsUpdateThrottler* const q_ptr;
+
+public:
+  qSlicerSpatialObjectsUpdateThrottlerPrivate(
+    qSlicerSpatialObjectsUpdateThrottler& object);
+
+  void init();
+  int indexOf(QObject* receiver)const;
+  void invoke(int index, bool preview);
+
+  struct Request
+  {
+    QPointer<QObject> Receiver;
+    QByteArray Member;
+    bool PreviewPending;
+  };
+  QList<Request> Requests;
+
+  QTimer PreviewTimer;
+  QTimer IdleTimer;
+};
+
+//------------------------------------------------------------------------------
+qSlicerSpatialObjectsUpdateThrottlerPrivate::
+qSlicerSpatialObjectsUpdateThrottlerPrivate(
+  qSlicerSpatialObjectsUpdateThrottler& object)
+  : q_ptr(&object)
+{
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottlerPrivate::init()
+{
+  Q_Q(qSlicerSpatialObjectsUpdateThrottler);
+
+  this->PreviewTimer.setSingleShot(true);
+  this->PreviewTimer.setInterval(50);
+  QObject::connect(&this->PreviewTimer, SIGNAL(timeout()),
+                   q, SLOT(onPreviewTimeout()));
+
+  this->IdleTimer.setSingleShot(true);
+  this->IdleTimer.setInterval(300);
+  QObject::connect(&this->IdleTimer, SIGNAL(timeout()),
+                   q, SLOT(flush()));
+}
+
+//------------------------------------------------------------------------------
+int qSlicerSpatialObjectsUpdateThrottlerPrivate::indexOf(QObject* receiver)const
+{
+  for (int i = 0; i < this->Requests.size(); ++i)
+    {
+    if (this->Requests[i].Receiver == receiver)
+      {
+      return i;
+      }
+    }
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottlerPrivate::invoke(int index,
+                                                         bool preview)
+{
+  Request& request = this->Requests[index];
+  request.PreviewPending = false;
+  if (request.Receiver)
+    {
+    QMetaObject::invokeMethod(request.Receiver, request.Member.constData(),
+                              Qt::DirectConnection, Q_ARG(bool, preview));
+    }
+}
+
+//------------------------------------------------------------------------------
+qSlicerSpatialObjectsUpdateThrottler::
+qSlicerSpatialObjectsUpdateThrottler(QObject* parentObject)
+  : Superclass(parentObject)
+  , d_ptr(new qSlicerSpatialObjectsUpdateThrottlerPrivate(*this))
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+  d->init();
+}
+
+//------------------------------------------------------------------------------
+qSlicerSpatialObjectsUpdateThrottler::~qSlicerSpatialObjectsUpdateThrottler()
+{}
+
+//------------------------------------------------------------------------------
+qSlicerSpatialObjectsUpdateThrottler*
+qSlicerSpatialObjectsUpdateThrottler::instance()
+{
+  static QPointer<qSlicerSpatialObjectsUpdateThrottler> throttler;
+  if (!throttler)
+    {
+    throttler =
+      new qSlicerSpatialObjectsUpdateThrottler(QCoreApplication::instance());
+    }
+  return throttler;
+}
+
+//------------------------------------------------------------------------------
+int qSlicerSpatialObjectsUpdateThrottler::previewInterval()const
+{
+  Q_D(const qSlicerSpatialObjectsUpdateThrottler);
+  return d->PreviewTimer.interval();
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::setPreviewInterval(int msec)
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+  d->PreviewTimer.setInterval(msec);
+}
+
+//------------------------------------------------------------------------------
+int qSlicerSpatialObjectsUpdateThrottler::idleDelay()const
+{
+  Q_D(const qSlicerSpatialObjectsUpdateThrottler);
+  return d->IdleTimer.interval();
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::setIdleDelay(int msec)
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+  d->IdleTimer.setInterval(msec);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::
+requestUpdate(QObject* receiver, const char* member)
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+
+  if (!receiver || !member)
+    {
+    return;
+    }
+
+  int index = d->indexOf(receiver);
+  if (index < 0)
+    {
+    qSlicerSpatialObjectsUpdateThrottlerPrivate::Request request;
+    request.Receiver = receiver;
+    d->Requests.append(request);
+    index = d->Requests.size() - 1;
+    }
+  d->Requests[index].Member = member;
+  d->Requests[index].PreviewPending = true;
+
+  // The first change of an interaction is previewed right away.
+  if (!d->PreviewTimer.isActive())
+    {
+    d->invoke(index, true);
+    d->PreviewTimer.start();
+    }
+  d->IdleTimer.start();
+}
+
+//------------------------------------------------------------------------------
+bool qSlicerSpatialObjectsUpdateThrottler::isPending(QObject* receiver)const
+{
+  Q_D(const qSlicerSpatialObjectsUpdateThrottler);
+  return d->indexOf(receiver) >= 0;
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::onPreviewTimeout()
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+
+  bool previewed = false;
+  for (int i = 0; i < d->Requests.size(); ++i)
+    {
+    if (d->Requests[i].PreviewPending)
+      {
+      d->invoke(i, true);
+      previewed = true;
+      }
+    }
+  // Keep the pace while the values are changing.
+  if (previewed)
+    {
+    d->PreviewTimer.start();
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::flush()
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+
+  d->PreviewTimer.stop();
+  d->IdleTimer.stop();
+
+  // The slots may request new updates.
+  QList<qSlicerSpatialObjectsUpdateThrottlerPrivate::Request> requests =
+    d->Requests;
+  d->Requests.clear();
+  for (int i = 0; i < requests.size(); ++i)
+    {
+    if (requests[i].Receiver)
+      {
+      QMetaObject::invokeMethod(requests[i].Receiver,
+                                requests[i].Member.constData(),
+                                Qt::DirectConnection, Q_ARG(bool, false));
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::flush(QObject* receiver)
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+
+  const int index = d->indexOf(receiver);
+  if (index < 0)
+    {
+    return;
+    }
+  qSlicerSpatialObjectsUpdateThrottlerPrivate::Request request =
+    d->Requests.takeAt(index);
+  if (d->Requests.isEmpty())
+    {
+    d->PreviewTimer.stop();
+    d->IdleTimer.stop();
+    }
+  if (request.Receiver)
+    {
+    QMetaObject::invokeMethod(request.Receiver, request.Member.constData(),
+                              Qt::DirectConnection, Q_ARG(bool, false));
+    }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsUpdateThrottler::cancel(QObject* receiver)
+{
+  Q_D(qSlicerSpatialObjectsUpdateThrottler);
+
+  const int index = d->indexOf(receiver);
+  if (index < 0)
+    {
+    return;
+    }
+  d->Requests.removeAt(index);
+  if (d->Requests.isEmpty())
+    {
+    d->PreviewTimer.stop();
+    d->IdleTimer.stop();
+    }
+}
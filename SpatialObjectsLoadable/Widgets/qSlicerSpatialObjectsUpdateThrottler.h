@@ -0,0 +1,88 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qSlicerSpatialObjectsUpdateThrottler_h
+#define __qSlicerSpatialObjectsUpdateThrottler_h
+
+// Qt includes
+#include <QObject>
+
+// qMRML includes
+#include "qSlicerSpatialObjectsModuleWidgetsExport.h"
+
+class qSlicerSpatialObjectsUpdateThrottlerPrivate;
+
+/// Debounce the updates pushed to MRML by interactive widgets.
+/// While a value is changing, requestUpdate() calls the receiver slot
+/// with preview=true at most once per previewInterval milliseconds. When
+/// no request was made for idleDelay milliseconds, or when flush() is
+/// called (e.g. when a slider is released), the slot is called once with
+/// preview=false for the full-quality update.
+/// The spatial objects widgets share instance() so that they all behave
+/// the same.
+class Q_SLICER_MODULE_SPATIALOBJECTS_WIDGETS_EXPORT
+qSlicerSpatialObjectsUpdateThrottler : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int previewInterval READ previewInterval WRITE setPreviewInterval)
+  Q_PROPERTY(int idleDelay READ idleDelay WRITE setIdleDelay)
+
+public:
+  typedef QObject Superclass;
+  qSlicerSpatialObjectsUpdateThrottler(QObject* parent = 0);
+  virtual ~qSlicerSpatialObjectsUpdateThrottler();
+
+  /// Throttler shared by the spatial objects widgets.
+  static qSlicerSpatialObjectsUpdateThrottler* instance();
+
+  /// Minimum time in ms between two preview updates. 50 by default.
+  int previewInterval()const;
+  void setPreviewInterval(int msec);
+
+  /// Time in ms without request before the full-quality update.
+  /// 300 by default.
+  int idleDelay()const;
+  void setIdleDelay(int msec);
+
+  /// Schedule a call to \a member, the name of a slot of \a receiver
+  /// taking a bool "preview" argument (e.g. "applyPendingChanges").
+  void requestUpdate(QObject* receiver, const char* member);
+
+  /// Return true if receiver has an update scheduled.
+  bool isPending(QObject* receiver)const;
+
+public slots:
+  /// Run now the full-quality update of all the receivers.
+  void flush();
+  /// Run now the full-quality update of \a receiver, if any is pending.
+  void flush(QObject* receiver);
+  /// Drop the update scheduled for receiver, e.g. when it pushed its
+  /// final values itself.
+  void cancel(QObject* receiver);
+
+protected slots:
+  void onPreviewTimeout();
+
+protected:
+  QScopedPointer<qSlicerSpatialObjectsUpdateThrottlerPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerSpatialObjectsUpdateThrottler);
+  Q_DISABLE_COPY(qSlicerSpatialObjectsUpdateThrottler);
+};
+
+#endif
@@ -18,6 +18,7 @@
 ==============================================================================*/
 
 // qMRML includes
+#include "qSlicerSpatialObjectsUpdateThrottler.h"
 #include "qSlicerSpatialObjectsWidget.h"
 #include "ui_qSlicerSpatialObjectsWidget.h"
 
@@ -31,6 +32,7 @@
 #include <vtkMRMLSpatialObjectsNode.h>
 #include <vtkMRMLSpatialObjectsDisplayNode.h>
 #include <vtkMRMLSpatialObjectsLineDisplayNode.h>
+#include <vtkMRMLSpatialObjectsTubeDisplayNode.h>
 #include <vtkMRMLSpatialObjectsDisplayPropertiesNode.h>
 
 // VTK includes
@@ -49,11 +51,24 @@ public:
   qSlicerSpatialObjectsWidgetPrivate(qSlicerSpatialObjectsWidget& object);
   void init();
   bool centeredOrigin(double* origin)const;
+  void setScalarRange(double minValue, double maxValue);
+  vtkMRMLSpatialObjectsTubeDisplayNode* tubeDisplayNode()const;
+  bool hasPendingValues()const;
 
   vtkMRMLSpatialObjectsNode* SpatialObjectsNode;
   vtkMRMLSpatialObjectsDisplayNode* SpatialObjectsDisplayNode;
   vtkMRMLSpatialObjectsDisplayPropertiesNode*
     SpatialObjectsDisplayPropertiesNode;
+
+  /// Values of the sliders being dragged, pushed by the throttler.
+  bool OpacityPending;
+  double PendingOpacity;
+  bool ScalarRangePending;
+  double PendingScalarRange[2];
+  bool TubeRadiusPending;
+  double PendingTubeRadius;
+  bool TubeNumberOfSidesPending;
+  int PendingTubeNumberOfSides;
 };
 
 //------------------------------------------------------------------------------
@@ -62,6 +77,15 @@ qSlicerSpatialObjectsWidgetPrivate::qSlicerSpatialObjectsWidgetPrivate
   : q_ptr(&object)
 {
   this->SpatialObjectsDisplayNode = 0;
+  this->OpacityPending = false;
+  this->PendingOpacity = 1.;
+  this->ScalarRangePending = false;
+  this->PendingScalarRange[0] = 0.;
+  this->PendingScalarRange[1] = 1.;
+  this->TubeRadiusPending = false;
+  this->PendingTubeRadius = 0.5;
+  this->TubeNumberOfSidesPending = false;
+  this->PendingTubeNumberOfSides = 6;
 }
 
 //------------------------------------------------------------------------------
@@ -124,12 +148,78 @@ void qSlicerSpatialObjectsWidgetPrivate::init()
                    SIGNAL(backfaceCullingChanged(bool)), q,
                    SLOT(setBackfaceCulling(bool)));
 
+  // While a slider is dragged, the updates are throttled. The final
+  // value is pushed when the slider is released.
+  this->OpacitySlider->setTracking(false);
+  QObject::connect(this->OpacitySlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onOpacityChanging(double)));
+  this->ScalarRangeWidget->setTracking(false);
+  QObject::connect(this->ScalarRangeWidget,
+                   SIGNAL(minimumValueIsChanging(double)), q,
+                   SLOT(onScalarRangeChanging()));
+  QObject::connect(this->ScalarRangeWidget,
+                   SIGNAL(maximumValueIsChanging(double)), q,
+                   SLOT(onScalarRangeChanging()));
+
+  // The tube settings regenerate the tube mesh: while they are dragged,
+  // the throttled previews build triangular tubes.
+  this->TubeRadiusSlider->setTracking(false);
+  this->TubeNumberOfSidesSlider->setTracking(false);
+  QObject::connect(this->TubeRadiusSlider,
+                   SIGNAL(valueChanged(double)), q,
+                   SLOT(setTubeRadius(double)));
+  QObject::connect(this->TubeRadiusSlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onTubeRadiusChanging(double)));
+  QObject::connect(this->TubeNumberOfSidesSlider,
+                   SIGNAL(valueChanged(double)), q,
+                   SLOT(setTubeNumberOfSides(double)));
+  QObject::connect(this->TubeNumberOfSidesSlider,
+                   SIGNAL(valueIsChanging(double)), q,
+                   SLOT(onTubeNumberOfSidesChanging(double)));
+
   this->MaterialPropertyWidget->setHidden(true);
   this->MaterialPropertyGroupBox->setHidden(true);
 
   this->ScalarRangeWidget->setRange(0., 0.);
 }
 
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidgetPrivate::setScalarRange(double minValue,
+                                                        double maxValue)
+{
+  if (!this->SpatialObjectsDisplayNode ||
+      !this->SpatialObjectsNode ||
+      !this->SpatialObjectsNode->GetPolyData() ||
+      !this->SpatialObjectsNode->GetPolyData()->GetPointData() ||
+      !this->SpatialObjectsDisplayNode->GetScalarVisibility())
+    {
+    return;
+    }
+
+  // Set the Range given the current ScalarColor
+  double range[2];
+  range[0] = minValue;
+  range[1] = maxValue;
+  this->SpatialObjectsDisplayNode->SetScalarRange(range);
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLSpatialObjectsTubeDisplayNode*
+qSlicerSpatialObjectsWidgetPrivate::tubeDisplayNode()const
+{
+  return vtkMRMLSpatialObjectsTubeDisplayNode::SafeDownCast(
+    this->SpatialObjectsDisplayNode);
+}
+
+//------------------------------------------------------------------------------
+bool qSlicerSpatialObjectsWidgetPrivate::hasPendingValues()const
+{
+  return this->OpacityPending || this->ScalarRangePending ||
+    this->TubeRadiusPending || this->TubeNumberOfSidesPending;
+}
+
 //------------------------------------------------------------------------------
 qSlicerSpatialObjectsWidget::qSlicerSpatialObjectsWidget(QWidget *_parent)
   : Superclass(_parent)
@@ -225,6 +315,11 @@ setSpatialObjectsDisplayNode(vtkMRMLSpatialObjectsDisplayNode*
     d->MaterialPropertyWidget->setHidden(false);
     d->MaterialPropertyGroupBox->setHidden(false);
     }
+  const bool tubes = d->tubeDisplayNode() != 0;
+  d->TubeRadiusLabel->setVisible(tubes);
+  d->TubeRadiusSlider->setVisible(tubes);
+  d->TubeNumberOfSidesLabel->setVisible(tubes);
+  d->TubeNumberOfSidesSlider->setVisible(tubes);
 
   qvtkReconnect(oldDisplayNode,
                 this->SpatialObjectsDisplayNode(),
@@ -359,20 +454,13 @@ void qSlicerSpatialObjectsWidget::onColorByScalarRangeChanged(double minValue,
 {
   Q_D(qSlicerSpatialObjectsWidget);
 
-  if (!d->SpatialObjectsDisplayNode ||
-      !d->SpatialObjectsNode ||
-      !d->SpatialObjectsNode->GetPolyData() ||
-      !d->SpatialObjectsNode->GetPolyData()->GetPointData() ||
-      !d->SpatialObjectsDisplayNode->GetScalarVisibility())
+  d->ScalarRangePending = false;
+  if (!d->hasPendingValues())
     {
-    return;
+    qSlicerSpatialObjectsUpdateThrottler::instance()->cancel(this);
     }
 
-    // Set the Range given the current ScalarColor
-    double range[2];
-    range[0] = minValue;
-    range[1] = maxValue;
-    d->SpatialObjectsDisplayNode->SetScalarRange(range);
+  d->setScalarRange(minValue, maxValue);
 }
 
 //------------------------------------------------------------------------------
@@ -409,7 +497,13 @@ setColorByCellScalarsColorTable(vtkMRMLNode* colortableNode)
 void qSlicerSpatialObjectsWidget::setOpacity(double opacity)
 {
   Q_D(qSlicerSpatialObjectsWidget);
-  
+
+  d->OpacityPending = false;
+  if (!d->hasPendingValues())
+    {
+    qSlicerSpatialObjectsUpdateThrottler::instance()->cancel(this);
+    }
+
   if (!d->SpatialObjectsDisplayNode)
     {
     return;
@@ -418,6 +512,156 @@ void qSlicerSpatialObjectsWidget::setOpacity(double opacity)
   d->SpatialObjectsDisplayNode->SetOpacity(opacity);
 }
 
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::onOpacityChanging(double opacity)
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  d->OpacityPending = true;
+  d->PendingOpacity = opacity;
+  qSlicerSpatialObjectsUpdateThrottler::instance()->requestUpdate(
+    this, "applyPendingValues");
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::onScalarRangeChanging()
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  d->ScalarRangePending = true;
+  d->PendingScalarRange[0] = d->ScalarRangeWidget->minimumValue();
+  d->PendingScalarRange[1] = d->ScalarRangeWidget->maximumValue();
+  qSlicerSpatialObjectsUpdateThrottler::instance()->requestUpdate(
+    this, "applyPendingValues");
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::setTubeRadius(double radius)
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  d->TubeRadiusPending = false;
+  if (!d->hasPendingValues())
+    {
+    qSlicerSpatialObjectsUpdateThrottler::instance()->cancel(this);
+    }
+
+  vtkMRMLSpatialObjectsTubeDisplayNode* tubeDisplayNode =
+    d->tubeDisplayNode();
+  if (!tubeDisplayNode)
+    {
+    return;
+    }
+
+  int wasModifying = tubeDisplayNode->StartModify();
+  tubeDisplayNode->SetTubeRadius(radius);
+  if (!d->TubeNumberOfSidesPending)
+    {
+    tubeDisplayNode->TubePreviewModeOff();
+    }
+  tubeDisplayNode->EndModify(wasModifying);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::setTubeNumberOfSides(double sides)
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  d->TubeNumberOfSidesPending = false;
+  if (!d->hasPendingValues())
+    {
+    qSlicerSpatialObjectsUpdateThrottler::instance()->cancel(this);
+    }
+
+  vtkMRMLSpatialObjectsTubeDisplayNode* tubeDisplayNode =
+    d->tubeDisplayNode();
+  if (!tubeDisplayNode)
+    {
+    return;
+    }
+
+  int wasModifying = tubeDisplayNode->StartModify();
+  tubeDisplayNode->SetTubeNumberOfSides(static_cast<int>(sides));
+  if (!d->TubeRadiusPending)
+    {
+    tubeDisplayNode->TubePreviewModeOff();
+    }
+  tubeDisplayNode->EndModify(wasModifying);
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::onTubeRadiusChanging(double radius)
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  d->TubeRadiusPending = true;
+  d->PendingTubeRadius = radius;
+  qSlicerSpatialObjectsUpdateThrottler::instance()->requestUpdate(
+    this, "applyPendingValues");
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::onTubeNumberOfSidesChanging(double sides)
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  d->TubeNumberOfSidesPending = true;
+  d->PendingTubeNumberOfSides = static_cast<int>(sides);
+  qSlicerSpatialObjectsUpdateThrottler::instance()->requestUpdate(
+    this, "applyPendingValues");
+}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsWidget::applyPendingValues(bool preview)
+{
+  Q_D(qSlicerSpatialObjectsWidget);
+
+  if (!d->SpatialObjectsDisplayNode)
+    {
+    d->OpacityPending = false;
+    d->ScalarRangePending = false;
+    d->TubeRadiusPending = false;
+    d->TubeNumberOfSidesPending = false;
+    return;
+    }
+
+  // Opacity and scalar range do not regenerate the geometry, the previews
+  // are only throttled. The tube settings regenerate the tube mesh, with
+  // 3 sides only while previewing.
+  const bool opacityPending = d->OpacityPending;
+  const bool scalarRangePending = d->ScalarRangePending;
+  const bool tubeRadiusPending = d->TubeRadiusPending;
+  const bool tubeNumberOfSidesPending = d->TubeNumberOfSidesPending;
+  vtkMRMLSpatialObjectsTubeDisplayNode* tubeDisplayNode =
+    d->tubeDisplayNode();
+  int wasModifying = d->SpatialObjectsDisplayNode->StartModify();
+  if (opacityPending)
+    {
+    d->SpatialObjectsDisplayNode->SetOpacity(d->PendingOpacity);
+    }
+  if (scalarRangePending)
+    {
+    d->setScalarRange(d->PendingScalarRange[0], d->PendingScalarRange[1]);
+    }
+  if (tubeDisplayNode && (tubeRadiusPending || tubeNumberOfSidesPending))
+    {
+    if (tubeRadiusPending)
+      {
+      tubeDisplayNode->SetTubeRadius(d->PendingTubeRadius);
+      }
+    if (tubeNumberOfSidesPending)
+      {
+      tubeDisplayNode->SetTubeNumberOfSides(d->PendingTubeNumberOfSides);
+      }
+    tubeDisplayNode->SetTubePreviewMode(preview ? 1 : 0);
+    }
+  d->OpacityPending = preview && opacityPending;
+  d->ScalarRangePending = preview && scalarRangePending;
+  d->TubeRadiusPending = preview && tubeRadiusPending;
+  d->TubeNumberOfSidesPending = preview && tubeNumberOfSidesPending;
+  d->SpatialObjectsDisplayNode->EndModify(wasModifying);
+}
+
 //------------------------------------------------------------------------------
 QColor qSlicerSpatialObjectsWidget::color() const
 {
@@ -563,6 +807,14 @@ void qSlicerSpatialObjectsWidget::updateWidgetFromMRML()
   d->VisibilityCheckBox->setChecked(
     d->SpatialObjectsDisplayNode->GetVisibility());
   d->OpacitySlider->setValue(d->SpatialObjectsDisplayNode->GetOpacity());
+  vtkMRMLSpatialObjectsTubeDisplayNode* tubeDisplayNode =
+    d->tubeDisplayNode();
+  if (tubeDisplayNode)
+    {
+    d->TubeRadiusSlider->setValue(tubeDisplayNode->GetTubeRadius());
+    d->TubeNumberOfSidesSlider->setValue(
+      tubeDisplayNode->GetTubeNumberOfSides());
+    }
   
   d->ColorByScalarsColorTableComboBox->setCurrentNode
     (d->SpatialObjectsDisplayNode->GetColorNodeID());
@@ -79,6 +79,10 @@ public slots:
   void onColorBySolidChanged(const QColor&);
   void setColorByCellScalarsColorTable(vtkMRMLNode*);
   void setOpacity(double);
+
+  /// Set the tube settings of a tube display node
+  void setTubeRadius(double);
+  void setTubeNumberOfSides(double);
   
   /// Set the values on the display node
   void setColor(const QColor&);
@@ -91,6 +95,14 @@ public slots:
 protected slots:
   void updateWidgetFromMRML();
 
+  /// Throttle the updates while the sliders are dragged.
+  void onOpacityChanging(double);
+  void onScalarRangeChanging();
+  void onTubeRadiusChanging(double);
+  void onTubeNumberOfSidesChanging(double);
+  /// Called by qSlicerSpatialObjectsUpdateThrottler.
+  void applyPendingValues(bool preview);
+
 protected:
   QScopedPointer<qSlicerSpatialObjectsWidgetPrivate> d_ptr;
 
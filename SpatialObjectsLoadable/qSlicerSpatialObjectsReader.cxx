@@ -23,9 +23,7 @@
 
 // SlicerQt includes
 #include "qSlicerSpatialObjectsReader.h"
-
-// TODO Create the Reader OptionWidget ?
-//#include "qSlicerSpatialObjectsReaderOptionsWidget.h"
+#include "qSlicerSpatialObjectsReaderOptionsWidget.h"
 
 // Logic includes
 #include <vtkSlicerApplicationLogic.h>
@@ -34,8 +32,11 @@
 // MRML includes
 #include <vtkMRMLSelectionNode.h>
 #include <vtkMRMLSpatialObjectsNode.h>
+#include <vtkMRMLSpatialObjectsStorageNode.h>
 
 // VTK includes
+#include <vtkIdList.h>
+#include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 
@@ -100,15 +101,14 @@ QStringList qSlicerSpatialObjectsReader::extensions() const
     << "VesselTubeSpatialObject (*.tre)"
     << "DTITubeSpatialObject (*.tre)"
     << "TubeSpatialObject (*.tre)"
+    << "Compressed SpatialObjects (*.trc)"
     << "All Files (*)";
 }
 
 //-----------------------------------------------------------------------------
 qSlicerIOOptions* qSlicerSpatialObjectsReader::options() const
 {
-  return 0;
-  // TODO add SPATIALOBjects Options
-  //return new qSlicerSpatialObjectsReaderOptionsWidget;
+  return new qSlicerSpatialObjectsReaderOptionsWidget;
 }
 
 //-----------------------------------------------------------------------------
@@ -137,11 +137,48 @@ bool qSlicerSpatialObjectsReader::load(const IOProperties& properties)
     fileNames << fileName;
     }
 
+  // Read options, see qSlicerSpatialObjectsReaderOptionsWidget
+  vtkNew<vtkMRMLSpatialObjectsStorageNode> readOptions;
+  if (properties.contains("pointDataArrays"))
+    {
+    readOptions->SetPointDataArrays(properties["pointDataArrays"].toInt());
+    }
+  if (properties.contains("minimumNumberOfPoints"))
+    {
+    readOptions->SetMinimumNumberOfPoints(
+      properties["minimumNumberOfPoints"].toInt());
+    }
+  if (properties.contains("minimumTubeLength"))
+    {
+    readOptions->SetMinimumTubeLength(
+      properties["minimumTubeLength"].toDouble());
+    }
+  if (properties.contains("decimationTolerance"))
+    {
+    readOptions->SetDecimationTolerance(
+      properties["decimationTolerance"].toDouble());
+    }
+  foreach(QVariant tubeID, properties["tubeIDs"].toList())
+    {
+    readOptions->GetTubeIDs()->InsertNextId(tubeID.toInt());
+    }
+  QVariantList roi = properties["roi"].toList();
+  if (roi.size() == 6)
+    {
+    double bounds[6];
+    for (int i = 0; i < 6; ++i)
+      {
+      bounds[i] = roi[i].toDouble();
+      }
+    readOptions->SetROI(bounds);
+    readOptions->SetUseROI(true);
+    }
+
   QStringList nodes;
   foreach(QString file, fileNames)
     {
     vtkMRMLSpatialObjectsNode* node =
-      d->Logic->AddSpatialObject(file.toLatin1());
+      d->Logic->AddSpatialObject(file.toLatin1(), readOptions.GetPointer());
 
     if (node)
       {
@@ -0,0 +1,149 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QDoubleSpinBox>
+
+// SlicerQt includes
+#include "qSlicerSpatialObjectsReaderOptionsWidget.h"
+#include "ui_qSlicerSpatialObjectsReaderOptionsWidget.h"
+
+// MRML includes
+#include <vtkSpatialObjectsTreReader.h>
+
+//------------------------------------------------------------------------------
+class qSlicerSpatialObjectsReaderOptionsWidgetPrivate
+  : public Ui_qSlicerSpatialObjectsReaderOptionsWidget
+{
+public:
+  QList<QDoubleSpinBox*> ROISpinBoxes;
+};
+
+//------------------------------------------------------------------------------
+qSlicerSpatialObjectsReaderOptionsWidget::
+qSlicerSpatialObjectsReaderOptionsWidget(QWidget* parentWidget)
+  : Superclass(parentWidget)
+  , d_ptr(new qSlicerSpatialObjectsReaderOptionsWidgetPrivate)
+{
+  Q_D(qSlicerSpatialObjectsReaderOptionsWidget);
+  d->setupUi(this);
+
+  d->ROISpinBoxes << d->ROIRMinSpinBox << d->ROIRMaxSpinBox
+                  << d->ROIAMinSpinBox << d->ROIAMaxSpinBox
+                  << d->ROISMinSpinBox << d->ROISMaxSpinBox;
+
+  QList<QCheckBox*> checkBoxes;
+  checkBoxes << d->TubeRadiusCheckBox << d->TangentsCheckBox
+             << d->MedialnessCheckBox << d->RidgenessCheckBox
+             << d->AdditionalArraysCheckBox;
+  foreach(QCheckBox* checkBox, checkBoxes)
+    {
+    connect(checkBox, SIGNAL(toggled(bool)),
+            this, SLOT(updateProperties()));
+    }
+  connect(d->MinimumNumberOfPointsSpinBox, SIGNAL(valueChanged(int)),
+          this, SLOT(updateProperties()));
+  connect(d->MinimumTubeLengthSpinBox, SIGNAL(valueChanged(double)),
+          this, SLOT(updateProperties()));
+  connect(d->DecimationToleranceSpinBox, SIGNAL(valueChanged(double)),
+          this, SLOT(updateProperties()));
+  connect(d->TubeIDsLineEdit, SIGNAL(textChanged(QString)),
+          this, SLOT(updateProperties()));
+  connect(d->ROIGroupBox, SIGNAL(toggled(bool)),
+          this, SLOT(updateProperties()));
+  foreach(QDoubleSpinBox* spinBox, d->ROISpinBoxes)
+    {
+    connect(spinBox, SIGNAL(valueChanged(double)),
+            this, SLOT(updateProperties()));
+    }
+
+  this->updateProperties();
+}
+
+//------------------------------------------------------------------------------
+qSlicerSpatialObjectsReaderOptionsWidget::
+~qSlicerSpatialObjectsReaderOptionsWidget()
+{}
+
+//------------------------------------------------------------------------------
+void qSlicerSpatialObjectsReaderOptionsWidget::updateProperties()
+{
+  Q_D(qSlicerSpatialObjectsReaderOptionsWidget);
+
+  int pointDataArrays = 0;
+  if (d->TubeRadiusCheckBox->isChecked())
+    {
+    pointDataArrays |= vtkSpatialObjectsTreReader::TubeRadiusArray;
+    }
+  if (d->TangentsCheckBox->isChecked())
+    {
+    pointDataArrays |= vtkSpatialObjectsTreReader::TangentArrays;
+    }
+  if (d->MedialnessCheckBox->isChecked())
+    {
+    pointDataArrays |= vtkSpatialObjectsTreReader::MedialnessArray;
+    }
+  if (d->RidgenessCheckBox->isChecked())
+    {
+    pointDataArrays |= vtkSpatialObjectsTreReader::RidgenessArray;
+    }
+  if (d->AdditionalArraysCheckBox->isChecked())
+    {
+    pointDataArrays |= vtkSpatialObjectsTreReader::AdditionalArrays;
+    }
+  this->Properties["pointDataArrays"] = pointDataArrays;
+  this->Properties["minimumNumberOfPoints"] =
+    d->MinimumNumberOfPointsSpinBox->value();
+  this->Properties["minimumTubeLength"] =
+    d->MinimumTubeLengthSpinBox->value();
+  this->Properties["decimationTolerance"] =
+    d->DecimationToleranceSpinBox->value();
+
+  QVariantList tubeIDs;
+  foreach(QString tubeID,
+          d->TubeIDsLineEdit->text().split(' ', QString::SkipEmptyParts))
+    {
+    bool ok = false;
+    const int id = tubeID.toInt(&ok);
+    if (ok)
+      {
+      tubeIDs << id;
+      }
+    }
+  if (!tubeIDs.isEmpty())
+    {
+    this->Properties["tubeIDs"] = tubeIDs;
+    }
+  else
+    {
+    this->Properties.remove("tubeIDs");
+    }
+
+  if (d->ROIGroupBox->isChecked())
+    {
+    QVariantList roi;
+    foreach(QDoubleSpinBox* spinBox, d->ROISpinBoxes)
+      {
+      roi << spinBox->value();
+      }
+    this->Properties["roi"] = roi;
+    }
+  else
+    {
+    this->Properties.remove("roi");
+    }
+}
@@ -0,0 +1,54 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qSlicerSpatialObjectsReaderOptionsWidget_h
+#define __qSlicerSpatialObjectsReaderOptionsWidget_h
+
+// SlicerQt includes
+#include "qSlicerIOOptionsWidget.h"
+
+class qSlicerSpatialObjectsReaderOptionsWidgetPrivate;
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_SpatialObjects
+/// Options of qSlicerSpatialObjectsReader: the point data arrays to load,
+/// the minimum number of points and length of the tubes, the decimation
+/// tolerance, the IDs of the tubes and the region of interest. They are
+/// set in the "pointDataArrays", "minimumNumberOfPoints",
+/// "minimumTubeLength", "decimationTolerance", "tubeIDs" and "roi"
+/// properties, see vtkMRMLSpatialObjectsStorageNode.
+class qSlicerSpatialObjectsReaderOptionsWidget : public qSlicerIOOptionsWidget
+{
+  Q_OBJECT
+
+public:
+  typedef qSlicerIOOptionsWidget Superclass;
+  qSlicerSpatialObjectsReaderOptionsWidget(QWidget *parent=0);
+  virtual ~qSlicerSpatialObjectsReaderOptionsWidget();
+
+protected slots:
+  void updateProperties();
+
+protected:
+  QScopedPointer<qSlicerSpatialObjectsReaderOptionsWidgetPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerSpatialObjectsReaderOptionsWidget);
+  Q_DISABLE_COPY(qSlicerSpatialObjectsReaderOptionsWidget);
+};
+
+#endif